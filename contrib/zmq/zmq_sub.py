@@ -15,6 +15,9 @@ zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashtxlock")
 zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawblock")
 zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawtx")
 zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawtxlock")
+zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawreceipts")
+zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"logs")
+zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"mempoolremove")
 zmqSubSocket.connect("tcp://127.0.0.1:%i" % port)
 
 try:
@@ -46,6 +49,15 @@ try:
         elif topic == "rawtxlock":
             print('- RAW TX LOCK ('+sequence+') -')
             print(binascii.hexlify(body).decode("utf-8"))
+        elif topic == "rawreceipts":
+            print('- RAW RECEIPTS ('+sequence+') -')
+            print(binascii.hexlify(body[31::-1]).decode("utf-8"))
+        elif topic == "logs":
+            print('- LOG ('+sequence+') -')
+            print(binascii.hexlify(body[76:96]).decode("utf-8"))
+        elif topic == "mempoolremove":
+            print('- MEMPOOL REMOVE ('+sequence+') -')
+            print(binascii.hexlify(body[:32]).decode("utf-8") + " reason " + str(bytearray(body)[32]))
 
 except KeyboardInterrupt:
     zmqContext.destroy()
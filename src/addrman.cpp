@@ -10,6 +10,8 @@
 #include "serialize.h"
 #include "streams.h"
 
+#include <algorithm>
+
 using namespace std;
 
 int CAddrInfo::GetTriedBucket(const uint256& nKey) const
@@ -68,6 +70,11 @@ double CAddrInfo::GetChance(int64_t nNow) const
     return fChance;
 }
 
+bool CAddrInfo::IsSelectable(int64_t nNow) const
+{
+    return nNow - nLastTry >= ADDRMAN_RETRY_INTERVAL && !IsTerrible(nNow);
+}
+
 CAddrInfo* CAddrMan::Find(const CNetAddr& addr, int* pnId)
 {
     std::map<CNetAddr, int>::iterator it = mapAddr.find(addr);
@@ -113,6 +120,35 @@ void CAddrMan::SwapRandom(unsigned int nRndPos1, unsigned int nRndPos2)
     vRandom[nRndPos2] = nId1;
 }
 
+/** Add or remove position nSlot of a table from the list of its occupied positions */
+static void UpdateSlots(std::vector<int>& vSlots, std::vector<int>& vSlotIndex, int nSlot, bool fOccupied)
+{
+    if ((vSlotIndex[nSlot] != -1) == fOccupied)
+        return;
+    if (fOccupied) {
+        vSlotIndex[nSlot] = vSlots.size();
+        vSlots.push_back(nSlot);
+    } else {
+        int nIndex = vSlotIndex[nSlot];
+        vSlots[nIndex] = vSlots.back();
+        vSlotIndex[vSlots[nIndex]] = nIndex;
+        vSlots.pop_back();
+        vSlotIndex[nSlot] = -1;
+    }
+}
+
+void CAddrMan::SetNew(int nUBucket, int nUBucketPos, int nId)
+{
+    UpdateSlots(vNewSlots, vNewSlotIndex, nUBucket * ADDRMAN_BUCKET_SIZE + nUBucketPos, nId != -1);
+    vvNew[nUBucket][nUBucketPos] = nId;
+}
+
+void CAddrMan::SetTried(int nKBucket, int nKBucketPos, int nId)
+{
+    UpdateSlots(vTriedSlots, vTriedSlotIndex, nKBucket * ADDRMAN_BUCKET_SIZE + nKBucketPos, nId != -1);
+    vvTried[nKBucket][nKBucketPos] = nId;
+}
+
 void CAddrMan::Delete(int nId)
 {
     assert(mapInfo.count(nId) != 0);
@@ -135,7 +171,7 @@ void CAddrMan::ClearNew(int nUBucket, int nUBucketPos)
         CAddrInfo& infoDelete = mapInfo[nIdDelete];
         assert(infoDelete.nRefCount > 0);
         infoDelete.nRefCount--;
-        vvNew[nUBucket][nUBucketPos] = -1;
+        SetNew(nUBucket, nUBucketPos, -1);
         if (infoDelete.nRefCount == 0) {
             Delete(nIdDelete);
         }
@@ -148,7 +184,7 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
     for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
         int pos = info.GetBucketPosition(nKey, true, bucket);
         if (vvNew[bucket][pos] == nId) {
-            vvNew[bucket][pos] = -1;
+            SetNew(bucket, pos, -1);
             info.nRefCount--;
         }
     }
@@ -169,7 +205,7 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
 
         // Remove the to-be-evicted item from the tried set.
         infoOld.fInTried = false;
-        vvTried[nKBucket][nKBucketPos] = -1;
+        SetTried(nKBucket, nKBucketPos, -1);
         nTried--;
 
         // find which new bucket it belongs to
@@ -180,12 +216,12 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
 
         // Enter it into the new set again.
         infoOld.nRefCount = 1;
-        vvNew[nUBucket][nUBucketPos] = nIdEvict;
+        SetNew(nUBucket, nUBucketPos, nIdEvict);
         nNew++;
     }
     assert(vvTried[nKBucket][nKBucketPos] == -1);
 
-    vvTried[nKBucket][nKBucketPos] = nId;
+    SetTried(nKBucket, nKBucketPos, nId);
     nTried++;
     info.fInTried = true;
 }
@@ -297,7 +333,7 @@ bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimeP
         if (fInsert) {
             ClearNew(nUBucket, nUBucketPos);
             pinfo->nRefCount++;
-            vvNew[nUBucket][nUBucketPos] = nId;
+            SetNew(nUBucket, nUBucketPos, nId);
         } else {
             if (pinfo->nRefCount == 0) {
                 Delete(nId);
@@ -326,45 +362,109 @@ void CAddrMan::Attempt_(const CService& addr, int64_t nTime)
     info.nAttempts++;
 }
 
-CAddress CAddrMan::Select_()
+CAddress CAddrMan::Select_(bool fSkipUnsuitable)
 {
     if (size() == 0)
         return CAddress();
 
+    stats.nSelects++;
+    int64_t nNow = GetAdjustedTime();
+
     // Use a 50% chance for choosing between tried and new table entries.
-    if (nTried > 0 && (nNew == 0 || GetRandInt(2) == 0)) {
-        // use a tried node
-        double fChanceFactor = 1.0;
-        while (1) {
-            int nKBucket = GetRandInt(ADDRMAN_TRIED_BUCKET_COUNT);
-            int nKBucketPos = GetRandInt(ADDRMAN_BUCKET_SIZE);
-            if (vvTried[nKBucket][nKBucketPos] == -1)
-                continue;
-            int nId = vvTried[nKBucket][nKBucketPos];
-            assert(mapInfo.count(nId) == 1);
-            CAddrInfo& info = mapInfo[nId];
-            if (GetRandInt(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
-                return info;
-            fChanceFactor *= 1.2;
+    bool fTried = nTried > 0 && (nNew == 0 || GetRandInt(2) == 0);
+    const std::vector<int>& vSlots = fTried ? vTriedSlots : vNewSlots;
+    const int* pTable = fTried ? &vvTried[0][0] : &vvNew[0][0];
+
+    // Draw among the occupied bucket positions only, so that a sparse table
+    // costs no empty draws. An entry in several "new" buckets keeps its larger
+    // chance of being drawn.
+    double fChanceFactor = 1.0;
+    for (int nDraw = 0; nDraw < ADDRMAN_SELECT_DRAWS; nDraw++) {
+        int nId = pTable[vSlots[GetRandInt(vSlots.size())]];
+        assert(mapInfo.count(nId) == 1);
+        CAddrInfo& info = mapInfo[nId];
+        stats.nDraws++;
+        if (fSkipUnsuitable && !info.IsSelectable(nNow)) {
+            stats.nSkipped++;
+            continue;
         }
-    } else {
-        // use a new node
-        double fChanceFactor = 1.0;
-        while (1) {
-            int nUBucket = GetRandInt(ADDRMAN_NEW_BUCKET_COUNT);
-            int nUBucketPos = GetRandInt(ADDRMAN_BUCKET_SIZE);
-            if (vvNew[nUBucket][nUBucketPos] == -1)
-                continue;
-            int nId = vvNew[nUBucket][nUBucketPos];
-            assert(mapInfo.count(nId) == 1);
-            CAddrInfo& info = mapInfo[nId];
-            if (GetRandInt(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
-                return info;
-            fChanceFactor *= 1.2;
+        if (GetRandInt(1 << 30) < fChanceFactor * info.GetChance(nNow) * (1 << 30))
+            return info;
+        fChanceFactor *= 1.2;
+    }
+
+    // Most entries are not worth trying right now: rather than keep drawing,
+    // choose among the suitable ones of both tables directly, or among all
+    // of them if there are none.
+    stats.nScans++;
+    std::vector<const CAddrInfo*> vCandidates;
+    for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
+        if (!fSkipUnsuitable || it->second.IsSelectable(nNow))
+            vCandidates.push_back(&it->second);
+    }
+    if (vCandidates.empty()) {
+        stats.nFallbacks++;
+        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++)
+            vCandidates.push_back(&it->second);
+    }
+    fChanceFactor = 1.0;
+    while (1) {
+        const CAddrInfo& info = *vCandidates[GetRandInt(vCandidates.size())];
+        if (GetRandInt(1 << 30) < fChanceFactor * info.GetChance(nNow) * (1 << 30))
+            return info;
+        fChanceFactor *= 1.2;
+    }
+}
+
+void CAddrMan::GetSnapshot(CAddrManSnapshot& snapshot) const
+{
+    LOCK(cs);
+
+    snapshot.nKey = nKey;
+    snapshot.vNew.clear();
+    snapshot.vNew.reserve(nNew);
+    snapshot.vTried.clear();
+    snapshot.vTried.reserve(nTried);
+    std::vector<int> vNewIds;
+    vNewIds.reserve(nNew);
+    for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
+        const CAddrInfo& info = it->second;
+        if (info.nRefCount) {
+            vNewIds.push_back(it->first);
+            snapshot.vNew.push_back(info);
+        }
+        if (info.fInTried)
+            snapshot.vTried.push_back(info);
+    }
+    assert((int)snapshot.vNew.size() == nNew);     // this means nNew was wrong, oh ow
+    assert((int)snapshot.vTried.size() == nTried); // this means nTried was wrong, oh ow
+
+    // vNewIds is sorted, as mapInfo is ordered by nId
+    snapshot.vNewBuckets.clear();
+    snapshot.vNewBuckets.reserve(ADDRMAN_NEW_BUCKET_COUNT + vNewSlots.size());
+    for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
+        int nSize = 0;
+        for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+            if (vvNew[bucket][i] != -1)
+                nSize++;
+        }
+        snapshot.vNewBuckets.push_back(nSize);
+        for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+            if (vvNew[bucket][i] != -1)
+                snapshot.vNewBuckets.push_back(std::lower_bound(vNewIds.begin(), vNewIds.end(), vvNew[bucket][i]) - vNewIds.begin());
         }
     }
 }
 
+CAddrManStats CAddrMan::GetStats() const
+{
+    LOCK(cs);
+    CAddrManStats statsRet = stats;
+    statsRet.nNew = nNew;
+    statsRet.nTried = nTried;
+    return statsRet;
+}
+
 #ifdef DEBUG_ADDRMAN
 int CAddrMan::Check_()
 {
@@ -439,6 +539,19 @@ int CAddrMan::Check_()
     if (nKey.IsNull())
         return -16;
 
+    for (unsigned int i = 0; i < vNewSlots.size(); i++) {
+        if (vNewSlotIndex[vNewSlots[i]] != (int)i || (&vvNew[0][0])[vNewSlots[i]] == -1)
+            return -20;
+    }
+    for (unsigned int i = 0; i < vTriedSlots.size(); i++) {
+        if (vTriedSlotIndex[vTriedSlots[i]] != (int)i || (&vvTried[0][0])[vTriedSlots[i]] == -1)
+            return -21;
+    }
+    if (vNewSlots.size() != (size_t)std::count_if(&vvNew[0][0], &vvNew[0][0] + ADDRMAN_NEW_BUCKET_COUNT * ADDRMAN_BUCKET_SIZE, [](int nId) { return nId != -1; }))
+        return -22;
+    if (vTriedSlots.size() != (size_t)std::count_if(&vvTried[0][0], &vvTried[0][0] + ADDRMAN_TRIED_BUCKET_COUNT * ADDRMAN_BUCKET_SIZE, [](int nId) { return nId != -1; }))
+        return -23;
+
     return 0;
 }
 #endif
@@ -100,6 +100,9 @@ public:
 
     //! Calculate the relative chance this entry should be given when selecting nodes to connect to
     double GetChance(int64_t nNow = GetAdjustedTime()) const;
+
+    //! Whether this entry is worth a connection attempt: neither terrible nor tried too recently
+    bool IsSelectable(int64_t nNow = GetAdjustedTime()) const;
 };
 
 /** Stochastic address manager
@@ -164,6 +167,68 @@ public:
 //! the maximum number of nodes to return in a getaddr call
 #define ADDRMAN_GETADDR_MAX 2500
 
+//! how long (in seconds) a selection that skips unsuitable entries leaves an address alone after trying it
+#define ADDRMAN_RETRY_INTERVAL (10 * 60)
+
+//! how many random draws a selection makes before choosing among the suitable entries directly
+#define ADDRMAN_SELECT_DRAWS 64
+
+/** Counters of the address manager's selections */
+struct CAddrManStats {
+    int nNew;
+    int nTried;
+    uint64_t nSelects;   //!< calls to Select
+    uint64_t nDraws;     //!< entries drawn at random
+    uint64_t nSkipped;   //!< drawn entries passed over as terrible or recently tried
+    uint64_t nScans;     //!< selections that ran out of draws and chose among the suitable entries directly
+    uint64_t nFallbacks; //!< selections that found no suitable entry and chose among all of them
+
+    CAddrManStats() : nNew(0), nTried(0), nSelects(0), nDraws(0), nSkipped(0), nScans(0), nFallbacks(0) {}
+};
+
+/**
+ * Everything peers.dat stores, copied out of the address manager. Taking the copy
+ * only needs a pass over the tables; building the serialized form, hashing and
+ * writing it then happen without holding up the threads that add, select and
+ * update addresses. Serializes to the format described at CAddrMan::Serialize.
+ */
+class CAddrManSnapshot
+{
+public:
+    uint256 nKey;
+    //! entries of the new table, in nId order
+    std::vector<CAddrInfo> vNew;
+    //! entries of the tried table, in nId order
+    std::vector<CAddrInfo> vTried;
+    //! for each new bucket its number of entries, followed by their indexes in vNew
+    std::vector<int> vNewBuckets;
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersionDummy) const
+    {
+        unsigned char nVersion = 1;
+        s << nVersion;
+        s << ((unsigned char)32);
+        s << nKey;
+        s << (int)vNew.size();
+        s << (int)vTried.size();
+
+        int nUBuckets = ADDRMAN_NEW_BUCKET_COUNT ^ (1 << 30);
+        s << nUBuckets;
+        for (std::vector<CAddrInfo>::const_iterator it = vNew.begin(); it != vNew.end(); it++)
+            s << *it;
+        for (std::vector<CAddrInfo>::const_iterator it = vTried.begin(); it != vTried.end(); it++)
+            s << *it;
+        for (std::vector<int>::const_iterator it = vNewBuckets.begin(); it != vNewBuckets.end(); it++)
+            s << *it;
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return (CSizeComputer(nType, nVersion) << *this).size();
+    }
+};
+
 /** 
  * Stochastical (IP) address manager 
  */
@@ -200,6 +265,19 @@ private:
     //! list of "new" buckets
     int vvNew[ADDRMAN_NEW_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE];
 
+    //! occupied positions of vvNew (bucket * ADDRMAN_BUCKET_SIZE + position), in no particular order
+    std::vector<int> vNewSlots;
+
+    //! index in vNewSlots of every position of vvNew, -1 when empty
+    std::vector<int> vNewSlotIndex;
+
+    //! occupied positions of vvTried and their indexes, like vNewSlots and vNewSlotIndex
+    std::vector<int> vTriedSlots;
+    std::vector<int> vTriedSlotIndex;
+
+    //! selection counters
+    CAddrManStats stats;
+
 protected:
     //! Find an entry.
     CAddrInfo* Find(const CNetAddr& addr, int* pnId = NULL);
@@ -211,6 +289,12 @@ protected:
     //! Swap two elements in vRandom.
     void SwapRandom(unsigned int nRandomPos1, unsigned int nRandomPos2);
 
+    //! Store nId (or -1 to empty it) at a position of the "new" table, keeping vNewSlots up to date.
+    void SetNew(int nUBucket, int nUBucketPos, int nId);
+
+    //! Store nId (or -1 to empty it) at a position of the "tried" table, keeping vTriedSlots up to date.
+    void SetTried(int nKBucket, int nKBucketPos, int nId);
+
     //! Move an entry from the "new" table(s) to the "tried" table
     void MakeTried(CAddrInfo& info, int nId);
 
@@ -230,8 +314,8 @@ protected:
     void Attempt_(const CService& addr, int64_t nTime);
 
     //! Select an address to connect to.
-    //! nUnkBias determines how much to favor new addresses over tried ones (min=0, max=100)
-    CAddress Select_();
+    //! fSkipUnsuitable passes over terrible and recently tried entries while there are others.
+    CAddress Select_(bool fSkipUnsuitable);
 
 #ifdef DEBUG_ADDRMAN
     //! Perform consistency check. Returns an error code or zero.
@@ -271,57 +355,17 @@ public:
      * This format is more complex, but significantly smaller (at most 1.5 MiB), and supports
      * changes to the ADDRMAN_ parameters without breaking the on-disk structure.
      *
+     * The lock is only held to take a CAddrManSnapshot, which is serialized after it is released.
+     *
      * We don't use ADD_SERIALIZE_METHODS since the serialization and deserialization code has
      * very little in common.
      */
     template <typename Stream>
     void Serialize(Stream& s, int nType, int nVersionDummy) const
     {
-        LOCK(cs);
-
-        unsigned char nVersion = 1;
-        s << nVersion;
-        s << ((unsigned char)32);
-        s << nKey;
-        s << nNew;
-        s << nTried;
-
-        int nUBuckets = ADDRMAN_NEW_BUCKET_COUNT ^ (1 << 30);
-        s << nUBuckets;
-        std::map<int, int> mapUnkIds;
-        int nIds = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
-            mapUnkIds[(*it).first] = nIds;
-            const CAddrInfo& info = (*it).second;
-            if (info.nRefCount) {
-                assert(nIds != nNew); // this means nNew was wrong, oh ow
-                s << info;
-                nIds++;
-            }
-        }
-        nIds = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
-            const CAddrInfo& info = (*it).second;
-            if (info.fInTried) {
-                assert(nIds != nTried); // this means nTried was wrong, oh ow
-                s << info;
-                nIds++;
-            }
-        }
-        for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
-            int nSize = 0;
-            for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
-                if (vvNew[bucket][i] != -1)
-                    nSize++;
-            }
-            s << nSize;
-            for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
-                if (vvNew[bucket][i] != -1) {
-                    int nIndex = mapUnkIds[vvNew[bucket][i]];
-                    s << nIndex;
-                }
-            }
-        }
+        CAddrManSnapshot snapshot;
+        GetSnapshot(snapshot);
+        s << snapshot;
     }
 
     template <typename Stream>
@@ -358,7 +402,7 @@ public:
                 int nUBucket = info.GetNewBucket(nKey);
                 int nUBucketPos = info.GetBucketPosition(nKey, true, nUBucket);
                 if (vvNew[nUBucket][nUBucketPos] == -1) {
-                    vvNew[nUBucket][nUBucketPos] = n;
+                    SetNew(nUBucket, nUBucketPos, n);
                     info.nRefCount++;
                 }
             }
@@ -378,7 +422,7 @@ public:
                 vRandom.push_back(nIdCount);
                 mapInfo[nIdCount] = info;
                 mapAddr[info] = nIdCount;
-                vvTried[nKBucket][nKBucketPos] = nIdCount;
+                SetTried(nKBucket, nKBucketPos, nIdCount);
                 nIdCount++;
             } else {
                 nLost++;
@@ -398,7 +442,7 @@ public:
                     int nUBucketPos = info.GetBucketPosition(nKey, true, bucket);
                     if (nVersion == 1 && nUBuckets == ADDRMAN_NEW_BUCKET_COUNT && vvNew[bucket][nUBucketPos] == -1 && info.nRefCount < ADDRMAN_NEW_BUCKETS_PER_ADDRESS) {
                         info.nRefCount++;
-                        vvNew[bucket][nUBucketPos] = nIndex;
+                        SetNew(bucket, nUBucketPos, nIndex);
                     }
                 }
             }
@@ -441,6 +485,10 @@ public:
                 vvTried[bucket][entry] = -1;
             }
         }
+        vNewSlots.clear();
+        vNewSlotIndex.assign(ADDRMAN_NEW_BUCKET_COUNT * ADDRMAN_BUCKET_SIZE, -1);
+        vTriedSlots.clear();
+        vTriedSlotIndex.assign(ADDRMAN_TRIED_BUCKET_COUNT * ADDRMAN_BUCKET_SIZE, -1);
 
         nIdCount = 0;
         nTried = 0;
@@ -464,6 +512,12 @@ public:
         return vRandom.size();
     }
 
+    //! Copy what peers.dat stores, holding the lock only for the copy.
+    void GetSnapshot(CAddrManSnapshot& snapshot) const;
+
+    //! Table sizes and selection counters.
+    CAddrManStats GetStats() const;
+
     //! Consistency check
     void Check()
     {
@@ -526,15 +580,16 @@ public:
 
     /**
      * Choose an address to connect to.
-     * nUnkBias determines how much "new" entries are favored over "tried" ones (0-100).
+     * With fSkipUnsuitable, entries that are terrible or were tried in the last
+     * ADDRMAN_RETRY_INTERVAL seconds are only returned when nothing else is left.
      */
-    CAddress Select()
+    CAddress Select(bool fSkipUnsuitable = false)
     {
         CAddress addrRet;
         {
             LOCK(cs);
             Check();
-            addrRet = Select_();
+            addrRet = Select_(fSkipUnsuitable);
             Check();
         }
         return addrRet;
@@ -0,0 +1,382 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2018 The Luxcore developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "crypto/common.h"
+#include "hash.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "script/script.h"
+#include "script/standard.h"
+
+#include <algorithm>
+
+namespace {
+
+/** Appends bits to a byte vector, most significant bit first. */
+class BitWriter
+{
+private:
+    std::vector<unsigned char>& m_out;
+    uint8_t m_buffer;
+    int m_offset;
+
+public:
+    explicit BitWriter(std::vector<unsigned char>& out) : m_out(out), m_buffer(0), m_offset(0) {}
+
+    ~BitWriter() { Flush(); }
+
+    /** Write the nbits least significant bits of data, 0 <= nbits <= 64. */
+    void Write(uint64_t data, int nbits)
+    {
+        while (nbits > 0) {
+            int bits = std::min(8 - m_offset, nbits);
+            m_buffer |= (data << (64 - nbits)) >> (64 - 8 + m_offset);
+            m_offset += bits;
+            nbits -= bits;
+            if (m_offset == 8)
+                Flush();
+        }
+    }
+
+    /** Write out the buffered bits, padding the last byte with zeros. */
+    void Flush()
+    {
+        if (m_offset == 0)
+            return;
+        m_out.push_back(m_buffer);
+        m_buffer = 0;
+        m_offset = 0;
+    }
+};
+
+/** Reads bits from a byte range, most significant bit first. */
+class BitReader
+{
+private:
+    const unsigned char* m_pos;
+    const unsigned char* m_end;
+    uint8_t m_buffer;
+    int m_offset;
+
+public:
+    BitReader(const unsigned char* begin, const unsigned char* end) : m_pos(begin), m_end(end), m_buffer(0), m_offset(8) {}
+
+    /** Read nbits bits as the least significant bits of the result, 0 <= nbits <= 64. */
+    uint64_t Read(int nbits)
+    {
+        uint64_t data = 0;
+        while (nbits > 0) {
+            if (m_offset == 8) {
+                if (m_pos == m_end)
+                    throw std::ios_base::failure("BitReader::Read(): end of data");
+                m_buffer = *m_pos++;
+                m_offset = 0;
+            }
+            int bits = std::min(8 - m_offset, nbits);
+            data <<= bits;
+            data |= static_cast<uint8_t>(m_buffer << m_offset) >> (8 - bits);
+            m_offset += bits;
+            nbits -= bits;
+        }
+        return data;
+    }
+
+    /** Whether every byte has been consumed; unread bits of the last byte are padding. */
+    bool AtEnd() const { return m_pos == m_end; }
+};
+
+/** Minimal stream over a byte range, for ReadCompactSize. */
+class ByteReader
+{
+private:
+    const unsigned char* m_pos;
+    const unsigned char* m_end;
+
+public:
+    ByteReader(const unsigned char* begin, const unsigned char* end) : m_pos(begin), m_end(end) {}
+
+    void read(char* pch, size_t nSize)
+    {
+        if ((size_t)(m_end - m_pos) < nSize)
+            throw std::ios_base::failure("ByteReader::read(): end of data");
+        memcpy(pch, m_pos, nSize);
+        m_pos += nSize;
+    }
+
+    const unsigned char* pos() const { return m_pos; }
+};
+
+class ByteWriter
+{
+private:
+    std::vector<unsigned char>& m_out;
+
+public:
+    explicit ByteWriter(std::vector<unsigned char>& out) : m_out(out) {}
+
+    void write(const char* pch, size_t nSize)
+    {
+        m_out.insert(m_out.end(), (const unsigned char*)pch, (const unsigned char*)pch + nSize);
+    }
+};
+
+void GolombRiceEncode(BitWriter& bitwriter, uint8_t P, uint64_t x)
+{
+    // Write quotient as unary-encoded: q 1's followed by one 0.
+    uint64_t q = x >> P;
+    while (q > 0) {
+        int nbits = q <= 64 ? static_cast<int>(q) : 64;
+        bitwriter.Write(~0ULL, nbits);
+        q -= nbits;
+    }
+    bitwriter.Write(0, 1);
+
+    // Write the remainder in P bits. Since the remainder is just the bottom
+    // P bits of x, there is no need to mask first.
+    bitwriter.Write(x, P);
+}
+
+uint64_t GolombRiceDecode(BitReader& bitreader, uint8_t P)
+{
+    // Read unary-encoded quotient: q 1's followed by one 0.
+    uint64_t q = 0;
+    while (bitreader.Read(1) == 1)
+        ++q;
+
+    uint64_t r = bitreader.Read(P);
+
+    return (q << P) + r;
+}
+
+/** Map a 64-bit hash uniformly into [0, n), as (x * n) >> 64. */
+uint64_t MapIntoRange(uint64_t x, uint64_t n)
+{
+    uint64_t x_hi = x >> 32;
+    uint64_t x_lo = x & 0xFFFFFFFF;
+    uint64_t n_hi = n >> 32;
+    uint64_t n_lo = n & 0xFFFFFFFF;
+
+    uint64_t ac = x_hi * n_hi;
+    uint64_t ad = x_hi * n_lo;
+    uint64_t bc = x_lo * n_hi;
+    uint64_t bd = x_lo * n_lo;
+
+    uint64_t mid34 = (bd >> 32) + (bc & 0xFFFFFFFF) + (ad & 0xFFFFFFFF);
+    return ac + (bc >> 32) + (ad >> 32) + (mid34 >> 32);
+}
+
+} // namespace
+
+uint64_t GCSFilter::HashToRange(const Element& element) const
+{
+    uint64_t hash = CSipHasher(m_params.m_siphash_k0, m_params.m_siphash_k1)
+        .Write(element.data(), element.size())
+        .Finalize();
+    return MapIntoRange(hash, m_F);
+}
+
+std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementSet& elements) const
+{
+    std::vector<uint64_t> hashed_elements;
+    hashed_elements.reserve(elements.size());
+    for (const Element& element : elements)
+        hashed_elements.push_back(HashToRange(element));
+    std::sort(hashed_elements.begin(), hashed_elements.end());
+    return hashed_elements;
+}
+
+GCSFilter::GCSFilter(const Params& params)
+    : m_params(params), m_N(0), m_F(0), m_encoded{0}
+{}
+
+GCSFilter::GCSFilter(const Params& params, const std::vector<unsigned char>& encoded_filter)
+    : m_params(params), m_encoded(encoded_filter)
+{
+    ByteReader stream(m_encoded.data(), m_encoded.data() + m_encoded.size());
+
+    uint64_t N = ReadCompactSize(stream);
+    m_N = static_cast<uint32_t>(N);
+    if (m_N != N)
+        throw std::ios_base::failure("N must be <2^32");
+    m_F = static_cast<uint64_t>(m_N) * static_cast<uint64_t>(m_params.m_M);
+
+    // Verify that the encoded filter contains exactly N elements. If it has too much or too little
+    // data, a std::ios_base::failure exception will be raised.
+    BitReader bitreader(stream.pos(), m_encoded.data() + m_encoded.size());
+    for (uint64_t i = 0; i < m_N; ++i)
+        GolombRiceDecode(bitreader, m_params.m_P);
+    if (!bitreader.AtEnd())
+        throw std::ios_base::failure("encoded_filter contains excess data");
+}
+
+GCSFilter::GCSFilter(const Params& params, const ElementSet& elements)
+    : m_params(params)
+{
+    size_t N = elements.size();
+    m_N = static_cast<uint32_t>(N);
+    if (m_N != N)
+        throw std::invalid_argument("N must be <2^32");
+    m_F = static_cast<uint64_t>(m_N) * static_cast<uint64_t>(m_params.m_M);
+
+    ByteWriter stream(m_encoded);
+    WriteCompactSize(stream, m_N);
+
+    if (elements.empty())
+        return;
+
+    BitWriter bitwriter(m_encoded);
+
+    uint64_t last_value = 0;
+    for (uint64_t value : BuildHashedSet(elements)) {
+        uint64_t delta = value - last_value;
+        GolombRiceEncode(bitwriter, m_params.m_P, delta);
+        last_value = value;
+    }
+
+    bitwriter.Flush();
+}
+
+bool GCSFilter::MatchInternal(const uint64_t* element_hashes, size_t size) const
+{
+    ByteReader stream(m_encoded.data(), m_encoded.data() + m_encoded.size());
+
+    // Seek forward by size of N
+    uint64_t N = ReadCompactSize(stream);
+    assert(N == m_N);
+
+    BitReader bitreader(stream.pos(), m_encoded.data() + m_encoded.size());
+
+    uint64_t value = 0;
+    size_t hashes_index = 0;
+    for (uint32_t i = 0; i < m_N; ++i) {
+        uint64_t delta = GolombRiceDecode(bitreader, m_params.m_P);
+        value += delta;
+
+        while (true) {
+            if (hashes_index == size) {
+                return false;
+            } else if (element_hashes[hashes_index] == value) {
+                return true;
+            } else if (element_hashes[hashes_index] > value) {
+                break;
+            }
+
+            hashes_index++;
+        }
+    }
+
+    return false;
+}
+
+bool GCSFilter::Match(const Element& element) const
+{
+    uint64_t query = HashToRange(element);
+    return MatchInternal(&query, 1);
+}
+
+bool GCSFilter::MatchAny(const ElementSet& elements) const
+{
+    const std::vector<uint64_t> queries = BuildHashedSet(elements);
+    return MatchInternal(queries.data(), queries.size());
+}
+
+std::string BlockFilterTypeName(BlockFilterType filter_type)
+{
+    switch (filter_type) {
+    case BLOCK_FILTER_BASIC: return "basic";
+    default: return "";
+    }
+}
+
+bool BlockFilterTypeByName(const std::string& name, BlockFilterType& filter_type)
+{
+    if (name == BlockFilterTypeName(BLOCK_FILTER_BASIC)) {
+        filter_type = BLOCK_FILTER_BASIC;
+        return true;
+    }
+    return false;
+}
+
+static GCSFilter::ElementSet BasicFilterElements(const CBlock& block, const CBlockUndo& block_undo)
+{
+    GCSFilter::ElementSet elements;
+
+    for (const CTransaction& tx : block.vtx) {
+        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+            const CScript& script = tx.vout[i].scriptPubKey;
+            if (script.empty() || script[0] == OP_RETURN)
+                continue;
+            elements.emplace(script.begin(), script.end());
+
+            // Contract outputs are also matched by the address of the contract
+            if (script.HasOpCreate() || script.HasOpCall()) {
+                CTxDestination dest;
+                if (ExtractDestination(COutPoint(tx.GetHash(), i), script, dest) && dest.type() == typeid(CKeyID)) {
+                    const CKeyID& contract = boost::get<CKeyID>(dest);
+                    elements.emplace(contract.begin(), contract.end());
+                }
+            }
+        }
+    }
+
+    for (const CTxUndo& tx_undo : block_undo.vtxundo) {
+        for (const CTxInUndo& prevout : tx_undo.vprevout) {
+            const CScript& script = prevout.txout.scriptPubKey;
+            if (script.empty())
+                continue;
+            elements.emplace(script.begin(), script.end());
+        }
+    }
+
+    return elements;
+}
+
+BlockFilter::BlockFilter(BlockFilterType filter_type, const uint256& block_hash,
+                         const std::vector<unsigned char>& filter)
+    : m_filter_type(filter_type), m_block_hash(block_hash)
+{
+    GCSFilter::Params params;
+    if (!BuildParams(params))
+        throw std::invalid_argument("unknown filter_type");
+    m_filter = GCSFilter(params, filter);
+}
+
+BlockFilter::BlockFilter(BlockFilterType filter_type, const uint256& block_hash, const CBlock& block,
+                         const CBlockUndo& block_undo)
+    : m_filter_type(filter_type), m_block_hash(block_hash)
+{
+    GCSFilter::Params params;
+    if (!BuildParams(params))
+        throw std::invalid_argument("unknown filter_type");
+    m_filter = GCSFilter(params, BasicFilterElements(block, block_undo));
+}
+
+bool BlockFilter::BuildParams(GCSFilter::Params& params) const
+{
+    switch (m_filter_type) {
+    case BLOCK_FILTER_BASIC:
+        params.m_siphash_k0 = ReadLE64(m_block_hash.begin());
+        params.m_siphash_k1 = ReadLE64(m_block_hash.begin() + 8);
+        params.m_P = BASIC_FILTER_P;
+        params.m_M = BASIC_FILTER_M;
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint256 BlockFilter::GetHash() const
+{
+    const std::vector<unsigned char>& data = GetEncodedFilter();
+    return Hash(data.begin(), data.end());
+}
+
+uint256 BlockFilter::ComputeHeader(const uint256& prev_header) const
+{
+    const uint256& filter_hash = GetHash();
+    return Hash(filter_hash.begin(), filter_hash.end(), prev_header.begin(), prev_header.end());
+}
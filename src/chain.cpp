@@ -69,6 +69,31 @@ CBlockIndex* CChain::FindEarliestAtLeast(int64_t nTime) const
     return (lower == vChain.end() ? nullptr : *lower);
 }
 
+/**
+ * CChainSnapshot implementation
+ */
+CChainSnapshot::CChainSnapshot(const CChain& chain, const CChainSnapshot* prev) : nHeight(chain.Height())
+{
+    int nSegments = (nHeight + SEGMENT_SIZE) / SEGMENT_SIZE;
+    vSegments.reserve(nSegments);
+    for (int i = 0; i < nSegments; i++) {
+        int nStart = i * SEGMENT_SIZE;
+        int nEnd = std::min(nStart + SEGMENT_SIZE, nHeight + 1);
+        // A segment whose last block is unchanged holds the same ancestors
+        if (prev && i < (int)prev->vSegments.size()) {
+            const std::shared_ptr<const Segment>& old = prev->vSegments[i];
+            if ((int)old->size() == nEnd - nStart && old->back() == chain[nEnd - 1]) {
+                vSegments.push_back(old);
+                continue;
+            }
+        }
+        std::shared_ptr<Segment> segment = std::make_shared<Segment>();
+        segment->reserve(nEnd - nStart);
+        for (int nHeightIn = nStart; nHeightIn < nEnd; nHeightIn++)
+            segment->push_back(chain[nHeightIn]);
+        vSegments.push_back(segment);
+    }
+}
 
 uint256 CBlockIndex::GetBlockTrust() const
 {
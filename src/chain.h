@@ -14,6 +14,7 @@
 #include "uint256.h"
 #include "util.h"
 
+#include <memory>
 #include <vector>
 
 #include <boost/lexical_cast.hpp>
@@ -591,4 +592,63 @@ public:
     CBlockIndex* FindEarliestAtLeast(int64_t nTime) const;
 };
 
+/**
+ * Immutable copy of an active chain, for readers that do not hold cs_main.
+ * Heights are stored in fixed-size segments shared between successive
+ * snapshots, so taking a new one after a few blocks only copies the last segment.
+ */
+class CChainSnapshot
+{
+private:
+    static const int SEGMENT_SIZE = 4096;
+
+    typedef std::vector<CBlockIndex*> Segment;
+
+    std::vector<std::shared_ptr<const Segment> > vSegments;
+    int nHeight;
+
+public:
+    CChainSnapshot() : nHeight(-1) {}
+
+    /** Copy chain, reusing the segments of prev (which may be NULL) that still match it. */
+    CChainSnapshot(const CChain& chain, const CChainSnapshot* prev);
+
+    CBlockIndex* Genesis() const
+    {
+        return (*this)[0];
+    }
+
+    CBlockIndex* Tip() const
+    {
+        return (*this)[nHeight];
+    }
+
+    CBlockIndex* operator[](int nHeightIn) const
+    {
+        if (nHeightIn < 0 || nHeightIn > nHeight)
+            return NULL;
+        return (*vSegments[nHeightIn / SEGMENT_SIZE])[nHeightIn % SEGMENT_SIZE];
+    }
+
+    bool Contains(const CBlockIndex* pindex) const
+    {
+        return (*this)[pindex->nHeight] == pindex;
+    }
+
+    CBlockIndex* Next(const CBlockIndex* pindex) const
+    {
+        if (Contains(pindex))
+            return (*this)[pindex->nHeight + 1];
+        else
+            return NULL;
+    }
+
+    int Height() const
+    {
+        return nHeight;
+    }
+};
+
+typedef std::shared_ptr<const CChainSnapshot> CChainSnapshotRef;
+
 #endif // BITCOIN_CHAIN_H
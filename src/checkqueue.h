@@ -7,7 +7,13 @@
 #ifndef BITCOIN_CHECKQUEUE_H
 #define BITCOIN_CHECKQUEUE_H
 
+#include "sync.h"
+#include "utiltime.h"
+
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -17,7 +23,58 @@
 template <typename T>
 class CCheckQueueControl;
 
-/** 
+/**
+ * Run one worker's batch of verifications, stopping at the first failure.
+ * Types that can share work across a batch (see CScriptCheck) provide their
+ * own overload, which is found through argument-dependent lookup.
+ */
+template <typename T>
+bool RunCheckBatch(std::vector<T>& vChecks)
+{
+    for (T& check : vChecks)
+        if (!check())
+            return false;
+    return true;
+}
+
+/** Statistics about the work done by a CCheckQueue between two calls to Wait(). */
+struct CCheckQueueStats
+{
+    //! Number of threads that ran at least one check, including the master
+    unsigned int nActive;
+    //! Number of threads registered with the queue, including the master
+    unsigned int nThreads;
+    //! Number of checks that were added
+    uint64_t nChecks;
+    //! Number of times a thread took work from another thread's deque
+    uint64_t nSteals;
+    //! Microseconds from the first Add() to the end of Wait()
+    int64_t nWallTime;
+    //! Sum of the microseconds each check spent queued before a thread picked it up
+    int64_t nQueueWait;
+    //! Microseconds the master spent blocked in Wait() for the workers to finish
+    int64_t nMasterWait;
+    //! Sum over all threads of the microseconds spent running checks
+    int64_t nBusyTotal;
+    //! Largest busy time of a single thread
+    int64_t nBusyMax;
+
+    CCheckQueueStats() : nActive(0), nThreads(0), nChecks(0), nSteals(0), nWallTime(0), nQueueWait(0), nMasterWait(0), nBusyTotal(0), nBusyMax(0) {}
+
+    //! Fraction of the available thread time that was spent running checks
+    double Utilization() const
+    {
+        return (nWallTime > 0 && nThreads > 0) ? (double)nBusyTotal / ((double)nWallTime * nThreads) : 0.0;
+    }
+
+    //! Busiest thread relative to the average active thread (1.0 = perfectly balanced)
+    double Imbalance() const
+    {
+        return (nBusyTotal > 0 && nActive > 0) ? (double)nBusyMax * nActive / nBusyTotal : 1.0;
+    }
+};
+
+/**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
   * operator(), returning a bool.
@@ -26,12 +83,40 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every thread owns a deque. The master spreads new work over the deques
+  * of all threads, each protected by its own mutex, so adding work never
+  * contends on a queue-wide lock. A thread takes work from the back of its
+  * own deque and, once that is empty, steals half of the front of another
+  * thread's deque. The queue-wide mutex is only used to put idle threads to
+  * sleep and wake them up again.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    /** Work owned by a single thread. */
+    struct WorkDeque
+    {
+        boost::mutex mutex;
+        std::deque<T> checks;
+        //! Time (in microseconds) each check in checks was added
+        std::deque<int64_t> times;
+        //! Per-session statistics of the owning thread
+        std::atomic<int64_t> nBusy;
+        std::atomic<int64_t> nQueueWait;
+        std::atomic<uint64_t> nSteals;
+
+        WorkDeque() : nBusy(0), nQueueWait(0), nSteals(0) {}
+    };
+
+    //! Deques of the master (index 0) and the workers, allocated up front so they never move
+    std::vector<std::unique_ptr<WorkDeque> > vDeques;
+
+    //! Number of entries of vDeques in use
+    std::atomic<unsigned int> nThreads;
+
+    //! Mutex used to sleep and wake up idle threads
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -40,91 +125,169 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! The number of workers that are (about to be) asleep.
+    std::atomic<int> nIdle;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! Whether the master is (about to be) asleep.
+    std::atomic<bool> fMasterIdle;
 
-    //! The total number of workers (including the master).
-    int nTotal;
-
-    //! The temporary evaluation result.
-    bool fAllOk;
+    //! Number of checks sitting in the deques.
+    std::atomic<unsigned int> nQueued;
 
     /**
      * Number of verifications that haven't completed yet.
-     * This includes elements that are not anymore in queue, but still in
-     * worker's own batches.
+     * This includes elements that are not anymore in a deque, but still in
+     * a thread's own batch.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
+
+    //! The temporary evaluation result. Once it is false, remaining checks are skipped.
+    std::atomic<bool> fAllOk;
 
     //! Whether we're shutting down.
-    bool fQuit;
+    std::atomic<bool> fQuit;
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! Deque the master fills next (only touched by the master)
+    unsigned int nNextDeque;
+
+    //! Session bookkeeping, only touched by the master
+    int64_t nSessionStart;
+    uint64_t nSessionChecks;
+    int64_t nMasterWait;
+    CCheckQueueStats lastStats;
+
+    /** Move up to nMax checks from the front or back of q into vChecks. Requires q.mutex. */
+    int64_t TakeLocked(WorkDeque& q, std::vector<T>& vChecks, unsigned int nMax, bool fFront, int64_t nNow)
+    {
+        unsigned int nTake = std::min<unsigned int>(nMax, q.checks.size());
+        int64_t nWait = 0;
+        for (unsigned int i = 0; i < nTake; i++) {
+            vChecks.push_back(T());
+            if (fFront) {
+                vChecks.back().swap(q.checks.front());
+                q.checks.pop_front();
+                nWait += nNow - q.times.front();
+                q.times.pop_front();
+            } else {
+                vChecks.back().swap(q.checks.back());
+                q.checks.pop_back();
+                nWait += nNow - q.times.back();
+                q.times.pop_back();
+            }
+        }
+        nQueued -= nTake;
+        return nWait;
+    }
+
+    /** Fill vChecks from our own deque, or steal from another thread. */
+    bool TakeWork(unsigned int nSelf, std::vector<T>& vChecks)
+    {
+        WorkDeque& self = *vDeques[nSelf];
+        int64_t nNow = GetTimeMicros();
+        {
+            boost::unique_lock<boost::mutex> lock(self.mutex);
+            if (!self.checks.empty()) {
+                // Leave part of the deque to be stolen by others
+                unsigned int nMax = std::max<unsigned int>(1, std::min<unsigned int>(nBatchSize, (self.checks.size() + 1) / 2));
+                self.nQueueWait += TakeLocked(self, vChecks, nMax, false, nNow);
+                return true;
+            }
+        }
+        const unsigned int n = nThreads;
+        for (unsigned int i = 1; i < n && nQueued > 0; i++) {
+            WorkDeque& victim = *vDeques[(nSelf + i) % n];
+            boost::unique_lock<boost::mutex> lock(victim.mutex, boost::try_to_lock);
+            if (!lock.owns_lock() || victim.checks.empty())
+                continue;
+            unsigned int nMax = std::max<unsigned int>(1, std::min<unsigned int>(nBatchSize, victim.checks.size() / 2));
+            self.nQueueWait += TakeLocked(victim, vChecks, nMax, true, nNow);
+            self.nSteals++;
+            return true;
+        }
+        return false;
+    }
+
     /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    bool Loop(unsigned int nSelf, bool fMaster = false)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        WorkDeque& self = *vDeques[nSelf];
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master he can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
+            if (!TakeWork(nSelf, vChecks)) {
+                if (nQueued > 0)
+                    // Someone else holds the deque that has work; retry
+                    continue;
+                if (fMaster) {
+                    if (nTodo == 0)
+                        break;
+                    // Wait for the workers to finish the checks they hold.
+                    // fMasterIdle and nTodo are seq_cst, so either we see
+                    // the last decrement or the worker sees us waiting.
+                    int64_t nStart = GetTimeMicros();
+                    boost::unique_lock<boost::mutex> lock(mutex);
+                    fMasterIdle = true;
+                    while (nTodo > 0)
+                        condMaster.wait(lock);
+                    fMasterIdle = false;
+                    nMasterWait += GetTimeMicros() - nStart;
+                    break;
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                // Same pattern between nIdle here and nQueued in Add().
+                boost::unique_lock<boost::mutex> lock(mutex);
+                nIdle++;
+                while (nQueued == 0 && !fQuit)
+                    condWorker.wait(lock);
+                nIdle--;
+                if (fQuit)
+                    return fAllOk;
+                continue;
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
+
+            // execute work, unless an earlier check already failed
+            if (fAllOk) {
+                int64_t nStart = GetTimeMicros();
+                if (!RunCheckBatch(vChecks))
+                    fAllOk = false;
+                self.nBusy += GetTimeMicros() - nStart;
+            }
+            unsigned int nNow = vChecks.size();
             vChecks.clear();
+            if (nTodo.fetch_sub(nNow) == nNow && !fMaster && fMasterIdle) {
+                // We processed the last element; inform the master it can exit and return the result
+                boost::unique_lock<boost::mutex> lock(mutex);
+                condMaster.notify_one();
+            }
         } while (true);
+
+        // All work is done; collect the statistics of this session and reset for new work later
+        CCheckQueueStats stats;
+        const unsigned int n = nThreads;
+        stats.nThreads = n;
+        stats.nChecks = nSessionChecks;
+        stats.nWallTime = nSessionStart ? GetTimeMicros() - nSessionStart : 0;
+        stats.nMasterWait = nMasterWait;
+        for (unsigned int i = 0; i < n; i++) {
+            WorkDeque& q = *vDeques[i];
+            int64_t nBusy = q.nBusy.exchange(0);
+            stats.nQueueWait += q.nQueueWait.exchange(0);
+            stats.nSteals += q.nSteals.exchange(0);
+            stats.nBusyTotal += nBusy;
+            stats.nBusyMax = std::max(stats.nBusyMax, nBusy);
+            if (nBusy > 0)
+                stats.nActive++;
+        }
+        lastStats = stats;
+        nSessionStart = 0;
+        nSessionChecks = 0;
+        nMasterWait = 0;
+
+        bool fRet = fAllOk;
+        fAllOk = true;
+        return fRet;
     }
 
 public:
@@ -132,34 +295,73 @@ public:
     //! Mutex to ensure only one concurrent CCheckQueueControl
     boost::mutex ControlMutex;
 
-    //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    //! Create a new check queue that can be served by up to nMaxThreadsIn threads (including the master)
+    CCheckQueue(unsigned int nBatchSizeIn, unsigned int nMaxThreadsIn = 128) : nThreads(1), nIdle(0), fMasterIdle(false), nQueued(0), nTodo(0), fAllOk(true), fQuit(false), nBatchSize(nBatchSizeIn), nNextDeque(0), nSessionStart(0), nSessionChecks(0), nMasterWait(0)
+    {
+        vDeques.resize(std::max(1U, nMaxThreadsIn));
+        for (std::unique_ptr<WorkDeque>& q : vDeques)
+            q.reset(new WorkDeque());
+    }
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        unsigned int nSelf = nThreads.fetch_add(1);
+        if (nSelf >= vDeques.size()) {
+            // No deque left for this thread; it would have nothing to do
+            nThreads--;
+            return;
+        }
+        Loop(nSelf);
     }
 
     //! Wait until execution finishes, and return whether all evaluations where successful.
     bool Wait()
     {
-        return Loop(true);
+        return Loop(0, true);
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty())
+            return;
+        int64_t nNow = GetTimeMicros();
+        if (!nSessionStart)
+            nSessionStart = nNow;
+        nSessionChecks += vChecks.size();
+
+        // Count the work before it becomes visible, so nTodo can't drop to zero early
         nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+
+        // Spread the checks over the deques in contiguous chunks
+        const unsigned int n = nThreads;
+        unsigned int nChunk = std::max<unsigned int>(1, (vChecks.size() + n - 1) / n);
+        for (size_t nPos = 0; nPos < vChecks.size(); nPos += nChunk) {
+            WorkDeque& q = *vDeques[nNextDeque++ % n];
+            size_t nEnd = std::min(vChecks.size(), nPos + nChunk);
+            boost::unique_lock<boost::mutex> lock(q.mutex);
+            for (size_t i = nPos; i < nEnd; i++) {
+                q.checks.push_back(T());
+                vChecks[i].swap(q.checks.back());
+                q.times.push_back(nNow);
+            }
+            nQueued += nEnd - nPos;
+        }
+
+        if (nIdle > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (vChecks.size() == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
+        }
+    }
+
+    //! Statistics of the last completed Wait()
+    const CCheckQueueStats& GetStats() const
+    {
+        return lastStats;
     }
 
     ~CCheckQueue()
@@ -168,7 +370,7 @@ public:
 
 };
 
-/** 
+/**
  * RAII-style controller object for a CCheckQueue that guarantees the passed
  * queue is finished before continuing.
  */
@@ -207,6 +409,14 @@ public:
             pqueue->Add(vChecks);
     }
 
+    //! Statistics of the checks run through this controller, valid after Wait()
+    CCheckQueueStats GetStats() const
+    {
+        if (pqueue == NULL || !fDone)
+            return CCheckQueueStats();
+        return pqueue->GetStats();
+    }
+
     ~CCheckQueueControl()
     {
         if (!fDone)
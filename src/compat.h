@@ -100,4 +100,8 @@ bool static inline IsSelectableSocket(SOCKET s)
 #endif
 }
 
+#if defined(HAVE_SYS_EPOLL_H) && !defined(WIN32)
+#define USE_EPOLL
+#endif
+
 #endif // BITCOIN_COMPAT_H
@@ -30,6 +30,7 @@
 #include <libdevcore/SHA3.h>
 #include <libdevcore/MemoryDB.h>
 #include <libdevcore/TrieDB.h>
+#include <libdevcore/Word256.h>
 #include <libdevcrypto/Common.h>
 #include <libdevcrypto/CryptoPP.h>
 using namespace std;
@@ -42,6 +43,8 @@ void help()
 		<< "Usage bench <mode> [OPTIONS]" << endl
 		<< "Modes:" << endl
 		<< "    trie  Trie benchmarks." << endl
+		<< "    sha3  Keccak-256 benchmarks." << endl
+		<< "    word256  EVM arithmetic on Boost u256 against Word256." << endl
 		<< endl
 		<< "General options:" << endl
 		<< "    -h,--help  Print this help message and exit." << endl
@@ -81,7 +84,8 @@ void setDefaultOrCLocale()
 
 enum class Mode {
 	Trie,
-	SHA3
+	SHA3,
+	Word256
 };
 
 enum class Alphabet
@@ -146,6 +150,65 @@ private:
 	}
 };
 
+/// The bodies of the interpreter's PUSH32, ADD, SUB, MUL, DIV, MOD, MSTORE and MLOAD
+/// cases on a u256 stack, computed directly with Boost.
+struct BoostOps
+{
+	static void push32(u256*& _sp, byte const* _code)
+	{
+		*++_sp = 0;
+		for (unsigned i = 0; i < 32; ++i)
+			*_sp = (*_sp << 8) | _code[i];
+	}
+	static void add(u256*& _sp) { *(_sp - 1) += *_sp; --_sp; }
+	static void sub(u256*& _sp) { *(_sp - 1) = *_sp - *(_sp - 1); --_sp; }
+	static void mul(u256*& _sp) { *(_sp - 1) *= *_sp; --_sp; }
+	static void div(u256*& _sp) { *(_sp - 1) = *(_sp - 1) ? u256(s512(*_sp) / s512(*(_sp - 1))) : 0; --_sp; }
+	static void mod(u256*& _sp) { *(_sp - 1) = *(_sp - 1) ? u256(s512(*_sp) % s512(*(_sp - 1))) : 0; --_sp; }
+	static void mstore(u256*& _sp, byte* _mem) { *(h256*)_mem = (h256)*_sp; --_sp; }
+	static void mload(u256*& _sp, byte const* _mem) { *++_sp = (u256)*(h256 const*)_mem; }
+};
+
+/// The same cases converting each operand to Word256 and back, as libevm/VM.cpp does.
+struct Word256Ops
+{
+	static void push32(u256*& _sp, byte const* _code) { *++_sp = Word256::loadBigEndian(_code, 32).toU256(); }
+	static void add(u256*& _sp) { *(_sp - 1) = (Word256::fromU256(*(_sp - 1)) + Word256::fromU256(*_sp)).toU256(); --_sp; }
+	static void sub(u256*& _sp) { *(_sp - 1) = (Word256::fromU256(*_sp) - Word256::fromU256(*(_sp - 1))).toU256(); --_sp; }
+	static void mul(u256*& _sp) { *(_sp - 1) = (Word256::fromU256(*(_sp - 1)) * Word256::fromU256(*_sp)).toU256(); --_sp; }
+	static void div(u256*& _sp) { *(_sp - 1) = (Word256::fromU256(*_sp) / Word256::fromU256(*(_sp - 1))).toU256(); --_sp; }
+	static void mod(u256*& _sp) { *(_sp - 1) = (Word256::fromU256(*_sp) % Word256::fromU256(*(_sp - 1))).toU256(); --_sp; }
+	static void mstore(u256*& _sp, byte* _mem) { Word256::fromU256(*_sp).storeBigEndian(_mem); --_sp; }
+	static void mload(u256*& _sp, byte const* _mem) { *++_sp = Word256::loadBigEndian(_mem).toU256(); }
+};
+
+/// An arithmetic-heavy contract body: for every pair of 32 byte immediates a, b in _code,
+/// x = b / (a - (x + a) * b) % a, spilled to memory and reloaded once per pair.
+template <class Ops> u256 arithmeticLoop(bytes const& _code)
+{
+	u256 stack[4];
+	u256* sp = stack;
+	byte mem[32] = {0};
+	for (size_t pc = 0; pc + 64 <= _code.size(); pc += 64)
+	{
+		byte const* a = _code.data() + pc;
+		byte const* b = a + 32;
+		Ops::push32(sp, a);
+		Ops::add(sp);
+		Ops::push32(sp, b);
+		Ops::mul(sp);
+		Ops::push32(sp, a);
+		Ops::sub(sp);
+		Ops::push32(sp, b);
+		Ops::div(sp);
+		Ops::push32(sp, a);
+		Ops::mod(sp);
+		Ops::mstore(sp, mem);
+		Ops::mload(sp, mem);
+	}
+	return *sp;
+}
+
 int main(int argc, char** argv)
 {
 	setDefaultOrCLocale();
@@ -160,6 +223,8 @@ int main(int argc, char** argv)
 			mode = Mode::Trie;
 		else if (arg == "sha3")
 			mode = Mode::SHA3;
+		else if (arg == "word256")
+			mode = Mode::Word256;
 		else if (arg == "-V" || arg == "--version")
 			version();
 	}
@@ -201,6 +266,74 @@ int main(int argc, char** argv)
 				s = sha3(s);
 		}
 		cout << "sha3 x 1000: " << t.elapsed() / trials * 1000000 << "us " << endl;
+
+		// The Keccak-f permutations on 32 byte inputs, as for trie keys: the portable
+		// reference, the one sha3AutoDetect() picked, and the batched interface.
+		string algo = sha3AutoDetect();
+		unsigned const count = 20000;
+		vector<h256> data(count);
+		for (unsigned i = 1; i < count; ++i)
+			data[i] = sha3(data[i - 1]);
+		vector<bytesConstRef> inputs;
+		for (h256 const& d: data)
+			inputs.push_back(d.ref());
+		vector<h256> outputs(count);
+		h256 check;
+
+		Timer portable;
+		for (unsigned trial = 0; trial < trials; ++trial)
+			for (unsigned i = 0; i < count; ++i)
+				sha3Portable(inputs[i], check.ref());
+		double portableTime = portable.elapsed();
+
+		Timer scalar;
+		for (unsigned trial = 0; trial < trials; ++trial)
+			for (unsigned i = 0; i < count; ++i)
+				outputs[i] = sha3(inputs[i]);
+		double scalarTime = scalar.elapsed();
+
+		Timer batch;
+		for (unsigned trial = 0; trial < trials; ++trial)
+			sha3(inputs.data(), outputs.data(), count);
+		double batchTime = batch.elapsed();
+
+		if (outputs[count - 1] != check)
+			cerr << "sha3 " << algo << " differs from the portable implementation" << endl;
+		cout << "keccak " << algo << ", " << count << " x 32 bytes: portable " << portableTime / trials * 1000000
+			<< "us, scalar " << scalarTime / trials * 1000000 << "us, batch " << batchTime / trials * 1000000 << "us" << endl;
+	}
+	else if (mode == Mode::Word256)
+	{
+		// Immediates with a random number of leading zero bytes, so that both the single
+		// limb and the multi-limb division paths are taken.
+		unsigned const pairs = 10000;
+		bytes code;
+		h256 seed;
+		for (unsigned i = 0; i < pairs * 2; ++i)
+		{
+			seed = sha3(seed);
+			h256 imm = seed;
+			memset(imm.data(), 0, seed[0] % 32);
+			code += imm.asBytes();
+		}
+
+		unsigned trials = 50;
+		u256 boostResult;
+		Timer boostTimer;
+		for (unsigned trial = 0; trial < trials; ++trial)
+			boostResult = arithmeticLoop<BoostOps>(code);
+		double boostTime = boostTimer.elapsed();
+
+		u256 wordResult;
+		Timer wordTimer;
+		for (unsigned trial = 0; trial < trials; ++trial)
+			wordResult = arithmeticLoop<Word256Ops>(code);
+		double wordTime = wordTimer.elapsed();
+
+		if (boostResult != wordResult)
+			cerr << "Word256 result differs from u256" << endl;
+		cout << "evm arithmetic, " << pairs << " rounds: u256 " << boostTime / trials * 1000000
+			<< "us, Word256 " << wordTime / trials * 1000000 << "us" << endl;
 	}
 
 	return 0;
@@ -20,6 +20,7 @@
  */
 
 #include "SHA3.h"
+#include <cassert>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -90,8 +91,8 @@ static const uint64_t RC[24] = \
   v = 0;            \
   REPEAT5(e; v += s;)
 
-/*** Keccak-f[1600] ***/
-static inline void keccakf(void* state) {
+/*** Keccak-f[1600], portable reference version ***/
+static inline void keccakfPortable(void* state) {
   uint64_t* a = (uint64_t*)state;
   uint64_t b[5] = {0};
   uint64_t t = 0;
@@ -148,7 +149,108 @@ static inline void keccakf(void* state) {
 mkapply_ds(xorin, dst[i] ^= src[i])  // xorin
 mkapply_sd(setout, dst[i] = src[i])  // setout
 
-#define P keccakf
+/******** Register-resident Keccak-f[1600] ********/
+
+/*
+ * All 25 lanes live in locals and every index is a constant, so the compiler
+ * keeps the state in registers for the whole round. The same body serves scalar
+ * lanes and, through GCC vector extensions, four interleaved states at once.
+ */
+#define KECCAK_CHI_PLANE(y) \
+	a[y + 0] = b[y + 0] ^ (~b[y + 1] & b[y + 2]); \
+	a[y + 1] = b[y + 1] ^ (~b[y + 2] & b[y + 3]); \
+	a[y + 2] = b[y + 2] ^ (~b[y + 3] & b[y + 4]); \
+	a[y + 3] = b[y + 3] ^ (~b[y + 4] & b[y + 0]); \
+	a[y + 4] = b[y + 4] ^ (~b[y + 0] & b[y + 1]);
+
+template <class Lane>
+static inline __attribute__((always_inline)) void keccakfRounds(Lane* state)
+{
+	Lane a[25];
+	Lane b[25];
+	for (int i = 0; i < 25; i++)
+		a[i] = state[i];
+
+	for (int round = 0; round < 24; round++)
+	{
+		// Theta
+		Lane c0 = a[0] ^ a[5] ^ a[10] ^ a[15] ^ a[20];
+		Lane c1 = a[1] ^ a[6] ^ a[11] ^ a[16] ^ a[21];
+		Lane c2 = a[2] ^ a[7] ^ a[12] ^ a[17] ^ a[22];
+		Lane c3 = a[3] ^ a[8] ^ a[13] ^ a[18] ^ a[23];
+		Lane c4 = a[4] ^ a[9] ^ a[14] ^ a[19] ^ a[24];
+		Lane d0 = c4 ^ rol(c1, 1);
+		Lane d1 = c0 ^ rol(c2, 1);
+		Lane d2 = c1 ^ rol(c3, 1);
+		Lane d3 = c2 ^ rol(c4, 1);
+		Lane d4 = c3 ^ rol(c0, 1);
+
+		// Rho and pi: lane (x, y) moves to (y, 2x + 3y) rotated by its offset
+		b[0] = a[0] ^ d0;
+		b[1] = rol(a[6] ^ d1, 44);
+		b[2] = rol(a[12] ^ d2, 43);
+		b[3] = rol(a[18] ^ d3, 21);
+		b[4] = rol(a[24] ^ d4, 14);
+		b[5] = rol(a[3] ^ d3, 28);
+		b[6] = rol(a[9] ^ d4, 20);
+		b[7] = rol(a[10] ^ d0, 3);
+		b[8] = rol(a[16] ^ d1, 45);
+		b[9] = rol(a[22] ^ d2, 61);
+		b[10] = rol(a[1] ^ d1, 1);
+		b[11] = rol(a[7] ^ d2, 6);
+		b[12] = rol(a[13] ^ d3, 25);
+		b[13] = rol(a[19] ^ d4, 8);
+		b[14] = rol(a[20] ^ d0, 18);
+		b[15] = rol(a[4] ^ d4, 27);
+		b[16] = rol(a[5] ^ d0, 36);
+		b[17] = rol(a[11] ^ d1, 10);
+		b[18] = rol(a[17] ^ d2, 15);
+		b[19] = rol(a[23] ^ d3, 56);
+		b[20] = rol(a[2] ^ d2, 62);
+		b[21] = rol(a[8] ^ d3, 55);
+		b[22] = rol(a[14] ^ d4, 39);
+		b[23] = rol(a[15] ^ d0, 41);
+		b[24] = rol(a[21] ^ d1, 2);
+
+		// Chi
+		KECCAK_CHI_PLANE(0)
+		KECCAK_CHI_PLANE(5)
+		KECCAK_CHI_PLANE(10)
+		KECCAK_CHI_PLANE(15)
+		KECCAK_CHI_PLANE(20)
+
+		// Iota
+		a[0] ^= RC[round];
+	}
+
+	for (int i = 0; i < 25; i++)
+		state[i] = a[i];
+}
+
+#undef KECCAK_CHI_PLANE
+
+static void keccakfOpt64(void* state) { keccakfRounds((uint64_t*)state); }
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KECCAK_X86 1
+
+// Identical code; with BMI1 chi compiles to ANDN instead of NOT + AND.
+__attribute__((target("bmi"))) static void keccakfBMI(void* state) { keccakfRounds((uint64_t*)state); }
+
+typedef uint64_t Lanes4 __attribute__((vector_size(32)));
+
+// Four independent states, lane i of state k at element k of the i-th vector.
+__attribute__((target("avx2"))) static void keccakfAVX2x4(Lanes4* state) { keccakfRounds(state); }
+#endif
+
+typedef void (*Permutation)(void*);
+static Permutation s_permute = keccakfOpt64;
+#if KECCAK_X86
+typedef void (*Permutation4)(Lanes4*);
+static Permutation4 s_permute4 = nullptr;
+#endif
+
+#define P permute
 #define Plen 200
 
 // Fold P*F over the full blocks of an input.
@@ -163,7 +265,7 @@ mkapply_sd(setout, dst[i] = src[i])  // setout
 /** The sponge-based hash construction. **/
 static inline int hash(uint8_t* out, size_t outlen,
 					   const uint8_t* in, size_t inlen,
-					   size_t rate, uint8_t delim) {
+					   size_t rate, uint8_t delim, Permutation permute = s_permute) {
   if ((out == NULL) || ((in == NULL) && inlen != 0) || (rate >= Plen)) {
 	return -1;
   }
@@ -209,6 +311,96 @@ defsha3(256)
 defsha3(384)
 defsha3(512)
 
+static const size_t c_rate256 = 200 - 256 / 4;
+
+static bool selfTest(Permutation _p)
+{
+	uint64_t expected[25];
+	uint64_t state[25];
+	for (unsigned i = 0; i < 25; i++)
+		expected[i] = state[i] = RC[i % 24] * (i + 1);
+	keccakfPortable(expected);
+	_p(state);
+	return memcmp(expected, state, sizeof(state)) == 0;
+}
+
+#if KECCAK_X86
+static bool selfTest4(Permutation4 _p)
+{
+	uint64_t expected[4][25];
+	Lanes4 state[25];
+	for (unsigned k = 0; k < 4; k++)
+		for (unsigned i = 0; i < 25; i++)
+			expected[k][i] = state[i][k] = RC[(i + k) % 24] * (i + k + 1);
+	for (unsigned k = 0; k < 4; k++)
+		keccakfPortable(expected[k]);
+	_p(state);
+	for (unsigned k = 0; k < 4; k++)
+		for (unsigned i = 0; i < 25; i++)
+			if (state[i][k] != expected[k][i])
+				return false;
+	return true;
+}
+
+/// Keccak-256 of four inputs that each fit into a single block.
+static void sha3SingleBlock4(bytesConstRef const* _inputs, h256* o_outputs, size_t const* _indices)
+{
+	uint8_t blocks[4][Plen];
+	Lanes4 state[25];
+	memset(blocks, 0, sizeof(blocks));
+	for (unsigned k = 0; k < 4; k++)
+	{
+		bytesConstRef in = _inputs[_indices[k]];
+		memcpy(blocks[k], in.data(), in.size());
+		blocks[k][in.size()] ^= 0x01;
+		blocks[k][c_rate256 - 1] ^= 0x80;
+	}
+	for (unsigned i = 0; i < 25; i++)
+		for (unsigned k = 0; k < 4; k++)
+		{
+			uint64_t lane;
+			memcpy(&lane, blocks[k] + 8 * i, 8);
+			state[i][k] = lane;
+		}
+	s_permute4(state);
+	for (unsigned k = 0; k < 4; k++)
+		for (unsigned i = 0; i < 4; i++)
+		{
+			uint64_t lane = state[i][k];
+			memcpy(o_outputs[_indices[k]].data() + 8 * i, &lane, 8);
+		}
+}
+#endif
+
+}
+
+std::string sha3AutoDetect()
+{
+	std::string ret = "opt64";
+	keccak::s_permute = keccak::keccakfOpt64;
+#if KECCAK_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("bmi") && keccak::selfTest(keccak::keccakfBMI))
+	{
+		keccak::s_permute = keccak::keccakfBMI;
+		ret = "bmi";
+	}
+	if (__builtin_cpu_supports("avx2") && keccak::selfTest4(keccak::keccakfAVX2x4))
+	{
+		keccak::s_permute4 = keccak::keccakfAVX2x4;
+		ret += ",avx2x4";
+	}
+#endif
+	assert(keccak::selfTest(keccak::s_permute));
+	return ret;
+}
+
+bool sha3Portable(bytesConstRef _input, bytesRef o_output)
+{
+	if (o_output.size() != 32)
+		return false;
+	keccak::hash(o_output.data(), 32, _input.data(), _input.size(), keccak::c_rate256, 0x01, keccak::keccakfPortable);
+	return true;
 }
 
 bool sha3(bytesConstRef _input, bytesRef o_output)
@@ -221,4 +413,31 @@ bool sha3(bytesConstRef _input, bytesRef o_output)
 	return true;
 }
 
+void sha3(bytesConstRef const* _inputs, h256* o_outputs, size_t _count)
+{
+#if KECCAK_X86
+	if (keccak::s_permute4)
+	{
+		// gather single-block inputs four at a time for the interleaved permutation
+		size_t pending[4];
+		unsigned nPending = 0;
+		for (size_t i = 0; i < _count; ++i)
+		{
+			if (_inputs[i].size() >= keccak::c_rate256)
+				sha3(_inputs[i], o_outputs[i].ref());
+			else if ((pending[nPending++] = i), nPending == 4)
+			{
+				keccak::sha3SingleBlock4(_inputs, o_outputs, pending);
+				nPending = 0;
+			}
+		}
+		for (unsigned j = 0; j < nPending; ++j)
+			sha3(_inputs[pending[j]], o_outputs[pending[j]].ref());
+		return;
+	}
+#endif
+	for (size_t i = 0; i < _count; ++i)
+		sha3(_inputs[i], o_outputs[i].ref());
+}
+
 }
@@ -36,6 +36,18 @@ namespace dev
 /// @returns false if o_output.size() != 32.
 bool sha3(bytesConstRef _input, bytesRef o_output);
 
+/// Calculate SHA3-256 hashes of _count independent inputs into o_outputs[0.._count).
+/// Short inputs are hashed several at a time when the CPU supports it, so prefer this
+/// over a loop of sha3() calls when many keys or nodes are hashed at once.
+void sha3(bytesConstRef const* _inputs, h256* o_outputs, size_t _count);
+
+/// Select the fastest Keccak-f[1600] permutation this CPU supports and verify it
+/// against the portable one. @returns a description of the selected implementation.
+std::string sha3AutoDetect();
+
+/// SHA3-256 with the unoptimised reference permutation, for testing and benchmarks.
+bool sha3Portable(bytesConstRef _input, bytesRef o_output);
+
 /// Calculate SHA3-256 hash of the given input, returning as a 256-bit hash.
 inline h256 sha3(bytesConstRef _input) { h256 ret; sha3(_input, ret.ref()); return ret; }
 inline SecureFixedHash<32> sha3Secure(bytesConstRef _input) { SecureFixedHash<32> ret; sha3(_input, ret.writable().ref()); return ret; }
@@ -96,6 +96,8 @@ public:
 	/// True if the trie is initialised but empty (i.e. that the DB contains the root node which is empty).
 	bool isEmpty() const { return m_root == c_shaNull && node(m_root).size(); }
 
+	/// The root hash without checking that its node is present, for use as a cache key.
+	h256 const& rootHash() const { return m_root; }
 	h256 const& root() const { if (node(m_root).empty()) BOOST_THROW_EXCEPTION(BadRoot(m_root)); /*std::cout << "Returning root as " << ret << " (really " << m_root << ")" << std::endl;*/ return m_root; }	// patch the root in the case of the empty trie. TODO: handle this properly.
 
 	std::string at(bytes const& _key) const { return at(&_key); }
@@ -334,6 +336,10 @@ public:
 	void insert(KeyType _k, bytes const& _value) { insert(_k, bytesConstRef(&_value)); }
 	void remove(KeyType _k) { Generic::remove(bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
 
+	/// Variants for hashed tries taking sha3(_k) from the caller, see hashedTrieKeys().
+	void insertHashed(h256 const& _hashedKey, KeyType _k, bytesConstRef _value) { Generic::insertHashed(_hashedKey, bytesConstRef((byte const*)&_k, sizeof(KeyType)), _value); }
+	void removeHashed(h256 const& _hashedKey) { Generic::removeHashed(_hashedKey); }
+
 	class iterator: public Generic::iterator
 	{
 	public:
@@ -355,6 +361,19 @@ public:
 	iterator lower_bound(KeyType _k) const { return iterator(this, bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
 };
 
+/// The keys as a hashed SpecificTrieDB stores them, computed with one batched sha3 call.
+template <class KeyType>
+std::vector<h256> hashedTrieKeys(std::vector<KeyType> const& _keys)
+{
+	std::vector<bytesConstRef> refs;
+	refs.reserve(_keys.size());
+	for (auto const& k: _keys)
+		refs.push_back(bytesConstRef((byte const*)&k, sizeof(KeyType)));
+	std::vector<h256> ret(_keys.size());
+	sha3(refs.data(), ret.data(), refs.size());
+	return ret;
+}
+
 template <class Generic, class KeyType>
 std::ostream& operator<<(std::ostream& _out, SpecificTrieDB<Generic, KeyType> const& _db)
 {
@@ -384,6 +403,7 @@ public:
 	using Super::isEmpty;
 
 	using Super::root;
+	using Super::rootHash;
 	using Super::db;
 
 	using Super::leftOvers;
@@ -394,6 +414,8 @@ public:
 	bool contains(bytesConstRef _key) { return Super::contains(sha3(_key)); }
 	void insert(bytesConstRef _key, bytesConstRef _value) { Super::insert(sha3(_key), _value); }
 	void remove(bytesConstRef _key) { Super::remove(sha3(_key)); }
+	void insertHashed(h256 const& _hashedKey, bytesConstRef, bytesConstRef _value) { Super::insert(_hashedKey, _value); }
+	void removeHashed(h256 const& _hashedKey) { Super::remove(_hashedKey); }
 
 	// empty from the PoV of the iterator interface; still need a basic iterator impl though.
 	class iterator
@@ -434,6 +456,7 @@ public:
 	using Super::isNull;
 	using Super::isEmpty;
 	using Super::root;
+	using Super::rootHash;
 	using Super::leftOvers;
 	using Super::check;
 	using Super::open;
@@ -451,6 +474,12 @@ public:
 	}
 
 	void remove(bytesConstRef _key) { Super::remove(sha3(_key)); }
+	void insertHashed(h256 const& _hashedKey, bytesConstRef _key, bytesConstRef _value)
+	{
+		Super::insert(_hashedKey, _value);
+		Super::db()->insertAux(_hashedKey, _key);
+	}
+	void removeHashed(h256 const& _hashedKey) { Super::remove(_hashedKey); }
 
 	// iterates over <key, value> pairs
 	class iterator: public GenericTrieDB<_DB>::iterator
@@ -0,0 +1,322 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Word256.h
+ * @date 2018
+ *
+ * Fixed-width 256-bit unsigned word used by the EVM interpreter for its hot
+ * arithmetic and memory paths.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "Common.h"
+
+namespace dev
+{
+
+/**
+ * @brief 256-bit unsigned integer stored as four 64-bit limbs, least significant first.
+ * All arithmetic wraps modulo 2^256 like the EVM. Division by zero yields zero.
+ * Conversion to and from u256 copies the Boost.Multiprecision limbs directly.
+ */
+struct Word256
+{
+	uint64_t w[4];
+
+	static Word256 zero() { return Word256{{0, 0, 0, 0}}; }
+
+	static Word256 fromU256(u256 const& _v)
+	{
+		using Limb = boost::multiprecision::limb_type;
+		unsigned const c_limbBits = sizeof(Limb) * 8;
+		Word256 r = zero();
+		auto const& b = _v.backend();
+		Limb const* p = b.limbs();
+		for (unsigned i = 0; i < b.size(); ++i)
+			r.w[i * c_limbBits / 64] |= uint64_t(p[i]) << (i * c_limbBits % 64);
+		return r;
+	}
+
+	u256 toU256() const
+	{
+		using Limb = boost::multiprecision::limb_type;
+		unsigned const c_limbBits = sizeof(Limb) * 8;
+		unsigned const c_limbs = 256 / c_limbBits;
+		u256 r;
+		auto& b = r.backend();
+		b.resize(c_limbs, c_limbs);
+		Limb* p = b.limbs();
+		for (unsigned i = 0; i < c_limbs; ++i)
+			p[i] = Limb(w[i * c_limbBits / 64] >> (i * c_limbBits % 64));
+		b.normalize();
+		return r;
+	}
+
+	/// Word from 32 big-endian bytes (MLOAD, CALLDATALOAD).
+	static Word256 loadBigEndian(byte const* _p)
+	{
+		Word256 r;
+		for (unsigned i = 0; i < 4; ++i)
+			r.w[3 - i] = load64BigEndian(_p + 8 * i);
+		return r;
+	}
+
+	/// Word from the _n <= 32 big-endian bytes at _p (PUSHn data).
+	static Word256 loadBigEndian(byte const* _p, unsigned _n)
+	{
+		byte buf[32] = {0};
+		std::memcpy(buf + 32 - _n, _p, _n);
+		return loadBigEndian(buf);
+	}
+
+	/// Write the word as 32 big-endian bytes (MSTORE).
+	void storeBigEndian(byte* _p) const
+	{
+		for (unsigned i = 0; i < 4; ++i)
+			store64BigEndian(_p + 8 * i, w[3 - i]);
+	}
+
+	bool isZero() const { return (w[0] | w[1] | w[2] | w[3]) == 0; }
+
+	unsigned bitLength() const
+	{
+		for (int i = 3; i >= 0; --i)
+			if (w[i])
+				return 64 * i + 64 - countLeadingZeros(w[i]);
+		return 0;
+	}
+
+	friend bool operator==(Word256 const& _a, Word256 const& _b)
+	{
+		return ((_a.w[0] ^ _b.w[0]) | (_a.w[1] ^ _b.w[1]) | (_a.w[2] ^ _b.w[2]) | (_a.w[3] ^ _b.w[3])) == 0;
+	}
+
+	friend bool operator!=(Word256 const& _a, Word256 const& _b) { return !(_a == _b); }
+
+	friend bool operator<(Word256 const& _a, Word256 const& _b)
+	{
+		for (int i = 3; i >= 0; --i)
+			if (_a.w[i] != _b.w[i])
+				return _a.w[i] < _b.w[i];
+		return false;
+	}
+
+	friend Word256 operator+(Word256 const& _a, Word256 const& _b)
+	{
+		Word256 r;
+		uint64_t carry = 0;
+		for (unsigned i = 0; i < 4; ++i)
+			r.w[i] = addCarry(_a.w[i], _b.w[i], carry);
+		return r;
+	}
+
+	friend Word256 operator-(Word256 const& _a, Word256 const& _b)
+	{
+		Word256 r;
+		uint64_t borrow = 0;
+		for (unsigned i = 0; i < 4; ++i)
+			r.w[i] = subBorrow(_a.w[i], _b.w[i], borrow);
+		return r;
+	}
+
+	/// Product truncated to 256 bits: only the limb products landing below 2^256 are formed.
+	friend Word256 operator*(Word256 const& _a, Word256 const& _b)
+	{
+		Word256 r = zero();
+		for (unsigned i = 0; i < 4; ++i)
+		{
+			uint64_t carry = 0;
+			for (unsigned j = 0; i + j < 4; ++j)
+			{
+				uint64_t hi;
+				uint64_t lo = mul64(_a.w[i], _b.w[j], hi);
+				uint64_t c = 0;
+				lo = addCarry(lo, r.w[i + j], c);
+				hi += c;
+				c = 0;
+				r.w[i + j] = addCarry(lo, carry, c);
+				carry = hi + c;
+			}
+		}
+		return r;
+	}
+
+	friend Word256 operator<<(Word256 const& _a, unsigned _n)
+	{
+		Word256 r = zero();
+		if (_n >= 256)
+			return r;
+		unsigned const limbs = _n / 64;
+		unsigned const bits = _n % 64;
+		for (int i = 3; i >= int(limbs); --i)
+		{
+			r.w[i] = _a.w[i - limbs] << bits;
+			if (bits && i > int(limbs))
+				r.w[i] |= _a.w[i - limbs - 1] >> (64 - bits);
+		}
+		return r;
+	}
+
+	friend Word256 operator>>(Word256 const& _a, unsigned _n)
+	{
+		Word256 r = zero();
+		if (_n >= 256)
+			return r;
+		unsigned const limbs = _n / 64;
+		unsigned const bits = _n % 64;
+		for (unsigned i = 0; i + limbs < 4; ++i)
+		{
+			r.w[i] = _a.w[i + limbs] >> bits;
+			if (bits && i + limbs + 1 < 4)
+				r.w[i] |= _a.w[i + limbs + 1] << (64 - bits);
+		}
+		return r;
+	}
+
+	/// Quotient and remainder of _a / _b; both are zero when _b is zero.
+	static void divMod(Word256 const& _a, Word256 const& _b, Word256& o_quotient, Word256& o_remainder)
+	{
+		o_quotient = zero();
+		o_remainder = zero();
+		if (_b.isZero())
+			return;
+		if (_a < _b)
+		{
+			o_remainder = _a;
+			return;
+		}
+#if defined(__SIZEOF_INT128__)
+		if ((_b.w[1] | _b.w[2] | _b.w[3]) == 0)
+		{
+			// single limb divisor: schoolbook division with 128/64 steps
+			unsigned __int128 rem = 0;
+			for (int i = 3; i >= 0; --i)
+			{
+				unsigned __int128 cur = (rem << 64) | _a.w[i];
+				o_quotient.w[i] = uint64_t(cur / _b.w[0]);
+				rem = cur % _b.w[0];
+			}
+			o_remainder.w[0] = uint64_t(rem);
+			return;
+		}
+#endif
+		// align the divisor with the dividend and subtract it bit by bit
+		unsigned shift = _a.bitLength() - _b.bitLength();
+		Word256 d = _b << shift;
+		Word256 r = _a;
+		for (int i = int(shift); i >= 0; --i)
+		{
+			if (!(r < d))
+			{
+				r = r - d;
+				o_quotient.w[i / 64] |= uint64_t(1) << (i % 64);
+			}
+			d = d >> 1;
+		}
+		o_remainder = r;
+	}
+
+	friend Word256 operator/(Word256 const& _a, Word256 const& _b)
+	{
+		Word256 q, r;
+		divMod(_a, _b, q, r);
+		return q;
+	}
+
+	friend Word256 operator%(Word256 const& _a, Word256 const& _b)
+	{
+		Word256 q, r;
+		divMod(_a, _b, q, r);
+		return r;
+	}
+
+private:
+	static uint64_t addCarry(uint64_t _a, uint64_t _b, uint64_t& io_carry)
+	{
+		uint64_t s = _a + _b;
+		uint64_t c = s < _a;
+		uint64_t r = s + io_carry;
+		io_carry = c | (r < s);
+		return r;
+	}
+
+	static uint64_t subBorrow(uint64_t _a, uint64_t _b, uint64_t& io_borrow)
+	{
+		uint64_t d = _a - _b;
+		uint64_t b = _a < _b;
+		uint64_t r = d - io_borrow;
+		io_borrow = b | (d < io_borrow);
+		return r;
+	}
+
+	/// Full 64x64 -> 128 bit product, low half returned and high half in o_hi.
+	static uint64_t mul64(uint64_t _a, uint64_t _b, uint64_t& o_hi)
+	{
+#if defined(__SIZEOF_INT128__)
+		unsigned __int128 p = (unsigned __int128)_a * _b;
+		o_hi = uint64_t(p >> 64);
+		return uint64_t(p);
+#else
+		uint64_t aLo = uint32_t(_a), aHi = _a >> 32, bLo = uint32_t(_b), bHi = _b >> 32;
+		uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+		uint64_t mid = (ll >> 32) + uint32_t(lh) + uint32_t(hl);
+		o_hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+		return (mid << 32) | uint32_t(ll);
+#endif
+	}
+
+	static unsigned countLeadingZeros(uint64_t _v)
+	{
+#if defined(__GNUC__)
+		return __builtin_clzll(_v);
+#else
+		unsigned n = 0;
+		for (uint64_t bit = uint64_t(1) << 63; !(_v & bit); bit >>= 1)
+			++n;
+		return n;
+#endif
+	}
+
+	static uint64_t load64BigEndian(byte const* _p)
+	{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		uint64_t v;
+		std::memcpy(&v, _p, 8);
+		return __builtin_bswap64(v);
+#else
+		uint64_t v = 0;
+		for (unsigned i = 0; i < 8; ++i)
+			v = (v << 8) | _p[i];
+		return v;
+#endif
+	}
+
+	static void store64BigEndian(byte* _p, uint64_t _v)
+	{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		_v = __builtin_bswap64(_v);
+		std::memcpy(_p, &_v, 8);
+#else
+		for (int i = 7; i >= 0; --i, _v >>= 8)
+			_p[i] = byte(_v);
+#endif
+	}
+};
+
+}
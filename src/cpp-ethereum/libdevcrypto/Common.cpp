@@ -35,6 +35,7 @@
 #include "AES.h"
 #include "CryptoPP.h"
 #include "Exceptions.h"
+#include "RecoveryCache.h"
 using namespace std;
 using namespace dev;
 using namespace dev::crypto;
@@ -201,6 +202,20 @@ bytesSec dev::decryptAES128CTR(bytesConstRef _k, h128 const& _iv, bytesConstRef
 }
 
 Public dev::recover(Signature const& _sig, h256 const& _message)
+{
+	int v = _sig[64];
+	if (v > 3)
+		return {};
+
+	Public ret;
+	if (RecoveryCache::instance().get(_message, _sig, ret))
+		return ret;
+	ret = recoverUncached(_sig, _message);
+	RecoveryCache::instance().store(_message, _sig, ret);
+	return ret;
+}
+
+Public dev::recoverUncached(Signature const& _sig, h256 const& _message)
 {
 	int v = _sig[64];
 	if (v > 3)
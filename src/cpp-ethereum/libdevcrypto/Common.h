@@ -130,7 +130,11 @@ inline bytesSec decryptSymNoAuth(SecureFixedHash<16> const& _k, h128 const& _iv,
 inline bytesSec decryptSymNoAuth(SecureFixedHash<32> const& _k, h128 const& _iv, bytesConstRef _cipher) { return decryptAES128CTR(_k.ref(), _iv, _cipher); }
 
 /// Recovers Public key from signed message hash.
+/// Results are kept in a bounded cache shared by all threads, keyed by hash and signature.
 Public recover(Signature const& _sig, h256 const& _hash);
+
+/// Recovers Public key from signed message hash with libsecp256k1, bypassing the cache.
+Public recoverUncached(Signature const& _sig, h256 const& _hash);
 	
 /// Returns siganture of message hash.
 Signature sign(Secret const& _k, h256 const& _hash);
@@ -0,0 +1,118 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file RecoveryCache.h
+ * @date 2018
+ */
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <cryptopp/seckey.h>  // siphash.h uses FixedKeyLength without including it
+#include <cryptopp/siphash.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+#include "Common.h"
+
+namespace dev
+{
+namespace crypto
+{
+
+/**
+ * Public keys recovered from (message hash, signature) pairs. The same signatures are
+ * recovered again and again: a transaction in the mempool and then in a block, or a
+ * contract that checks the same signature with ecrecover in every call.
+ *
+ * Both parts of the key are chosen by whoever sends the transaction, so buckets are
+ * picked with SipHash under a random per-process key rather than from the raw bytes.
+ */
+class RecoveryCache
+{
+public:
+	explicit RecoveryCache(size_t _maxSize = c_defaultMaxSize):
+		m_maxSize(_maxSize), m_cache(0, KeyHash(h128::random()))
+	{}
+
+	bool get(h256 const& _hash, Signature const& _sig, Public& o_public)
+	{
+		Key key(_hash, _sig);
+		Guard l(x_cache);
+		auto it = m_cache.find(key);
+		if (it == m_cache.end())
+			return false;
+		m_lru.splice(m_lru.begin(), m_lru, it->second.second);
+		o_public = it->second.first;
+		return true;
+	}
+
+	void store(h256 const& _hash, Signature const& _sig, Public const& _public)
+	{
+		Key key(_hash, _sig);
+		Guard l(x_cache);
+		if (m_cache.count(key))
+			return;
+		if (m_cache.size() >= m_maxSize)
+		{
+			m_cache.erase(m_lru.back());
+			m_lru.pop_back();
+		}
+		m_lru.push_front(key);
+		m_cache.emplace(key, std::make_pair(_public, m_lru.begin()));
+	}
+
+	size_t size() const { Guard l(x_cache); return m_cache.size(); }
+
+	static RecoveryCache& instance() { static RecoveryCache cache; return cache; }
+
+private:
+	struct Key
+	{
+		Key(h256 const& _hash, Signature const& _sig): hash(_hash), sig(_sig) {}
+		bool operator==(Key const& _k) const { return hash == _k.hash && sig == _k.sig; }
+
+		h256 hash;
+		Signature sig;
+	};
+
+	struct KeyHash
+	{
+		explicit KeyHash(h128 const& _salt): salt(_salt) {}
+
+		size_t operator()(Key const& _k) const
+		{
+			CryptoPP::SipHash<2, 4, false> mac(salt.data(), h128::size);
+			mac.Update(_k.hash.data(), h256::size);
+			mac.Update(_k.sig.data(), Signature::size);
+			uint64_t ret;
+			mac.TruncatedFinal(reinterpret_cast<byte*>(&ret), sizeof(ret));
+			return static_cast<size_t>(ret);
+		}
+
+		h128 salt;
+	};
+
+	static const size_t c_defaultMaxSize = 16384;
+
+	size_t const m_maxSize;
+	mutable Mutex x_cache;
+	std::list<Key> m_lru;	///< Most recently used first.
+	std::unordered_map<Key, std::pair<Public, std::list<Key>::iterator>, KeyHash> m_cache;
+};
+
+}
+}
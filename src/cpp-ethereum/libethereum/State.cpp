@@ -170,7 +170,7 @@ Account* State::account(Address const& _addr)
 		return nullptr;
 
 	// Populate basic info.
-	string stateBack = m_state.at(_addr);
+	string stateBack = accountRLP(_addr);
 	if (stateBack.empty())
 	{
 		m_nonExistingAccountsCache.insert(_addr);
@@ -189,6 +189,18 @@ Account* State::account(Address const& _addr)
 	return &i.first->second;
 }
 
+string State::accountRLP(Address const& _addr) const
+{
+	h256 const& root = m_state.rootHash();
+	string ret;
+	if (!StateCache::instance().account(root, _addr, ret))
+	{
+		ret = m_state.at(_addr);
+		StateCache::instance().storeAccount(root, _addr, ret);
+	}
+	return ret;
+}
+
 void State::clearCacheIfTooLarge() const
 {
 	// TODO: Find a good magic number
@@ -211,7 +223,10 @@ void State::commit(CommitBehaviour _commitBehaviour)
 {
 	if (_commitBehaviour == CommitBehaviour::RemoveEmptyAccounts)
 		removeEmptyAccounts();
-	m_touched += dev::eth::commit(m_cache, m_state);
+	h256 const oldRoot = m_state.rootHash();
+	AddressHash const changed = dev::eth::commit(m_cache, m_state);
+	StateCache::instance().noteCommit(oldRoot, m_state.rootHash(), changed);
+	m_touched += changed;
 	m_changeLog.clear();
 	m_cache.clear();
 	m_unchangedCacheEntries.clear();
@@ -358,10 +373,15 @@ u256 State::storage(Address const& _id, u256 const& _key) const
 		if (mit != a->storageOverlay().end())
 			return mit->second;
 
-		// Not in the storage cache - go to the DB.
-		SecureTrieDB<h256, OverlayDB> memdb(const_cast<OverlayDB*>(&m_db), a->baseRoot());			// promise we won't change the overlay! :)
-		string payload = memdb.at(_key);
-		u256 ret = payload.size() ? RLP(payload).toInt<u256>() : 0;
+		// Not in the storage cache - try the shared cache, then go to the DB.
+		u256 ret;
+		if (!StateCache::instance().storage(a->baseRoot(), _key, ret))
+		{
+			SecureTrieDB<h256, OverlayDB> memdb(const_cast<OverlayDB*>(&m_db), a->baseRoot());			// promise we won't change the overlay! :)
+			string payload = memdb.at(_key);
+			ret = payload.size() ? RLP(payload).toInt<u256>() : 0;
+			StateCache::instance().storeStorage(a->baseRoot(), _key, ret);
+		}
 		a->setStorageCache(_key, ret);
 		return ret;
 	}
@@ -411,7 +431,7 @@ map<h256, pair<u256, u256>> State::storage(Address const& _id) const
 
 h256 State::storageRoot(Address const& _id) const
 {
-	string s = m_state.at(_id);
+	string s = accountRLP(_id);
 	if (s.size())
 	{
 		RLP r(s);
@@ -30,6 +30,7 @@
 #include <libethcore/Exceptions.h>
 #include <libethcore/BlockHeader.h>
 #include <libethereum/CodeSizeCache.h>
+#include <libethereum/StateCache.h>
 #include <libethereum/GenericMiner.h>
 #include <libevm/ExtVMFace.h>
 #include "Account.h"
@@ -82,7 +83,8 @@ enum class BaseState
 enum class Permanence
 {
 	Reverted,
-	Committed
+	Committed,
+	Uncommitted	///< Kept in the state's trie but never flushed to its database.
 };
 
 #if ETH_FATDB
@@ -321,6 +323,9 @@ protected: // lux
 	/// The pointer is valid until the next access to the state or account.
 	Account* account(Address const& _addr);
 
+	/// @returns the committed account record of _addr, empty if it does not exist. Goes through StateCache.
+	std::string accountRLP(Address const& _addr) const;
+
 	/// Purges non-modified entries in m_cache if it grows too large.
 	void clearCacheIfTooLarge() const;
 
@@ -344,49 +349,68 @@ std::ostream& operator<<(std::ostream& _out, State const& _s);
 template <class DB>
 AddressHash commit(AccountMap const& _cache, SecureTrieDB<Address, DB>& _state)
 {
-	AddressHash ret;
+	// Keys are hashed up front in batches rather than one by one inside insert/remove.
+	std::vector<Address> dirty;
 	for (auto const& i: _cache)
 		if (i.second.isDirty())
+			dirty.push_back(i.first);
+	std::vector<h256> const hashedAddresses = hashedTrieKeys(dirty);
+
+	AddressHash ret;
+	for (size_t n = 0; n < dirty.size(); ++n)
+	{
+		Account const& account = _cache.at(dirty[n]);
+		if (!account.isAlive())
+			_state.removeHashed(hashedAddresses[n]);
+		else
 		{
-			if (!i.second.isAlive())
-				_state.remove(i.first);
+			RLPStream s(4);
+			s << account.nonce() << account.balance();
+
+			if (account.storageOverlay().empty())
+			{
+				assert(account.baseRoot());
+				s.append(account.baseRoot());
+			}
 			else
 			{
-				RLPStream s(4);
-				s << i.second.nonce() << i.second.balance();
-
-				if (i.second.storageOverlay().empty())
+				SecureTrieDB<h256, DB> storageDB(_state.db(), account.baseRoot());
+				std::vector<h256> keys;
+				keys.reserve(account.storageOverlay().size());
+				for (auto const& j: account.storageOverlay())
+					keys.push_back(h256(j.first));
+				std::vector<h256> const hashedKeys = hashedTrieKeys(keys);
+				size_t k = 0;
+				for (auto const& j: account.storageOverlay())
 				{
-					assert(i.second.baseRoot());
-					s.append(i.second.baseRoot());
+					if (j.second)
+					{
+						bytes const value = rlp(j.second);
+						storageDB.insertHashed(hashedKeys[k], keys[k], &value);
+					}
+					else
+						storageDB.removeHashed(hashedKeys[k]);
+					++k;
 				}
-				else
-				{
-					SecureTrieDB<h256, DB> storageDB(_state.db(), i.second.baseRoot());
-					for (auto const& j: i.second.storageOverlay())
-						if (j.second)
-							storageDB.insert(j.first, rlp(j.second));
-						else
-							storageDB.remove(j.first);
-					assert(storageDB.root());
-					s.append(storageDB.root());
-				}
-
-				if (i.second.hasNewCode())
-				{
-					h256 ch = i.second.codeHash();
-					// Store the size of the code
-					CodeSizeCache::instance().store(ch, i.second.code().size());
-					_state.db()->insert(ch, &i.second.code());
-					s << ch;
-				}
-				else
-					s << i.second.codeHash();
+				assert(storageDB.root());
+				s.append(storageDB.root());
+			}
 
-				_state.insert(i.first, &s.out());
+			if (account.hasNewCode())
+			{
+				h256 ch = account.codeHash();
+				// Store the size of the code
+				CodeSizeCache::instance().store(ch, account.code().size());
+				_state.db()->insert(ch, &account.code());
+				s << ch;
 			}
-			ret.insert(i.first);
+			else
+				s << account.codeHash();
+
+			_state.insertHashed(hashedAddresses[n], dirty[n], &s.out());
 		}
+		ret.insert(dirty[n]);
+	}
 	return ret;
 }
 
@@ -0,0 +1,231 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateCache.h
+ * @date 2018
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+#include <libdevcrypto/Common.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Thread-safe cache of account records and storage slots read from the state tries,
+ * shared by every State and kept across commits and blocks.
+ *
+ * Entries are keyed by the root of the trie they were read from, so a cached value can never
+ * be wrong for the root it is looked up under: changing roots with setRoot() on a reorg or for
+ * a temporary state needs no invalidation. Storage slots are keyed by the account's storage
+ * root, which fully determines their value. For accounts, every commit records which addresses
+ * it changed between the old and the new state root; a lookup that misses at the current root
+ * follows these records back to an older root as long as the address was not changed, so
+ * accounts untouched by recent transactions stay cached.
+ */
+class StateCache
+{
+public:
+	StateCache() { setMaxSize(c_defaultMaxSize); }
+
+	/// Account record RLP at state root _root, empty if the account does not exist.
+	bool account(h256 const& _root, Address const& _address, std::string& o_rlp)
+	{
+		UniqueGuard g(x_cache);
+		h256 root = _root;
+		for (unsigned depth = 0; depth <= c_maxLineageDepth; ++depth)
+		{
+			if (std::string const* rlp = m_accounts.find(std::make_pair(root, _address)))
+			{
+				o_rlp = *rlp;
+				// Re-key under the root asked for so that the next lookup finds it immediately.
+				if (depth)
+					m_accounts.insert(std::make_pair(_root, _address), o_rlp, accountCost(o_rlp));
+				++m_hits;
+				return true;
+			}
+			auto it = m_lineage.find(root);
+			if (it == m_lineage.end() || it->second.changed.count(_address))
+				break;
+			root = it->second.parent;
+		}
+		++m_misses;
+		return false;
+	}
+
+	void storeAccount(h256 const& _root, Address const& _address, std::string const& _rlp)
+	{
+		UniqueGuard g(x_cache);
+		m_accounts.insert(std::make_pair(_root, _address), _rlp, accountCost(_rlp));
+	}
+
+	/// Record that committing the accounts in _changed to the state at _oldRoot gave _newRoot.
+	void noteCommit(h256 const& _oldRoot, h256 const& _newRoot, AddressHash const& _changed)
+	{
+		if (_oldRoot == _newRoot)
+			return;
+		UniqueGuard g(x_cache);
+		if (!m_lineage.emplace(_newRoot, Lineage{_oldRoot, _changed}).second)
+			return;
+		m_lineageOrder.push_back(_newRoot);
+		if (m_lineageOrder.size() > c_maxLineage)
+		{
+			m_lineage.erase(m_lineageOrder.front());
+			m_lineageOrder.pop_front();
+		}
+	}
+
+	/// Value of slot _key in the storage trie with root _storageRoot.
+	bool storage(h256 const& _storageRoot, u256 const& _key, u256& o_value)
+	{
+		UniqueGuard g(x_cache);
+		if (u256 const* value = m_storage.find(std::make_pair(_storageRoot, h256(_key))))
+		{
+			o_value = *value;
+			++m_hits;
+			return true;
+		}
+		++m_misses;
+		return false;
+	}
+
+	void storeStorage(h256 const& _storageRoot, u256 const& _key, u256 const& _value)
+	{
+		UniqueGuard g(x_cache);
+		m_storage.insert(std::make_pair(_storageRoot, h256(_key)), _value, c_storageCost);
+	}
+
+	/// Limit the memory used by cached entries; accounts get a quarter, storage slots the rest.
+	void setMaxSize(size_t _bytes)
+	{
+		UniqueGuard g(x_cache);
+		m_accounts.setMaxSize(_bytes / 4);
+		m_storage.setMaxSize(_bytes - _bytes / 4);
+	}
+
+	uint64_t hits() const { return m_hits; }
+	uint64_t misses() const { return m_misses; }
+	size_t size() const { UniqueGuard g(x_cache); return m_accounts.size() + m_storage.size(); }
+	size_t memoryUsage() const { UniqueGuard g(x_cache); return m_accounts.memoryUsage() + m_storage.memoryUsage(); }
+
+	static StateCache& instance() { static StateCache cache; return cache; }
+
+private:
+	/// Accounts changed by the commit that produced a root, and the root it was made from.
+	struct Lineage
+	{
+		h256 parent;
+		AddressHash changed;
+	};
+
+	template <class Key>
+	struct RootKeyHash
+	{
+		size_t operator()(std::pair<h256, Key> const& _k) const { return std::hash<h256>()(_k.first) ^ std::hash<Key>()(_k.second); }
+	};
+
+	/// LRU map bounded by the estimated memory of its entries.
+	template <class Key, class Value, class Hash>
+	class LruMap
+	{
+	public:
+		Value const* find(Key const& _key)
+		{
+			auto it = m_map.find(_key);
+			if (it == m_map.end())
+				return nullptr;
+			m_lru.splice(m_lru.begin(), m_lru, it->second);
+			return &it->second->value;
+		}
+
+		void insert(Key const& _key, Value const& _value, size_t _cost)
+		{
+			if (_cost > m_maxSize)
+				return;
+			auto it = m_map.find(_key);
+			if (it != m_map.end())
+			{
+				m_usage -= it->second->cost;
+				m_lru.erase(it->second);
+				m_map.erase(it);
+			}
+			m_lru.push_front(Entry{_key, _value, _cost});
+			m_map.emplace(_key, m_lru.begin());
+			m_usage += _cost;
+			evict();
+		}
+
+		void setMaxSize(size_t _bytes) { m_maxSize = _bytes; evict(); }
+		size_t size() const { return m_map.size(); }
+		size_t memoryUsage() const { return m_usage; }
+
+	private:
+		struct Entry
+		{
+			Key key;
+			Value value;
+			size_t cost;
+		};
+
+		void evict()
+		{
+			while (!m_lru.empty() && m_usage > m_maxSize)
+			{
+				m_usage -= m_lru.back().cost;
+				m_map.erase(m_lru.back().key);
+				m_lru.pop_back();
+			}
+		}
+
+		std::list<Entry> m_lru;	///< Most recently used first.
+		std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> m_map;
+		size_t m_usage = 0;
+		size_t m_maxSize = 0;
+	};
+
+	static size_t accountCost(std::string const& _rlp) { return c_entryOverhead + sizeof(h256) + sizeof(Address) + _rlp.size(); }
+
+	static const size_t c_defaultMaxSize = 64 * 1024 * 1024;
+	/// Approximate per-entry overhead of the LRU list and hash map nodes.
+	static const size_t c_entryOverhead = 96;
+	static const size_t c_storageCost = c_entryOverhead + 2 * sizeof(h256) + sizeof(u256);
+	/// Commits remembered for following an account back to an older root.
+	static const size_t c_maxLineage = 4096;
+	/// Commits an account lookup walks back at most.
+	static const unsigned c_maxLineageDepth = 64;
+
+	mutable Mutex x_cache;
+	LruMap<std::pair<h256, Address>, std::string, RootKeyHash<Address>> m_accounts;
+	LruMap<std::pair<h256, h256>, u256, RootKeyHash<h256>> m_storage;
+	std::unordered_map<h256, Lineage> m_lineage;
+	std::deque<h256> m_lineageOrder;
+	std::atomic<uint64_t> m_hits{0};
+	std::atomic<uint64_t> m_misses{0};
+};
+
+}
+}
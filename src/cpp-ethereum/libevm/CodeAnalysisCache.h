@@ -0,0 +1,132 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file CodeAnalysisCache.h
+ * @date 2018
+ */
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Result of VM::optimize() for one piece of code: the extended and rewritten code
+ * buffer, the sorted jump destination table and the push constant pool. It only depends
+ * on the code, so it is shared read-only by every VM executing code with the same hash.
+ */
+struct CodeAnalysis
+{
+	bytes code;
+	std::vector<uint64_t> jumpDests;
+	std::vector<uint64_t> beginSubs;
+	u256 pool[256];
+
+	size_t memoryUsage() const
+	{
+		return sizeof(CodeAnalysis) + code.capacity() + (jumpDests.capacity() + beginSubs.capacity()) * sizeof(uint64_t);
+	}
+};
+
+/**
+ * @brief Thread-safe LRU cache of code analyses keyed by code hash, bounded by the memory
+ * used by the cached analyses.
+ */
+class CodeAnalysisCache
+{
+public:
+	/// Analysis of the code with hash _hash and size _codeSize, or null if not cached.
+	std::shared_ptr<CodeAnalysis> get(h256 const& _hash, size_t _codeSize)
+	{
+		UniqueGuard g(x_cache);
+		auto it = m_cache.find(_hash);
+		// The size check guards against a stale or mismatched hash for the running code.
+		if (it == m_cache.end() || it->second.first->code.size() != _codeSize + c_extraBytes)
+		{
+			++m_misses;
+			return nullptr;
+		}
+		m_lru.splice(m_lru.begin(), m_lru, it->second.second);
+		++m_hits;
+		return it->second.first;
+	}
+
+	void store(h256 const& _hash, std::shared_ptr<CodeAnalysis> const& _analysis)
+	{
+		size_t const usage = _analysis->memoryUsage();
+		UniqueGuard g(x_cache);
+		if (usage > m_maxSize || m_cache.count(_hash))
+			return;
+		while (!m_lru.empty() && m_usage + usage > m_maxSize)
+		{
+			auto it = m_cache.find(m_lru.back());
+			m_usage -= it->second.first->memoryUsage();
+			m_cache.erase(it);
+			m_lru.pop_back();
+		}
+		m_lru.push_front(_hash);
+		m_cache.emplace(_hash, std::make_pair(_analysis, m_lru.begin()));
+		m_usage += usage;
+	}
+
+	void setMaxSize(size_t _bytes)
+	{
+		UniqueGuard g(x_cache);
+		m_maxSize = _bytes;
+		while (!m_lru.empty() && m_usage > m_maxSize)
+		{
+			auto it = m_cache.find(m_lru.back());
+			m_usage -= it->second.first->memoryUsage();
+			m_cache.erase(it);
+			m_lru.pop_back();
+		}
+	}
+
+	uint64_t hits() const { return m_hits; }
+	uint64_t misses() const { return m_misses; }
+	size_t size() const { UniqueGuard g(x_cache); return m_cache.size(); }
+	size_t memoryUsage() const { UniqueGuard g(x_cache); return m_usage; }
+
+	static CodeAnalysisCache& instance() { static CodeAnalysisCache cache; return cache; }
+
+	/// Zero bytes appended to the code so that trailing PUSH data can be read without bounds checks.
+	static const size_t c_extraBytes = 33;
+
+private:
+	static const size_t c_defaultMaxSize = 32 * 1024 * 1024;
+
+	mutable Mutex x_cache;
+	std::unordered_map<h256, std::pair<std::shared_ptr<CodeAnalysis>, std::list<h256>::iterator>> m_cache;
+	std::list<h256> m_lru;	///< Most recently used first.
+	size_t m_usage = 0;
+	size_t m_maxSize = c_defaultMaxSize;
+	std::atomic<uint64_t> m_hits{0};
+	std::atomic<uint64_t> m_misses{0};
+};
+
+}
+}
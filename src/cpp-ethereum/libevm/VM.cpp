@@ -20,6 +20,7 @@
  */
 
 #include <libethereum/ExtVM.h>
+#include <libdevcore/Word256.h>
 #include "VMConfig.h"
 #include "VM.h"
 using namespace std;
@@ -272,7 +273,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			*m_SP = (u256)*(h256 const*)(m_mem.data() + (unsigned)*m_SP);
+			*m_SP = Word256::loadBigEndian(m_mem.data() + (unsigned)*m_SP).toU256();
 		}
 		NEXT
 
@@ -283,7 +284,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			*(h256*)&m_mem[(unsigned)*m_SP] = (h256)*(m_SP - 1);
+			Word256::fromU256(*(m_SP - 1)).storeBigEndian(&m_mem[(unsigned)*m_SP]);
 			m_SP -= 2;
 		}
 		NEXT
@@ -391,7 +392,7 @@ void VM::interpretCases()
 			updateIOGas();
 
 			//pops two items and pushes S[-1] + S[-2] mod 2^256.
-			*(m_SP - 1) += *m_SP;
+			*(m_SP - 1) = (Word256::fromU256(*(m_SP - 1)) + Word256::fromU256(*m_SP)).toU256();
 			--m_SP;
 		}
 		NEXT
@@ -405,7 +406,7 @@ void VM::interpretCases()
 #if EVM_HACK_MUL_64
 			*(uint64_t*)(m_SP - 1) *= *(uint64_t*)m_SP;
 #else
-			*(m_SP - 1) *= *m_SP;
+			*(m_SP - 1) = (Word256::fromU256(*(m_SP - 1)) * Word256::fromU256(*m_SP)).toU256();
 #endif
 			--m_SP;
 		}
@@ -416,7 +417,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			*(m_SP - 1) = *m_SP - *(m_SP - 1);
+			*(m_SP - 1) = (Word256::fromU256(*m_SP) - Word256::fromU256(*(m_SP - 1))).toU256();
 			--m_SP;
 		}
 		NEXT
@@ -426,7 +427,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			*(m_SP - 1) = *(m_SP - 1) ? divWorkaround(*m_SP, *(m_SP - 1)) : 0;
+			*(m_SP - 1) = (Word256::fromU256(*m_SP) / Word256::fromU256(*(m_SP - 1))).toU256();
 			--m_SP;
 		}
 		NEXT
@@ -446,7 +447,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			*(m_SP - 1) = *(m_SP - 1) ? modWorkaround(*m_SP, *(m_SP - 1)) : 0;
+			*(m_SP - 1) = (Word256::fromU256(*m_SP) % Word256::fromU256(*(m_SP - 1))).toU256();
 			--m_SP;
 		}
 		NEXT
@@ -876,13 +877,12 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			int numBytes = (int)m_OP - (int)Instruction::PUSH1 + 1;
-			*++m_SP = 0;
+			unsigned numBytes = (unsigned)m_OP - (unsigned)Instruction::PUSH1 + 1;
 			// Construct a number out of PUSH bytes.
 			// This requires the code has been copied and extended by 32 zero
 			// bytes to handle "out of code" push data here.
-			for (++m_PC; numBytes--; ++m_PC)
-				*m_SP = (*m_SP << 8) | m_code[m_PC];
+			*++m_SP = Word256::loadBigEndian(m_code + m_PC + 1, numBytes).toU256();
+			m_PC += numBytes + 1;
 		}
 		CONTINUE
 
@@ -28,6 +28,7 @@
 #include <libdevcore/SHA3.h>
 #include <libethcore/BlockHeader.h>
 #include "VMFace.h"
+#include "CodeAnalysisCache.h"
 
 namespace dev
 {
@@ -97,8 +98,8 @@ private:
 	// space for memory
 	bytes m_mem;
 
-	// space for code and pointer to data
-	bytes m_codeSpace;
+	// analysed code, shared with other VMs running the same code, and pointer to data
+	std::shared_ptr<CodeAnalysis> m_analysis;
 	byte* m_code = nullptr;
 
 	// space for stack and pointer to data
@@ -116,7 +117,7 @@ private:
 #endif
 
 	// constant pool
-	u256 m_pool[256];
+	u256 const* m_pool = nullptr;
 
 	// interpreter state
 	Instruction m_OP;                   // current operator
@@ -153,8 +154,6 @@ private:
 
 	void reportStackUse();
 
-	std::vector<uint64_t> m_beginSubs;
-	std::vector<uint64_t> m_jumpDests;
 	int64_t verifyJumpDest(u256 const& _dest, bool _throw = true);
 
 	int poolConstant(const u256&);
@@ -83,7 +83,7 @@ int64_t VM::verifyJumpDest(u256 const& _dest, bool _throw)
 		// check for within bounds and to a jump destination
 		// use binary search of array because hashtable collisions are exploitable
 		uint64_t pc = uint64_t(_dest);
-		if (std::binary_search(m_jumpDests.begin(), m_jumpDests.end(), pc))
+		if (std::binary_search(m_analysis->jumpDests.begin(), m_analysis->jumpDests.end(), pc))
 			return pc;
 	}
 	if (_throw)
@@ -55,18 +55,31 @@ void VM::copyCode(int _extraBytes)
 	// _extraBytes zero bytes to allow reading virtual data at the end
 	// of the code without bounds checks.
 	auto extendedSize = m_ext->code.size() + _extraBytes;
-	m_codeSpace.reserve(extendedSize);
-	m_codeSpace = m_ext->code;
-	m_codeSpace.resize(extendedSize);
-	m_code = m_codeSpace.data();
+	bytes& codeSpace = m_analysis->code;
+	codeSpace.reserve(extendedSize);
+	codeSpace = m_ext->code;
+	codeSpace.resize(extendedSize);
+	m_code = codeSpace.data();
 }
 
 void VM::optimize()
 {
-	copyCode(33);
-
 	size_t const nBytes = m_ext->code.size();
 
+	// the analysis depends on nothing but the code, so reuse the one of
+	// an earlier frame running the same code if it is still cached
+	CodeAnalysisCache& cache = CodeAnalysisCache::instance();
+	if (m_ext->codeHash && (m_analysis = cache.get(m_ext->codeHash, nBytes)))
+	{
+		m_code = m_analysis->code.data();
+		m_pool = m_analysis->pool;
+		return;
+	}
+
+	m_analysis = make_shared<CodeAnalysis>();
+	m_pool = m_analysis->pool;
+	copyCode(CodeAnalysisCache::c_extraBytes);
+
 	// build a table of jump destinations for use in verifyJumpDest
 	
 	TRACE_STR(1, "Build JUMPDEST table")
@@ -88,7 +101,7 @@ void VM::optimize()
 
 		if (op == Instruction::JUMPDEST)
 		{
-			m_jumpDests.push_back(pc);
+			m_analysis->jumpDests.push_back(pc);
 		}
 		else if (
 			(byte)Instruction::PUSH1 <= (byte)op &&
@@ -113,7 +126,7 @@ void VM::optimize()
 		}
 		else if (op == Instruction::BEGINSUB)
 		{
-			m_beginSubs.push_back(pc);
+			m_analysis->beginSubs.push_back(pc);
 		}
 		else if (op == Instruction::BEGINDATA)
 		{
@@ -165,7 +178,7 @@ void VM::optimize()
 				}
 				return table[hash] == val;
 			}
-		} constantPool(m_pool);
+		} constantPool(m_analysis->pool);
 		#define CONST_POOL_HASH_INIT() constantPool.hashInit()
 		#define CONST_POOL_HASH_BYTE(b) constantPool.hashByte(b)
 		#define CONST_POOL_GET_HASH() constantPool.getHash()
@@ -249,6 +262,9 @@ void VM::optimize()
 	}
 	TRACE_STR(1, "Finished optimizations")
 #endif	
+
+	if (m_ext->codeHash)
+		cache.store(m_ext->codeHash, m_analysis);
 }
 
 
@@ -17,6 +17,8 @@
 #include "utilstrencodings.h"
 #include "ui_interface.h"
 
+#include <set>
+
 #include <boost/algorithm/string.hpp> // boost::trim
 
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
@@ -84,6 +86,197 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     }
 }
 
+/** Results with at least this many array elements are sent as a chunked reply */
+static const size_t RPC_STREAM_MIN_ITEMS = 1000;
+/** Size of the chunks of a streamed reply */
+static const size_t RPC_STREAM_CHUNK_SIZE = 64 * 1024;
+
+static size_t CountArrayItems(const UniValue& value)
+{
+    size_t nItems = value.isArray() ? value.size() : 0;
+    if (value.isArray() || value.isObject()) {
+        for (size_t i = 0; i < value.size(); i++) {
+            const UniValue& child = value[i];
+            if (child.isArray() || child.isObject())
+                nItems += CountArrayItems(child);
+        }
+    }
+    return nItems;
+}
+
+/**
+ * Reply to a single JSON-RPC call whose result is written as a stream of chunks,
+ * either by the handler itself or from a large UniValue. The reply starts with the
+ * first chunk, so a result that was never streamed leaves the request untouched.
+ */
+class JSONRPCReplyStream
+{
+private:
+    HTTPRequest* req;
+    JSONStreamWriter writer;
+    bool fStarted;
+
+    void Send(const std::string& chunk)
+    {
+        if (!fStarted) {
+            // the chunked transfer ends when the connection closes
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteHeader("Connection", "close");
+            req->Chunk("{\"result\":" + chunk);
+            fStarted = true;
+            return;
+        }
+        req->Chunk(chunk);
+    }
+
+public:
+    explicit JSONRPCReplyStream(HTTPRequest* reqIn) : req(reqIn),
+                                                      writer(std::bind(&JSONRPCReplyStream::Send, this, std::placeholders::_1), RPC_STREAM_CHUNK_SIZE),
+                                                      fStarted(false)
+    {
+    }
+
+    JSONStreamWriter* Writer() { return &writer; }
+
+    bool Used() const { return writer.Used(); }
+
+    /** Complete the reply. An error after part of the result went out is reported next to it. */
+    void Finish(const UniValue& error, const UniValue& id)
+    {
+        writer.CloseAll();
+        writer.WriteRaw(",\"error\":" + error.write() + ",\"id\":" + id.write() + "}\n");
+        writer.Flush();
+        req->ChunkEnd();
+    }
+};
+
+/** Bytes of a request body searched for the method name when classifying it */
+static const size_t RPC_CLASSIFY_PEEK_SIZE = 512;
+
+/** Calls that scan an index, the chain or the wallet, and are run on the slow worker pool */
+static const char* const SLOW_RPC_METHODS[] = {
+    "getaddressdeltas", "getaddressmempool", "getaddresstxids", "getaddressutxos", "getaddressbalance",
+    "getblockhashes", "getchaintips", "getchaintxstats", "getrawmempool", "gettxoutsetinfo", "verifychain",
+    "getnetworkhashps", "generate", "pruneblockchain", "purgetxindex",
+    "callcontract", "listcontracts", "searchlogs", "tracetransaction", "gettokenhistory",
+    "backupwallet", "dumpwallet", "importwallet", "importprivkey", "importaddress", "importpubkey",
+    "keypoolrefill", "listaccounts", "listaddressbalances", "listaddressgroupings", "listreceivedbyaccount",
+    "listreceivedbyaddress", "listsinceblock", "listtransactions", "listunspent",
+};
+
+/** Calls that block until an event or a timeout, and are run on their own pool so
+ * that waiting clients cannot take every slow worker */
+static const char* const LONGPOLL_RPC_METHODS[] = {
+    "getblocktemplate", "waitforlogs",
+};
+
+static const char* const JSON_WHITESPACE = " \t\r\n";
+
+/** Position after the JSON string starting at nPos, or npos if it is cut off */
+static size_t SkipJSONString(const std::string& str, size_t nPos)
+{
+    for (nPos++; nPos < str.size(); nPos++) {
+        if (str[nPos] == '\\')
+            nPos++;
+        else if (str[nPos] == '"')
+            return nPos + 1;
+    }
+    return std::string::npos;
+}
+
+/** Position after the JSON value starting at nPos, or npos if it is cut off */
+static size_t SkipJSONValue(const std::string& str, size_t nPos)
+{
+    int nDepth = 0;
+    while (nPos < str.size()) {
+        char c = str[nPos];
+        if (c == '"') {
+            nPos = SkipJSONString(str, nPos);
+            if (nPos == std::string::npos || nDepth == 0)
+                return nPos;
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            nDepth++;
+        } else if (c == '}' || c == ']') {
+            if (nDepth == 0)
+                return nPos;
+            if (--nDepth == 0)
+                return nPos + 1;
+        } else if (c == ',' && nDepth == 0) {
+            return nPos;
+        }
+        nPos++;
+    }
+    return std::string::npos;
+}
+
+bool PeekRPCMethod(const std::string& strBody, std::string& strMethod)
+{
+    size_t nPos = strBody.find_first_not_of(JSON_WHITESPACE);
+    if (nPos == std::string::npos || strBody[nPos] != '{')
+        return false;
+    nPos++;
+    while (true) {
+        nPos = strBody.find_first_not_of(JSON_WHITESPACE, nPos);
+        if (nPos == std::string::npos || strBody[nPos] != '"')
+            return false;
+        size_t nKeyEnd = SkipJSONString(strBody, nPos);
+        if (nKeyEnd == std::string::npos)
+            return false;
+        bool fMethod = strBody.compare(nPos, nKeyEnd - nPos, "\"method\"") == 0;
+        nPos = strBody.find_first_not_of(JSON_WHITESPACE, nKeyEnd);
+        if (nPos == std::string::npos || strBody[nPos] != ':')
+            return false;
+        nPos = strBody.find_first_not_of(JSON_WHITESPACE, nPos + 1);
+        if (nPos == std::string::npos)
+            return false;
+        if (fMethod) {
+            if (strBody[nPos] != '"')
+                return false;
+            size_t nEnd = SkipJSONString(strBody, nPos);
+            if (nEnd == std::string::npos)
+                return false;
+            strMethod = strBody.substr(nPos + 1, nEnd - nPos - 2);
+            return true;
+        }
+        nPos = SkipJSONValue(strBody, nPos);
+        if (nPos == std::string::npos)
+            return false;
+        nPos = strBody.find_first_not_of(JSON_WHITESPACE, nPos);
+        if (nPos == std::string::npos || strBody[nPos] != ',')
+            return false;
+        nPos++;
+    }
+}
+
+HTTPWorkClass ClassifyRPCRequest(const std::string& strBody, std::string& label)
+{
+    static const std::set<std::string> setSlow(SLOW_RPC_METHODS, SLOW_RPC_METHODS + ARRAYLEN(SLOW_RPC_METHODS));
+    static const std::set<std::string> setLongPoll(LONGPOLL_RPC_METHODS, LONGPOLL_RPC_METHODS + ARRAYLEN(LONGPOLL_RPC_METHODS));
+
+    size_t nStart = strBody.find_first_not_of(JSON_WHITESPACE);
+    if (nStart != std::string::npos && strBody[nStart] == '[') {
+        label = "batch";
+        return HTTP_WORK_SLOW;
+    }
+    // Labels are limited to registered commands, so that clients cannot grow the metrics
+    std::string strMethod;
+    if (!PeekRPCMethod(strBody, strMethod) || !tableRPC[strMethod]) {
+        label = "other";
+        return HTTP_WORK_FAST;
+    }
+    label = strMethod;
+    if (setLongPoll.count(strMethod))
+        return HTTP_WORK_LONGPOLL;
+    return setSlow.count(strMethod) ? HTTP_WORK_SLOW : HTTP_WORK_FAST;
+}
+
+static HTTPWorkClass ClassifyJSONRPC(HTTPRequest* req, const std::string&, std::string& label)
+{
+    return ClassifyRPCRequest(req->PeekBody(RPC_CLASSIFY_PEEK_SIZE), label);
+}
+
 static bool RPCAuthorized(const std::string& strAuth)
 {
     if (strRPCUserColonPass.empty()) // Belt-and-suspenders measure if InitRPCAuthentication was not called
@@ -134,13 +327,34 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
+            JSONRPCReplyStream stream(req);
+            UniValue result;
+            try {
+                RPCResultStreamScope scope(stream.Writer());
+                result = tableRPC.execute(jreq.strMethod, jreq.params);
+            } catch (const UniValue& objError) {
+                if (!stream.Used())
+                    throw;
+                stream.Finish(objError, jreq.id);
+                return false;
+            }
+
+            if (stream.Used()) {
+                stream.Finish(NullUniValue, jreq.id);
+                return true;
+            }
 
             if (jreq.isLongPolling) {
                 jreq.PollReply(result);
                 return true;
             }
 
+            if (CountArrayItems(result) >= RPC_STREAM_MIN_ITEMS) {
+                stream.Writer()->Value(result);
+                stream.Finish(NullUniValue, jreq.id);
+                return true;
+            }
+
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
 
@@ -185,7 +399,7 @@ bool StartHTTPRPC()
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, ClassifyJSONRPC);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
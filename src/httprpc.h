@@ -7,6 +7,8 @@
 #ifndef BITCOIN_HTTPRPC_H
 #define BITCOIN_HTTPRPC_H
 
+#include "httpserver.h"
+
 #include <string>
 #include <map>
 
@@ -24,6 +26,16 @@ void InterruptHTTPRPC();
  */
 void StopHTTPRPC();
 
+/**
+ * Extract the top-level "method" of a JSON-RPC request from the start of its body.
+ * Keys of nested values such as params are skipped. A request whose method comes
+ * after the peeked bytes, or is written with escapes, is not recognized and runs
+ * as fast work under the "other" label; the handler still parses the whole body.
+ */
+bool PeekRPCMethod(const std::string& strBody, std::string& strMethod);
+/** Work class of a JSON-RPC request body, and the label its queue metrics are kept under */
+HTTPWorkClass ClassifyRPCRequest(const std::string& strBody, std::string& label);
+
 /** Start HTTP REST subsystem.
  * Precondition; HTTP and RPC has been started.
  */
@@ -8,6 +8,7 @@
 
 #include "chainparamsbase.h"
 #include "compat.h"
+#include "mpmcqueue.h"
 #include "util.h"
 #include "netbase.h"
 #include "rpcprotocol.h" // For HTTP status codes
@@ -22,7 +23,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <atomic>
 #include <future>
+#include <map>
 
 #include <event2/event.h>
 #include <event2/http.h>
@@ -49,7 +52,7 @@ class HTTPWorkItem : public HTTPClosure
 {
 public:
     HTTPWorkItem(std::unique_ptr<HTTPRequest> _req, const std::string &_path, const HTTPRequestHandler& _func):
-        req(std::move(_req)), path(_path), func(_func)
+        req(std::move(_req)), workClass(HTTP_WORK_FAST), nTimeQueued(0), path(_path), func(_func)
     {
     }
     void operator()()
@@ -58,84 +61,160 @@ public:
     }
 
     std::unique_ptr<HTTPRequest> req;
+    //! Name the request is accounted under in the queue metrics
+    std::string label;
+    HTTPWorkClass workClass;
+    int64_t nTimeQueued;
 
 private:
     std::string path;
     HTTPRequestHandler func;
 };
 
-/** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
+/** Per-label request counters, kept for getrpcqueueinfo */
+class HTTPWorkMetrics
+{
+private:
+    std::mutex cs;
+    std::map<std::string, HTTPWorkStats> mapStats;
+
+public:
+    void Started(const HTTPWorkItem& item, int64_t nWaitMicros)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        HTTPWorkStats& stats = mapStats[item.label];
+        stats.workClass = item.workClass;
+        stats.nRequests++;
+        stats.nWaitMicros += nWaitMicros;
+        stats.nMaxWaitMicros = std::max(stats.nMaxWaitMicros, nWaitMicros);
+    }
+
+    void Rejected(const HTTPWorkItem& item)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        HTTPWorkStats& stats = mapStats[item.label];
+        stats.workClass = item.workClass;
+        stats.nRejected++;
+    }
+
+    std::map<std::string, HTTPWorkStats> Get()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        return mapStats;
+    }
+};
+
+/** Work queue for distributing requests over pools of fast, slow and long-poll
+ * worker threads. Each work class has its own lock-free bounded queue, so cheap
+ * requests never wait behind expensive ones. Fast and long-poll workers only take
+ * their own work; slow workers prefer slow work but are woken for fast work when
+ * every fast worker is busy. Workers sleep on a per-pool semaphore that is posted
+ * once for every item queued for the pool.
+ *
+ * Only the event loop thread enqueues, from http_request_cb. Enqueue is written
+ * for that single producer: it pushes, posts and decides from the idle counts
+ * whether a slow worker should help without taking a lock. Concurrent producers
+ * would need a lock around those steps.
  */
-template <typename WorkItem>
 class WorkQueue
 {
 private:
-    /** Mutex protects entire object */
-    std::mutex cs;
-    std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
-    bool running;
-    size_t maxDepth;
+    std::unique_ptr<BoundedMPMCQueue<HTTPWorkItem*> > queues[HTTP_WORK_CLASSES];
+    std::unique_ptr<CSemaphore> signals[HTTP_WORK_CLASSES];
+    std::atomic<int> nIdle[HTTP_WORK_CLASSES];
+    std::atomic<int> nThreads[HTTP_WORK_CLASSES];
+    std::atomic<bool> running;
 
 public:
-    explicit WorkQueue(size_t _maxDepth) : running(true),
-                                 maxDepth(_maxDepth)
+    HTTPWorkMetrics metrics;
+
+    explicit WorkQueue(size_t _maxDepth) : running(true)
     {
+        for (int i = 0; i < HTTP_WORK_CLASSES; i++) {
+            queues[i].reset(new BoundedMPMCQueue<HTTPWorkItem*>(_maxDepth));
+            signals[i].reset(new CSemaphore(0));
+            nIdle[i] = 0;
+            nThreads[i] = 0;
+        }
     }
     /*( Precondition: worker threads have all stopped
      * (call WaitExit)
      */
     ~WorkQueue()
     {
+        // Requests still queued are answered by their destructor
+        for (int i = 0; i < HTTP_WORK_CLASSES; i++) {
+            HTTPWorkItem* item;
+            while (queues[i]->TryPop(item))
+                delete item;
+        }
     }
-    /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    /** Enqueue a work item; called on the event loop thread only */
+    bool Enqueue(HTTPWorkItem* item)
     {
-        std::unique_lock<std::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        item->nTimeQueued = GetTimeMicros();
+        if (!queues[item->workClass]->TryPush(item))
             return false;
-        }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
-        cond.notify_one();
+        signals[item->workClass]->post();
+        if (item->workClass == HTTP_WORK_FAST && nIdle[HTTP_WORK_FAST] == 0 && nIdle[HTTP_WORK_SLOW] > 0)
+            signals[HTTP_WORK_SLOW]->post();
         return true;
     }
     /** Thread function */
-    void Run()
+    void Run(HTTPWorkClass workClass)
     {
+        nThreads[workClass]++;
         while (true) {
-            std::unique_ptr<WorkItem> i;
-            {
-                std::unique_lock<std::mutex> lock(cs);
-                while (running && queue.empty())
-                    cond.wait(lock);
-                if (!running)
-                    break;
-                i = std::move(queue.front());
-                queue.pop_front();
+            nIdle[workClass]++;
+            signals[workClass]->wait();
+            nIdle[workClass]--;
+            if (!running)
+                break;
+            HTTPWorkItem* pitem;
+            if (!queues[workClass]->TryPop(pitem)) {
+                // a slow worker may have taken it, or this is a slow worker helping out
+                if (workClass != HTTP_WORK_SLOW || !queues[HTTP_WORK_FAST]->TryPop(pitem))
+                    continue;
             }
+            std::unique_ptr<HTTPWorkItem> i(pitem);
+            metrics.Started(*i, GetTimeMicros() - i->nTimeQueued);
             (*i)();
         }
+        nThreads[workClass]--;
     }
     /** Interrupt and exit loops */
-    void Interrupt()
+    void Interrupt(int nWorkers)
     {
-        std::unique_lock<std::mutex> lock(cs);
         running = false;
-        cond.notify_all();
+        for (int i = 0; i < HTTP_WORK_CLASSES; i++) {
+            for (int j = 0; j < nWorkers; j++)
+                signals[i]->post();
+        }
+    }
+
+    HTTPQueueStats GetQueueStats(HTTPWorkClass workClass) const
+    {
+        HTTPQueueStats stats;
+        stats.workClass = workClass;
+        stats.nDepth = queues[workClass]->Size();
+        stats.nCapacity = queues[workClass]->Capacity();
+        stats.nThreads = nThreads[workClass];
+        stats.nIdle = nIdle[workClass];
+        return stats;
     }
 };
 
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPRequestClassifier _classifier):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), classifier(_classifier)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPRequestClassifier classifier;
 };
 
 /** HTTP module state */
@@ -147,7 +226,7 @@ struct evhttp* eventHTTP = nullptr;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
-static WorkQueue<HTTPClosure>* workQueue = nullptr;
+static WorkQueue* workQueue = nullptr;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 std::vector<evhttp_bound_socket *> boundSockets;
@@ -260,11 +339,16 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
     // Dispatch to worker thread
     if (i != iend) {
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
+        if (i->classifier)
+            item->workClass = i->classifier(item->req.get(), path, item->label);
+        else
+            item->label = i->prefix;
         assert(workQueue);
         if (workQueue->Enqueue(item.get()))
             item.release(); /* if true, queue took ownership */
         else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            LogPrintf("WARNING: %s request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n", item->label);
+            workQueue->metrics.Rejected(*item);
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
         }
     } else {
@@ -329,10 +413,11 @@ static bool HTTPBindAddresses(struct evhttp* http)
 }
 
 /** Simple wrapper to set thread name and run work queue */
-static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue)
+static void HTTPWorkQueueRun(WorkQueue* queue, HTTPWorkClass workClass)
 {
-    RenameThread("bitcoin-httpworker");
-    queue->Run();
+    static const char* const THREAD_NAMES[HTTP_WORK_CLASSES] = {"bitcoin-httpworker", "bitcoin-httpslow", "bitcoin-httppoll"};
+    RenameThread(THREAD_NAMES[workClass]);
+    queue->Run(workClass);
 }
 
 /** libevent event log callback */
@@ -398,9 +483,8 @@ bool InitHTTPServer()
 
     LogPrint("http", "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
-
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    workQueue = new WorkQueue(workQueueDepth);
+    LogPrintf("HTTP: creating work queues of depth %d\n", workQueue->GetQueueStats(HTTP_WORK_FAST).nCapacity);
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -429,13 +513,21 @@ bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
     int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
+    int rpcSlowThreads = std::max((long)GetArg("-rpcslowthreads", DEFAULT_HTTP_SLOW_THREADS), 1L);
+    int rpcLongPollThreads = std::max((long)GetArg("-rpclongpollthreads", DEFAULT_HTTP_LONGPOLL_THREADS), 1L);
+    LogPrintf("HTTP: starting %d worker threads, %d for slow requests and %d for long polls\n", rpcThreads, rpcSlowThreads, rpcLongPollThreads);
     std::packaged_task<bool(event_base*)> task(ThreadHTTP);
     threadResult = task.get_future();
     threadHTTP = std::thread(std::move(task), eventBase);
 
     for (int i = 0; i < rpcThreads; i++) {
-        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue);
+        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue, HTTP_WORK_FAST);
+    }
+    for (int i = 0; i < rpcSlowThreads; i++) {
+        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue, HTTP_WORK_SLOW);
+    }
+    for (int i = 0; i < rpcLongPollThreads; i++) {
+        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue, HTTP_WORK_LONGPOLL);
     }
     return true;
 }
@@ -452,7 +544,7 @@ void InterruptHTTPServer()
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, NULL);
     }
     if (workQueue)
-        workQueue->Interrupt();
+        workQueue->Interrupt(g_thread_http_workers.size());
 }
 
 
@@ -635,6 +727,17 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+std::string HTTPRequest::PeekBody(size_t nMaxSize)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    std::string rv(std::min(evbuffer_get_length(buf), nMaxSize), '\0');
+    ev_ssize_t nCopied = evbuffer_copyout(buf, &rv[0], rv.size());
+    rv.resize(nCopied > 0 ? nCopied : 0);
+    return rv;
+}
+
 bool HTTPRequest::ReplySent() {
     return replySent;
 }
@@ -761,10 +864,21 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &classifier)
 {
     LogPrint("http", "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classifier));
+}
+
+bool GetHTTPWorkQueueStats(std::vector<HTTPQueueStats>& vQueues, std::map<std::string, HTTPWorkStats>& mapRequests)
+{
+    if (!workQueue)
+        return false;
+    vQueues.clear();
+    for (int i = 0; i < HTTP_WORK_CLASSES; i++)
+        vQueues.push_back(workQueue->GetQueueStats((HTTPWorkClass)i));
+    mapRequests = workQueue->metrics.Get();
+    return true;
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
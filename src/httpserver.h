@@ -10,10 +10,14 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <map>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_SLOW_THREADS=2;
+static const int DEFAULT_HTTP_LONGPOLL_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
@@ -36,16 +40,55 @@ void InterruptHTTPServer();
 /** Stop HTTP server */
 void StopHTTPServer();
 
+/** Worker pool a request is run on. Slow requests have their own threads, so
+ * that they cannot hold up cheap ones, and so do long polls, which mostly wait. */
+enum HTTPWorkClass
+{
+    HTTP_WORK_FAST,
+    HTTP_WORK_SLOW,
+    HTTP_WORK_LONGPOLL,
+    HTTP_WORK_CLASSES
+};
+
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Chooses the work class of a request and sets the label its queue metrics are
+ * kept under. Runs on the event loop thread before the request is queued, so it
+ * must be cheap and must not consume the request body. */
+typedef std::function<HTTPWorkClass(HTTPRequest* req, const std::string &, std::string &label)> HTTPRequestClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Without a classifier, requests are fast and labelled by prefix.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &classifier = HTTPRequestClassifier());
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** State of the queue of one work class */
+struct HTTPQueueStats
+{
+    HTTPWorkClass workClass;
+    size_t nDepth;
+    size_t nCapacity;
+    int nThreads;
+    int nIdle;
+};
+
+/** Counters of the requests with one label */
+struct HTTPWorkStats
+{
+    HTTPWorkClass workClass;
+    uint64_t nRequests;
+    uint64_t nRejected;
+    int64_t nWaitMicros;  //!< total time spent queued by the started requests
+    int64_t nMaxWaitMicros;
+
+    HTTPWorkStats() : workClass(HTTP_WORK_FAST), nRequests(0), nRejected(0), nWaitMicros(0), nMaxWaitMicros(0) {}
+};
+
+/** Snapshot of the work queue metrics, or false if the HTTP server is not running */
+bool GetHTTPWorkQueueStats(std::vector<HTTPQueueStats>& vQueues, std::map<std::string, HTTPWorkStats>& mapRequests);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -109,6 +152,12 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Copy up to nMaxSize bytes from the start of the request body, leaving
+     * it in place for ReadBody.
+     */
+    std::string PeekBody(size_t nMaxSize);
+
     /**
      * Write output header.
      *
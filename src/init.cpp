@@ -23,6 +23,9 @@
 #include "httprpc.h"
 #include "key.h"
 #include "luxcontrol.h"
+#include "lux/luxcallengine.h"
+#include <libevm/CodeAnalysisCache.h>
+#include <libdevcore/SHA3.h>
 #include "main.h"
 #include "stake.h"
 #include "masternodeconfig.h"
@@ -30,6 +33,7 @@
 #include "miner.h"
 #include "net.h"
 #include "policy/policy.h"
+#include "rpccache.h"
 #include "rpcserver.h"
 #include "script/standard.h"
 #include "script/sigcache.h"
@@ -211,6 +215,11 @@ void PrepareShutdown()
     StopREST();
     StopRPC();
     StopHTTPServer();
+    if (pluxCallEngine) {
+        pluxCallEngine->Stop();
+        delete pluxCallEngine;
+        pluxCallEngine = NULL;
+    }
 #ifdef ENABLE_WALLET
     if (pwalletMain)
         bitdb.Flush(false);
@@ -396,11 +405,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
+    strUsage += HelpMessageOpt("-batchsigverify", strprintf(_("Verify Schnorr signatures in batches on the script verification threads (default: %u)"), DEFAULT_BATCH_SIG_VERIFY));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (1 to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), (int)boost::thread::hardware_concurrency(), DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), "luxd.pid"));
 #endif
     strUsage += HelpMessageOpt("-record-log-opcodes", _("Logs all EVM LOG opcode operations to the file vmExecLogs.json"));
+    strUsage += HelpMessageOpt("-evmcodecache=<n>", strprintf(_("Set the memory for analysed contract code reused across EVM calls in megabytes (0 to disable, default: %u)"), DEFAULT_EVM_CODE_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-evmstatecache=<n>", strprintf(_("Set the memory for contract accounts and storage kept across blocks in megabytes (0 to disable, default: %u)"), DEFAULT_EVM_STATE_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-callcontractthreads=<n>", strprintf(_("Set the number of threads serving callcontract without the global contract state (0 to %d, 0 = run under the chain lock, default: %d)"), MAX_CALLCONTRACT_THREADS, DEFAULT_CALLCONTRACT_THREADS));
     //Temporarily disabled until our chain doesn't grow in size
     //strUsage += HelpMessageOpt("-prune=<n>", _("Reduce storage requirements by pruning (deleting) old blocks. This mode disables wallet support and is incompatible with -txindex.") + " " + _("Warning: Reverting this setting requires re-downloading the entire blockchain.") + " " + _("(default: 0 = disable pruning blocks,") + " " + strprintf(_(">%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-reindex-chainstate", _("Rebuild chain state from the currently indexed blocks"));
@@ -412,6 +425,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
     strUsage += HelpMessageOpt("-logevents", strprintf(_("Maintain a full EVM log index, used by searchlogs and gettransactionreceipt rpc calls (default: %u)"), false));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain an index of BIP158 compact block filters, built in the background, used by the getblockfilter rpc call (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
+    strUsage += HelpMessageOpt("-peerblockfilters", strprintf(_("Serve compact block filters to peers per BIP 157; requires -blockfilterindex (default: %u)"), DEFAULT_PEERBLOCKFILTERS));
+    strUsage += HelpMessageOpt("-tokenindex", strprintf(_("Maintain an index of token Transfer events with running balances, used by the gettokenbalance and gettokenhistory rpc calls; requires -logevents (default: %u)"), DEFAULT_TOKENINDEX));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
@@ -434,6 +450,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-port=<port>", strprintf(_("Listen for connections on <port> (default: %u or testnet: %u)"), 26969, 28333));
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+#ifdef USE_EPOLL
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("How to wait for peer sockets: select, or epoll which is not limited to %u connections (default: %s)"), FD_SETSIZE, DEFAULT_SOCKETEVENTS));
+#endif
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
 #ifdef USE_UPNP
 #if USE_UPNP
@@ -483,6 +502,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtxlock=<address>", _("Enable publish raw transaction (locked via InstanTX) in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawreceipts=<address>", _("Enable publish contract execution receipts of connected blocks in <address> (requires -logevents)"));
+    strUsage += HelpMessageOpt("-zmqpublogs=<address>", _("Enable publish contract event logs of connected blocks in <address> (requires -logevents)"));
+    strUsage += HelpMessageOpt("-zmqpubmempoolremove=<address>", _("Enable publish hash and removal reason of transactions leaving the mempool in <address>"));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -562,7 +584,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", _("Password for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 9888, 9777));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
-    strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), 4));
+    strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpclongpollthreads=<n>", strprintf(_("Set the number of threads to service RPC calls that wait for an event, such as getblocktemplate long polls (default: %d)"), DEFAULT_HTTP_LONGPOLL_THREADS));
+    strUsage += HelpMessageOpt("-rpcslowthreads=<n>", strprintf(_("Set the number of threads to service RPC calls that scan indexes or the wallet (default: %d)"), DEFAULT_HTTP_SLOW_THREADS));
+    strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf(_("Set the depth of the work queue of each RPC thread pool, rounded up to a power of two (default: %d)"), DEFAULT_HTTP_WORKQUEUE));
+    strUsage += HelpMessageOpt("-rpccachesize=<n>", strprintf(_("Set the memory for cached RPC and REST results about old blocks in megabytes, 0 to disable (default: %u)"), DEFAULT_RPC_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-rpccachedepth=<n>", strprintf(_("Cache RPC and REST results about blocks with at least <n> confirmations (default: %d)"), DEFAULT_RPC_CACHE_DEPTH));
     strUsage += HelpMessageOpt("-rpckeepalive", strprintf(_("RPC support for HTTP persistent connections (default: %d)"), 1));
 
     strUsage += HelpMessageGroup(_("RPC SSL options: (see the Bitcoin Wiki for SSL setup instructions)"));
@@ -590,6 +617,11 @@ std::string LicenseInfo()
            "\n";
 }
 
+static void RPCCacheBlockTipCallback(bool initialSync, const CBlockIndex *pBlockIndex)
+{
+    rpcResponseCache.BlockTipChanged(pBlockIndex);
+}
+
 static void BlockNotifyCallback(bool initialSync, const CBlockIndex *pBlockIndex)
 {
     if (initialSync || !pBlockIndex)
@@ -733,6 +765,9 @@ bool AppInitServers()
 {
     RPCServer::OnStopped(&OnRPCStopped);
     RPCServer::OnPreCommand(&OnRPCPreCommand);
+    rpcResponseCache.SetLimits(std::max<int64_t>(GetArg("-rpccachesize", DEFAULT_RPC_CACHE_SIZE), 0) << 20,
+                               GetArg("-rpccachedepth", DEFAULT_RPC_CACHE_DEPTH));
+    uiInterface.NotifyBlockTip.connect(RPCCacheBlockTipCallback);
     if (!InitHTTPServer())
         return false;
     if (!StartRPC())
@@ -904,17 +939,33 @@ bool AppInit2()
     // (we must reconnect blocks whenever we disconnect them for these indexes to work)
     bool fAdditionalIndexes =
         GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ||
-        GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+        GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ||
+        GetBoolArg("-tokenindex", DEFAULT_TOKENINDEX);
 
     if (fAdditionalIndexes && GetArg("-checklevel", DEFAULT_CHECKLEVEL) < 4) {
         ForceSetArg("-checklevel", "4");
         LogPrintf("%s: parameter interaction: additional indexes -> setting -checklevel=4\n", __func__);
     }
 
+    if (GetBoolArg("-tokenindex", DEFAULT_TOKENINDEX) && !GetBoolArg("-logevents", DEFAULT_LOGEVENTS))
+        return InitError(_("-tokenindex requires -logevents"));
+
+    std::string strSocketEvents = GetArg("-socketevents", DEFAULT_SOCKETEVENTS);
+    if (strSocketEvents == "select")
+        nSocketEventsMode = SOCKETEVENTS_SELECT;
+#ifdef USE_EPOLL
+    else if (strSocketEvents == "epoll")
+        nSocketEventsMode = SOCKETEVENTS_EPOLL;
+#endif
+    else
+        return InitError(strprintf(_("Unknown -socketevents mode: '%s'"), strSocketEvents));
+
     // Make sure enough file descriptors are available
     int nBind = std::max((int)mapArgs.count("-bind") + (int)mapArgs.count("-whitebind"), 1);
     nMaxConnections = GetArg("-maxconnections", 125);
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    if (nSocketEventsMode == SOCKETEVENTS_SELECT)
+        nMaxConnections = std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS));
+    nMaxConnections = std::max(nMaxConnections, 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -980,6 +1031,8 @@ bool AppInit2()
     if (maxMempoolSize < 0)
         return InitError(_("Error: -maxmempool must be at least %d MB"));
 
+    fBatchSigVerify = GetBoolArg("-batchsigverify", DEFAULT_BATCH_SIG_VERIFY);
+
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
     if (nScriptCheckThreads <= 0)
@@ -1092,9 +1145,17 @@ bool AppInit2()
     if (GetBoolArg("-peerbloomfilters", false))
         nLocalServices = ServiceFlags(nLocalServices | NODE_BLOOM);
 
+    fBlockFilterIndex = GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    if (GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        if (!fBlockFilterIndex)
+            return InitError(_("Cannot set -peerblockfilters without -blockfilterindex."));
+        nLocalServices = ServiceFlags(nLocalServices | NODE_COMPACT_FILTERS);
+    }
+
     // ********************************************************* Step 4: application initialization: dir lock, daemonize, pidfile, debug log
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
+    std::string keccak_algo = dev::sha3AutoDetect();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
 
@@ -1127,6 +1188,7 @@ bool AppInit2()
     LogPrintf("LUX version %s (%s)\n", FormatFullVersion(), CLIENT_DATE);
     LogPrintf("Using OpenSSL version %s\n", SSLeay_version(SSLEAY_VERSION));
     LogPrintf("Using the %s SHA256 implementation\n", sha256_algo.c_str());
+    LogPrintf("Using the %s Keccak-f[1600] implementation\n", keccak_algo.c_str());
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
 #endif
@@ -1150,6 +1212,9 @@ bool AppInit2()
     if (nScriptCheckThreads) {
         for (int i = 0; i < nScriptCheckThreads - 1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        // loose transactions get half as many workers, so the total stays close to -par
+        for (int i = 0; i < (nScriptCheckThreads - 1) / 2; i++)
+            threadGroup.create_thread(&ThreadMempoolScriptCheck);
     }
 
     if (mapArgs.count("-sporkkey")) // spork priv key
@@ -1565,6 +1630,8 @@ bool AppInit2()
 
 
                 fRecordLogOpcodes = GetBoolArg("-record-log-opcodes", true);
+                dev::eth::CodeAnalysisCache::instance().setMaxSize((size_t)std::max((int64_t)0, GetArg("-evmcodecache", DEFAULT_EVM_CODE_CACHE_SIZE)) << 20);
+                dev::eth::StateCache::instance().setMaxSize((size_t)std::max((int64_t)0, GetArg("-evmstatecache", DEFAULT_EVM_STATE_CACHE_SIZE)) << 20);
                 fIsVMlogFile = boost::filesystem::exists(GetDataDir() / "vmExecLogs.json");
                 ///////////////////////////////////////////////////////////
 
@@ -1594,6 +1661,18 @@ bool AppInit2()
                     pblocktree->WriteFlag("logevents", fLogEvents);
                 }
 
+                // Check for changed -tokenindex state
+                if (!fTokenIndex && GetBoolArg("-tokenindex", DEFAULT_TOKENINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to enable -tokenindex");
+                    break;
+                }
+
+                if (fTokenIndex && !GetBoolArg("-tokenindex", DEFAULT_TOKENINDEX)) {
+                    pblocktree->WipeTokenIndex();
+                    fTokenIndex = false;
+                    pblocktree->WriteFlag("tokenindex", fTokenIndex);
+                }
+
                 nLogFile = GetArg("-nlogfile", 1);
 
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
@@ -1902,6 +1981,9 @@ bool AppInit2()
             MilliSleep(10);
     }
 
+    if (fBlockFilterIndex)
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "blockfilter", &ThreadBlockFilterIndex));
+
     // Add wallet transactions that aren't already in a block to mempool
     // Do this here as mempool requires genesis block to be loaded
 #ifdef ENABLE_WALLET
@@ -1985,6 +2067,13 @@ bool AppInit2()
     darkSendPool.InitCollateralAddress();
 
     threadGroup.create_thread(boost::bind(&ThreadCheckDarkSendPool));
+    threadGroup.create_thread(boost::bind(&ThreadMasternodeAnnounceVerify));
+
+    int nCallContractThreads = std::max(0, std::min((int)GetArg("-callcontractthreads", DEFAULT_CALLCONTRACT_THREADS), MAX_CALLCONTRACT_THREADS));
+    if (nCallContractThreads > 0) {
+        pluxCallEngine = new LuxCallEngine();
+        pluxCallEngine->Start(nCallContractThreads);
+    }
 
     // ********************************************************* Step 11: start node
 
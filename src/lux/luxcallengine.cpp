@@ -0,0 +1,234 @@
+#include <lux/luxcallengine.h>
+#include <lux/luxDGP.h>
+#include "chainparams.h"
+#include "main.h"
+#include "timedata.h"
+#include "ui_interface.h"
+#include "util.h"
+
+#include <libethereum/ChainParams.h>
+#include <libethashseal/GenesisInfo.h>
+
+#include <future>
+
+#include <boost/bind.hpp>
+
+LuxCallEngine* pluxCallEngine = nullptr;
+
+static ResultExecute ExecuteCall(const LuxCallSnapshot& snapshot, dev::eth::SealEngineFace& sealEngine, const LuxTransaction& tx, LuxExecutionProfiler* profiler)
+{
+    // Private copy: execution and even account lookups write into the state caches.
+    LuxState state(*snapshot.state);
+    if(!state.addressInUse(tx.receiveAddress())){
+        dev::eth::ExecutionResult execRes;
+        execRes.excepted = dev::eth::TransactionException::Unknown;
+        return ResultExecute{execRes, dev::eth::TransactionReceipt(dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction()};
+    }
+
+    dev::eth::EnvInfo envInfo(snapshot.env);
+    envInfo.setTimestamp(dev::u256(GetAdjustedTime()));
+    sealEngine.setLuxSchedule(snapshot.schedule);
+    ResultExecute result = state.execute(envInfo, sealEngine, tx, dev::eth::Permanence::Reverted, profiler ? profiler->Hook() : OnOpFunc());
+    sealEngine.deleteAddresses.clear();
+    if(profiler)
+        profiler->Finish();
+    return result;
+}
+
+LuxCallEngine::~LuxCallEngine()
+{
+    Stop();
+}
+
+bool LuxCallEngine::Start(int nThreads)
+{
+    if(nThreads <= 0 || IsRunning())
+        return false;
+
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+    uiInterface.NotifyBlockTip.connect(boost::bind(&LuxCallEngine::BlockTipChanged, this, _1, _2));
+
+    fShutdown = false;
+    nWorkers = nThreads;
+    for(int i = 0; i < nThreads; i++)
+        threads.create_thread(boost::bind(&LuxCallEngine::ThreadWorker, this));
+    LogPrintf("LuxCallEngine: started %d contract call threads\n", nThreads);
+    return true;
+}
+
+void LuxCallEngine::Stop()
+{
+    if(!IsRunning())
+        return;
+
+    uiInterface.NotifyBlockTip.disconnect(boost::bind(&LuxCallEngine::BlockTipChanged, this, _1, _2));
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        fShutdown = true;
+    }
+    cond.notify_all();
+    threads.join_all();
+    nWorkers = 0;
+
+    boost::lock_guard<boost::mutex> lock(csSnapshots);
+    snapshots.clear();
+}
+
+size_t LuxCallEngine::PendingCalls()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return queue.size();
+}
+
+void LuxCallEngine::BlockTipChanged(bool fInitialDownload, const CBlockIndex* pindex)
+{
+    pindexTip = pindex;
+}
+
+void LuxCallEngine::ThreadWorker()
+{
+    RenameThread("lux-callcontract");
+
+    // The seal engine carries the gas schedule and the touched addresses of the
+    // running call, so every worker needs its own.
+    dev::eth::ChainParams cp((dev::eth::genesisInfo(dev::eth::Network::luxMainNetwork)));
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine(cp.createSealEngine());
+
+    while(true){
+        CallTask task;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            while(!fShutdown && queue.empty())
+                cond.wait(lock);
+            // Pending calls are drained before exiting so that no caller is left waiting.
+            if(queue.empty())
+                return;
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+        task(*sealEngine);
+    }
+}
+
+LuxCallSnapshotRef LuxCallEngine::BuildSnapshot(const CBlockIndex* pindex, std::string& strError)
+{
+    CBlock block;
+    if(!ReadBlockFromDisk(block, pindex, Params().GetConsensus())){
+        strError = "Can't read block from disk";
+        return LuxCallSnapshotRef();
+    }
+
+    std::shared_ptr<LuxCallSnapshot> snapshot = std::make_shared<LuxCallSnapshot>();
+    snapshot->hashBlock = pindex->GetBlockHash();
+    snapshot->nHeight = pindex->nHeight;
+    {
+        // The global state is only copied here; the DGP contracts may be evaluated
+        // through it as well, so both need cs_main. This happens once per block.
+        LOCK(cs_main);
+        LuxState* state = new LuxState(*globalState);
+        snapshot->state.reset(state);
+        state->setRoot(uintToh256(pindex->hashStateRoot));
+        state->setRootUTXO(uintToh256(pindex->hashUTXORoot));
+
+        LuxDGP luxDGP(state, fGettingValuesDGP);
+        snapshot->blockGasLimit = luxDGP.getBlockGasLimit(pindex->nHeight + 1);
+        snapshot->schedule = luxDGP.getGasSchedule(pindex->nHeight + 1);
+    }
+
+    ByteCodeExec exec(block, std::vector<LuxTransaction>(), snapshot->blockGasLimit);
+    snapshot->env = exec.BuildEVMEnvironment(pindex);
+
+    LogPrint("rpc", "%s: snapshot at height %d (%s)\n", __func__, pindex->nHeight, snapshot->hashBlock.ToString());
+    return snapshot;
+}
+
+LuxCallSnapshotRef LuxCallEngine::GetSnapshot(int nHeight, std::string& strError)
+{
+    const CBlockIndex* pindex = pindexTip;
+    if(pindex == nullptr){
+        strError = "No active chain";
+        return LuxCallSnapshotRef();
+    }
+    if(nHeight >= 0){
+        if(nHeight > pindex->nHeight){
+            strError = "Block height out of range";
+            return LuxCallSnapshotRef();
+        }
+        // Ancestor links never change, so this walk needs no lock.
+        pindex = pindex->GetAncestor(nHeight);
+    }
+    if(pindex->nHeight < Params().FirstSCBlock()){
+        strError = "Smart contracts are not active at this height";
+        return LuxCallSnapshotRef();
+    }
+
+    const uint256 hashBlock = pindex->GetBlockHash();
+    {
+        boost::lock_guard<boost::mutex> lock(csSnapshots);
+        for(std::list<LuxCallSnapshotRef>::iterator it = snapshots.begin(); it != snapshots.end(); ++it){
+            if((*it)->hashBlock == hashBlock){
+                snapshots.splice(snapshots.begin(), snapshots, it);
+                return snapshots.front();
+            }
+        }
+    }
+
+    LuxCallSnapshotRef snapshot = BuildSnapshot(pindex, strError);
+    if(!snapshot)
+        return snapshot;
+
+    boost::lock_guard<boost::mutex> lock(csSnapshots);
+    for(const LuxCallSnapshotRef& cached : snapshots){
+        // Another caller built the same block in the meantime
+        if(cached->hashBlock == hashBlock)
+            return cached;
+    }
+    snapshots.push_front(snapshot);
+    if(snapshots.size() > CALLCONTRACT_SNAPSHOT_CACHE_SIZE)
+        snapshots.pop_back();
+    return snapshot;
+}
+
+bool LuxCallEngine::AddressInUse(const LuxCallSnapshotRef& snapshot, const dev::Address& addr) const
+{
+    LuxState state(*snapshot->state);
+    return state.addressInUse(addr);
+}
+
+bool LuxCallEngine::Call(const LuxCallSnapshotRef& snapshot, const dev::Address& addrContract, const std::vector<unsigned char>& opcode,
+                         const dev::Address& sender, uint64_t gasLimit, std::vector<ResultExecute>& results, std::string& strError,
+                         LuxExecutionProfiler* profiler)
+{
+    if(gasLimit == 0){
+        gasLimit = snapshot->blockGasLimit - 1;
+    }
+    dev::Address senderAddress = sender == dev::Address() ? dev::Address("ffffffffffffffffffffffffffffffffffffffff") : sender;
+
+    LuxTransaction callTransaction(0, 1, dev::u256(gasLimit), addrContract, opcode, dev::u256(0));
+    callTransaction.forceSender(senderAddress);
+    callTransaction.setVersion(VersionVM::GetEVMDefault());
+
+    typedef std::packaged_task<ResultExecute(dev::eth::SealEngineFace&)> CallPackage;
+    std::shared_ptr<CallPackage> package = std::make_shared<CallPackage>(
+        [snapshot, callTransaction, profiler](dev::eth::SealEngineFace& sealEngine){ return ExecuteCall(*snapshot, sealEngine, callTransaction, profiler); });
+    std::future<ResultExecute> future = package->get_future();
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if(fShutdown || nWorkers == 0){
+            strError = "Contract call engine is not running";
+            return false;
+        }
+        if(queue.size() >= CALLCONTRACT_QUEUE_SIZE){
+            strError = "Too many pending contract calls";
+            return false;
+        }
+        queue.push_back([package](dev::eth::SealEngineFace& sealEngine){ (*package)(sealEngine); });
+    }
+    cond.notify_one();
+
+    results.push_back(future.get());
+    return true;
+}
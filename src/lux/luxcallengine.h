@@ -0,0 +1,102 @@
+#ifndef LUXCALLENGINE_H
+#define LUXCALLENGINE_H
+
+#include <lux/luxstate.h>
+#include <lux/luxtrace.h>
+#include "uint256.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+
+#include <boost/thread.hpp>
+
+static const int DEFAULT_CALLCONTRACT_THREADS = 4;
+static const int MAX_CALLCONTRACT_THREADS = 16;
+/** Number of block state snapshots kept for read-only calls */
+static const size_t CALLCONTRACT_SNAPSHOT_CACHE_SIZE = 8;
+/** Maximum number of calls waiting for a worker */
+static const size_t CALLCONTRACT_QUEUE_SIZE = 256;
+
+/**
+ * Contract state and EVM environment of one block. The state is never executed on
+ * directly: every call works on its own copy, so a snapshot can be shared by any
+ * number of concurrent calls without holding cs_main.
+ */
+struct LuxCallSnapshot{
+    uint256 hashBlock;
+    int nHeight;
+    uint64_t blockGasLimit;
+    dev::eth::EVMSchedule schedule;
+    dev::eth::EnvInfo env;
+    std::unique_ptr<const LuxState> state;
+};
+
+typedef std::shared_ptr<const LuxCallSnapshot> LuxCallSnapshotRef;
+
+/**
+ * Executes read-only contract calls (callcontract) on a pool of worker threads, each
+ * owning its own seal engine, against immutable per-block state snapshots.
+ */
+class LuxCallEngine{
+
+public:
+
+    LuxCallEngine() : fShutdown(false), nWorkers(0), pindexTip(nullptr) {}
+
+    ~LuxCallEngine();
+
+    bool Start(int nThreads);
+
+    void Stop();
+
+    bool IsRunning() const { return nWorkers > 0; }
+
+    /** Number of calls waiting for a worker. */
+    size_t PendingCalls();
+
+    /** Snapshot at nHeight of the active chain, or at the tip when nHeight is negative. */
+    LuxCallSnapshotRef GetSnapshot(int nHeight, std::string& strError);
+
+    bool AddressInUse(const LuxCallSnapshotRef& snapshot, const dev::Address& addr) const;
+
+    /** Run a call against snapshot on a worker thread and wait for its result, profiling it when profiler is set. */
+    bool Call(const LuxCallSnapshotRef& snapshot, const dev::Address& addrContract, const std::vector<unsigned char>& opcode,
+              const dev::Address& sender, uint64_t gasLimit, std::vector<ResultExecute>& results, std::string& strError,
+              LuxExecutionProfiler* profiler = nullptr);
+
+private:
+
+    typedef std::function<void(dev::eth::SealEngineFace&)> CallTask;
+
+    void ThreadWorker();
+
+    void BlockTipChanged(bool fInitialDownload, const CBlockIndex* pindex);
+
+    LuxCallSnapshotRef BuildSnapshot(const CBlockIndex* pindex, std::string& strError);
+
+    boost::mutex cs;
+
+    boost::condition_variable cond;
+
+    std::deque<CallTask> queue;
+
+    bool fShutdown;
+
+    int nWorkers;
+
+    boost::thread_group threads;
+
+    std::atomic<const CBlockIndex*> pindexTip;
+
+    boost::mutex csSnapshots;
+
+    std::list<LuxCallSnapshotRef> snapshots; // most recently used first
+};
+
+extern LuxCallEngine* pluxCallEngine;
+
+#endif // LUXCALLENGINE_H
@@ -18,6 +18,8 @@ LuxState::LuxState() : dev::eth::State(dev::Invalid256, dev::OverlayDB(), dev::e
     stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
 }
 
+LuxState::LuxState(LuxState const& _s) : State(_s), transfers(_s.transfers), dbUTXO(_s.dbUTXO), stateUTXO(&dbUTXO, _s.rootHashUTXO(), Verification::Skip), cacheUTXO(_s.cacheUTXO) {}
+
 ResultExecute LuxState::execute(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, LuxTransaction const& _t, Permanence _p, OnOpFunc const& _onOp){
 
     assert(_t.getVersion().toRaw() == VersionVM::GetEVMDefault().toRaw());
@@ -41,16 +41,24 @@ namespace lux{
     template <class DB>
     dev::AddressHash commit(std::unordered_map<dev::Address, Vin> const& _cache, dev::eth::SecureTrieDB<dev::Address, DB>& _state, std::unordered_map<dev::Address, dev::eth::Account> const& _cacheAcc)
     {
+        std::vector<dev::Address> addresses;
+        addresses.reserve(_cache.size());
+        for (auto const& i: _cache)
+            addresses.push_back(i.first);
+        std::vector<dev::h256> const hashedAddresses = dev::hashedTrieKeys(addresses);
+
         dev::AddressHash ret;
+        size_t n = 0;
         for (auto const& i: _cache){
             if(i.second.alive == 0){
-                 _state.remove(i.first);
+                 _state.removeHashed(hashedAddresses[n]);
             } else {
                 dev::RLPStream s(4);
                 s << i.second.hash << i.second.nVout << i.second.value << i.second.alive;
-                _state.insert(i.first, &s.out());
+                _state.insertHashed(hashedAddresses[n], i.first, &s.out());
             }
             ret.insert(i.first);
+            ++n;
         }
         return ret;
     }
@@ -66,6 +74,9 @@ public:
 
     LuxState(dev::u256 const& _accountStartNonce, dev::OverlayDB const& _db, const std::string& _path, dev::eth::BaseState _bs = dev::eth::BaseState::PreExisting);
 
+    // Shares the underlying databases with _s; the UTXO trie is rebound to the copy's own overlay.
+    LuxState(LuxState const& _s);
+
     ResultExecute execute(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, LuxTransaction const& _t, dev::eth::Permanence _p = dev::eth::Permanence::Committed, dev::eth::OnOpFunc const& _onOp = OnOpFunc());
 
     void setRootUTXO(dev::h256 const& _r) { cacheUTXO.clear(); stateUTXO.setRoot(_r); }
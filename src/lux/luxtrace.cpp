@@ -0,0 +1,178 @@
+#include <lux/luxtrace.h>
+
+#include <libevmcore/Instruction.h>
+
+#include <algorithm>
+#include <chrono>
+
+static int64_t GetProfilerTimeNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LuxExecutionProfiler::LuxExecutionProfiler() : nSteps(0)
+{
+    std::fill(opcodes, opcodes + 256, OpcodeStats{0, 0, 0});
+}
+
+dev::eth::OnOpFunc LuxExecutionProfiler::Hook()
+{
+    return [this](uint64_t nStep, uint64_t, dev::eth::Instruction inst, dev::bigint, dev::bigint gasCost, dev::bigint gas, dev::eth::VM*, dev::eth::ExtVMFace const* ext){
+        OnOp(nStep, inst, (uint64_t)gasCost, (uint64_t)gas, ext);
+    };
+}
+
+void LuxExecutionProfiler::OnOp(uint64_t nStep, dev::eth::Instruction inst, uint64_t nGasCost, uint64_t nGas, const dev::eth::ExtVMFace* ext)
+{
+    int64_t nNow = GetProfilerTimeNanos();
+
+    if(nStep == 1){
+        // Every frame runs on its own VM, whose step counter starts at one. Frames at the
+        // same or a deeper level have returned by now.
+        while(!callStack.empty() && frames[callStack.back()].nDepth >= ext->depth)
+            CloseFrame(nNow);
+
+        CallFrame frame = CallFrame();
+        frame.address = ext->myAddress;
+        frame.nDepth = ext->depth;
+        frame.nGasStart = nGas;
+        frame.nTimeStart = nNow;
+        frame.nPendingOp = -1;
+        frames.push_back(frame);
+        if(callStack.empty())
+            roots.push_back(frames.size() - 1);
+        else
+            frames[callStack.back()].children.push_back(frames.size() - 1);
+        callStack.push_back(frames.size() - 1);
+    }else{
+        while(callStack.size() > 1 && frames[callStack.back()].nDepth > ext->depth)
+            CloseFrame(nNow);
+        SettlePending(frames[callStack.back()], nGas, nNow);
+    }
+
+    CallFrame& frame = frames[callStack.back()];
+    frame.nSteps++;
+    nSteps++;
+    if(inst == dev::eth::Instruction::SLOAD)
+        frame.nStorageReads++;
+    else if(inst == dev::eth::Instruction::SSTORE)
+        frame.nStorageWrites++;
+
+    frame.nPendingOp = (int)inst;
+    frame.nPendingGas = nGas;
+    frame.nPendingCost = nGasCost;
+    frame.nPendingTime = nNow;
+    frame.nPendingChildGas = 0;
+    frame.nPendingChildTime = 0;
+}
+
+void LuxExecutionProfiler::SettlePending(CallFrame& frame, uint64_t nGasAfter, int64_t nNow)
+{
+    if(frame.nPendingOp < 0)
+        return;
+    // Gas and time spent in frames called by the instruction are accounted there.
+    uint64_t nSpent = frame.nPendingGas > nGasAfter ? frame.nPendingGas - nGasAfter : 0;
+    OpcodeStats& stats = opcodes[frame.nPendingOp];
+    stats.nCount++;
+    stats.nGas += nSpent > frame.nPendingChildGas ? nSpent - frame.nPendingChildGas : 0;
+    stats.nTimeNanos += std::max<int64_t>(0, nNow - frame.nPendingTime - frame.nPendingChildTime);
+    frame.nPendingOp = -1;
+}
+
+void LuxExecutionProfiler::CloseFrame(int64_t nNow)
+{
+    CallFrame& frame = frames[callStack.back()];
+    // The last instruction of a frame is charged its own cost; for a frame that ran out
+    // of gas this understates what was consumed.
+    uint64_t nGasEnd = frame.nPendingGas > frame.nPendingCost ? frame.nPendingGas - frame.nPendingCost : 0;
+    SettlePending(frame, nGasEnd, nNow);
+    frame.nGasUsed = frame.nGasStart > nGasEnd ? frame.nGasStart - nGasEnd : 0;
+    frame.nTimeNanos = nNow - frame.nTimeStart;
+    uint64_t nGasUsed = frame.nGasUsed;
+    int64_t nTimeNanos = frame.nTimeNanos;
+
+    callStack.pop_back();
+    if(!callStack.empty()){
+        CallFrame& parent = frames[callStack.back()];
+        parent.nPendingChildGas += nGasUsed;
+        parent.nPendingChildTime += nTimeNanos;
+    }
+}
+
+void LuxExecutionProfiler::Finish()
+{
+    int64_t nNow = GetProfilerTimeNanos();
+    while(!callStack.empty())
+        CloseFrame(nNow);
+}
+
+UniValue LuxExecutionProfiler::FrameToJSON(size_t nFrame) const
+{
+    const CallFrame& frame = frames[nFrame];
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("address", frame.address.hex()));
+    obj.push_back(Pair("depth", (int)frame.nDepth));
+    obj.push_back(Pair("steps", frame.nSteps));
+    obj.push_back(Pair("gasUsed", frame.nGasUsed));
+    obj.push_back(Pair("timeMicros", frame.nTimeNanos / 1000));
+    obj.push_back(Pair("storageReads", frame.nStorageReads));
+    obj.push_back(Pair("storageWrites", frame.nStorageWrites));
+    if(!frame.children.empty()){
+        UniValue calls(UniValue::VARR);
+        for(size_t nChild : frame.children)
+            calls.push_back(FrameToJSON(nChild));
+        obj.push_back(Pair("calls", calls));
+    }
+    return obj;
+}
+
+UniValue LuxExecutionProfiler::ToJSON() const
+{
+    uint64_t nGasUsed = 0;
+    int64_t nTimeNanos = 0;
+    for(size_t nRoot : roots){
+        nGasUsed += frames[nRoot].nGasUsed;
+        nTimeNanos += frames[nRoot].nTimeNanos;
+    }
+    uint64_t nStorageReads = 0;
+    uint64_t nStorageWrites = 0;
+    for(const CallFrame& frame : frames){
+        nStorageReads += frame.nStorageReads;
+        nStorageWrites += frame.nStorageWrites;
+    }
+
+    // Most expensive instructions first
+    std::vector<int> order;
+    for(int op = 0; op < 256; op++){
+        if(opcodes[op].nCount)
+            order.push_back(op);
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b){
+        if(opcodes[a].nGas != opcodes[b].nGas)
+            return opcodes[a].nGas > opcodes[b].nGas;
+        return opcodes[a].nCount > opcodes[b].nCount;
+    });
+    UniValue ops(UniValue::VARR);
+    for(int op : order){
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("opcode", dev::eth::instructionInfo((dev::eth::Instruction)op).name));
+        entry.push_back(Pair("count", opcodes[op].nCount));
+        entry.push_back(Pair("gas", opcodes[op].nGas));
+        entry.push_back(Pair("timeMicros", opcodes[op].nTimeNanos / 1000));
+        ops.push_back(entry);
+    }
+
+    UniValue calls(UniValue::VARR);
+    for(size_t nRoot : roots)
+        calls.push_back(FrameToJSON(nRoot));
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("steps", nSteps));
+    result.push_back(Pair("gasUsed", nGasUsed));
+    result.push_back(Pair("timeMicros", nTimeNanos / 1000));
+    result.push_back(Pair("storageReads", nStorageReads));
+    result.push_back(Pair("storageWrites", nStorageWrites));
+    result.push_back(Pair("opcodes", ops));
+    result.push_back(Pair("calls", calls));
+    return result;
+}
@@ -0,0 +1,80 @@
+#ifndef LUXTRACE_H
+#define LUXTRACE_H
+
+#include <lux/luxstate.h>
+#include "univalue/univalue.h"
+
+#include <vector>
+
+/**
+ * Aggregated profile of contract executions, collected through the EVM OnOpFunc hook.
+ *
+ * Per opcode it counts executions, gas and wall time; per call frame (each contract
+ * execution, including nested calls and creates) it records steps, gas, wall time and
+ * storage accesses, arranged as a call tree. Gas and time of an instruction exclude the
+ * frames it calls into, so the opcode table adds up to the total. Everything except the
+ * times is deterministic for a given transaction and state.
+ */
+class LuxExecutionProfiler{
+
+public:
+
+    LuxExecutionProfiler();
+
+    /** Hook to pass to LuxState::execute. The profiler must outlive the execution. */
+    dev::eth::OnOpFunc Hook();
+
+    /** Close the frames still open once execution has returned. */
+    void Finish();
+
+    UniValue ToJSON() const;
+
+private:
+
+    struct OpcodeStats{
+        uint64_t nCount;
+        uint64_t nGas;
+        int64_t nTimeNanos;
+    };
+
+    struct CallFrame{
+        dev::Address address;
+        unsigned nDepth;
+        uint64_t nSteps;
+        uint64_t nGasStart;
+        uint64_t nGasUsed;
+        int64_t nTimeStart;
+        int64_t nTimeNanos;
+        uint64_t nStorageReads;
+        uint64_t nStorageWrites;
+        std::vector<size_t> children;
+
+        // Instruction started last in this frame, settled when the frame continues or ends
+        int nPendingOp;
+        uint64_t nPendingGas;
+        uint64_t nPendingCost;
+        int64_t nPendingTime;
+        uint64_t nPendingChildGas;
+        int64_t nPendingChildTime;
+    };
+
+    void OnOp(uint64_t nStep, dev::eth::Instruction inst, uint64_t nGasCost, uint64_t nGas, const dev::eth::ExtVMFace* ext);
+
+    void SettlePending(CallFrame& frame, uint64_t nGasAfter, int64_t nNow);
+
+    void CloseFrame(int64_t nNow);
+
+    UniValue FrameToJSON(size_t nFrame) const;
+
+    OpcodeStats opcodes[256];
+
+    std::vector<CallFrame> frames;
+
+    std::vector<size_t> callStack;
+
+    std::vector<size_t> roots;
+
+    uint64_t nSteps;
+};
+
+#endif // LUXTRACE_H
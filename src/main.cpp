@@ -82,6 +82,8 @@ static const int POS_REWARD_CHANGED_BLOCK = 300000;
 #include <iostream>
 #include <bitset>
 #include "pubkey.h"
+#include <libevm/CodeAnalysisCache.h>
+#include <lux/luxtrace.h>
 
 extern std::atomic<bool> fRequestShutdown;
 
@@ -126,7 +128,12 @@ void updateBlockSizeParams(unsigned int newBlockSize){
 CCriticalSection cs_main;
 
 BlockMap mapBlockIndex;
+/** Taken exclusively to insert into or clear mapBlockIndex, so that it can be read without cs_main */
+static boost::shared_mutex csBlockIndexMap;
 CChain chainActive;
+/** Copy of chainActive for readers without cs_main */
+static CChainSnapshotRef chainSnapshot = std::make_shared<const CChainSnapshot>();
+static boost::mutex cs_chainSnapshot;
 CBlockIndex* pindexBestHeader = NULL;
 int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
@@ -137,10 +144,13 @@ std::atomic_bool fReindex(false);
 bool fLogEvents = false;
 bool fTxIndex = true;
 bool fAddressIndex = false;
+bool fTokenIndex = false;
+bool fBlockFilterIndex = false;
 bool fSpentIndex = false;
 //bool fIsBareMultisigStd = true; already defined in script.cpp
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
+bool fBatchSigVerify = DEFAULT_BATCH_SIG_VERIFY;
 size_t nCoinCacheUsage = 5000 * 300;
 unsigned int nBytesPerSigOp = DEFAULT_BYTES_PER_SIGOP;
 bool fAlerts = DEFAULT_ALERTS;
@@ -982,6 +992,28 @@ CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowF
     return nMinFee;
 }
 
+/** The number of transactions remembered as having passed PreVerifyTransactionScripts */
+static const unsigned int MAX_PREVERIFIED_SCRIPTS = 10000;
+
+/**
+ * Transactions whose input scripts PreVerifyTransactionScripts verified, each keyed by
+ * its witness hash together with the script flags it was verified under.
+ */
+static CCriticalSection cs_preverified;
+static mruset<uint256> setPreVerifiedScripts(MAX_PREVERIFIED_SCRIPTS);
+
+static uint256 PreVerifiedScriptsKey(const CTransaction& tx, unsigned int flags)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << tx.GetWitnessHash() << flags;
+    return ss.GetHash();
+}
+
+bool HavePreVerifiedScripts(const CTransaction& tx, unsigned int flags)
+{
+    LOCK(cs_preverified);
+    return setPreVerifiedScripts.count(PreVerifiedScriptsKey(tx, flags));
+}
 
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, list<CTransactionRef>* plTxnReplaced, bool fRejectInsaneFee, bool ignoreFees)
 {
@@ -1150,6 +1182,8 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
         CAmount nFees = nValueIn - nValueOut;
 
         dev::u256 txMinGasPrice = 0;
+        uint64_t txGasLimit = 0;
+        uint64_t txMaxGasLimit = 0;
 
         //////////////////////////////////////////////////////////// // lux
         if(chainActive.Height() >= chainParams.FirstSCBlock() && tx.HasCreateOrCall()) {
@@ -1158,9 +1192,9 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
                 return state.DoS(1, false, REJECT_INVALID, "bad-txns-invalid-sender-script");
             }
 
-            LuxDGP luxDGP(globalState.get(), fGettingValuesDGP);
-            uint64_t minGasPrice = luxDGP.getMinGasPrice(chainActive.Height() + 1);
-            uint64_t blockGasLimit = luxDGP.getBlockGasLimit(chainActive.Height() + 1);
+            const LuxDGPParams& dgpParams = GetTipDGPParams(chainActive.Height() + 1);
+            uint64_t minGasPrice = dgpParams.minGasPrice;
+            uint64_t blockGasLimit = dgpParams.blockGasLimit;
             size_t count = 0;
             for(const CTxOut& o : tx.vout)
                 count += o.scriptPubKey.HasOpCreate() || o.scriptPubKey.HasOpCall() ? 1 : 0;
@@ -1214,6 +1248,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
                 gasAllTxs += luxTransaction.gas();
                 if(gasAllTxs > dev::u256(blockGasLimit))
                     return state.DoS(1, false, REJECT_INVALID, "bad-txns-gas-exceeds-blockgaslimit");
+                txMaxGasLimit = std::max(txMaxGasLimit, (uint64_t)luxTransaction.gas());
 
                 //don't allow less than DGP set minimum gas price to prevent MPoS greedy mining/spammers
                 if(v.rootVM!=0 && (uint64_t)luxTransaction.gasPrice() < minGasPrice)
@@ -1225,11 +1260,14 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
 
             if(count > luxTransactions.size())
                 return state.DoS(100, false, REJECT_INVALID, "bad-txns-incorrect-format");
+
+            // cached in the mempool entry so block assembly can skip infeasible contracts without extracting them again
+            txGasLimit = (uint64_t)gasAllTxs;
         }
         ////////////////////////////////////////////////////////////
 
         double dPriority = view.GetPriority(tx, chainActive.Height(), inChainInputValue);
-        CTxMemPoolEntry entry(MakeTransactionRef(tx), nFees, GetTime(), dPriority, chainActive.Height(), inChainInputValue, fSpendsCoinbase, nSigOpsCost,  lp, pool.HasNoInputsOf(tx),CAmount(txMinGasPrice));
+        CTxMemPoolEntry entry(MakeTransactionRef(tx), nFees, GetTime(), dPriority, chainActive.Height(), inChainInputValue, fSpendsCoinbase, nSigOpsCost,  lp, pool.HasNoInputsOf(tx), CAmount(txMinGasPrice), txGasLimit, txMaxGasLimit);
 
         // Check that the transaction doesn't have an excessive number of
         // sigops, making it impossible to mine. Since the coinbase transaction
@@ -1380,8 +1418,10 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
         
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
+        // The scripts may already have passed under these very flags on the way in from a peer
         PrecomputedTransactionData txdata(tx);
-        if (!CheckInputs(tx, state, view, true, standardFlags, true, txdata)) {
+        bool fScriptChecks = !HavePreVerifiedScripts(tx, standardFlags);
+        if (!CheckInputs(tx, state, view, fScriptChecks, standardFlags, true, txdata)) {
             // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
             // need to turn both off, and compare against just turning off CLEANSTACK
             // to see if the failure is specifically due to witness validation.
@@ -1460,6 +1500,29 @@ bool GetAddressIndex(uint160 addrHash, uint16_t addrType, AddressIndexVector &ad
     return true;
 }
 
+bool GetAddressIndexBatch(const AddressTypeVector &addresses, AddressIndexVector &addressIndex,
+                          int start, unsigned int startIndex, int end, size_t nLimit, bool &fMore)
+{
+    if (!fAddressIndex)
+        return error("-addressindex not enabled");
+
+    if (!pblocktree->ReadAddressIndexBatch(addresses, addressIndex, start, startIndex, end, nLimit, fMore))
+        return error("unable to get txs for addresses");
+
+    return true;
+}
+
+bool GetAddressBalance(uint160 addrHash, uint16_t addrType, CAddressBalanceValue &balance)
+{
+    if (!fAddressIndex)
+        return error("-addressindex not enabled");
+
+    if (!pblocktree->ReadAddressBalance(addrHash, addrType, balance))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
 bool GetAddressUnspent(uint160 addrHash, uint16_t addrType, AddressUnspentVector &unspentOutputs)
 {
     if (!fAddressIndex)
@@ -1471,6 +1534,18 @@ bool GetAddressUnspent(uint160 addrHash, uint16_t addrType, AddressUnspentVector
     return true;
 }
 
+bool GetAddressUnspentBatch(const AddressTypeVector &addresses, AddressUnspentVector &unspentOutputs,
+                            const CAddressUnspentKey *pcursorKey, size_t nLimit, CAddressUnspentKey *pnextKey)
+{
+    if (!fAddressIndex)
+        return error("-addressindex not enabled");
+
+    if (!pblocktree->ReadAddressUnspentIndexBatch(addresses, unspentOutputs, pcursorKey, nLimit, pnextKey))
+        return error("unable to get utxos for addresses");
+
+    return true;
+}
+
 bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, bool fRejectInsaneFee, bool isDSTX)
 {
     AssertLockHeld(cs_main);
@@ -1587,6 +1662,8 @@ bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransact
         CAmount nFees = nValueIn - nValueOut;
 
         dev::u256 txMinGasPrice = 0;
+        uint64_t txGasLimit = 0;
+        uint64_t txMaxGasLimit = 0;
 
         //////////////////////////////////////////////////////////// // lux
         if(chainActive.Height() >= Params().FirstSCBlock() && tx.HasCreateOrCall()) {
@@ -1595,9 +1672,9 @@ bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransact
                 return state.DoS(1, false, REJECT_INVALID, "bad-txns-invalid-sender-script");
             }
 
-            LuxDGP luxDGP(globalState.get(), fGettingValuesDGP);
-            uint64_t minGasPrice = luxDGP.getMinGasPrice(chainActive.Height() + 1);
-            uint64_t blockGasLimit = luxDGP.getBlockGasLimit(chainActive.Height() + 1);
+            const LuxDGPParams& dgpParams = GetTipDGPParams(chainActive.Height() + 1);
+            uint64_t minGasPrice = dgpParams.minGasPrice;
+            uint64_t blockGasLimit = dgpParams.blockGasLimit;
             size_t count = 0;
             for(const CTxOut& o : tx.vout)
                 count += o.scriptPubKey.HasOpCreate() || o.scriptPubKey.HasOpCall() ? 1 : 0;
@@ -1651,6 +1728,7 @@ bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransact
                 gasAllTxs += luxTransaction.gas();
                 if(gasAllTxs > dev::u256(blockGasLimit))
                     return state.DoS(1, false, REJECT_INVALID, "bad-txns-gas-exceeds-blockgaslimit");
+                txMaxGasLimit = std::max(txMaxGasLimit, (uint64_t)luxTransaction.gas());
 
                 //don't allow less than DGP set minimum gas price to prevent MPoS greedy mining/spammers
                 if(v.rootVM!=0 && (uint64_t)luxTransaction.gasPrice() < minGasPrice)
@@ -1662,11 +1740,14 @@ bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransact
 
             if(count > luxTransactions.size())
                 return state.DoS(100, false, REJECT_INVALID, "bad-txns-incorrect-format");
+
+            // cached in the mempool entry so block assembly can skip infeasible contracts without extracting them again
+            txGasLimit = (uint64_t)gasAllTxs;
         }
         ////////////////////////////////////////////////////////////
 
         double dPriority = view.GetPriority(tx, chainActive.Height(), inChainInputValue);
-        CTxMemPoolEntry entry(MakeTransactionRef(tx), nFees, GetTime(), dPriority, chainActive.Height(), inChainInputValue, fSpendsCoinbase, nSigOpsCost,  lp, pool.HasNoInputsOf(tx), CAmount(txMinGasPrice));
+        CTxMemPoolEntry entry(MakeTransactionRef(tx), nFees, GetTime(), dPriority, chainActive.Height(), inChainInputValue, fSpendsCoinbase, nSigOpsCost,  lp, pool.HasNoInputsOf(tx), CAmount(txMinGasPrice), txGasLimit, txMaxGasLimit);
 
         // Check for non-standard pay-to-script-hash in inputs
         // for any real tx this will be checked on AcceptToMemoryPool anyway
@@ -2219,12 +2300,65 @@ bool CScriptCheck::operator()()
 {
     const CScript& scriptSig = ptxTo->vin[nIn].scriptSig;
     const CScriptWitness *witness = (nIn < ptxTo->wit.vtxinwit.size()) ? &ptxTo->wit.vtxinwit[nIn].scriptWitness : nullptr;
-    if (!VerifyScript(scriptSig, scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, amount, cacheStore, *txdata), &error)) {
+    if (!VerifyScript(scriptSig, scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, amount, cacheStore, *txdata, pbatch), &error)) {
         return false;
     }
     return true;
 }
 
+/**
+ * Find the scripts whose deferred signatures fail the batch check, among the checks
+ * vDeferred[nBegin, nEnd). Each entry holds a check and the end of its signatures in
+ * the batch. Halves are verified as sub-batches and only failing halves are split
+ * further, down to single scripts, which are then re-run without deferring anything.
+ */
+static bool CheckDeferredSignatures(CSignatureBatch& batch, const std::vector<std::pair<CScriptCheck*, size_t> >& vDeferred, size_t nBegin, size_t nEnd)
+{
+    if (nEnd - nBegin == 1)
+        return (*vDeferred[nBegin].first)();
+    size_t nMid = (nBegin + nEnd) / 2;
+    size_t nFirst = nBegin ? vDeferred[nBegin - 1].second : 0;
+    if (!batch.Verify(nFirst, vDeferred[nMid - 1].second) && !CheckDeferredSignatures(batch, vDeferred, nBegin, nMid))
+        return false;
+    if (!batch.Verify(vDeferred[nMid - 1].second, vDeferred[nEnd - 1].second) && !CheckDeferredSignatures(batch, vDeferred, nMid, nEnd))
+        return false;
+    return true;
+}
+
+bool RunCheckBatch(std::vector<CScriptCheck>& vChecks)
+{
+    if (!fBatchSigVerify || vChecks.size() < 2) {
+        for (CScriptCheck& check : vChecks)
+            if (!check())
+                return false;
+        return true;
+    }
+
+    CSignatureBatch batch;
+    std::vector<std::pair<CScriptCheck*, size_t> > vDeferred;
+    for (CScriptCheck& check : vChecks) {
+        size_t nBatchSize = batch.size();
+        check.SetBatch(&batch);
+        bool fOk = check();
+        check.SetBatch(NULL);
+        if (!fOk) {
+            // The script fails even with its deferred signatures taken as valid;
+            // re-run it in full for the real error.
+            batch.Truncate(nBatchSize);
+            if (!check())
+                return false;
+        } else if (batch.size() > nBatchSize) {
+            vDeferred.push_back(std::make_pair(&check, batch.size()));
+        }
+    }
+    if (batch.Verify(0, batch.size()))
+        return true;
+
+    // Only scripts that cannot pass without it defer a signature, so some script here is
+    // invalid. Narrow it down instead of re-running every script of the share.
+    return CheckDeferredSignatures(batch, vDeferred, 0, vDeferred.size());
+}
+
 bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck>* pvChecks)
 {
     if (!tx.IsCoinBase()) {
@@ -2538,7 +2672,18 @@ static DisconnectResult DisconnectBlock(CBlock& block, CValidationState& state,
         pblocktree->EraseHeightIndex(pindex->nHeight);
     }
 
+    if (fTokenIndex) {
+        if (!pblocktree->EraseTokenTransfers(pindex->nHeight)) {
+            error("%s(): Failed to undo token transfers", __func__);
+            return DISCONNECT_FAILED;
+        }
+    }
+
     if (fAddressIndex) {
+        if (!pblocktree->DisconnectAddressBalances(addressIndex, pindex->nHeight, pindex->GetBlockHash())) {
+            error("%s(): Failed to undo address balances", __func__);
+            return DISCONNECT_FAILED;
+        }
         if (!pblocktree->EraseAddressIndex(addressIndex)) {
             //AbortNode(state, "Failed to delete address index");
             error("%s(): Failed to delete address index", __func__);
@@ -2579,7 +2724,7 @@ void static FlushBlockFile(bool fFinalize = false)
 
 bool FindUndoPos(CValidationState& state, int nFile, CDiskBlockPos& pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128, MAX_SCRIPTCHECK_THREADS);
 
 void ThreadScriptCheck()
 {
@@ -2587,6 +2732,143 @@ void ThreadScriptCheck()
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CScriptCheck> mempoolcheckqueue(128, MAX_SCRIPTCHECK_THREADS);
+
+static std::atomic<int> nMempoolCheckThreads(0);
+
+void ThreadMempoolScriptCheck()
+{
+    RenameThread("lux-mempoolch");
+    nMempoolCheckThreads++;
+    mempoolcheckqueue.Thread();
+}
+
+/** Set once the background pass has filters up to the tip; ConnectBlock keeps it there afterwards. */
+static std::atomic<bool> fBlockFilterIndexSynced(false);
+
+void ThreadBlockFilterIndex()
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    // Resume after the last block the index is known to be complete up to
+    const CBlockIndex* pindex = NULL;
+    uint256 hashBest;
+    uint256 hashPrevHeader;
+    {
+        LOCK(cs_main);
+        if (pblocktree->ReadBlockFilterBest(hashBest)) {
+            const CBlockIndex* pindexBest = LookupBlockIndex(hashBest);
+            if (pindexBest)
+                pindex = chainActive.FindFork(pindexBest);
+        }
+    }
+    uint256 hashFilter;
+    if (pindex && !pblocktree->ReadBlockFilterHeader(pindex->GetBlockHash(), hashFilter, hashPrevHeader))
+        pindex = NULL;
+    LogPrintf("%s: building block filters from height %d\n", __func__, pindex ? pindex->nHeight + 1 : 0);
+
+    int64_t nStart = GetTimeMillis();
+    int nBlocks = 0;
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        const CBlockIndex* pindexNext;
+        CDiskBlockPos posBlock;
+        CDiskBlockPos posUndo;
+        {
+            LOCK(cs_main);
+            if (pindex && !chainActive.Contains(pindex)) {
+                // Reorganized away from; the filters below the fork are still valid
+                pindex = chainActive.FindFork(pindex);
+                if (pindex && !pblocktree->ReadBlockFilterHeader(pindex->GetBlockHash(), hashFilter, hashPrevHeader))
+                    pindex = NULL;
+            }
+            pindexNext = pindex ? chainActive.Next(pindex) : chainActive.Genesis();
+            if (pindexNext == NULL) {
+                fBlockFilterIndexSynced = true;
+                break;
+            }
+            posBlock = pindexNext->GetBlockPos();
+            posUndo = pindexNext->GetUndoPos();
+        }
+
+        // Blocks connected meanwhile may already have theirs
+        uint256 header;
+        if (!pblocktree->ReadBlockFilterHeader(pindexNext->GetBlockHash(), hashFilter, header)) {
+            CBlock block;
+            CBlockUndo blockundo;
+            if (!ReadBlockFromDisk(block, posBlock, pindexNext->nHeight, consensusParams) ||
+                (pindexNext->pprev && !UndoReadFromDisk(blockundo, posUndo, pindexNext->pprev->GetBlockHash()))) {
+                LogPrintf("%s: unable to read block %s, block filter index stopped at height %d\n", __func__,
+                          pindexNext->GetBlockHash().ToString(), pindex ? pindex->nHeight : -1);
+                return;
+            }
+            BlockFilter filter(BLOCK_FILTER_BASIC, pindexNext->GetBlockHash(), block, blockundo);
+            header = filter.ComputeHeader(hashPrevHeader);
+            if (!pblocktree->WriteBlockFilter(filter, header, nBlocks % 1000 == 999)) {
+                AbortNode("Failed to write block filter index");
+                return;
+            }
+            nBlocks++;
+        }
+        pindex = pindexNext;
+        hashPrevHeader = header;
+    }
+
+    pblocktree->WriteBlockFilterBest(pindex->GetBlockHash());
+    LogPrintf("%s: block filters synced to height %d, %d blocks indexed in %dms\n", __func__, pindex->nHeight, nBlocks, GetTimeMillis() - nStart);
+}
+
+/** Check a getcfilters/getcfheaders/getcfcheckpt request and find its stop block, punishing peers that should know better. */
+static bool PrepareBlockFilterRequest(CNode* pfrom, uint8_t nFilterType, uint32_t nStartHeight, const uint256& hashStop,
+                                      uint32_t nMaxHeightDiff, const CBlockIndex*& pindexStop)
+{
+    if (!(nLocalServices & NODE_COMPACT_FILTERS) || nFilterType != BLOCK_FILTER_BASIC) {
+        LogPrint("net", "peer %d requested unsupported block filter type: %d\n", pfrom->id, nFilterType);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    {
+        LOCK(cs_main);
+        pindexStop = LookupBlockIndex(hashStop);
+        if (!pindexStop || !chainActive.Contains(pindexStop)) {
+            LogPrint("net", "peer %d requested block filters for unknown or stale block %s\n", pfrom->id, hashStop.ToString());
+            pfrom->fDisconnect = true;
+            return false;
+        }
+    }
+
+    uint32_t nStopHeight = pindexStop->nHeight;
+    if (nStartHeight > nStopHeight) {
+        LogPrint("net", "peer %d sent invalid getcfilters/getcfheaders with start height %d and stop height %d\n",
+                 pfrom->id, nStartHeight, nStopHeight);
+        Misbehaving(pfrom->GetId(), 100);
+        return false;
+    }
+    if (nStopHeight - nStartHeight >= nMaxHeightDiff) {
+        LogPrint("net", "peer %d requested too many block filters: %d / %d\n", pfrom->id, nStopHeight - nStartHeight + 1, nMaxHeightDiff);
+        Misbehaving(pfrom->GetId(), 100);
+        return false;
+    }
+
+    if (!fBlockFilterIndexSynced) {
+        LogPrint("net", "peer %d requested block filters while the index is being built\n", pfrom->id);
+        return false;
+    }
+    return true;
+}
+
+/** Hashes of the active chain blocks from nStartHeight up to pindexStop */
+static std::vector<uint256> GetBlockFilterRange(uint32_t nStartHeight, const CBlockIndex* pindexStop)
+{
+    LOCK(cs_main);
+    std::vector<uint256> vHashes(pindexStop->nHeight - nStartHeight + 1);
+    for (const CBlockIndex* pindex = pindexStop; pindex && pindex->nHeight >= (int)nStartHeight; pindex = pindex->pprev)
+        vHashes[pindex->nHeight - nStartHeight] = pindex->GetBlockHash();
+    return vHashes;
+}
+
 static bool IsBlockValueValid(const CBlock& block, int64_t nExpectedValue)
 {
     CBlockIndex* pindexPrev = chainActive.Tip();
@@ -2675,12 +2957,14 @@ ThresholdState VersionBitsTipState(const Consensus::Params& params, Consensus::D
 static ThresholdConditionCache warningcache[VERSIONBITS_NUM_BITS];
 
 static int64_t nTimeVerify = 0;
+static int64_t nTimeCheckQueueWait = 0;
 static int64_t nTimeConnect = 0;
 static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
-bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck)
+bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck,
+                  std::vector<TransactionReceiptInfo>* pvReceipts)
 {
     AssertLockHeld(cs_main);
 
@@ -2794,6 +3078,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     ///////////////////////////////////////////////////////// // lux
     std::map<dev::Address, std::pair<CHeightTxIndexKey, std::vector<uint256>>> heightIndexes;
+    std::vector<CTokenTransfer> tokenTransfers;
     /////////////////////////////////////////////////////////
 
     int64_t nTimeStart = GetTimeMicros();
@@ -3073,6 +3358,31 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                                                              countCumulativeGasUsed, uint64_t(resultExec[k].execRes.gasUsed), resultExec[k].execRes.newAddress, resultExec[k].txRec.log(), resultExec[k].execRes.excepted});
                     }
 
+                    if(fTokenIndex){
+                        static const dev::h256 transferTopic(TOKEN_TRANSFER_TOPIC);
+                        uint32_t nLogIndex = 0;
+                        for(size_t k = 0; k < resultExec.size(); k ++){
+                            for(const dev::eth::LogEntry& log : resultExec[k].txRec.log()){
+                                uint32_t nLog = nLogIndex++;
+                                // Transfer(address indexed from, address indexed to, uint256 value)
+                                if(log.topics.size() != 3 || log.topics[0] != transferTopic || log.data.size() != 32)
+                                    continue;
+                                CTokenTransfer transfer;
+                                transfer.token = uint160(log.address.asBytes());
+                                transfer.from = uint160(dev::right160(log.topics[1]).asBytes());
+                                transfer.to = uint160(dev::right160(log.topics[2]).asBytes());
+                                transfer.amount = h256Touint(dev::h256(log.data));
+                                transfer.txhash = tx.GetHash();
+                                transfer.blockHeight = pindex->nHeight;
+                                transfer.txIndex = i;
+                                transfer.logIndex = nLog;
+                                tokenTransfers.push_back(transfer);
+                            }
+                        }
+                    }
+
+                    if (pvReceipts)
+                        pvReceipts->insert(pvReceipts->end(), tri.begin(), tri.end());
                     pstorageresult->addResult(uintToh256(tx.GetHash()), tri);
                 }
 
@@ -3124,6 +3434,14 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     int64_t nTime1 = GetTimeMicros();
     nTimeConnect += nTime1 - nTimeStart;
     LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs - 1), nTimeConnect * 0.000001);
+    if (pindex->nHeight >= Params().FirstSCBlock()) {
+        const dev::eth::CodeAnalysisCache& codeCache = dev::eth::CodeAnalysisCache::instance();
+        LogPrint("bench", "      - EVM code analysis cache: %u entries, %.2fMiB, %u hits, %u misses\n",
+            (unsigned)codeCache.size(), codeCache.memoryUsage() * (1.0 / (1 << 20)), (unsigned)codeCache.hits(), (unsigned)codeCache.misses());
+        const dev::eth::StateCache& stateCache = dev::eth::StateCache::instance();
+        LogPrint("bench", "      - EVM state cache: %u entries, %.2fMiB, %u hits, %u misses\n",
+            (unsigned)stateCache.size(), stateCache.memoryUsage() * (1.0 / (1 << 20)), (unsigned)stateCache.hits(), (unsigned)stateCache.misses());
+    }
 
     if (block.IsProofOfWork()) {
         auto nReward = GetProofOfWorkReward(nFees, pindex->nHeight);
@@ -3166,6 +3484,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     int64_t nTime2 = GetTimeMicros();
     nTimeVerify += nTime2 - nTimeStart;
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs - 1), nTimeVerify * 0.000001);
+    if (fScriptChecks && nScriptCheckThreads) {
+        CCheckQueueStats stats = control.GetStats();
+        nTimeCheckQueueWait += stats.nMasterWait;
+        LogPrint("bench", "      - Script checks: %u on %u/%u threads, queue wait %.3fms/check, master wait %.2fms [%.2fs], utilization %.1f%%, imbalance %.2f, %u steals\n",
+            (unsigned)stats.nChecks, stats.nActive, stats.nThreads, stats.nChecks ? 0.001 * stats.nQueueWait / stats.nChecks : 0,
+            0.001 * stats.nMasterWait, nTimeCheckQueueWait * 0.000001, 100.0 * stats.Utilization(), stats.Imbalance(), (unsigned)stats.nSteals);
+    }
 
     ////////////////////////////////////////////////////////////////// // lux
     if (pindex->nHeight >= Params().FirstSCBlock()) {
@@ -3276,6 +3601,22 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
     }
 
+    if (fTokenIndex && !fJustCheck) {
+        if (!pblocktree->WriteTokenTransfers(pindex->nHeight, tokenTransfers))
+            return AbortNode("Failed to write token index");
+    }
+
+    if (fBlockFilterIndex && !fJustCheck) {
+        // Until the background pass reaches the tip the parent may have no filter yet;
+        // that pass then indexes this block as well.
+        uint256 hashPrevFilter, hashPrevHeader;
+        if (pindex->pprev == NULL || pblocktree->ReadBlockFilterHeader(pindex->pprev->GetBlockHash(), hashPrevFilter, hashPrevHeader)) {
+            BlockFilter filter(BLOCK_FILTER_BASIC, pindex->GetBlockHash(), block, blockundo);
+            if (!pblocktree->WriteBlockFilter(filter, filter.ComputeHeader(hashPrevHeader), fBlockFilterIndexSynced))
+                return AbortNode("Failed to write block filter index");
+        }
+    }
+
     if (fTxIndex)
         if (!pblocktree->WriteTxIndex(vPos))
             return state.Error("Failed to write transaction index");
@@ -3286,6 +3627,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             return state.Error("Failed to write address index");
         }
 
+        if (!pblocktree->ConnectAddressBalances(addressIndex, pindex->nHeight, pindex->GetBlockHash())) {
+            return state.Error("Failed to write address balances");
+        }
+
         if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             //return AbortNode(state, "Failed to write address unspent index");
             return state.Error("Failed to write address unspent index");
@@ -3472,6 +3817,24 @@ void PruneAndFlush() {
     FlushStateToDisk(state, FLUSH_STATE_NONE);
 }
 
+CChainSnapshotRef GetChainSnapshot()
+{
+    boost::lock_guard<boost::mutex> lock(cs_chainSnapshot);
+    return chainSnapshot;
+}
+
+/** Make the current chainActive visible to readers without cs_main */
+static void PublishChainSnapshot()
+{
+    AssertLockHeld(cs_main);
+    CChainSnapshotRef prev = GetChainSnapshot();
+    if (prev->Height() == chainActive.Height() && prev->Tip() == chainActive.Tip())
+        return;
+    CChainSnapshotRef snapshot = std::make_shared<const CChainSnapshot>(chainActive, prev.get());
+    boost::lock_guard<boost::mutex> lock(cs_chainSnapshot);
+    chainSnapshot = snapshot;
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex* pindexNew, const CChainParams& chainParams)
 {
@@ -3609,12 +3972,13 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    std::vector<TransactionReceiptInfo> vReceipts;
     {
         CInv inv(MSG_BLOCK, pindexNew->GetBlockHash());
         dev::h256 oldHashStateRoot = getGlobalStateRoot(pindexNew);
         dev::h256 oldHashUTXORoot = getGlobalStateUTXO(pindexNew);
 
-        bool rv = ConnectBlock(*pblock, state, pindexNew, view, chainparams);
+        bool rv = ConnectBlock(*pblock, state, pindexNew, view, chainparams, false, &vReceipts);
         GetMainSignals().BlockChecked(*pblock, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -3661,6 +4025,8 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     for (const CTransaction& tx : pblock->vtx) {
         SyncWithWallets(tx, pblock);
     }
+    // Hand the block that is still in memory to listeners that want all of it
+    GetMainSignals().BlockConnected(*pblock, pindexNew, vReceipts);
 
     int64_t nTime6 = GetTimeMicros();
     nTimePostConnect += nTime6 - nTime5;
@@ -3681,6 +4047,7 @@ bool DisconnectBlocksAndReprocess(int blocks)
     LogPrintf("DisconnectBlocksAndReprocess: Got command to replay %d blocks\n", blocks);
     for (int i = 0; i <= blocks; i++)
         DisconnectTip(state, chainParams);
+    PublishChainSnapshot();
 
     return true;
 }
@@ -3952,7 +4319,10 @@ bool ActivateBestChain(CValidationState& state, const CChainParams& chainparams,
             //Active chain's tip will be updated after ActivateBestChainStep, when block is added, so add 1 to active height
             usePhi2 = chainActive.Height() + 1 >= Params().SwitchPhi2Block();
 
-            if (!ActivateBestChainStep(state, chainparams, pindexMostWork, pblock && pblock->GetHash(usePhi2) == pindexMostWork->GetBlockHash() ? pblock : NULL))
+            bool fStepOk = ActivateBestChainStep(state, chainparams, pindexMostWork, pblock && pblock->GetHash(usePhi2) == pindexMostWork->GetBlockHash() ? pblock : NULL);
+            // Readers without cs_main see the chain only between steps, never halfway through a reorganization
+            PublishChainSnapshot();
+            if (!fStepOk)
                 return false;
 
             pindexNewTip = chainActive.Tip();
@@ -3978,6 +4348,7 @@ bool ActivateBestChain(CValidationState& state, const CChainParams& chainparams,
                                  (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : nBlockEstimate))
                         pnode->PushInventory(CInv(MSG_BLOCK, hashNewTip));
             }
+            GetMainSignals().UpdatedBlockTip(pindexNewTip);
         }
         // Notify external listeners about the new tip.
         uiInterface.NotifyBlockTip(fInitialDownload, pindexNewTip);
@@ -4010,9 +4381,11 @@ bool InvalidateBlock(CValidationState& state, const CChainParams& chainparams, C
         // ActivateBestChain considers blocks already in chainActive
         // unconditionally valid already, so force disconnect away from it.
         if (!DisconnectTip(state, chainparams)) {
+            PublishChainSnapshot();
             return false;
         }
     }
+    PublishChainSnapshot();
 
     // The resulting new best tip may not be in setBlockIndexCandidates anymore, so
     // add them again.
@@ -4081,6 +4454,8 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
     pindexNew->nSequenceId = 0;
+    // Held until the entry is filled in, so that concurrent lookups never see it half built
+    boost::unique_lock<boost::shared_mutex> lockMap(csBlockIndexMap);
     BlockMap::iterator mi = mapBlockIndex.emplace(hash, pindexNew).first;
 
     //mark as PoS seen
@@ -5330,13 +5705,23 @@ CBlockIndex* InsertBlockIndex(uint256 hash)
     CBlockIndex* pindexNew = new CBlockIndex();
     if (!pindexNew)
         throw runtime_error("LoadBlockIndex() : new CBlockIndex failed");
-    mi = mapBlockIndex.emplace(hash, pindexNew).first;
+    {
+        boost::unique_lock<boost::shared_mutex> lockMap(csBlockIndexMap);
+        mi = mapBlockIndex.emplace(hash, pindexNew).first;
+    }
 
     pindexNew->phashBlock = &((*mi).first);
 
     return pindexNew;
 }
 
+CBlockIndex* LookupBlockIndexConcurrent(const uint256& hash)
+{
+    boost::shared_lock<boost::shared_mutex> lockMap(csBlockIndexMap);
+    BlockMap::const_iterator it = mapBlockIndex.find(hash);
+    return it == mapBlockIndex.end() ? nullptr : it->second;
+}
+
 bool static LoadBlockIndexDB()
 {
     const CChainParams& chainparams = Params();
@@ -5445,7 +5830,7 @@ bool static LoadBlockIndexDB()
         CBlockIndex* pindexLastMeta = vSortedByHeight[vinfoBlockFile[nLastBlockFile].nHeightLast + 1].second;
 
         //fix Assertion `hashPrevBlock == view.GetBestBlock()' failed. By adjusting height to the last recorded by coinsview
-        CBlockIndex* pindexCoinsView = mapBlockIndex[pcoinsTip->GetBestBlock()];
+        CBlockIndex* pindexCoinsView = LookupBlockIndex(pcoinsTip->GetBestBlock());
         if (pindexCoinsView)
         {
             for (unsigned int i = vinfoBlockFile[nLastBlockFile].nHeightLast + 1; i < vSortedByHeight.size(); i++)
@@ -5529,10 +5914,25 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("logevents", fLogEvents);
     LogPrintf("%s: log events index %s\n", __func__, fLogEvents ? "enabled" : "disabled");
 
+    // Check whether we have a token transfer index
+    pblocktree->ReadFlag("tokenindex", fTokenIndex);
+    LogPrintf("%s: token index %s\n", __func__, fTokenIndex ? "enabled" : "disabled");
+
     // Check whether we have an address index
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Databases indexed before the address balances existed build them once
+    if (fAddressIndex) {
+        bool fAddressBalanceIndex = false;
+        pblocktree->ReadFlag("addressbalanceindex", fAddressBalanceIndex);
+        if (!fAddressBalanceIndex) {
+            if (!pblocktree->BuildAddressBalanceIndex())
+                return error("%s: failed to build the address balance index", __func__);
+            pblocktree->WriteFlag("addressbalanceindex", true);
+        }
+    }
+
     // Check whether we have a spent index
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
@@ -5545,6 +5945,7 @@ bool static LoadBlockIndexDB()
     if (!pindexPrev)
         return true;
     chainActive.SetTip(pindexPrev);
+    PublishChainSnapshot();
 
     if (Params().NetworkID() != CBaseChainParams::REGTEST) {
         PruneBlockIndexCandidates();
@@ -5672,7 +6073,12 @@ void UnloadBlockIndex()
    // LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    {
+        boost::lock_guard<boost::mutex> lock(cs_chainSnapshot);
+        chainSnapshot = std::make_shared<const CChainSnapshot>();
+    }
     pindexBestInvalid = NULL;
+    boost::unique_lock<boost::shared_mutex> lockMap(csBlockIndexMap);
     for (BlockMap::value_type& entry : mapBlockIndex) {
         delete entry.second;
     }
@@ -5693,6 +6099,9 @@ bool LoadBlockIndex()
         // Use the provided setting for -logevents in the new database
         fLogEvents = GetBoolArg("-logevents", DEFAULT_LOGEVENTS);
         pblocktree->WriteFlag("logevents", fLogEvents);
+        // The token index is built from the same receipts
+        fTokenIndex = fLogEvents && GetBoolArg("-tokenindex", DEFAULT_TOKENINDEX);
+        pblocktree->WriteFlag("tokenindex", fTokenIndex);
     }
     return true;
 }
@@ -5712,6 +6121,7 @@ bool InitBlockIndex(const CChainParams& chainparams)
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    pblocktree->WriteFlag("addressbalanceindex", true);
 
     // Use the provided setting for -spentindex in the new database
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
@@ -5808,14 +6218,15 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                 }
 
                 // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+                CBlockIndex* pindex = LookupBlockIndex(hash);
+                if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
                     CValidationState state;
                     if (ProcessNewBlock(state, chainparams, NULL, &block, dbp))
                         nLoaded++;
                     if (state.IsError())
                         break;
-                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+                    LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
                 }
 
                 NotifyHeaderTip();
@@ -5831,7 +6242,8 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                         pindexPrev = LookupBlockIndex(block.hashPrevBlock);
                         usePhi2 = pindexPrev ? pindexPrev->nHeight + 1 >= Params().SwitchPhi2Block() : false;
                         hash = block.GetHash(usePhi2);
-                        int nHeight = mapBlockIndex[hash] ? mapBlockIndex[hash]->nHeight : pindexPrev->nHeight;
+                        CBlockIndex* pindexKnown = LookupBlockIndex(hash);
+                        int nHeight = pindexKnown ? pindexKnown->nHeight : pindexPrev->nHeight;
                         if (ReadBlockFromDisk(block, it->second, nHeight, chainparams.GetConsensus())) {
                             LogPrintf("%s: Processing out of order child %s of %s\n", __func__,
                                       block.GetHash(usePhi2).ToString(),
@@ -6100,6 +6512,27 @@ string GetWarnings(string strFor)
 //
 
 
+/** The number of loose transactions remembered as rejected */
+static const unsigned int MAX_RECENT_REJECTS = 20000;
+
+/**
+ * Transactions AcceptToMemoryPool rejected for other reasons than missing
+ * inputs. A new tip may make them acceptable, so the set is cleared whenever
+ * it changes. (protected by cs_main)
+ */
+mruset<uint256> setRecentRejects(MAX_RECENT_REJECTS);
+static uint256 hashRecentRejectsChainTip;
+
+static bool IsRecentlyRejected(const uint256& hash)
+{
+    AssertLockHeld(cs_main);
+    if (chainActive.Tip() && chainActive.Tip()->GetBlockHash() != hashRecentRejectsChainTip) {
+        setRecentRejects.clear();
+        hashRecentRejectsChainTip = chainActive.Tip()->GetBlockHash();
+    }
+    return setRecentRejects.count(hash);
+}
+
 bool static AlreadyHave(const CInv& inv)
 {
     switch (inv.type) {
@@ -6109,7 +6542,7 @@ bool static AlreadyHave(const CInv& inv)
         bool txInMap = false;
         txInMap = mempool.exists(inv.hash);
         return txInMap || mapOrphanTransactions.count(inv.hash) ||
-               pcoinsTip->HaveCoins(inv.hash);
+               IsRecentlyRejected(inv.hash) || pcoinsTip->HaveCoins(inv.hash);
         }
     case MSG_BLOCK:
     case MSG_WITNESS_BLOCK:
@@ -6128,6 +6561,111 @@ bool static AlreadyHave(const CInv& inv)
     return true;
 }
 
+/** How many of the most recent blocks keep their serialized "block" message */
+static const int MAX_BLOCK_MESSAGES = 8;
+
+/**
+ * Serialized "block" messages of blocks near the tip, most recently used first.
+ * Peers asking for a new block get the bytes it arrived in, or was first sent
+ * in, without another disk read or serialization. (protected by cs_main)
+ */
+static std::list<std::pair<uint256, CSerializedNetMsg> > lBlockMessages;
+
+static bool IsBlockMessageCacheable(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    return (pindex->nStatus & BLOCK_HAVE_DATA) && pindex->nHeight + MAX_BLOCK_MESSAGES > chainActive.Height();
+}
+
+static CSerializedNetMsg GetBlockMessage(const uint256& hash)
+{
+    AssertLockHeld(cs_main);
+    for (std::list<std::pair<uint256, CSerializedNetMsg> >::iterator it = lBlockMessages.begin(); it != lBlockMessages.end(); ++it) {
+        if (it->first == hash) {
+            lBlockMessages.splice(lBlockMessages.begin(), lBlockMessages, it);
+            return it->second;
+        }
+    }
+    return CSerializedNetMsg();
+}
+
+static void CacheBlockMessage(const uint256& hash, const CSerializedNetMsg& msg)
+{
+    AssertLockHeld(cs_main);
+    if (!GetBlockMessage(hash).IsNull())
+        return;
+    lBlockMessages.push_front(std::make_pair(hash, msg));
+    if (lBlockMessages.size() > (size_t)MAX_BLOCK_MESSAGES)
+        lBlockMessages.pop_back();
+}
+
+bool PreVerifyTransactionScripts(const CTransaction& tx)
+{
+    if (tx.IsCoinBase() || tx.IsCoinStake())
+        return false;
+
+    PrecomputedTransactionData txdata(tx);
+    std::vector<CScriptCheck> vChecks;
+    unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    {
+        // The spent coins come from the chain tip or the mempool; the checks
+        // copy their scripts and amounts, so nothing refers back to them.
+        LOCK2(cs_main, mempool.cs);
+
+        // Only transactions that pass the cheap checks of AcceptToMemoryPool are worth
+        // the signatures; the rest are left to it, which rejects them before its own.
+        if (AlreadyHave(CInv(MSG_TX, tx.GetHash())))
+            return false;
+        CValidationState state;
+        std::string reason;
+        if (!CheckTransaction(tx, state) || !IsFinalTx(tx, chainActive.Height() + 1))
+            return false;
+        if (fRequireStandard && !IsStandardTx(tx, reason, IsWitnessEnabled(chainActive.Tip(), Params().GetConsensus())))
+            return false;
+        for (const CTxIn& txin : tx.vin) {
+            if (mempool.mapNextTx.count(txin.prevout))
+                return false;
+        }
+
+        CCoinsView dummy;
+        CCoinsViewCache view(&dummy);
+        CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
+        view.SetBackend(viewMemPool);
+        if (!view.HaveInputs(tx))
+            return false;
+        if (fRequireStandard && !AreInputsStandard(tx, view))
+            return false;
+        CAmount nFees = view.GetValueIn(tx) - tx.GetValueOut();
+        if (nFees < ::minRelayTxFee.GetFee(::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION)))
+            return false;
+
+        // Same flags as AcceptToMemoryPool, which skips its own script checks only if they match
+        if (chainActive.Height() >= Params().StartDevfeeBlock())
+            flags |= SCRIPT_ENABLE_SCHNORR;
+
+        vChecks.reserve(tx.vin.size());
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            const CCoins* coins = view.AccessCoins(tx.vin[i].prevout.hash);
+            vChecks.push_back(CScriptCheck());
+            CScriptCheck(*coins, tx, i, flags, true, &txdata).swap(vChecks.back());
+        }
+        view.SetBackend(dummy);
+    }
+
+    bool fOk;
+    if (nMempoolCheckThreads > 0 && vChecks.size() > 1) {
+        CCheckQueueControl<CScriptCheck> control(&mempoolcheckqueue);
+        control.Add(vChecks);
+        fOk = control.Wait();
+    } else {
+        fOk = RunCheckBatch(vChecks);
+    }
+    if (fOk) {
+        LOCK(cs_preverified);
+        setPreVerifiedScripts.insert(PreVerifiedScriptsKey(tx, flags));
+    }
+    return fOk;
+}
 
 void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParams)
 {
@@ -6168,10 +6706,26 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // Pruned nodes may have deleted the block, so check whether
                 // it's available before trying to send.
                 if (send && pindex && (pindex->nStatus & BLOCK_HAVE_DATA)) {
+                    bool fFullBlock = (inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK);
+                    CSerializedNetMsg msgBlock;
+                    if (fFullBlock)
+                        msgBlock = GetBlockMessage(inv.hash);
+
                     // Send block from disk
                     CBlock block;
-                    if (ReadBlockFromDisk(block, pindex, consensusParams)) {
-                        if (inv.type == MSG_BLOCK)
+                    if (!msgBlock.IsNull()) {
+                        pfrom->PushSerializedMessage(msgBlock);
+                    } else if (ReadBlockFromDisk(block, pindex, consensusParams)) {
+                        if (fFullBlock && IsBlockMessageCacheable(pindex)) {
+                            // Serialize once for all the peers about to ask for a new block
+                            CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+                            ssBlock << block;
+                            CSerializeData vchBlock;
+                            ssBlock.Swap(vchBlock);
+                            msgBlock = MakeSerializedNetMsg("block", vchBlock);
+                            CacheBlockMessage(inv.hash, msgBlock);
+                            pfrom->PushSerializedMessage(msgBlock);
+                        } else if (inv.type == MSG_BLOCK)
                             pfrom->PushMessage("block", block); //TODO: push message with flag NO_WITNESS
                           //pfrom->PushMessageWithFlag(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block);
                         else if (inv.type == MSG_WITNESS_BLOCK)
@@ -6732,6 +7286,12 @@ static bool ProcessMessage(CNode* pfrom, const string &strCommand, CDataStream&
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
 
+        // Verify the scripts of a transaction that passes the cheap checks before taking
+        // cs_main for the admission itself, which then only has the signature cache to consult.
+        int64_t nTimeVerify = GetTimeMicros();
+        bool fScriptsOk = PreVerifyTransactionScripts(tx);
+        LogPrint("bench", "    - Pre-verify %s: %s %.2fms\n", tx.GetHash().ToString(), fScriptsOk ? "ok" : "skipped/failed", 0.001 * (GetTimeMicros() - nTimeVerify));
+
         LOCK(cs_main);
 
         bool fMissingInputs = false;
@@ -6810,6 +7370,9 @@ static bool ProcessMessage(CNode* pfrom, const string &strCommand, CDataStream&
             if (nEvicted > 0)
                 LogPrint("mempool", "mapOrphan overflow, removed %u tx\n", nEvicted);
         } else {
+            // Not verified or admitted again until the tip changes
+            if (!state.CorruptionPossible())
+                setRecentRejects.insert(tx.GetHash());
 
             if (pfrom->fWhitelisted && GetBoolArg("-whitelistalwaysrelay", DEFAULT_WHITELISTALWAYSRELAY)) {
                 int nDoS = 0;
@@ -6896,8 +7459,12 @@ static bool ProcessMessage(CNode* pfrom, const string &strCommand, CDataStream&
 
 
     else if (strCommand == "block" && !fImporting && !fReindex) { // Ignore blocks received while importing
+        // Parse the block where it was received, keeping the bytes to relay them as they are
+        CSerializeData vchBlock;
+        vRecv.Swap(vchBlock);
         CBlock block;
-        vRecv >> block;
+        CBufferReader reader(vchBlock.data(), vchBlock.data() + vchBlock.size(), vRecv.GetType(), vRecv.GetVersion());
+        reader >> block;
 
         CBlockIndex* pindexPrev = LookupBlockIndex(block.hashPrevBlock);
         bool usePhi2 = pindexPrev ? pindexPrev->nHeight + 1 >= Params().SwitchPhi2Block() : false;
@@ -6930,8 +7497,29 @@ static bool ProcessMessage(CNode* pfrom, const string &strCommand, CDataStream&
                     TRY_LOCK(cs_main, lockMain);
                     if (lockMain) Misbehaving(pfrom->GetId(), nDoS);
                 }
+            } else if (vchBlock.size() == ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)) {
+                // Only bytes that are exactly what we would serialize are passed on. The size
+                // check above rules out most other encodings; the bytes are compared only for
+                // a block about to be cached, which happens once per block.
+                bool fCache = false;
+                {
+                    LOCK(cs_main);
+                    CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+                    fCache = pindex && IsBlockMessageCacheable(pindex) && GetBlockMessage(hashBlock).IsNull();
+                }
+                if (fCache) {
+                    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+                    ssBlock << block;
+                    fCache = std::equal(ssBlock.begin(), ssBlock.end(), vchBlock.begin());
+                }
+                if (fCache) {
+                    CSerializedNetMsg msgBlock = MakeSerializedNetMsg("block", vchBlock);
+                    LOCK(cs_main);
+                    CacheBlockMessage(hashBlock, msgBlock);
+                }
             }
         }
+        ReleaseNetBuffer(vchBlock);
 
     }
 
@@ -7079,6 +7667,93 @@ static bool ProcessMessage(CNode* pfrom, const string &strCommand, CDataStream&
     }
 
 
+    else if (strCommand == "getcfilters") {
+        uint8_t nFilterType;
+        uint32_t nStartHeight;
+        uint256 hashStop;
+        vRecv >> nFilterType >> nStartHeight >> hashStop;
+
+        const CBlockIndex* pindexStop;
+        if (!PrepareBlockFilterRequest(pfrom, nFilterType, nStartHeight, hashStop, MAX_GETCFILTERS_SIZE, pindexStop))
+            return true;
+
+        for (const uint256& hashBlock : GetBlockFilterRange(nStartHeight, pindexStop)) {
+            BlockFilter filter;
+            if (!pblocktree->ReadBlockFilter(hashBlock, filter)) {
+                LogPrint("net", "Failed to find block filter for block %s, requested by peer %d\n", hashBlock.ToString(), pfrom->id);
+                return true;
+            }
+            pfrom->PushMessage("cfilter", filter);
+        }
+    }
+
+
+    else if (strCommand == "getcfheaders") {
+        uint8_t nFilterType;
+        uint32_t nStartHeight;
+        uint256 hashStop;
+        vRecv >> nFilterType >> nStartHeight >> hashStop;
+
+        const CBlockIndex* pindexStop;
+        if (!PrepareBlockFilterRequest(pfrom, nFilterType, nStartHeight, hashStop, MAX_GETCFHEADERS_SIZE, pindexStop))
+            return true;
+
+        std::vector<uint256> vHashes = GetBlockFilterRange(nStartHeight, pindexStop);
+        uint256 hashPrevHeader;
+        uint256 hashFilter;
+        if (nStartHeight > 0) {
+            uint256 hashPrevBlock;
+            {
+                LOCK(cs_main);
+                hashPrevBlock = pindexStop->GetAncestor(nStartHeight - 1)->GetBlockHash();
+            }
+            if (!pblocktree->ReadBlockFilterHeader(hashPrevBlock, hashFilter, hashPrevHeader)) {
+                LogPrint("net", "Failed to find block filter header for block %s, requested by peer %d\n", hashPrevBlock.ToString(), pfrom->id);
+                return true;
+            }
+        }
+
+        std::vector<uint256> vFilterHashes;
+        vFilterHashes.reserve(vHashes.size());
+        uint256 header;
+        for (const uint256& hashBlock : vHashes) {
+            if (!pblocktree->ReadBlockFilterHeader(hashBlock, hashFilter, header)) {
+                LogPrint("net", "Failed to find block filter hash for block %s, requested by peer %d\n", hashBlock.ToString(), pfrom->id);
+                return true;
+            }
+            vFilterHashes.push_back(hashFilter);
+        }
+        pfrom->PushMessage("cfheaders", nFilterType, hashStop, hashPrevHeader, vFilterHashes);
+    }
+
+
+    else if (strCommand == "getcfcheckpt") {
+        uint8_t nFilterType;
+        uint256 hashStop;
+        vRecv >> nFilterType >> hashStop;
+
+        const CBlockIndex* pindexStop;
+        if (!PrepareBlockFilterRequest(pfrom, nFilterType, 0, hashStop, std::numeric_limits<uint32_t>::max(), pindexStop))
+            return true;
+
+        std::vector<uint256> vHeaders;
+        {
+            LOCK(cs_main);
+            for (int nHeight = CFCHECKPT_INTERVAL; nHeight <= pindexStop->nHeight; nHeight += CFCHECKPT_INTERVAL)
+                vHeaders.push_back(pindexStop->GetAncestor(nHeight)->GetBlockHash());
+        }
+        uint256 hashFilter;
+        for (uint256& header : vHeaders) {
+            uint256 hashBlock = header;
+            if (!pblocktree->ReadBlockFilterHeader(hashBlock, hashFilter, header)) {
+                LogPrint("net", "Failed to find block filter header for block %s, requested by peer %d\n", hashBlock.ToString(), pfrom->id);
+                return true;
+            }
+        }
+        pfrom->PushMessage("cfcheckpt", nFilterType, hashStop, vHeaders);
+    }
+
+
     else if (!(nLocalServices & NODE_BLOOM) &&
              (strCommand == "filterload" ||
               strCommand == "filteradd" ||
@@ -7630,22 +8305,86 @@ bool CheckSenderScript(const CCoinsViewCache& view, const CTransaction& tx) {
     return true;
 }
 
-std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, const dev::Address& sender, uint64_t gasLimit){
+/**
+ * Values derived from the active tip that contract calls and mempool acceptance
+ * would otherwise recompute every time: each DGP query executes the DGP contracts,
+ * and calls on the tip state need the tip block.
+ */
+struct CTipCache {
+    uint256 hashTip;
+    std::map<unsigned int, LuxDGPParams> mapDGPParams;
+    std::unique_ptr<CBlock> pblockSkeleton;
+    bool fEvaluatingDGP;
+
+    CTipCache() : fEvaluatingDGP(false) {}
+
+    void Update()
+    {
+        AssertLockHeld(cs_main);
+        uint256 hash = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256();
+        if(hash != hashTip){
+            hashTip = hash;
+            mapDGPParams.clear();
+            pblockSkeleton.reset();
+        }
+    }
+};
+static CTipCache tipCache;
+
+const LuxDGPParams& GetTipDGPParams(unsigned int nHeight){
+    static const LuxDGPParams defaultParams = {DEFAULT_BLOCK_GAS_LIMIT_DGP, DEFAULT_MIN_GAS_PRICE_DGP, DEFAULT_BLOCK_SIZE_DGP, dev::eth::EIP158Schedule};
+
+    tipCache.Update();
+    std::map<unsigned int, LuxDGPParams>::const_iterator it = tipCache.mapDGPParams.find(nHeight);
+    if(it != tipCache.mapDGPParams.end())
+        return it->second;
+
+    // With -dgpevm the DGP contracts are read through CallContract, which asks for
+    // the block gas limit again; those nested calls run with the defaults.
+    if(tipCache.fEvaluatingDGP)
+        return defaultParams;
+    tipCache.fEvaluatingDGP = true;
+    LuxDGPParams params;
+    try {
+        LuxDGP luxDGP(globalState.get(), fGettingValuesDGP);
+        params.blockGasLimit = luxDGP.getBlockGasLimit(nHeight);
+        params.minGasPrice = luxDGP.getMinGasPrice(nHeight);
+        params.blockSize = luxDGP.getBlockSize(nHeight);
+        params.schedule = luxDGP.getGasSchedule(nHeight);
+    } catch (...) {
+        tipCache.fEvaluatingDGP = false;
+        throw;
+    }
+    tipCache.fEvaluatingDGP = false;
+    return tipCache.mapDGPParams.insert(std::make_pair(nHeight, params)).first->second;
+}
+
+bool GetTipBlockSkeleton(CBlock& block){
+    tipCache.Update();
+    if(!tipCache.pblockSkeleton){
+        CBlockIndex* pindex = chainActive.Tip();
+        std::unique_ptr<CBlock> pblock(new CBlock());
+        if(pindex == nullptr || !ReadBlockFromDisk(*pblock, pindex, Params().GetConsensus()))
+            return false;
+
+        // Only the header and the reward transactions are used to build the EVM environment
+        if(pblock->IsProofOfStake())
+            pblock->vtx.erase(pblock->vtx.begin()+std::min<size_t>(2, pblock->vtx.size()), pblock->vtx.end());
+        else
+            pblock->vtx.erase(pblock->vtx.begin()+std::min<size_t>(1, pblock->vtx.size()), pblock->vtx.end());
+        tipCache.pblockSkeleton = std::move(pblock);
+    }
+    block = *tipCache.pblockSkeleton;
+    return true;
+}
+
+std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, const dev::Address& sender, uint64_t gasLimit, const dev::eth::OnOpFunc& onOp){
     CBlock block;
     CMutableTransaction tx;
-    const CChainParams& chainparams = Params();
-    CBlockIndex* pblockindex = mapBlockIndex[chainActive.Tip()->GetBlockHash()];
-    ReadBlockFromDisk(block, pblockindex, chainparams.GetConsensus());
+    GetTipBlockSkeleton(block);
     block.nTime = GetAdjustedTime();
 
-    if(block.IsProofOfStake())
-        block.vtx.erase(block.vtx.begin()+2,block.vtx.end());
-    else
-        block.vtx.erase(block.vtx.begin()+1,block.vtx.end());
-
-
-    LuxDGP luxDGP(globalState.get(), fGettingValuesDGP);
-    uint64_t blockGasLimit = luxDGP.getBlockGasLimit(chainActive.Height() + 1);
+    uint64_t blockGasLimit = GetTipDGPParams(chainActive.Height() + 1).blockGasLimit;
 
     if(gasLimit == 0){
         gasLimit = blockGasLimit - 1;
@@ -7660,10 +8399,68 @@ std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::v
 
 
     ByteCodeExec exec(block, std::vector<LuxTransaction>(1, callTransaction), blockGasLimit);
-    exec.performByteCode(dev::eth::Permanence::Reverted);
+    exec.performByteCode(dev::eth::Permanence::Reverted, nullptr, onOp);
     return exec.getResult();
 }
 
+bool TraceContractTransaction(const uint256& txid, LuxExecutionProfiler& profiler, std::vector<ResultExecute>& results, std::string& strError){
+    AssertLockHeld(cs_main);
+
+    CTransaction tx;
+    uint256 hashBlock;
+    if(!GetTransaction(txid, tx, Params().GetConsensus(), hashBlock, true) || hashBlock.IsNull()){
+        strError = "No such mined transaction (requires -txindex)";
+        return false;
+    }
+    BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+    if(mi == mapBlockIndex.end() || !chainActive.Contains(mi->second)){
+        strError = "Transaction is not in the active chain";
+        return false;
+    }
+    const CBlockIndex* pindex = mi->second;
+    if(pindex->nHeight < Params().FirstSCBlock() || !tx.HasCreateOrCall() || tx.HasOpSpend()){
+        strError = "Not a contract transaction";
+        return false;
+    }
+    CBlock block;
+    if(!ReadBlockFromDisk(block, pindex, Params().GetConsensus())){
+        strError = "Can't read block from disk";
+        return false;
+    }
+
+    // Replay the block on the state of its parent the way ConnectBlock executed it,
+    // hooking the profiler into the requested transaction only. The replay runs on a
+    // private copy whose writes stay in its own overlay and are dropped on return.
+    LuxState state(*globalState);
+    state.setRoot(uintToh256(pindex->pprev->hashStateRoot));
+    state.setRootUTXO(uintToh256(pindex->pprev->hashUTXORoot));
+    for(const CTransaction& btx : block.vtx){
+        if(!btx.HasCreateOrCall() || btx.HasOpSpend())
+            continue;
+
+        LuxTxConverter convert(btx, NULL, &block.vtx);
+        ExtractLuxTX resultConvertLuxTX;
+        if(!convert.extractionLuxTransactions(resultConvertLuxTX)){
+            strError = "Contract transaction of the wrong format in block";
+            return false;
+        }
+
+        bool fTarget = btx.GetHash() == txid;
+        ByteCodeExec exec(block, resultConvertLuxTX.first, DEFAULT_BLOCK_GAS_LIMIT_DGP);
+        if(!exec.performByteCode(dev::eth::Permanence::Uncommitted, pindex->pprev, fTarget ? profiler.Hook() : OnOpFunc(), &state)){
+            strError = "Unknown error during contract execution";
+            return false;
+        }
+        if(fTarget){
+            profiler.Finish();
+            results = exec.getResult();
+            return true;
+        }
+    }
+    strError = "Transaction not found in its block";
+    return false;
+}
+
 bool CheckMinGasPrice(std::vector<EthTransactionParams>& etps, const uint64_t& minGasPrice){
     for(EthTransactionParams& etp : etps){
         if(etp.gasPrice < dev::u256(minGasPrice))
@@ -7812,23 +8609,26 @@ void writeVMlog(const std::vector<ResultExecute>& res, const CTransaction& tx, c
     fIsVMlogFile = true;
 }
 
-bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
+bool ByteCodeExec::performByteCode(dev::eth::Permanence type, const CBlockIndex* pindexPrev, const dev::eth::OnOpFunc& onOp, LuxState* pstate){
+    LuxState& state = pstate ? *pstate : *globalState;
     for(LuxTransaction& tx : txs){
         //validate VM version
         if(tx.getVersion().toRaw() != VersionVM::GetEVMDefault().toRaw()){
             return false;
         }
-        dev::eth::EnvInfo envInfo(BuildEVMEnvironment());
-        if(!tx.isCreation() && !globalState->addressInUse(tx.receiveAddress())){
+        dev::eth::EnvInfo envInfo(BuildEVMEnvironment(pindexPrev));
+        if(!tx.isCreation() && !state.addressInUse(tx.receiveAddress())){
             dev::eth::ExecutionResult execRes;
             execRes.excepted = dev::eth::TransactionException::Unknown;
             result.push_back(ResultExecute{execRes, dev::eth::TransactionReceipt(dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction()});
             continue;
         }
-        result.push_back(globalState->execute(envInfo, *globalSealEngine.get(), tx, type, OnOpFunc()));
+        result.push_back(state.execute(envInfo, *globalSealEngine.get(), tx, type, onOp));
+    }
+    if(type != dev::eth::Permanence::Uncommitted){
+        state.db().commit();
+        state.dbUtxo().commit();
     }
-    globalState->db().commit();
-    globalState->dbUtxo().commit();
     globalSealEngine.get()->deleteAddresses.clear();
     return true;
 }
@@ -7872,9 +8672,9 @@ bool ByteCodeExec::processingResults(ByteCodeExecResult& resultBCE){
     return true;
 }
 
-dev::eth::EnvInfo ByteCodeExec::BuildEVMEnvironment(){
+dev::eth::EnvInfo ByteCodeExec::BuildEVMEnvironment(const CBlockIndex* pindexPrev){
     dev::eth::EnvInfo env;
-    CBlockIndex* tip = chainActive.Tip();
+    const CBlockIndex* tip = pindexPrev ? pindexPrev : chainActive.Tip();
     env.setNumber(dev::u256(tip->nHeight + 1));
     env.setTimestamp(dev::u256(block.nTime));
     env.setDifficulty(dev::u256(block.nBits));
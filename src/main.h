@@ -73,6 +73,7 @@ class CChainParams;
 class CInv;
 class CConnman;
 class CScriptCheck;
+class CSignatureBatch;
 class CValidationInterface;
 class CValidationState;
 
@@ -123,9 +124,11 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 /** Maximum number of script-checking threads allowed */
-static const int MAX_SCRIPTCHECK_THREADS = 16;
+static const int MAX_SCRIPTCHECK_THREADS = 64;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Default for -batchsigverify, verify Schnorr signatures of script-check batches together */
+static const bool DEFAULT_BATCH_SIG_VERIFY = true;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -133,6 +136,12 @@ static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached their tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 2000;
+/** Maximum number of compact filters that may be requested with one getcfilters. See BIP 157. */
+static const uint32_t MAX_GETCFILTERS_SIZE = 1000;
+/** Maximum number of cf hashes that may be requested with one getcfheaders. See BIP 157. */
+static const uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+/** Interval between compact filter checkpoints. See BIP 157. */
+static const int CFCHECKPT_INTERVAL = 1000;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
@@ -163,6 +172,9 @@ static const bool DEFAULT_TXINDEX = true;
 static const int64_t STATIC_POS_REWARD = 1 * COIN; //Constant reward 8%
 
 static const bool DEFAULT_LOGEVENTS = false;
+static const bool DEFAULT_TOKENINDEX = false;
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
 
 static const int64_t DEFAULT_MAX_TIP_AGE = 6 * 60 * 60; // ~144 blocks behind -> 2 x fork detection time, was 24 * 60 * 60 in bitcoin
 
@@ -174,6 +186,12 @@ static const CAmount MAX_RPC_GAS_PRICE=0.00000100*COIN;
 
 static const size_t MAX_CONTRACT_VOUTS = 1000;
 
+/** Default for -evmcodecache, memory for analysed contract code shared by EVM instances (MiB) */
+static const unsigned int DEFAULT_EVM_CODE_CACHE_SIZE = 32;
+
+/** Default for -evmstatecache, memory for contract accounts and storage slots kept across blocks (MiB) */
+static const unsigned int DEFAULT_EVM_STATE_CACHE_SIZE = 64;
+
 /** Minimum gas limit that is allowed in a transaction within a block - prevent various types of tx and mempool spam **/
 static const uint64_t MINIMUM_GAS_LIMIT = 10000;
 
@@ -226,11 +244,14 @@ extern int nScriptCheckThreads;
 extern bool fTxIndex;
 extern bool fLogEvents;
 extern bool fAddressIndex;
+extern bool fTokenIndex;
+extern bool fBlockFilterIndex;
 extern bool fSpentIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern unsigned int nBytesPerSigOp;
 extern bool fCheckBlockIndex;
+extern bool fBatchSigVerify;
 extern size_t nCoinCacheUsage;
 extern CFeeRate minRelayTxFee;
 extern bool fAlerts;
@@ -321,6 +342,10 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the script checking thread for transactions entering the mempool */
+void ThreadMempoolScriptCheck();
+/** Build the missing compact block filters of the active chain, then leave the index to ConnectBlock */
+void ThreadBlockFilterIndex();
 
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
@@ -384,6 +409,20 @@ void PruneAndFlush();
 
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced = nullptr, bool fRejectInsaneFee = false, bool ignoreFees = false);
+/**
+ * Verify the input scripts of a loose transaction on the mempool check threads
+ * while cs_main is not held. A transaction that passes is remembered with the
+ * script flags used, and the AcceptToMemoryPool that follows skips its standard
+ * script checks if it would use the same flags; the mandatory ones still run and
+ * find the signatures in the signature cache. Only the lookup of the spent coins
+ * and the cheap checks of AcceptToMemoryPool run under cs_main; transactions
+ * already known, recently rejected, non-standard, conflicting or below the relay
+ * fee are not verified here. This never changes whether or why a transaction is
+ * rejected. Returns true if the scripts were verified and passed.
+ */
+bool PreVerifyTransactionScripts(const CTransaction& tx);
+/** Whether the input scripts of tx passed PreVerifyTransactionScripts under exactly these flags */
+bool HavePreVerifiedScripts(const CTransaction& tx, unsigned int flags);
 
 bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, bool fRejectInsaneFee = false, bool isDSTX = false);
 
@@ -662,15 +701,19 @@ private:
     bool cacheStore;
     ScriptError error;
     PrecomputedTransactionData *txdata;
+    CSignatureBatch *pbatch;
 
 public:
-    CScriptCheck(): amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
+    CScriptCheck(): amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), pbatch(NULL) {}
     CScriptCheck(const CCoins& txFromIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
         scriptPubKey(txFromIn.vout[txToIn.vin[nInIn].prevout.n].scriptPubKey), amount(txFromIn.vout[txToIn.vin[nInIn].prevout.n].nValue),
-        ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn) {}
+        ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn), pbatch(NULL) {}
 
     bool operator()();
 
+    /** Defer Schnorr signature checks to pbatchIn instead of verifying them inline (NULL to disable). */
+    void SetBatch(CSignatureBatch* pbatchIn) { pbatch = pbatchIn; }
+
     void swap(CScriptCheck& check)
     {
         scriptPubKey.swap(check.scriptPubKey);
@@ -681,14 +724,28 @@ public:
         std::swap(cacheStore, check.cacheStore);
         std::swap(error, check.error);
         std::swap(txdata, check.txdata);
+        std::swap(pbatch, check.pbatch);
     }
 
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Run a worker's share of script checks from the check queue. With
+ * -batchsigverify, Schnorr signatures of CHECKSIGVERIFY and NULLFAIL
+ * CHECKSIG are verified together for the whole share. If that fails, the
+ * share is bisected down to the scripts at fault, which are checked alone.
+ */
+bool RunCheckBatch(std::vector<CScriptCheck>& vChecks);
+
 /** Address and Spent Indexes **/
 bool GetAddressIndex(uint160 addrHash, uint16_t addrType, AddressIndexVector &addressIndex, int start = 0, int end = 0);
+bool GetAddressIndexBatch(const AddressTypeVector &addresses, AddressIndexVector &addressIndex,
+                          int start, unsigned int startIndex, int end, size_t nLimit, bool &fMore);
+bool GetAddressBalance(uint160 addrHash, uint16_t addrType, CAddressBalanceValue &balance);
 bool GetAddressUnspent(uint160 addrHash, uint16_t addrType, AddressUnspentVector &unspentOutputs);
+bool GetAddressUnspentBatch(const AddressTypeVector &addresses, AddressUnspentVector &unspentOutputs,
+                            const CAddressUnspentKey *pcursorKey, size_t nLimit, CAddressUnspentKey *pnextKey);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 
 /** Functions for disk access for blocks */
@@ -709,7 +766,8 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 bool DisconnectBlocksAndReprocess(int blocks);
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins */
-bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, const CChainParams& chainparams, bool fJustCheck = false);
+bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, const CChainParams& chainparams, bool fJustCheck = false,
+                  std::vector<TransactionReceiptInfo>* pvReceipts = NULL);
 
 /** Context-independent validity checks */
 bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true);
@@ -820,6 +878,19 @@ inline CBlockIndex* LookupBlockIndex(const uint256& hash)
     return it == mapBlockIndex.end() ? nullptr : it->second;
 }
 
+/**
+ * Find a block index entry without holding cs_main, for read-only RPC and REST
+ * handlers. Entries are never removed while the node runs.
+ */
+CBlockIndex* LookupBlockIndexConcurrent(const uint256& hash);
+
+/**
+ * Active chain as of the last completed ActivateBestChain step. Readers that use it
+ * instead of chainActive need not take cs_main; the coins view and the mempool still
+ * require it.
+ */
+CChainSnapshotRef GetChainSnapshot();
+
 /** Find the last common block between the parameter chain and a locator. */
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator);
 
@@ -858,7 +929,26 @@ static const unsigned int REJECT_CONFLICT = 0x102;
 int GetSpendHeight(const CCoinsViewCache& inputs);
 
 //////////////////////////////////////////////////////// lux
-std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, const dev::Address& sender = dev::Address(), uint64_t gasLimit=0);
+/** DGP parameters for a block height, evaluated on the state of the active chain tip */
+struct LuxDGPParams {
+    uint64_t blockGasLimit;
+    uint64_t minGasPrice;
+    uint32_t blockSize;
+    dev::eth::EVMSchedule schedule;
+};
+
+/** DGP parameters for nHeight on the active tip, cached until the tip changes. Requires cs_main. */
+const LuxDGPParams& GetTipDGPParams(unsigned int nHeight);
+
+/** Header and reward transactions of the active tip block, cached until the tip changes. Requires cs_main. */
+bool GetTipBlockSkeleton(CBlock& block);
+
+std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, const dev::Address& sender = dev::Address(), uint64_t gasLimit=0, const dev::eth::OnOpFunc& onOp = OnOpFunc());
+
+class LuxExecutionProfiler;
+
+/** Re-execute the contract transactions of the block containing txid up to txid, profiling txid (requires -txindex). */
+bool TraceContractTransaction(const uint256& txid, LuxExecutionProfiler& profiler, std::vector<ResultExecute>& results, std::string& strError);
 
 bool CheckSenderScript(const CCoinsViewCache& view, const CTransaction& tx);
 
@@ -923,15 +1013,17 @@ public:
 
     ByteCodeExec(const CBlock& _block, std::vector<LuxTransaction> _txs, const uint64_t _blockGasLimit) : txs(_txs), block(_block), blockGasLimit(_blockGasLimit) {}
 
-    bool performByteCode(dev::eth::Permanence type = dev::eth::Permanence::Committed);
+    // Executes on pstate, or on globalState when null. Permanence::Uncommitted leaves the database untouched.
+    bool performByteCode(dev::eth::Permanence type = dev::eth::Permanence::Committed, const CBlockIndex* pindexPrev = nullptr, const dev::eth::OnOpFunc& onOp = OnOpFunc(), LuxState* pstate = nullptr);
 
     bool processingResults(ByteCodeExecResult& result);
 
     std::vector<ResultExecute>& getResult(){ return result; }
 
-private:
+    // Environment for executing on top of pindexPrev (the active tip when null).
+    dev::eth::EnvInfo BuildEVMEnvironment(const CBlockIndex* pindexPrev = nullptr);
 
-    dev::eth::EnvInfo BuildEVMEnvironment();
+private:
 
     dev::Address EthAddrFromScript(const CScript& scriptIn);
 
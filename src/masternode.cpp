@@ -8,11 +8,15 @@
 #include "activemasternode.h"
 #include "consensus/validation.h"
 #include "darksend.h"
+#include "hash.h"
 #include "primitives/transaction.h"
 #include "main.h"
 #include "util.h"
 #include "addrman.h"
+#include "limitedmap.h"
+
 #include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
 //tt
 
 int CMasterNode::minProtoVersion = MIN_PROTO_VERSION;
@@ -52,8 +56,211 @@ void ProcessMasternodeConnections() {
     }
 }
 
+// dsee announces whose signature checked out, the newest sigTimes are kept
+static CCriticalSection cs_mapVerifiedAnnounces;
+static limitedmap<uint256, int64_t> mapVerifiedAnnounces(MASTERNODE_ANNOUNCE_CACHE_SIZE);
+// dsee announces waiting for ThreadMasternodeAnnounceVerify and its results
+static boost::mutex mutexAnnounceQueue;
+static boost::condition_variable condAnnounceQueue;
+static std::deque<CMasternodeAnnounce> queueAnnounces;
+static std::set<uint256> setQueuedAnnounces;
+static std::vector<std::pair<CMasternodeAnnounce, bool> > vAnnounceResults;
+
+std::string CMasternodeAnnounce::GetSignatureMessage() const
+{
+    std::string vchPubKey(pubkey.begin(), pubkey.end());
+    std::string vchPubKey2(pubkey2.begin(), pubkey2.end());
+
+    return addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
+}
+
+uint256 CMasternodeAnnounce::GetHash() const
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << vin << addr << vchSig << sigTime << pubkey << pubkey2 << protocolVersion;
+    return ss.GetHash();
+}
+
+// Look the collateral up directly in the UTXO set. Returns false if it is missing or
+// already spent, otherwise fAssociated tells whether it is a collateral paid to pubkey
+// and nAge how many confirmations it has.
+static bool CheckMasternodeCollateral(const CTxIn& vin, const CPubKey& pubkey, bool& fAssociated, int& nAge)
+{
+    LOCK2(cs_main, mempool.cs);
+    const CCoins* coins = pcoinsTip->AccessCoins(vin.prevout.hash);
+    if (!coins || !coins->IsAvailable(vin.prevout.n) || mempool.isSpent(vin.prevout))
+        return false;
+
+    const CTxOut& out = coins->vout[vin.prevout.n];
+    fAssociated = out.nValue == GetMNCollateral(chainActive.Height()) * COIN &&
+                  out.scriptPubKey == GetScriptForDestination(pubkey.GetID());
+    nAge = (chainActive.Height() + 1) - coins->nHeight;
+    return true;
+}
+
+bool IsMasternodeAnnounceUseful(const CMasternodeAnnounce& mnb)
+{
+    for (CMasterNode& mn : vecMasternodes) {
+        if (mn.vin.prevout == mnb.vin.prevout)
+            return mnb.count == -1 && mn.pubkey == mnb.pubkey && !mn.UpdatedWithin(MASTERNODE_MIN_DSEE_SECONDS);
+    }
+    return true;
+}
+
+bool IsMasternodeAnnounceVerified(const uint256& hash)
+{
+    LOCK(cs_mapVerifiedAnnounces);
+    return mapVerifiedAnnounces.count(hash) > 0;
+}
+
+bool QueueMasternodeAnnounce(const CMasternodeAnnounce& mnb)
+{
+    uint256 hash = mnb.GetHash();
+    {
+        boost::unique_lock<boost::mutex> lock(mutexAnnounceQueue);
+        // the same announce relayed by several peers is only checked once
+        if (setQueuedAnnounces.count(hash))
+            return true;
+        if (queueAnnounces.size() >= MASTERNODE_ANNOUNCE_QUEUE_SIZE)
+            return false;
+        queueAnnounces.push_back(mnb);
+        setQueuedAnnounces.insert(hash);
+    }
+    condAnnounceQueue.notify_one();
+    return true;
+}
+
+void ThreadMasternodeAnnounceVerify()
+{
+    RenameThread("lux-mnverify");
+
+    while (true) {
+        CMasternodeAnnounce mnb;
+        {
+            boost::unique_lock<boost::mutex> lock(mutexAnnounceQueue);
+            while (queueAnnounces.empty())
+                condAnnounceQueue.wait(lock);
+            mnb = queueAnnounces.front();
+            queueAnnounces.pop_front();
+        }
+
+        std::string errorMessage = "";
+        std::vector<unsigned char> vchSig = mnb.vchSig;
+        bool fValid = darkSendSigner.VerifyMessage(mnb.pubkey, vchSig, mnb.GetSignatureMessage(), errorMessage);
+        uint256 hash = mnb.GetHash();
+        if (fValid) {
+            LOCK(cs_mapVerifiedAnnounces);
+            mapVerifiedAnnounces.insert(std::make_pair(hash, mnb.sigTime));
+        }
+
+        boost::unique_lock<boost::mutex> lock(mutexAnnounceQueue);
+        setQueuedAnnounces.erase(hash);
+        vAnnounceResults.push_back(std::make_pair(mnb, fValid));
+    }
+}
+
+void ProcessVerifiedMasternodeAnnounces()
+{
+    std::vector<std::pair<CMasternodeAnnounce, bool> > vResults;
+    {
+        boost::unique_lock<boost::mutex> lock(mutexAnnounceQueue);
+        vResults.swap(vAnnounceResults);
+    }
+
+    for (const std::pair<CMasternodeAnnounce, bool>& result : vResults) {
+        if (!result.second) {
+            LogPrintf("dsee - Got bad masternode address signature\n");
+            Misbehaving(result.first.nodeId, 100);
+            continue;
+        }
+        ProcessMasternodeAnnounce(result.first);
+    }
+}
+
+void ProcessMasternodeAnnounce(const CMasternodeAnnounce& mnb)
+{
+    bool isLocal = mnb.addr.IsRFC1918() || mnb.addr.IsLocal();
+    //if(Params().MineBlocksOnDemand()) isLocal = false;
+
+    //search existing masternode list, this is where we update existing masternodes with new dsee broadcasts
+    //LOCK(cs_masternodes);
+    for (CMasterNode& mn : vecMasternodes) {
+        if (mn.vin.prevout == mnb.vin.prevout) {
+            // count == -1 when it's a new entry
+            //   e.g. We don't want the entry relayed/time updated when we're syncing the list
+            // mn.pubkey = pubkey, the collateral is validated once below,
+            //   after that they just need to match
+            if (mnb.count == -1 && mn.pubkey == mnb.pubkey && !mn.UpdatedWithin(MASTERNODE_MIN_DSEE_SECONDS)) {
+                mn.UpdateLastSeen();
+
+                if (mn.now < mnb.sigTime) { //take the newest entry
+                    LogPrintf("dsee - Got updated entry for %s\n", mnb.addr.ToString().c_str());
+                    mn.pubkey2 = mnb.pubkey2;
+                    mn.now = mnb.sigTime;
+                    mn.sig = mnb.vchSig;
+                    mn.protocolVersion = mnb.protocolVersion;
+                    mn.addr = mnb.addr;
+
+                    RelayDarkSendElectionEntry(mnb.vin, mnb.addr, mnb.vchSig, mnb.sigTime, mnb.pubkey, mnb.pubkey2, mnb.count, mnb.current, mnb.lastUpdated, mnb.protocolVersion);
+                }
+            }
+
+            return;
+        }
+    }
+
+    // make sure the vout that was signed is an unspent collateral paid to pubkey
+    //  - this is only done once per masternode, the spent state is checked
+    //    later by .check() in many places and by ThreadCheckDarkSendPool()
+    bool fAssociated = false;
+    int nInputAge = 0;
+    if (!CheckMasternodeCollateral(mnb.vin, mnb.pubkey, fAssociated, nInputAge)) {
+        LogPrintf("dsee - Rejected masternode entry %s, collateral %s is missing or spent\n", mnb.addr.ToString().c_str(), mnb.vin.prevout.ToString().c_str());
+        return;
+    }
+
+    if (!fAssociated) {
+        LogPrintf("dsee - Got mismatched pubkey and vin\n");
+        if (!IsTestNet()) {
+            Misbehaving(mnb.nodeId, 10);
+            return;
+        }
+    }
+
+    if (fDebug) LogPrintf("dsee - Accepted masternode entry %s %i %i\n", mnb.addr.ToString().c_str(), mnb.count, mnb.current);
+
+    if (nInputAge < MASTERNODE_MIN_CONFIRMATIONS) {
+        LogPrintf("dsee - Input must have least %d confirmations\n", MASTERNODE_MIN_CONFIRMATIONS);
+        Misbehaving(mnb.nodeId, 20);
+        return;
+    }
+
+    // use this as a peer
+    addrman.Add(CAddress(mnb.addr, NODE_NETWORK), mnb.addrFrom, 2 * 60 * 60);
+
+    // add our masternode
+    CMasterNode mn(mnb.addr, mnb.vin, mnb.pubkey, mnb.vchSig, mnb.sigTime, mnb.pubkey2, mnb.protocolVersion);
+    mn.UpdateLastSeen(mnb.lastUpdated);
+    mn.cacheInputAge = nInputAge;
+    mn.cacheInputAgeBlock = chainActive.Height();
+    vecMasternodes.push_back(mn);
+
+    // if it matches our masternodeprivkey, then we've been remotely activated
+    if (mnb.pubkey2 == activeMasternode.pubKeyMasternode && mnb.protocolVersion == PROTOCOL_VERSION) {
+        CTxIn vin = mnb.vin;
+        CService addr = mnb.addr;
+        activeMasternode.EnableHotColdMasterNode(vin, addr);
+    }
+
+    if (mnb.count == -1 && !isLocal)
+        RelayDarkSendElectionEntry(mnb.vin, mnb.addr, mnb.vchSig, mnb.sigTime, mnb.pubkey, mnb.pubkey2, mnb.count, mnb.current, mnb.lastUpdated, mnb.protocolVersion);
+}
+
 void ProcessMasternode(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, bool& isMasternodeCommand) {
 
+    // apply the announces the verification thread has finished with so far
+    ProcessVerifiedMasternodeAnnounces();
+
     int nHeight = chainActive.Height() + 1;
 
     // Do not accept the peers having older versions when the fork happens
@@ -75,42 +282,26 @@ void ProcessMasternode(CNode* pfrom, const std::string& strCommand, CDataStream&
         bool fIsInitialDownload = IsInitialBlockDownload();
         if (fIsInitialDownload) return;
 
-        CTxIn vin;
-        CService addr;
-        CPubKey pubkey;
-        CPubKey pubkey2;
-        vector<unsigned char> vchSig;
-        int64_t sigTime;
-        int count;
-        int current;
-        int64_t lastUpdated;
-        int protocolVersion;
-        std::string strMessage;
+        CMasternodeAnnounce mnb;
+        mnb.nodeId = pfrom->GetId();
+        mnb.addrFrom = pfrom->addr;
 
         // 70047 and greater
-        vRecv >> vin >> addr >> vchSig >> sigTime >> pubkey >> pubkey2 >> count >> current >> lastUpdated >> protocolVersion;
+        vRecv >> mnb.vin >> mnb.addr >> mnb.vchSig >> mnb.sigTime >> mnb.pubkey >> mnb.pubkey2 >> mnb.count >> mnb.current >> mnb.lastUpdated >> mnb.protocolVersion;
 
         // make sure signature isn't in the future (past is OK)
-        if (sigTime > GetAdjustedTime() + 60 * 60) {
-            LogPrintf("dsee - Signature rejected, too far into the future %s\n", vin.ToString().c_str());
+        if (mnb.sigTime > GetAdjustedTime() + 60 * 60) {
+            LogPrintf("dsee - Signature rejected, too far into the future %s\n", mnb.vin.ToString().c_str());
             return;
         }
 
-        bool isLocal = addr.IsRFC1918() || addr.IsLocal();
-        //if(Params().MineBlocksOnDemand()) isLocal = false;
-
-        std::string vchPubKey(pubkey.begin(), pubkey.end());
-        std::string vchPubKey2(pubkey2.begin(), pubkey2.end());
-
-        strMessage = addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
-
-        if (protocolVersion < MIN_PROTO_VERSION) {
-            LogPrintf("dsee - ignoring outdated masternode %s protocol version %d\n", vin.ToString().c_str(), protocolVersion);
+        if (mnb.protocolVersion < MIN_PROTO_VERSION) {
+            LogPrintf("dsee - ignoring outdated masternode %s protocol version %d\n", mnb.vin.ToString().c_str(), mnb.protocolVersion);
             return;
         }
 
         CScript pubkeyScript;
-        pubkeyScript = GetScriptForDestination(pubkey.GetID());
+        pubkeyScript = GetScriptForDestination(mnb.pubkey.GetID());
 
         if (pubkeyScript.size() != 25) {
             LogPrintf("dsee - pubkey the wrong size\n");
@@ -119,7 +310,7 @@ void ProcessMasternode(CNode* pfrom, const std::string& strCommand, CDataStream&
         }
 
         CScript pubkeyScript2;
-        pubkeyScript2 = GetScriptForDestination(pubkey2.GetID());
+        pubkeyScript2 = GetScriptForDestination(mnb.pubkey2.GetID());
 
         if (pubkeyScript2.size() != 25) {
             LogPrintf("dsee - pubkey2 the wrong size\n");
@@ -127,104 +318,19 @@ void ProcessMasternode(CNode* pfrom, const std::string& strCommand, CDataStream&
             return;
         }
 
-        std::string errorMessage = "";
-        if (!darkSendSigner.VerifyMessage(pubkey, vchSig, strMessage, errorMessage)) {
-            LogPrintf("dsee - Got bad masternode address signature\n");
-            Misbehaving(pfrom->GetId(), 100);
+        // an announce for a known masternode that would not update it is dropped
+        // before paying for the signature check
+        if (!IsMasternodeAnnounceUseful(mnb))
             return;
-        }
 
-
-        //search existing masternode list, this is where we update existing masternodes with new dsee broadcasts
-        //LOCK(cs_masternodes);
-        for (CMasterNode& mn : vecMasternodes) {
-            if (mn.vin.prevout == vin.prevout) {
-                // count == -1 when it's a new entry
-                //   e.g. We don't want the entry relayed/time updated when we're syncing the list
-                // mn.pubkey = pubkey, IsVinAssociatedWithPubkey is validated once below,
-                //   after that they just need to match
-                if (count == -1 && mn.pubkey == pubkey && !mn.UpdatedWithin(MASTERNODE_MIN_DSEE_SECONDS)) {
-                    mn.UpdateLastSeen();
-
-                    if (mn.now < sigTime) { //take the newest entry
-                        LogPrintf("dsee - Got updated entry for %s\n", addr.ToString().c_str());
-                        mn.pubkey2 = pubkey2;
-                        mn.now = sigTime;
-                        mn.sig = vchSig;
-                        mn.protocolVersion = protocolVersion;
-                        mn.addr = addr;
-
-                        RelayDarkSendElectionEntry(vin, addr, vchSig, sigTime, pubkey, pubkey2, count, current, lastUpdated, protocolVersion);
-                    }
-                }
-
-                return;
-            }
-        }
-
-        // make sure the vout that was signed is related to the transaction that spawned the masternode
-        //  - this is expensive, so it's only done once per masternode
-        if (!darkSendSigner.IsVinAssociatedWithPubkey(vin, pubkey) && !IsInitialBlockDownload()) {
-            LogPrintf("dsee - Got mismatched pubkey and vin\n");
-            if (!IsTestNet()) {
-                Misbehaving(pfrom->GetId(), 10);
-                return;
-            }
-        }
-
-        if (fDebug) LogPrintf("dsee - Got NEW masternode entry %s\n", addr.ToString().c_str());
-
-        // make sure it's still unspent
-        //  - this is checked later by .check() in many places and by ThreadCheckDarkSendPool()
-
-        CValidationState state;
-        CMutableTransaction tx = CMutableTransaction();
-        CTxOut vout = CTxOut((GetMNCollateral(chainActive.Height()) - 1) * COIN, darkSendPool.collateralPubKey);
-        tx.vin.push_back(vin);
-        tx.vout.push_back(vout);
-        //if(AcceptableInputs(mempool, state, tx)){
-        bool inputsAcceptable;
-        {
-            LOCK(cs_main);
-            bool pfMissingInputs;
-            inputsAcceptable = AcceptableInputs(mempool, state, CTransaction(tx), false, &pfMissingInputs);
+        if (IsMasternodeAnnounceVerified(mnb.GetHash())) {
+            ProcessMasternodeAnnounce(mnb);
+            return;
         }
-        if (inputsAcceptable) {
-            if (fDebug) LogPrintf("dsee - Accepted masternode entry %i %i\n", count, current);
-
-            if (GetInputAge(vin) < MASTERNODE_MIN_CONFIRMATIONS) {
-                LogPrintf("dsee - Input must have least %d confirmations\n", MASTERNODE_MIN_CONFIRMATIONS);
-                Misbehaving(pfrom->GetId(), 20);
-                return;
-            }
-
-            // use this as a peer
-            addrman.Add(CAddress(addr, NODE_NETWORK), pfrom->addr, 2 * 60 * 60);
 
-            // add our masternode
-            CMasterNode mn(addr, vin, pubkey, vchSig, sigTime, pubkey2, protocolVersion);
-            mn.UpdateLastSeen(lastUpdated);
-            vecMasternodes.push_back(mn);
-
-            // if it matches our masternodeprivkey, then we've been remotely activated
-            if (pubkey2 == activeMasternode.pubKeyMasternode && protocolVersion == PROTOCOL_VERSION) {
-                activeMasternode.EnableHotColdMasterNode(vin, addr);
-            }
-
-            if (count == -1 && !isLocal)
-                RelayDarkSendElectionEntry(vin, addr, vchSig, sigTime, pubkey, pubkey2, count, current, lastUpdated, protocolVersion);
-
-        } else {
-            LogPrintf("dsee - Rejected masternode entry %s\n", addr.ToString().c_str());
-
-            int nDoS = 0;
-            if (state.IsInvalid(nDoS)) {
-                LogPrintf("dsee - %s from %s %s was not accepted into the memory pool\n", tx.GetHash().ToString().c_str(),
-                          pfrom->addr.ToString().c_str(), pfrom->cleanSubVer.c_str());
-                if (nDoS > 0)
-                    Misbehaving(pfrom->GetId(), nDoS);
-            }
-        }
+        // the signature is checked by ThreadMasternodeAnnounceVerify
+        if (!QueueMasternodeAnnounce(mnb))
+            LogPrint("masternode", "dsee - verification queue full, dropping entry %s\n", mnb.addr.ToString().c_str());
     }
 
     else if (strCommand == "dseep") { //DarkSend Election Entry Ping
@@ -39,6 +39,8 @@ class uint256;
 #define MASTERNODE_EXPIRATION_SECONDS          (65*60) //Old 65*60
 #define MASTERNODE_REMOVAL_SECONDS             (70*60) //Old 70*60
 #define MASTERNODE_CHECK_SECONDS               60
+#define MASTERNODE_ANNOUNCE_CACHE_SIZE         10000 // verified dsee signatures remembered
+#define MASTERNODE_ANNOUNCE_QUEUE_SIZE         2000  // dsee waiting for signature verification
 
 using namespace std;
 
@@ -159,6 +161,35 @@ public:
 };
 
 
+/** A dsee announce as received from a peer */
+struct CMasternodeAnnounce
+{
+    NodeId nodeId;
+    CAddress addrFrom;
+    CTxIn vin;
+    CService addr;
+    std::vector<unsigned char> vchSig;
+    int64_t sigTime;
+    CPubKey pubkey;
+    CPubKey pubkey2;
+    int count;
+    int current;
+    int64_t lastUpdated;
+    int protocolVersion;
+
+    std::string GetSignatureMessage() const;
+    /** Hash of the signed part of the announce, count/current/lastUpdated are not covered */
+    uint256 GetHash() const;
+};
+
+bool IsMasternodeAnnounceUseful(const CMasternodeAnnounce& mnb);
+bool IsMasternodeAnnounceVerified(const uint256& hash);
+bool QueueMasternodeAnnounce(const CMasternodeAnnounce& mnb);
+void ProcessMasternodeAnnounce(const CMasternodeAnnounce& mnb);
+void ProcessVerifiedMasternodeAnnounces();
+/** Check dsee signatures off the message handler thread */
+void ThreadMasternodeAnnounceVerify();
+
 // Get the current winner for this block
 int GetCurrentMasterNode(int mod=1, int64_t nBlockHeight=0, int minProtocol=CMasterNode::minProtoVersion);
 
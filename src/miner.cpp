@@ -403,17 +403,17 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
         originalRewardTx = CMutableTransaction(pblock->vtx[1]);
 
     //////////////////////////////////////////////////////// lux
-    LuxDGP luxDGP(globalState.get(), fGettingValuesDGP);
-    globalSealEngine->setLuxSchedule(luxDGP.getGasSchedule(nHeight));
-    uint32_t blockSizeDGP = luxDGP.getBlockSize(nHeight);
-    minGasPrice = luxDGP.getMinGasPrice(nHeight);
+    const LuxDGPParams& dgpParams = GetTipDGPParams(nHeight);
+    globalSealEngine->setLuxSchedule(dgpParams.schedule);
+    uint32_t blockSizeDGP = dgpParams.blockSize;
+    minGasPrice = dgpParams.minGasPrice;
     if(IsArgSet("-staker-min-tx-gas-price")) {
         CAmount stakerMinGasPrice;
         if(ParseMoney(GetArg("-staker-min-tx-gas-price", ""), stakerMinGasPrice)) {
             minGasPrice = std::max(minGasPrice, (uint64_t)stakerMinGasPrice);
         }
     }
-    hardBlockGasLimit = luxDGP.getBlockGasLimit(nHeight);
+    hardBlockGasLimit = dgpParams.blockGasLimit;
     softBlockGasLimit = GetArg("-staker-soft-block-gas-limit", hardBlockGasLimit);
     softBlockGasLimit = std::min(softBlockGasLimit, hardBlockGasLimit);
     txGasLimit = GetArg("-staker-max-tx-gas-limit", softBlockGasLimit);
@@ -593,6 +593,37 @@ bool BlockAssembler::CheckBlockBeyondFull()
     return true;
 }
 
+bool BlockAssembler::TestContractGas(CTxMemPool::txiter iter, uint64_t minGasPrice)
+{
+    if (iter->GetGasLimit() == 0) {
+        // nothing was cached when the tx was accepted, AttemptToAddContractToBlock does the checks
+        return true;
+    }
+    if (iter->GetGasLimit() > txGasLimit) {
+        return false;
+    }
+    if (bceResult.usedGas + iter->GetMaxGasLimit() > softBlockGasLimit) {
+        return false;
+    }
+    if (iter->GetMinGasPrice() < (CAmount)minGasPrice) {
+        return false;
+    }
+    return true;
+}
+
+uint64_t BlockAssembler::MinContractGasLimit(uint64_t minGasPrice)
+{
+    uint64_t nMinGas = std::numeric_limits<uint64_t>::max();
+    // contract txs come first, highest gas price first
+    for (const CTxMemPoolEntry& entry : mempool.mapTx.get<gas_price>()) {
+        if (entry.GetGasLimit() == 0 || entry.GetMinGasPrice() < (CAmount)minGasPrice) {
+            break;
+        }
+        nMinGas = std::min(nMinGas, entry.GetMaxGasLimit());
+    }
+    return nMinGas;
+}
+
 bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64_t minGasPrice) {
     if (nTimeLimit != 0 && GetAdjustedTime() >= nTimeLimit - BYTECODE_TIME_BUFFER) {
         return false;
@@ -601,6 +632,9 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
     {
         return false;
     }
+    if (!TestContractGas(iter, minGasPrice)) {
+        return false;
+    }
 
     CBlockIndex* pindexState = chainActive.Tip();
     dev::h256 oldHashStateRoot = getGlobalStateRoot(pindexState);
@@ -852,6 +886,10 @@ void BlockAssembler::addPackageTxs(uint64_t minGasPrice, const bool fProofOfStak
     const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
     int64_t nConsecutiveFailed = 0;
 
+    // Once the gas left in the block is below the smallest gas limit of the
+    // contracts paying enough, only the size and sigop budgets remain to fill.
+    const uint64_t nMinContractGas = MinContractGasLimit(minGasPrice);
+
     while (mi != mempool.mapTx.get<ancestor_score_or_gas_price>().end() || !mapModifiedTx.empty())
     {
         if(nTimeLimit != 0 && GetAdjustedTime() >= nTimeLimit){
@@ -920,6 +958,17 @@ void BlockAssembler::addPackageTxs(uint64_t minGasPrice, const bool fProofOfStak
             continue;
         }
 
+        // Skip contracts that cannot fit the remaining gas or pay too little for it
+        // before computing their package; neither changes for the rest of this block.
+        if (iter->GetGasLimit() != 0 &&
+                (nMinContractGas > softBlockGasLimit - bceResult.usedGas || !TestContractGas(iter, minGasPrice))) {
+            if (fUsingModified) {
+                mapModifiedTx.get<ancestor_score_or_gas_price>().erase(modit);
+            }
+            failedTx.insert(iter);
+            continue;
+        }
+
         CTxMemPool::setEntries ancestors;
         uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
         std::string dummy;
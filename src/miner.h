@@ -265,6 +265,10 @@ private:
     void AddToBlock(CTxMemPool::txiter iter);
 
     bool AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64_t minGasPrice);
+    /** Test the gas values cached in a contract tx's mempool entry against the block's gas budget */
+    bool TestContractGas(CTxMemPool::txiter iter, uint64_t minGasPrice);
+    /** Smallest gas limit among the mempool contract txs paying at least minGasPrice */
+    uint64_t MinContractGasLimit(uint64_t minGasPrice);
 
     // Methods for how to add transactions to a block.
     /** Add transactions based on tx "priority" */
@@ -0,0 +1,104 @@
+// Copyright (c) 2015-2018 The Luxcore developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_MPMCQUEUE_H
+#define BITCOIN_MPMCQUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Bounded multi-producer multi-consumer queue on a ring of sequenced cells,
+ * after Dmitry Vyukov's design. Pushing and popping never take a lock; a cell
+ * is claimed by advancing a position counter, and its sequence number tells
+ * whether it is free, filled or still being written. The capacity is rounded
+ * up to a power of two.
+ */
+template <typename T>
+class BoundedMPMCQueue
+{
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    std::atomic<size_t> enqueuePos;
+    std::atomic<size_t> dequeuePos;
+
+public:
+    explicit BoundedMPMCQueue(size_t nMinCapacity) : enqueuePos(0), dequeuePos(0)
+    {
+        size_t nCapacity = 2;
+        while (nCapacity < nMinCapacity)
+            nCapacity <<= 1;
+        cells.reset(new Cell[nCapacity]);
+        mask = nCapacity - 1;
+        for (size_t i = 0; i < nCapacity; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    size_t Capacity() const { return mask + 1; }
+
+    /** Number of queued items; only approximate while other threads push or pop */
+    size_t Size() const
+    {
+        size_t nDequeue = dequeuePos.load(std::memory_order_relaxed);
+        size_t nEnqueue = enqueuePos.load(std::memory_order_relaxed);
+        return nEnqueue > nDequeue ? std::min(nEnqueue - nDequeue, Capacity()) : 0;
+    }
+
+    /** Append value, or return false if the queue is full */
+    bool TryPush(const T& value)
+    {
+        Cell* cell;
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Remove the oldest item into value, or return false if the queue is empty */
+    bool TryPop(T& value)
+    {
+        Cell* cell;
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        value = cell->data;
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif // BITCOIN_MPMCQUEUE_H
@@ -36,6 +36,10 @@
 #include <miniupnpc/upnperrors.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 #include <math.h>
@@ -92,7 +96,11 @@ uint64_t nLocalHostNonce = 0;
 static std::vector<ListenSocket> vhListenSocket;
 CAddrMan addrman;
 int nMaxConnections = 125;
+SocketEventsMode nSocketEventsMode = SOCKETEVENTS_SELECT;
 bool fAddressesInitialized = false;
+#ifdef USE_EPOLL
+static int hEpoll = -1;
+#endif
 
 vector<CNode*> vNodes;
 CCriticalSection cs_vNodes;
@@ -114,7 +122,9 @@ NodeId nLastNodeId = 0;
 CCriticalSection cs_nLastNodeId;
 
 static CSemaphore* semOutbound = NULL;
-boost::condition_variable messageHandlerCondition;
+static boost::mutex mutexMsgProc;
+static boost::condition_variable messageHandlerCondition;
+static bool fMsgProcWake = false;
 
 // Signals for message handling
 static CNodeSignals g_signals;
@@ -441,6 +451,28 @@ CNode* FindNode(const CService& addr)
     return NULL;
 }
 
+/** Whether the socket handler can wait on hSocket; select() only takes descriptors below FD_SETSIZE */
+static bool IsUsableSocket(SOCKET hSocket)
+{
+    return nSocketEventsMode != SOCKETEVENTS_SELECT || IsSelectableSocket(hSocket);
+}
+
+/** Start watching the socket of a node that was just added to vNodes */
+static void SocketEventsAdd(CNode* pnode)
+{
+#ifdef USE_EPOLL
+    if (hEpoll == -1)
+        return;
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0) {
+        LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+        pnode->CloseSocketDisconnect();
+    }
+#endif
+}
+
 CNode* ConnectNode(CAddress addrConnect, const char* pszDest, bool darkSendMaster)
 {
     if (pszDest == NULL) {
@@ -469,7 +501,7 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest, bool darkSendMaste
     bool proxyConnectionFailed = false;
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed)) {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!IsUsableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -487,6 +519,7 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest, bool darkSendMaste
             LOCK(cs_vNodes);
             vNodes.push_back(pnode);
         }
+        SocketEventsAdd(pnode);
 
         pnode->nServicesExpected = ServiceFlags(addrConnect.nServices & nRelevantServices);
         pnode->nTimeConnected = GetTime();
@@ -507,6 +540,10 @@ void CNode::CloseSocketDisconnect()
     fDisconnect = true;
     if (hSocket != INVALID_SOCKET) {
         LogPrint("net", "disconnecting peer=%d\n", id);
+#ifdef USE_EPOLL
+        if (hEpoll != -1)
+            epoll_ctl(hEpoll, EPOLL_CTL_DEL, hSocket, NULL);
+#endif
         CloseSocket(hSocket);
     }
 
@@ -700,11 +737,16 @@ void CNode::copyStats(CNodeStats& stats)
     {
         LOCK(cs_vSend);
         X(nSendBytes);
+        X(nSendSize);
     }
     {
         LOCK(cs_vRecv);
         X(nRecvBytes);
     }
+    {
+        TRY_LOCK(cs_vRecvMsg, lockRecv);
+        stats.nRecvSize = lockRecv ? GetTotalRecvSize() : 0;
+    }
     X(fWhitelisted);
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -758,7 +800,7 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes)
 
         if (msg.complete()) {
             msg.nTime = GetTimeMicros();
-            messageHandlerCondition.notify_one();
+            WakeMessageHandler();
         }
     }
 
@@ -792,9 +834,21 @@ int CNetMessage::readHeader(const char* pch, unsigned int nBytes)
     // switch state to reading message data
     in_data = true;
 
+    // read the payload into a buffer left over from an earlier message
+    CSerializeData data;
+    TakeNetBuffer(data);
+    vRecv.Swap(data);
+
     return nCopy;
 }
 
+CNetMessage::~CNetMessage()
+{
+    CSerializeData data;
+    vRecv.Swap(data);
+    ReleaseNetBuffer(data);
+}
+
 int CNetMessage::readData(const char* pch, unsigned int nBytes)
 {
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
@@ -812,13 +866,71 @@ int CNetMessage::readData(const char* pch, unsigned int nBytes)
 }
 
 
+struct CNetBufferPool {
+    CCriticalSection cs;
+    std::vector<CSerializeData> vBuffers;
+};
+// Never freed: buffers held by other modules may be released during static destruction
+static CNetBufferPool* pNetBufferPool = new CNetBufferPool();
+
+void TakeNetBuffer(CSerializeData& data)
+{
+    data.clear();
+    LOCK(pNetBufferPool->cs);
+    std::vector<CSerializeData>& vBuffers = pNetBufferPool->vBuffers;
+    if (!vBuffers.empty()) {
+        data.swap(vBuffers.back());
+        vBuffers.pop_back();
+    }
+}
+
+void ReleaseNetBuffer(CSerializeData& data)
+{
+    if (data.capacity() == 0 || data.capacity() > MAX_NET_BUFFER_POOL_CAPACITY)
+        return;
+    data.clear();
+    LOCK(pNetBufferPool->cs);
+    std::vector<CSerializeData>& vBuffers = pNetBufferPool->vBuffers;
+    if (vBuffers.size() < MAX_NET_BUFFER_POOL) {
+        vBuffers.push_back(CSerializeData());
+        vBuffers.back().swap(data);
+    }
+}
+
+CNetBufferRef MakeNetBuffer(CSerializeData& data)
+{
+    CSerializeData* pdata = new CSerializeData();
+    pdata->swap(data);
+    return CNetBufferRef(pdata, [](const CSerializeData* p) {
+        ReleaseNetBuffer(*const_cast<CSerializeData*>(p));
+        delete p;
+    });
+}
+
+CSerializedNetMsg MakeSerializedNetMsg(const char* pszCommand, CSerializeData& payload)
+{
+    CMessageHeader hdr(pszCommand, payload.size());
+    uint256 hash = Hash(payload.begin(), payload.end());
+    memcpy(&hdr.nChecksum, &hash, sizeof(hdr.nChecksum));
+
+    CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+    ssHeader << hdr;
+    CSerializeData data;
+    ssHeader.Swap(data);
+
+    CSerializedNetMsg msg;
+    msg.header = MakeNetBuffer(data);
+    msg.payload = MakeNetBuffer(payload);
+    return msg;
+}
+
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode* pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    std::deque<CNetBufferRef>::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end()) {
-        const CSerializeData& data = *it;
+        const CSerializeData& data = **it;
         assert(data.size() > pnode->nSendOffset);
         int nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
         if (nBytes > 0) {
@@ -855,6 +967,25 @@ void SocketSendData(CNode* pnode)
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
 }
 
+// requires LOCK(pnode->cs_vSend)
+static void SocketSendQueued(CNode* pnode)
+{
+    bool fWasFull = pnode->nSendSize >= SendBufferSize();
+    SocketSendData(pnode);
+    // the message handler leaves peers with a full send buffer alone until it drains
+    if (fWasFull && pnode->nSendSize < SendBufferSize())
+        WakeMessageHandler();
+}
+
+void WakeMessageHandler()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mutexMsgProc);
+        fMsgProcWake = true;
+    }
+    messageHandlerCondition.notify_one();
+}
+
 static list<CNode*> vNodesDisconnected;
 
 static void AcceptConnection(const ListenSocket& hListenSocket) {
@@ -890,7 +1021,7 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket)) {
+    if (!IsUsableSocket(hSocket)) {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
         return;
@@ -929,11 +1060,163 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
             LOCK(cs_vNodes);
             vNodes.push_back(pnode);
         }
+        SocketEventsAdd(pnode);
+    }
+
+// requires LOCK(pnode->cs_vRecvMsg)
+/** Read from the socket of pnode once; returns whether the socket may have more to read */
+static bool SocketRecvData(CNode* pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    if (nBytes > 0) {
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
+            pnode->CloseSocketDisconnect();
+        pnode->nLastRecv = GetTime();
+        pnode->nRecvBytes += nBytes;
+        pnode->RecordBytesRecv(nBytes);
+        // a stream socket fills the buffer unless it ran out of data
+        return nBytes == sizeof(pchBuf);
+    } else if (nBytes == 0) {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LogPrint("net", "socket closed\n");
+        pnode->CloseSocketDisconnect();
+    } else if (nBytes < 0) {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
+            //if (!pnode->fDisconnect)
+              //  LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return false;
+}
+
+static void InactivityCheck(CNode* pnode)
+{
+    int64_t nTime = GetTime();
+    if (nTime - pnode->nTimeConnected > 60) {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0) {
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
+        } else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL) {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        } else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90 * 60)) {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        } else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros()) {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
+    }
+}
+
+#ifdef USE_EPOLL
+/** Nodes with socket readiness left to use (only accessed by the socket handler thread) */
+static std::set<CNode*> setNodesReady;
+
+/**
+ * Serve the sockets that epoll reports ready for about nMilliseconds. Sockets
+ * are edge-triggered, so a node stays in setNodesReady until its socket ran out
+ * of data to read and its queued messages are sent or no longer fit. Only the
+ * nodes with events are visited; the inactivity checks run once a second.
+ */
+static void SocketHandlerEpoll(int64_t nMilliseconds, int64_t& nLastInactivityCheck)
+{
+    struct epoll_event events[256];
+    int64_t nEnd = GetTimeMillis() + nMilliseconds;
+    bool fMoreWork = false;
+    for (int64_t nNow = GetTimeMillis(); nNow < nEnd; nNow = GetTimeMillis()) {
+        int nEvents = epoll_wait(hEpoll, events, ARRAYLEN(events), fMoreWork ? 0 : nEnd - nNow);
+        boost::this_thread::interruption_point();
+        if (nEvents < 0) {
+            int nErr = WSAGetLastError();
+            if (nErr != EINTR) {
+                LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+                MilliSleep(nEnd - nNow);
+            }
+            continue;
+        }
+
+        for (int i = 0; i < nEvents; i++) {
+            CNode* pnode = (CNode*)events[i].data.ptr;
+            if (!pnode) {
+                // listen sockets are level-triggered, anything not accepted now comes back
+                for (const ListenSocket& hListenSocket : vhListenSocket) {
+                    if (hListenSocket.socket != INVALID_SOCKET)
+                        AcceptConnection(hListenSocket);
+                }
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                pnode->fSocketRecvReady = true;
+            if (events[i].events & EPOLLOUT)
+                pnode->fSocketSendReady = true;
+            setNodesReady.insert(pnode);
+        }
+
+        fMoreWork = false;
+        std::vector<CNode*> vNodesReady(setNodesReady.begin(), setNodesReady.end());
+        for (CNode* pnode : vNodesReady) {
+            boost::this_thread::interruption_point();
+            if (pnode->hSocket == INVALID_SOCKET) {
+                setNodesReady.erase(pnode);
+                continue;
+            }
+
+            // Drain the send queue first, as the select() loop does
+            if (pnode->fSocketSendReady && pnode->nSendSize > 0) {
+                TRY_LOCK(pnode->cs_vSend, lockSend);
+                if (lockSend) {
+                    SocketSendQueued(pnode);
+                    // what is left did not fit into the socket buffer: wait for EPOLLOUT
+                    if (!pnode->vSendMsg.empty())
+                        pnode->fSocketSendReady = false;
+                }
+            }
+
+            if (pnode->fSocketRecvReady && pnode->nSendSize == 0 && pnode->hSocket != INVALID_SOCKET) {
+                TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+                if (lockRecv && pnode->GetTotalRecvSize() <= ReceiveFloodSize()) {
+                    if (SocketRecvData(pnode))
+                        fMoreWork = true;
+                    else
+                        pnode->fSocketRecvReady = false;
+                }
+            }
+
+            // Keep the node while it has data to read or to send once the socket
+            // allows; fSocketSendReady stays set for the next message queued.
+            if (pnode->hSocket == INVALID_SOCKET || (!pnode->fSocketRecvReady && !(pnode->fSocketSendReady && pnode->nSendSize > 0)))
+                setNodesReady.erase(pnode);
+        }
+
+        if (GetTime() != nLastInactivityCheck) {
+            nLastInactivityCheck = GetTime();
+            vector<CNode*> vNodesCopy;
+            {
+                LOCK(cs_vNodes);
+                vNodesCopy = vNodes;
+            }
+            for (CNode* pnode : vNodesCopy) {
+                if (pnode && pnode->hSocket != INVALID_SOCKET)
+                    InactivityCheck(pnode);
+            }
+        }
     }
+}
+#endif
 
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+#ifdef USE_EPOLL
+    int64_t nLastInactivityCheck = 0;
+#endif
     while (true) {
         //
         // Disconnect nodes
@@ -955,6 +1238,9 @@ void ThreadSocketHandler()
 
                     // remove from vNodes
                     vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+#ifdef USE_EPOLL
+                    setNodesReady.erase(pnode);
+#endif
 
                     // release outbound grant (if any)
                     pnode->grantOutbound.Release();
@@ -1004,6 +1290,13 @@ void ThreadSocketHandler()
             uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
+#ifdef USE_EPOLL
+        if (nSocketEventsMode == SOCKETEVENTS_EPOLL) {
+            SocketHandlerEpoll(50, nLastInactivityCheck);
+            continue;
+        }
+#endif
+
         //
         // Find which sockets have data to receive
         //
@@ -1121,33 +1414,8 @@ void ThreadSocketHandler()
                 continue;
             if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError)) {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                if (lockRecv) {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0) {
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
-                                pnode->CloseSocketDisconnect();
-                            pnode->nLastRecv = GetTime();
-                            pnode->nRecvBytes += nBytes;
-                            pnode->RecordBytesRecv(nBytes);
-                        } else if (nBytes == 0) {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
-                            pnode->CloseSocketDisconnect();
-                        } else if (nBytes < 0) {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
-                                //if (!pnode->fDisconnect)
-                                  //  LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
+                if (lockRecv)
+                    SocketRecvData(pnode);
             }
 
             //
@@ -1158,28 +1426,13 @@ void ThreadSocketHandler()
             if (FD_ISSET(pnode->hSocket, &fdsetSend)) {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
                 if (lockSend)
-                    SocketSendData(pnode);
+                    SocketSendQueued(pnode);
             }
 
             //
             // Inactivity checking
             //
-            int64_t nTime = GetTime();
-            if (nTime - pnode->nTimeConnected > 60) {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0) {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                } else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL) {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                } else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90 * 60)) {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                } else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros()) {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-            }
+            InactivityCheck(pnode);
         }
         {
             //LOCK(cs_vNodes);
@@ -1454,11 +1707,10 @@ void ThreadOpenConnections() {
             }
         }
 
-        int64_t nANow = GetAdjustedTime();
-
         int nTries = 0;
         while (true) {
-            CAddress addr = addrman.Select();
+            // only consider terrible or very recently tried nodes after 30 failed attempts
+            CAddress addr = addrman.Select(nTries < 30);
 
             // if we selected an invalid address, restart
             if (!addr.IsValid() || setConnected.count(addr.GetGroup()) || IsLocal(addr))
@@ -1478,10 +1730,6 @@ void ThreadOpenConnections() {
             if ((addr.nServices & REQUIRED_SERVICES) != REQUIRED_SERVICES)
                 continue;
 
-            // only consider very recently tried nodes after 30 failed attempts
-            if (nANow - addr.nLastTry < 600 && nTries < 30)
-                continue;
-
             // only consider nodes missing relevant services after 40 failed attemps
             if ((addr.nServices & nRelevantServices) != nRelevantServices && (nTries < 40))
                 continue;
@@ -1613,9 +1861,6 @@ bool OpenNetworkConnection(const CAddress& addrConnect, bool fCountFailure, CSem
 
 
 void ThreadMessageHandler() {
-    boost::mutex condition_mutex;
-    boost::unique_lock<boost::mutex> lock(condition_mutex);
-
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true) {
         vector<CNode*> vNodesCopy;
@@ -1673,8 +1918,13 @@ void ThreadMessageHandler() {
                     pnode->Release();
         }
 
+        // Sleep until a message arrives or a full send buffer drains; wake up
+        // every 100ms regardless for the periodic work of SendMessages.
+        boost::unique_lock<boost::mutex> lock(mutexMsgProc);
         if (fSleep)
-            messageHandlerCondition.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100));
+            messageHandlerCondition.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100),
+                [] { return fMsgProcWake; });
+        fMsgProcWake = false;
     }
 }
 
@@ -1878,6 +2128,25 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler) {
     // Map ports with UPnP
     MapPort(GetBoolArg("-upnp", DEFAULT_UPNP));
 
+#ifdef USE_EPOLL
+    if (nSocketEventsMode == SOCKETEVENTS_EPOLL && hEpoll == -1) {
+        hEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (hEpoll == -1) {
+            LogPrintf("epoll_create1 failed: %s, using select() for sockets\n", NetworkErrorString(WSAGetLastError()));
+            nSocketEventsMode = SOCKETEVENTS_SELECT;
+        }
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            if (hEpoll == -1 || hListenSocket.socket == INVALID_SOCKET)
+                continue;
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = NULL;
+            if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0)
+                LogPrintf("epoll_ctl failed for a listening socket: %s\n", NetworkErrorString(WSAGetLastError()));
+        }
+    }
+#endif
+
     // Send and receive from sockets, accept connections
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "net", &ThreadSocketHandler));
 
@@ -1955,6 +2224,12 @@ public:
             if (hListenSocket.socket != INVALID_SOCKET)
                 if (!CloseSocket(hListenSocket.socket))
                     LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
+#ifdef USE_EPOLL
+        if (hEpoll != -1) {
+            close(hEpoll);
+            hEpoll = -1;
+        }
+#endif
 
         // clean up some globals (to help leak detection)
         for (CNode* pnode : vNodes)
@@ -2248,19 +2523,20 @@ bool CAddrDB::Write(const CAddrMan& addr)
     GetRandBytes((unsigned char*)&randv, sizeof(randv));
     std::string tmpfn = strprintf("peers.dat.%04x", randv);
 
-    // serialize addresses, checksum data up to that point, then append csum
+    // serialize addresses, checksum data up to that point, then append csum;
+    // addrman is only locked while it copies its tables
     CDataStream ssPeers(SER_DISK, CLIENT_VERSION);
     ssPeers << FLATDATA(Params().MessageStart());
     ssPeers << addr;
     uint256 hash = Hash(ssPeers.begin(), ssPeers.end());
     ssPeers << hash;
 
-    // open output file, and associate with CAutoFile
-    boost::filesystem::path pathAddr = GetDataDir() / "peers.dat";
-    FILE* file = fopen(pathAddr.string().c_str(), "wb");
+    // open temp output file, and associate with CAutoFile
+    boost::filesystem::path pathTmp = GetDataDir() / tmpfn;
+    FILE* file = fopen(pathTmp.string().c_str(), "wb");
     CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
     if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathAddr.string());
+        return error("%s : Failed to open file %s", __func__, pathTmp.string());
 
     // Write and commit header, data
     try {
@@ -2271,6 +2547,10 @@ bool CAddrDB::Write(const CAddrMan& addr)
     FileCommit(fileout.Get());
     fileout.fclose();
 
+    // replace existing peers.dat, if any, with new peers.dat.XXXX
+    if (!RenameOver(pathTmp, pathAddr))
+        return error("%s : Rename-into-place failed", __func__);
+
     return true;
 }
 
@@ -2335,6 +2615,8 @@ CNode::CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn, bool fIn
     nServicesExpected = NODE_NONE;
     hSocket = hSocketIn;
     nRecvVersion = INIT_PROTO_VERSION;
+    fSocketRecvReady = false;
+    fSocketSendReady = false;
     nLastSend = 0;
     nLastRecv = 0;
     nSendBytes = 0;
@@ -2472,9 +2754,12 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
 
     LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
 
-    std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-    ssSend.GetAndClear(*it);
-    nSendSize += (*it).size();
+    // hand the serialized message over and continue in a buffer from the pool
+    CSerializeData data;
+    TakeNetBuffer(data);
+    ssSend.Swap(data);
+    std::deque<CNetBufferRef>::iterator it = vSendMsg.insert(vSendMsg.end(), MakeNetBuffer(data));
+    nSendSize += (*it)->size();
 
     // If write queue empty, attempt "optimistic write"
     if (it == vSendMsg.begin())
@@ -2483,6 +2768,25 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     LEAVE_CRITICAL_SECTION(cs_vSend);
 }
 
+void CNode::PushSerializedMessage(const CSerializedNetMsg& msg)
+{
+    if (msg.IsNull())
+        return;
+
+    LOCK(cs_vSend);
+    LogPrint("net", "sending serialized message (%d bytes) peer=%d\n", msg.payload->size(), id);
+
+    bool fWasEmpty = vSendMsg.empty();
+    vSendMsg.push_back(msg.header);
+    if (!msg.payload->empty())
+        vSendMsg.push_back(msg.payload);
+    nSendSize += msg.size();
+
+    // If write queue empty, attempt "optimistic write"
+    if (fWasEmpty)
+        SocketSendData(this);
+}
+
 //
 // CBanListDB
 //
@@ -2593,11 +2897,14 @@ void DumpBanlist()
 
     int64_t nStart = GetTimeMillis();
 
+    // Clear the flag before taking the copy, so that a ban set while the copy
+    // is written out gets flushed the next time
     CBanDB bandb;
     banmap_t banmap;
+    CNode::SetBannedSetDirty(false);
     CNode::GetBanned(banmap);
-    if (bandb.Write(banmap))
-        CNode::SetBannedSetDirty(false);
+    if (!bandb.Write(banmap))
+        CNode::SetBannedSetDirty(true);
 
     LogPrint("net", "Flushed %d banned node ips/subnets to banlist.dat  %dms\n",
              banmap.size(), GetTimeMillis() - nStart);
@@ -67,6 +67,22 @@ static const bool DEFAULT_UPNP = false;
 #endif
 /** The maximum number of entries in mapAskFor */
 static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
+/** The maximum number of idle message buffers kept for reuse */
+static const size_t MAX_NET_BUFFER_POOL = 64;
+/** Buffers that grew larger than this are freed rather than kept for reuse */
+static const size_t MAX_NET_BUFFER_POOL_CAPACITY = 256 * 1024;
+
+/** How the socket handler thread waits for its sockets to become readable or writable */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT, //!< select(), limited to FD_SETSIZE descriptors
+    SOCKETEVENTS_EPOLL,  //!< edge-triggered epoll (Linux)
+};
+/** -socketevents default */
+#ifdef USE_EPOLL
+static const char* const DEFAULT_SOCKETEVENTS = "epoll";
+#else
+static const char* const DEFAULT_SOCKETEVENTS = "select";
+#endif
 
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
@@ -89,6 +105,29 @@ bool BindListenPort(const CService& bindAddr, std::string& strError, bool fWhite
 void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler);
 bool StopNode();
 void SocketSendData(CNode* pnode);
+void WakeMessageHandler();
+
+/** Reference counted serialized message bytes, queued without a copy for every peer that sends them */
+typedef std::shared_ptr<const CSerializeData> CNetBufferRef;
+
+/** Take an empty buffer from the pool, its capacity left over from an earlier message */
+void TakeNetBuffer(CSerializeData& data);
+/** Give a buffer no longer needed back to the pool */
+void ReleaseNetBuffer(CSerializeData& data);
+/** Move the contents of data into a shared buffer that returns to the pool once the last reference is gone */
+CNetBufferRef MakeNetBuffer(CSerializeData& data);
+
+/** A complete message serialized once, to be sent to any number of peers */
+struct CSerializedNetMsg {
+    CNetBufferRef header;
+    CNetBufferRef payload;
+
+    bool IsNull() const { return !header; }
+    size_t size() const { return header ? header->size() + payload->size() : 0; }
+};
+
+/** Build the header of a message around payload, which is taken over without a copy */
+CSerializedNetMsg MakeSerializedNetMsg(const char* pszCommand, CSerializeData& payload);
 
 typedef int NodeId;
 
@@ -141,6 +180,7 @@ extern uint64_t nLocalHostNonce;
 extern CAddrMan addrman;
 extern int nMaxConnections;
 extern int nMaxOutbound;
+extern SocketEventsMode nSocketEventsMode;
 
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
@@ -178,6 +218,8 @@ public:
     int nStartingHeight;
     uint64_t nSendBytes;
     uint64_t nRecvBytes;
+    size_t nSendSize;
+    unsigned int nRecvSize;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
@@ -208,6 +250,8 @@ public:
         nTime = 0;
     }
 
+    ~CNetMessage();
+
     bool complete() const
     {
         if (!in_data)
@@ -300,7 +344,7 @@ public:
     size_t nSendSize;   // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<CSerializeData> vSendMsg;
+    std::deque<CNetBufferRef> vSendMsg; // may be shared with other peers sending the same message
     CCriticalSection cs_vSend;
     CCriticalSection cs_vRecv;
     std::deque<CInv> vRecvGetData;
@@ -308,6 +352,10 @@ public:
     CCriticalSection cs_vRecvMsg;
     uint64_t nRecvBytes;
     int nRecvVersion;
+    // readiness of hSocket reported by edge-triggered events and not used up yet
+    // (only accessed by the socket handler thread)
+    bool fSocketRecvReady;
+    bool fSocketSendReady;
 
     std::atomic<int64_t> nLastSend;
     std::atomic<int64_t> nLastRecv;
@@ -508,6 +556,9 @@ public:
 
     void PushVersion();
 
+    /** Queue a message serialized beforehand, sharing its buffers instead of copying them */
+    void PushSerializedMessage(const CSerializedNetMsg& msg);
+
 
     void PushMessage(const char* pszCommand)
     {
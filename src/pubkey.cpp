@@ -197,6 +197,34 @@ bool CPubKey::VerifySchnorr(const uint256 &hash,
                                     hash.begin(), &pubkey);
 }
 
+bool CPubKey::VerifySchnorrBatch(const std::vector<CPubKey>& vPubKeys,
+                                 const std::vector<uint256>& vHashes,
+                                 const std::vector<std::vector<uint8_t> >& vSigs)
+{
+    assert(vPubKeys.size() == vHashes.size() && vPubKeys.size() == vSigs.size());
+
+    std::vector<secp256k1_pubkey> vParsed(vPubKeys.size());
+    std::vector<const secp256k1_pubkey*> vpPubKeys(vPubKeys.size());
+    std::vector<const unsigned char*> vpHashes(vPubKeys.size());
+    std::vector<const unsigned char*> vpSigs(vPubKeys.size());
+    for (size_t i = 0; i < vPubKeys.size(); i++) {
+        const CPubKey& pubkey = vPubKeys[i];
+        if (!pubkey.IsValid() || vSigs[i].size() != 64) {
+            return false;
+        }
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &vParsed[i],
+                                       &pubkey[0], pubkey.size())) {
+            return false;
+        }
+        vpPubKeys[i] = &vParsed[i];
+        vpHashes[i] = vHashes[i].begin();
+        vpSigs[i] = vSigs[i].data();
+    }
+
+    return secp256k1_schnorr_verify_batch(secp256k1_context_verify, vpSigs.data(),
+                                          vpHashes.data(), vpPubKeys.data(), vpPubKeys.size());
+}
+
 bool CPubKey::RecoverCompact(const uint256& hash, const std::vector<unsigned char>& vchSig)
 {
     if (vchSig.size() != COMPACT_SIGNATURE_SIZE)
@@ -192,6 +192,15 @@ public:
     bool VerifySchnorr(const uint256 &hash,
                        const std::vector<uint8_t> &vchSig) const;
 
+    /**
+     * Verify a batch of Schnorr signatures at once. Returns true only if
+     * every (pubkey, hash, signature) triple is valid; a false result does
+     * not tell which entry failed.
+     */
+    static bool VerifySchnorrBatch(const std::vector<CPubKey>& vPubKeys,
+                                   const std::vector<uint256>& vHashes,
+                                   const std::vector<std::vector<uint8_t> >& vSigs);
+
     /**
      * Check whether a DER ECDSA signature is normalized (lower-S).
      */
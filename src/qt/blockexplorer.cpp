@@ -299,19 +299,19 @@ const CBlockIndex* getexplorerBlockIndex(int64_t height)
 {
     std::string hex = getexplorerBlockHash(height);
     uint256 hash = uint256S(hex);
-    return mapBlockIndex[hash];
+    return LookupBlockIndexConcurrent(hash);
 }
 
 std::string getexplorerBlockHash(int64_t Height)
 {
     std::string genesisblockhash = "0000037a438b746437529ddecad8f992b9e5536368686f6de24cfac13ff8acd2";
-    CBlockIndex* pindexBest = mapBlockIndex[chainActive.Tip()->GetBlockHash()];
+    CBlockIndex* pindexBest = chainActive.Tip();
     if ((Height < 0) || (Height > pindexBest->nHeight)) {
         return genesisblockhash;
     }
 
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[chainActive.Tip()->GetBlockHash()];
+    CBlockIndex* pblockindex = pindexBest;
     while (pblockindex->nHeight > Height)
         pblockindex = pblockindex->pprev;
     return pblockindex->GetBlockHash().GetHex();
@@ -676,7 +676,7 @@ void BlockExplorer::showEvent(QShowEvent* ev)
 
 void BlockExplorer::home()
 {
-    CBlockIndex* pindexBest = mapBlockIndex[chainActive.Tip()->GetBlockHash()];
+    CBlockIndex* pindexBest = chainActive.Tip();
 
     setBlock(pindexBest);
     QString text = QString("%1").arg(pindexBest->nHeight);
@@ -696,7 +696,7 @@ bool BlockExplorer::switchTo(const QString& query)
     if (IsOk && AsInt >= 0 && AsInt <= chainActive.Height()) {
         std::string hex = getexplorerBlockHash(AsInt);
         uint256 hash = uint256S(hex);
-        CBlockIndex* pIndex = mapBlockIndex[hash];
+        CBlockIndex* pIndex = LookupBlockIndexConcurrent(hash);
         if (pIndex) {
             setBlock(pIndex);
             return true;
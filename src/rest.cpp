@@ -8,6 +8,7 @@
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "httpserver.h"
+#include "rpccache.h"
 #include "rpcserver.h"
 #include "streams.h"
 #include "sync.h"
@@ -23,6 +24,7 @@
 using namespace std;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const size_t REST_STREAM_CHUNK_SIZE = 64 * 1024; //chunk size of streamed JSON replies
 
 enum RetFormat {
     RF_UNDEF,
@@ -58,7 +60,7 @@ struct CCoin {
 };
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
-extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, const CChainSnapshot& chain, bool txDetails = false);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message)
@@ -68,6 +70,54 @@ static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message
     return false;
 }
 
+/**
+ * Send the JSON of a block with its transactions in chunks. Unless pstrCopy is NULL, the text
+ * is also collected there as long as it stays within nMaxCopySize; beyond that it is cleared.
+ */
+static void StreamBlockJSON(HTTPRequest* req, const CBlock& block, const CBlockIndex* pblockindex, const CChainSnapshot& chain,
+                            std::string* pstrCopy = NULL, size_t nMaxCopySize = 0)
+{
+    UniValue objBlock = blockToJSON(block, pblockindex, chain, false);
+    const std::vector<std::string>& keys = objBlock.getKeys();
+    const std::vector<UniValue>& values = objBlock.getValues();
+
+    // the chunked transfer ends when the connection closes
+    req->WriteHeader("Content-Type", "application/json");
+    req->WriteHeader("Connection", "close");
+
+    bool fCopy = pstrCopy != NULL;
+    JSONStreamWriter writer([req, pstrCopy, nMaxCopySize, &fCopy](const std::string& strChunk) {
+        if (fCopy) {
+            if (pstrCopy->size() + strChunk.size() <= nMaxCopySize) {
+                pstrCopy->append(strChunk);
+            } else {
+                fCopy = false;
+                pstrCopy->clear();
+            }
+        }
+        req->Chunk(strChunk);
+    }, REST_STREAM_CHUNK_SIZE);
+    writer.BeginObject();
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] != "tx") {
+            writer.KeyValue(keys[i], values[i]);
+            continue;
+        }
+        writer.Key("tx");
+        writer.BeginArray();
+        for (const CTransaction& tx : block.vtx) {
+            UniValue objTx(UniValue::VOBJ);
+            TxToJSON(tx, uint256(), objTx);
+            writer.Value(objTx);
+        }
+        writer.End();
+    }
+    writer.End();
+    writer.WriteRaw("\n");
+    writer.Flush();
+    req->ChunkEnd();
+}
+
 static enum RetFormat ParseDataFormat(vector<string>& params, const string strReq)
 {
     boost::split(params, strReq, boost::is_any_of("."));
@@ -138,14 +188,13 @@ static bool rest_headers(HTTPRequest* req,
     std::vector<const CBlockIndex *> headers;
     headers.reserve(count);
     {
-        LOCK(cs_main);
-        BlockMap::const_iterator it = mapBlockIndex.find(hash);
-        const CBlockIndex *pindex = (it != mapBlockIndex.end()) ? it->second : NULL;
-        while (pindex != NULL && chainActive.Contains(pindex)) {
+        CChainSnapshotRef chain = GetChainSnapshot();
+        const CBlockIndex *pindex = LookupBlockIndexConcurrent(hash);
+        while (pindex != NULL && chain->Contains(pindex)) {
             headers.push_back(pindex);
             if (headers.size() == (unsigned long)count)
                 break;
-            pindex = chainActive.Next(pindex);
+            pindex = chain->Next(pindex);
         }
     }
 
@@ -198,18 +247,22 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
+    CChainSnapshotRef chain = GetChainSnapshot();
+    const std::string strCacheMethod = showTxDetails ? "rest/block" : "rest/block/notxdetails";
+    // With -spentindex the transaction details change as the outputs get spent
+    const bool fCache = !(showTxDetails && fSpentIndex);
+    std::string strJSON;
+    if (rf == RF_JSON && fCache && rpcResponseCache.Get(strCacheMethod, hash.GetHex(), *chain, strJSON)) {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
     CBlock block;
     const Consensus::Params consensusParams = Params().GetConsensus();
-    CBlockIndex* pblockindex = NULL;
-    {
-        LOCK(cs_main);
-        if (mapBlockIndex.count(hash) == 0)
-            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
-
-        pblockindex = mapBlockIndex[hash];
-        if (!ReadBlockFromDisk(block, pblockindex, consensusParams))
-            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
-    }
+    CBlockIndex* pblockindex = LookupBlockIndexConcurrent(hash);
+    if (!pblockindex || !ReadBlockFromDisk(block, pblockindex, consensusParams))
+        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
 
     CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
     ssBlock << block;
@@ -230,10 +283,20 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        if (showTxDetails) {
+            if (!fCache || !rpcResponseCache.IsCacheable(pblockindex, *chain)) {
+                StreamBlockJSON(req, block, pblockindex, *chain);
+                return true;
+            }
+            StreamBlockJSON(req, block, pblockindex, *chain, &strJSON, rpcResponseCache.GetMaxEntrySize());
+        } else {
+            UniValue objBlock = blockToJSON(block, pblockindex, *chain, showTxDetails);
+            strJSON = objBlock.write() + "\n";
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, strJSON);
+        }
+        if (!strJSON.empty())
+            rpcResponseCache.Put(strCacheMethod, hash.GetHex(), pblockindex, *chain, strJSON);
         return true;
     }
 
@@ -556,21 +619,29 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
+    HTTPWorkClass workClass;
 } uri_prefixes[] = {
-      {"/rest/tx/", rest_tx},
-      {"/rest/block/notxdetails/", rest_block_notxdetails},
-      {"/rest/block/", rest_block_extended},
-      {"/rest/chaininfo", rest_chaininfo},
+      {"/rest/tx/", rest_tx, HTTP_WORK_FAST},
+      {"/rest/block/notxdetails/", rest_block_notxdetails, HTTP_WORK_FAST},
+      {"/rest/block/", rest_block_extended, HTTP_WORK_SLOW},
+      {"/rest/chaininfo", rest_chaininfo, HTTP_WORK_FAST},
  //     {"/rest/mempool/info", rest_mempool_info},
  //     {"/rest/mempool/contents", rest_mempool_contents},
-      {"/rest/headers/", rest_headers},
-      {"/rest/getutxos", rest_getutxos},
+      {"/rest/headers/", rest_headers, HTTP_WORK_FAST},
+      {"/rest/getutxos", rest_getutxos, HTTP_WORK_SLOW},
 };
 
 bool StartREST()
 {
-    for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
-        RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler);
+    for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++) {
+        const std::string prefix = uri_prefixes[i].prefix;
+        const HTTPWorkClass workClass = uri_prefixes[i].workClass;
+        RegisterHTTPHandler(prefix, false, uri_prefixes[i].handler,
+                            [prefix, workClass](HTTPRequest*, const std::string&, std::string& label) {
+                                label = prefix;
+                                return workClass;
+                            });
+    }
     return true;
 }
 
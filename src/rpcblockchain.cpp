@@ -8,7 +8,9 @@
 #include "checkpoints.h"
 #include "consensus/validation.h"
 #include "main.h"
+#include "lux/luxtrace.h"
 #include "primitives/transaction.h"
+#include "rpccache.h"
 #include "rpcserver.h"
 #include "rpcwallet.cpp"
 #include "sync.h"
@@ -24,7 +26,6 @@ using namespace std;
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
 void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
-int getBlockTimeByHeight(int nHeight);
 
 double GetDifficulty(const CBlockIndex* blockindex)
 {
@@ -71,14 +72,14 @@ CBlockIndex* GetLastBlockOfType(const int nPoS) // 0: PoW; 1: PoS
     return NULL;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, const CChainSnapshot& chain, bool txDetails = false)
 {
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", block.GetHash(blockindex->nHeight >= Params().SwitchPhi2Block()).GetHex()));
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (chain.Contains(blockindex))
+        confirmations = chain.Height() - blockindex->nHeight + 1;
     result.push_back(Pair("confirmations", confirmations));
     result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
     result.push_back(Pair("height", blockindex->nHeight));
@@ -106,7 +107,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex* pnext = chainActive.Next(blockindex);
+    CBlockIndex* pnext = chain.Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
@@ -137,8 +138,7 @@ UniValue getblockcount(const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getblockcount", "") + HelpExampleRpc("getblockcount", ""));
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainSnapshot()->Height();
 }
 
 UniValue getbestblockhash(const UniValue& params, bool fHelp)
@@ -152,8 +152,10 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp)
             "\nExamples\n" +
             HelpExampleCli("getbestblockhash", "") + HelpExampleRpc("getbestblockhash", ""));
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    CChainSnapshotRef chain = GetChainSnapshot();
+    if (!chain->Tip())
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "No active chain");
+    return chain->Tip()->GetBlockHash().GetHex();
 }
 
 void RPCNotifyBlockChange(bool ibd, const CBlockIndex* pindex)
@@ -224,7 +226,7 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
 
     if (fVerbose) {
         LOCK(mempool.cs);
-        UniValue o(UniValue::VARR);
+        RPCResultArray o;
         for (const CTxMemPoolEntry& e : mempool.mapTx) {
             const uint256& txid = e.GetTx().GetHash();
             const uint256& hash = e.GetTx().GetWitnessHash();
@@ -252,7 +254,7 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
             info.push_back(Pair("depends", depends));
             o.push_back(info);
         }
-        return o;
+        return o.Finish();
     } else {
         vector<uint256> vtxid;
         mempool.queryHashes(vtxid);
@@ -295,32 +297,23 @@ UniValue getblockhashes(const UniValue& params, bool fHelp)
                 + HelpExampleCli("getblockhashes", "1522073246 1521473246 '{\"noOrphans\":false, \"logicalTimes\":true}'")
         );
 
-    LOCK(cs_main);
+    CChainSnapshotRef chain = GetChainSnapshot();
 
     unsigned int high = params[0].get_int();
     unsigned int low = params[1].get_int();
     UniValue a(UniValue::VARR);
-    int nHeight = chainActive.Height();
+    int nHeight = chain->Height();
 
     for (int i = 0; i <= nHeight; i++) {
-        unsigned int blockTime = getBlockTimeByHeight(i);
+        CBlockIndex* pblockindex = (*chain)[i];
+        unsigned int blockTime = pblockindex->GetBlockTime();
         if (blockTime > low && blockTime < high) {
-            CBlockIndex* pblockindex =chainActive[i];
             a.push_back(pblockindex->GetBlockHash().GetHex());
         }
     }
     return a;
 }
 
-int getBlockTimeByHeight(int nHeight){
-    CBlock block;
-    CBlockIndex* pblockindex =chainActive[nHeight];
-    std::string strHash = pblockindex->GetBlockHash().GetHex();
-    uint256 hash(strHash);
-    CBlockIndex* pblockindex2 = mapBlockIndex[hash];
-        return pblockindex2->GetBlockTime();
-    }
-
 UniValue getblockhash(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -334,13 +327,13 @@ UniValue getblockhash(const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getblockhash", "1000") + HelpExampleRpc("getblockhash", "1000"));
 
-    LOCK(cs_main);
+    CChainSnapshotRef chain = GetChainSnapshot();
 
     int nHeight = params[0].get_int();
-    if (nHeight < 0 || nHeight > chainActive.Height())
+    if (nHeight < 0 || nHeight > chain->Height())
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
 
-    CBlockIndex* pblockindex = chainActive[nHeight];
+    CBlockIndex* pblockindex = (*chain)[nHeight];
     return pblockindex->GetBlockHash().GetHex();
 }
 
@@ -378,7 +371,7 @@ UniValue getblock(const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getblock", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\"") + HelpExampleRpc("getblock", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\""));
 
-    LOCK(cs_main);
+    CChainSnapshotRef chain = GetChainSnapshot();
 
     std::string strHash = params[0].get_str();
     uint256 hash(strHash);
@@ -387,23 +380,30 @@ UniValue getblock(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
+    std::string strCacheParams = hash.GetHex() + (fVerbose ? "/1" : "/0");
+    UniValue cached;
+    if (RPCResultFromCache("getblock", strCacheParams, *chain, cached))
+        return cached;
+
+    CBlockIndex* pblockindex = LookupBlockIndexConcurrent(hash);
+    if (!pblockindex)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
     if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
+    UniValue result;
     if (!fVerbose) {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
         ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        result = HexStr(ssBlock.begin(), ssBlock.end());
+    } else {
+        result = blockToJSON(block, pblockindex, *chain);
     }
 
-    return blockToJSON(block, pblockindex);
+    RPCCacheResult("getblock", strCacheParams, pblockindex, *chain, result);
+    return result;
 }
 
 UniValue getstorage(const UniValue& params, bool fHelp)
@@ -651,7 +651,7 @@ UniValue searchlogs(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
     }
 
-    UniValue result(UniValue::VARR);
+    RPCResultArray result;
 
     auto topics = logsParams.topics;
 
@@ -700,7 +700,7 @@ UniValue searchlogs(const UniValue& params, bool fHelp)
         }
     }
 
-    return result;
+    return result.Finish();
 }
 
 class WaitForLogsParams {
@@ -898,8 +898,6 @@ UniValue gettransactionreceipt(const UniValue& params, bool fHelp)
     if(!fLogEvents)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Events indexing disabled");
 
-    LOCK(cs_main);
-
     std::string hashTemp = params[0].get_str();
     if(hashTemp.size() != 64){
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect hash");
@@ -907,6 +905,13 @@ UniValue gettransactionreceipt(const UniValue& params, bool fHelp)
 
     uint256 hash(uint256S(hashTemp));
 
+    CChainSnapshotRef chain = GetChainSnapshot();
+    UniValue cached;
+    if (RPCResultFromCache("gettransactionreceipt", hash.GetHex(), *chain, cached))
+        return cached;
+
+    LOCK(cs_main);
+
     if (pstorageresult == nullptr) {
         return NullUniValue;
     }
@@ -919,6 +924,260 @@ UniValue gettransactionreceipt(const UniValue& params, bool fHelp)
         transactionReceiptInfoToJSON(t, tri);
         result.push_back(tri);
     }
+
+    if (!transactionReceiptInfo.empty())
+        RPCCacheResult("gettransactionreceipt", hash.GetHex(), LookupBlockIndexConcurrent(transactionReceiptInfo[0].blockHash), *chain, result);
+    return result;
+}
+
+static uint160 ParseTokenAddress(const UniValue& param, const std::string& strName)
+{
+    std::string strAddr = param.get_str();
+    if(strAddr.size() != 40 || !IsHex(strAddr))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect " + strName + " address");
+    return uint160(ParseHex(strAddr));
+}
+
+static std::string TokenAmountToString(const uint256& amount)
+{
+    return uintTou256(amount).str();
+}
+
+UniValue gettokenbalance(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 2)
+        throw std::runtime_error(
+            "gettokenbalance \"token\" \"address\"\n"
+            "\nNOTE: This function requires -tokenindex enabled.\n"
+
+            "\nReturns the balance of an address in a token, summed from the Transfer events of the token contract.\n"
+
+            "\nArguments:\n"
+            "1. \"token\"      (string, required) The hexadecimal token contract address\n"
+            "2. \"address\"    (string, required) The hexadecimal holder address\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\": \"n\",   (string)  Received minus sent, in the token's base unit; negative if the token\n"
+            "                       did not emit a Transfer for every change (e.g. when minting)\n"
+            "  \"received\": \"n\",  (string)  Total amount received\n"
+            "  \"sent\": \"n\",      (string)  Total amount sent\n"
+            "  \"transfers\": n    (numeric) Number of transfers from or to the address\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("gettokenbalance", "\"eb6a149ec16aaa7fc1e4d2f5f6d6e0e3e4aafbc7\" \"2d8ba8d0ca8f9a9a1f4f7f2a1fb2c1a2d8f6d3c1\"")
+            + HelpExampleRpc("gettokenbalance", "\"eb6a149ec16aaa7fc1e4d2f5f6d6e0e3e4aafbc7\", \"2d8ba8d0ca8f9a9a1f4f7f2a1fb2c1a2d8f6d3c1\"")
+        );
+
+    if(!fTokenIndex)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Token indexing disabled");
+
+    uint160 token = ParseTokenAddress(params[0], "token");
+    uint160 holder = ParseTokenAddress(params[1], "holder");
+
+    CTokenBalanceValue value;
+    if(!pblocktree->ReadTokenBalance(token, holder, value))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read token balance");
+
+    dev::u256 balance = uintTou256(value.balance);
+    UniValue result(UniValue::VOBJ);
+    if(balance >> 255)
+        result.push_back(Pair("balance", "-" + dev::u256(0 - balance).str()));
+    else
+        result.push_back(Pair("balance", balance.str()));
+    result.push_back(Pair("received", TokenAmountToString(value.received)));
+    result.push_back(Pair("sent", TokenAmountToString(value.sent)));
+    result.push_back(Pair("transfers", value.transfers));
+    return result;
+}
+
+UniValue gettokenhistory(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 2 || params.size() > 5)
+        throw std::runtime_error(
+            "gettokenhistory \"token\" \"address\" ( fromBlock toBlock count )\n"
+            "\nNOTE: This function requires -tokenindex enabled.\n"
+
+            "\nReturns the Transfer events of a token from or to an address, oldest first.\n"
+
+            "\nArguments:\n"
+            "1. \"token\"      (string, required) The hexadecimal token contract address\n"
+            "2. \"address\"    (string, required) The hexadecimal holder address\n"
+            "3. fromBlock      (numeric, optional, default=0) The first block to include\n"
+            "4. toBlock        (numeric, optional, default=-1) The last block to include, -1 for the tip\n"
+            "5. count          (numeric, optional, default=0) The maximum number of entries, 0 for no limit\n"
+
+            "\nResult:\n"
+            "[{\n"
+            "  \"blockNumber\": n,         (numeric) The block height\n"
+            "  \"transactionHash\": \"id\",  (string)  The transaction id\n"
+            "  \"transactionIndex\": n,    (numeric) The transaction index in block\n"
+            "  \"logIndex\": n,            (numeric) The index of the event among the logs of the transaction\n"
+            "  \"from\": \"address\",        (string)  The hexadecimal sender address\n"
+            "  \"to\": \"address\",          (string)  The hexadecimal recipient address\n"
+            "  \"amount\": \"n\"             (string)  The amount transferred, in the token's base unit\n"
+            "}]\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("gettokenhistory", "\"eb6a149ec16aaa7fc1e4d2f5f6d6e0e3e4aafbc7\" \"2d8ba8d0ca8f9a9a1f4f7f2a1fb2c1a2d8f6d3c1\" 0 -1 100")
+            + HelpExampleRpc("gettokenhistory", "\"eb6a149ec16aaa7fc1e4d2f5f6d6e0e3e4aafbc7\", \"2d8ba8d0ca8f9a9a1f4f7f2a1fb2c1a2d8f6d3c1\", 0, -1, 100")
+        );
+
+    if(!fTokenIndex)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Token indexing disabled");
+
+    uint160 token = ParseTokenAddress(params[0], "token");
+    uint160 holder = ParseTokenAddress(params[1], "holder");
+
+    int fromBlock = params.size() > 2 ? params[2].get_int() : 0;
+    int toBlock = params.size() > 3 ? params[3].get_int() : -1;
+    int count = params.size() > 4 ? params[4].get_int() : 0;
+    if(fromBlock < 0 || toBlock < -1 || (toBlock != -1 && toBlock < fromBlock))
+        throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block range");
+    if(count < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect count");
+
+    TokenHistoryVector history;
+    if(!pblocktree->ReadTokenHistory(token, holder, history, fromBlock, toBlock == -1 ? 0 : toBlock, count))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read token history");
+
+    UniValue result(UniValue::VARR);
+    for(const std::pair<CTokenHistoryKey, CTokenHistoryValue>& entry : history){
+        const CTokenHistoryKey& key = entry.first;
+        const uint160& from = key.fIncoming ? entry.second.counterparty : key.holder;
+        const uint160& to = key.fIncoming ? key.holder : entry.second.counterparty;
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("blockNumber", key.blockHeight));
+        obj.push_back(Pair("transactionHash", entry.second.txhash.GetHex()));
+        obj.push_back(Pair("transactionIndex", (int64_t)key.txIndex));
+        obj.push_back(Pair("logIndex", (int64_t)key.logIndex));
+        obj.push_back(Pair("from", HexStr(from.begin(), from.end())));
+        obj.push_back(Pair("to", HexStr(to.begin(), to.end())));
+        obj.push_back(Pair("amount", TokenAmountToString(entry.second.amount)));
+        result.push_back(obj);
+    }
+    return result;
+}
+
+UniValue getblockfilter(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nNOTE: This function requires -blockfilterindex enabled.\n"
+
+            "\nRetrieve a BIP 157 content filter for a particular block.\n"
+
+            "\nArguments:\n"
+            "1. \"blockhash\"    (string, required) The hash of the block\n"
+            "2. \"filtertype\"   (string, optional, default=basic) The type name of the filter\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",   (string) the hex-encoded filter data\n"
+            "  \"header\" : \"hex\"    (string) the hex-encoded filter header\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+        );
+
+    if (!fBlockFilterIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Block filter index disabled");
+
+    uint256 hashBlock(uint256S(params[0].get_str()));
+    BlockFilterType filterType = BLOCK_FILTER_BASIC;
+    if (params.size() > 1 && !BlockFilterTypeByName(params[1].get_str(), filterType))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+
+    {
+        LOCK(cs_main);
+        if (!LookupBlockIndex(hashBlock))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    }
+
+    BlockFilter filter;
+    uint256 hashFilter;
+    uint256 header;
+    if (!pblocktree->ReadBlockFilter(hashBlock, filter) || !pblocktree->ReadBlockFilterHeader(hashBlock, hashFilter, header))
+        throw JSONRPCError(RPC_MISC_ERROR, "Filter not found. Block filters are still in the process of being indexed, or the block is not in the active chain.");
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("filter", HexStr(filter.GetEncodedFilter())));
+    result.push_back(Pair("header", header.GetHex()));
+    return result;
+}
+
+UniValue tracetransaction(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw std::runtime_error(
+            "tracetransaction \"txid\"\n"
+            "\nNOTE: This function requires -txindex enabled.\n"
+
+            "\nRe-executes a mined contract transaction on the state of its block and returns an execution profile.\n"
+            "Gas and time of an opcode exclude the calls it makes. All numbers except the times are deterministic.\n"
+
+            "\nArgument:\n"
+            "1. \"txid\"      (string, required) The transaction id\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"txid\": \"id\",                (string)  The transaction id\n"
+            "  \"blockHash\": \"hash\",         (string)  The block containing the transaction\n"
+            "  \"blockNumber\": n,             (numeric) The block height\n"
+            "  \"executionResults\": [ ... ],  (array)   The result of each contract output, as in callcontract\n"
+            "  \"trace\": {\n"
+            "    \"steps\": n,                 (numeric) Instructions executed\n"
+            "    \"gasUsed\": n,               (numeric) Gas used by the executed code\n"
+            "    \"timeMicros\": n,            (numeric) Wall time\n"
+            "    \"storageReads\": n,          (numeric) SLOAD count\n"
+            "    \"storageWrites\": n,         (numeric) SSTORE count\n"
+            "    \"opcodes\": [               (array)   Per opcode, most gas first\n"
+            "      { \"opcode\": \"name\", \"count\": n, \"gas\": n, \"timeMicros\": n }, ...\n"
+            "    ],\n"
+            "    \"calls\": [                 (array)   Call tree, one root per contract output\n"
+            "      { \"address\": \"hex\", \"depth\": n, \"steps\": n, \"gasUsed\": n, \"timeMicros\": n,\n"
+            "        \"storageReads\": n, \"storageWrites\": n, \"calls\": [ ... ] }, ...\n"
+            "    ]\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("tracetransaction", "\"txid\"")
+            + HelpExampleRpc("tracetransaction", "\"txid\"")
+        );
+
+    std::string hashTemp = params[0].get_str();
+    if(hashTemp.size() != 64){
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect hash");
+    }
+    uint256 hash(uint256S(hashTemp));
+
+    LOCK(cs_main);
+
+    LuxExecutionProfiler profiler;
+    std::vector<ResultExecute> execResults;
+    std::string strError;
+    if(!TraceContractTransaction(hash, profiler, execResults, strError))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strError);
+
+    CTransaction tx;
+    uint256 hashBlock;
+    GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true);
+
+    UniValue results(UniValue::VARR);
+    for(const ResultExecute& res : execResults)
+        results.push_back(executionResultToJSON(res.execRes));
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("txid", hash.GetHex()));
+    result.push_back(Pair("blockHash", hashBlock.GetHex()));
+    CBlockIndex* pblockindex = LookupBlockIndex(hashBlock);
+    result.push_back(Pair("blockNumber", pblockindex ? pblockindex->nHeight : -1));
+    result.push_back(Pair("executionResults", results));
+    result.push_back(Pair("trace", profiler.ToJSON()));
     return result;
 }
 
@@ -1045,7 +1304,7 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getblockheader", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\"") + HelpExampleRpc("getblockheader", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\""));
 
-    LOCK(cs_main);
+    CChainSnapshotRef chain = GetChainSnapshot();
 
     std::string strHash = params[0].get_str();
     uint256 hash(strHash);
@@ -1054,23 +1313,30 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
+    std::string strCacheParams = hash.GetHex() + (fVerbose ? "/1" : "/0");
+    UniValue cached;
+    if (RPCResultFromCache("getblockheader", strCacheParams, *chain, cached))
+        return cached;
+
+    CBlockIndex* pblockindex = LookupBlockIndexConcurrent(hash);
+    if (!pblockindex)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
     if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
+    UniValue result;
     if (!fVerbose) {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
         ssBlock << block.GetBlockHeader();
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        result = HexStr(ssBlock.begin(), ssBlock.end());
+    } else {
+        result = blockHeaderToJSON(block, pblockindex);
     }
 
-    return blockHeaderToJSON(block, pblockindex);
+    RPCCacheResult("getblockheader", strCacheParams, pblockindex, *chain, result);
+    return result;
 }
 
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
@@ -1456,10 +1722,10 @@ UniValue invalidateblock(const UniValue& params, bool fHelp)
 
     {
         LOCK(cs_main);
-        if (mapBlockIndex.count(hash) == 0)
+        CBlockIndex* pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-        CBlockIndex* pblockindex = mapBlockIndex[hash];
         InvalidateBlock(state, Params(), pblockindex);
     }
 
@@ -1493,10 +1759,10 @@ UniValue reconsiderblock(const UniValue& params, bool fHelp)
 
     {
         LOCK(cs_main);
-        if (mapBlockIndex.count(hash) == 0)
+        CBlockIndex* pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-        CBlockIndex* pblockindex = mapBlockIndex[hash];
         ReconsiderBlock(state, pblockindex);
     }
 
@@ -0,0 +1,213 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpccache.h"
+
+#include "chain.h"
+#include "memusage.h"
+#include "rpcserver.h"
+#include "univalue/univalue.h"
+#include "utilstrencodings.h"
+
+/** The only key of a cacheable result whose value changes as the chain grows */
+static const std::string CONFIRMATIONS_KEY = "\"confirmations\":";
+
+CRPCResponseCache rpcResponseCache;
+
+CRPCResponseCache::CRPCResponseCache() : nUsage(0),
+                                         nMaxUsage(0),
+                                         nMinDepth(DEFAULT_RPC_CACHE_DEPTH),
+                                         pindexTip(NULL),
+                                         nEvicted(0),
+                                         nInvalidated(0)
+{
+}
+
+void CRPCResponseCache::SetLimits(size_t nMaxUsageIn, int nMinDepthIn)
+{
+    LOCK(cs);
+    nMaxUsage = nMaxUsageIn;
+    nMinDepth = std::max(nMinDepthIn, 1);
+    while (nUsage > nMaxUsage)
+        Erase(std::prev(lru.end()));
+}
+
+bool CRPCResponseCache::IsCacheable(const CBlockIndex* pindex, const CChainSnapshot& chain) const
+{
+    if (!pindex || !chain.Contains(pindex))
+        return false;
+    LOCK(cs);
+    return nMaxUsage > 0 && chain.Height() - pindex->nHeight + 1 >= nMinDepth;
+}
+
+bool CRPCResponseCache::Get(const std::string& strMethod, const std::string& strParams, const CChainSnapshot& chain, std::string& strJSON)
+{
+    LOCK(cs);
+    if (nMaxUsage == 0)
+        return false;
+
+    CRPCCacheMethodStats& stats = mapMethods[strMethod];
+    std::unordered_map<std::string, EntryList::iterator>::iterator it = mapEntries.find(strMethod + "/" + strParams);
+    // The chain may be older than the entry, or lose its block before the tip
+    // change is announced; such lookups miss but leave the entry alone.
+    if (it == mapEntries.end() || !chain.Contains(it->second->pindex) ||
+        chain.Next(it->second->pindex) != it->second->pindexNext) {
+        stats.nMisses++;
+        return false;
+    }
+    stats.nHits++;
+
+    lru.splice(lru.begin(), lru, it->second);
+    const Entry& entry = *it->second;
+    strJSON = entry.strPrefix;
+    if (entry.fConfirmations)
+        strJSON += itostr(chain.Height() - entry.pindex->nHeight + 1);
+    strJSON += entry.strSuffix;
+    return true;
+}
+
+size_t CRPCResponseCache::GetMaxEntrySize() const
+{
+    LOCK(cs);
+    return nMaxUsage / 8;
+}
+
+void CRPCResponseCache::Put(const std::string& strMethod, const std::string& strParams, const CBlockIndex* pindex,
+                            const CChainSnapshot& chain, const std::string& strJSON)
+{
+    if (!IsCacheable(pindex, chain))
+        return;
+
+    Entry entry;
+    entry.strKey = strMethod + "/" + strParams;
+    entry.pindex = pindex;
+    entry.pindexNext = chain.Next(pindex);
+    entry.fConfirmations = false;
+    size_t nPos = strJSON.find(CONFIRMATIONS_KEY);
+    if (nPos == std::string::npos) {
+        entry.strPrefix = strJSON;
+    } else {
+        // A quote inside a string value is escaped, so this is a key; a result
+        // with it in several places does not have one count to update.
+        nPos += CONFIRMATIONS_KEY.size();
+        if (strJSON.find(CONFIRMATIONS_KEY, nPos) != std::string::npos)
+            return;
+        size_t nEnd = strJSON.find_first_not_of("-0123456789", nPos);
+        if (nEnd == std::string::npos)
+            return;
+        entry.strPrefix = strJSON.substr(0, nPos);
+        entry.strSuffix = strJSON.substr(nEnd);
+        entry.fConfirmations = true;
+    }
+    entry.nUsage = memusage::MallocUsage(sizeof(Entry)) + memusage::MallocUsage(entry.strKey.capacity()) * 2 +
+                   memusage::MallocUsage(entry.strPrefix.capacity()) + memusage::MallocUsage(entry.strSuffix.capacity()) +
+                   memusage::MallocUsage(sizeof(std::pair<const std::string, EntryList::iterator>) + 2 * sizeof(void*));
+
+    LOCK(cs);
+    if (entry.nUsage > nMaxUsage / 8)
+        return;
+    // An entry that could not be served from chain is replaced
+    std::unordered_map<std::string, EntryList::iterator>::iterator itOld = mapEntries.find(entry.strKey);
+    if (itOld != mapEntries.end())
+        Erase(itOld->second);
+    while (nUsage + entry.nUsage > nMaxUsage) {
+        Erase(std::prev(lru.end()));
+        nEvicted++;
+    }
+    nUsage += entry.nUsage;
+    lru.push_front(entry);
+    mapEntries.emplace(lru.front().strKey, lru.begin());
+}
+
+void CRPCResponseCache::BlockTipChanged(const CBlockIndex* pindexNew)
+{
+    if (!pindexNew)
+        return;
+
+    LOCK(cs);
+    const CBlockIndex* pindexOld = pindexTip;
+    pindexTip = pindexNew;
+    if (!pindexOld || lru.empty())
+        return;
+
+    // Find the fork point between the old and the new chain
+    const CBlockIndex* pindexFork = pindexOld;
+    const CBlockIndex* pindexWalk = pindexNew;
+    if (pindexFork->nHeight > pindexWalk->nHeight)
+        pindexFork = pindexFork->GetAncestor(pindexWalk->nHeight);
+    else
+        pindexWalk = pindexWalk->GetAncestor(pindexFork->nHeight);
+    while (pindexFork != pindexWalk) {
+        pindexFork = pindexFork->pprev;
+        pindexWalk = pindexWalk->pprev;
+    }
+
+    // The fork block stays, but its "nextblockhash" now names another block
+    int nForkHeight = pindexFork ? pindexFork->nHeight : -1;
+    EntryList::iterator it = lru.begin();
+    while (it != lru.end()) {
+        EntryList::iterator itCur = it++;
+        if (itCur->pindex->nHeight >= nForkHeight) {
+            Erase(itCur);
+            nInvalidated++;
+        }
+    }
+}
+
+void CRPCResponseCache::Clear()
+{
+    LOCK(cs);
+    mapEntries.clear();
+    lru.clear();
+    nUsage = 0;
+}
+
+CRPCCacheStats CRPCResponseCache::GetStats() const
+{
+    LOCK(cs);
+    CRPCCacheStats stats;
+    stats.nEntries = mapEntries.size();
+    stats.nUsage = nUsage;
+    stats.nMaxUsage = nMaxUsage;
+    stats.nMinDepth = nMinDepth;
+    stats.nEvicted = nEvicted;
+    stats.nInvalidated = nInvalidated;
+    stats.mapMethods = mapMethods;
+    return stats;
+}
+
+void CRPCResponseCache::Erase(EntryList::iterator it)
+{
+    nUsage -= it->nUsage;
+    mapEntries.erase(it->strKey);
+    lru.erase(it);
+}
+
+bool RPCResultFromCache(const std::string& strMethod, const std::string& strParams, const CChainSnapshot& chain, UniValue& result)
+{
+    std::string strJSON;
+    if (!rpcResponseCache.Get(strMethod, strParams, chain, strJSON))
+        return false;
+
+    JSONStreamWriter* stream = RPCResultStream();
+    if (stream) {
+        stream->WriteRaw(strJSON);
+        result = NullUniValue;
+        return true;
+    }
+
+    // UniValue only reads containers at the top level
+    UniValue wrapped;
+    if (!wrapped.read("[" + strJSON + "]") || wrapped.size() != 1)
+        return false;
+    result = wrapped[0];
+    return true;
+}
+
+void RPCCacheResult(const std::string& strMethod, const std::string& strParams, const CBlockIndex* pindex,
+                    const CChainSnapshot& chain, const UniValue& result)
+{
+    if (rpcResponseCache.IsCacheable(pindex, chain))
+        rpcResponseCache.Put(strMethod, strParams, pindex, chain, result.write());
+}
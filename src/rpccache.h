@@ -0,0 +1,123 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPCCACHE_H
+#define BITCOIN_RPCCACHE_H
+
+#include "sync.h"
+
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+class CBlockIndex;
+class CChainSnapshot;
+class UniValue;
+
+/** Default for -rpccachesize, the memory for cached RPC and REST results in megabytes */
+static const unsigned int DEFAULT_RPC_CACHE_SIZE = 32;
+/** Default for -rpccachedepth, the confirmations a block needs before results about it are cached */
+static const int DEFAULT_RPC_CACHE_DEPTH = 6;
+
+struct CRPCCacheMethodStats {
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    CRPCCacheMethodStats() : nHits(0), nMisses(0) {}
+};
+
+struct CRPCCacheStats {
+    size_t nEntries;
+    size_t nUsage;
+    size_t nMaxUsage;
+    int nMinDepth;
+    uint64_t nEvicted;      //!< entries dropped to make room
+    uint64_t nInvalidated;  //!< entries dropped because their block was disconnected
+    std::map<std::string, CRPCCacheMethodStats> mapMethods;
+};
+
+/**
+ * Least recently used cache of serialized JSON results about historical data,
+ * keyed by method and parameters. Every entry belongs to a block that was at
+ * least nMinDepth deep in the main chain when the result was built, and is
+ * only served while that block and its successor ("nextblockhash") are the
+ * same in the chain it is checked against. The "confirmations" count is
+ * filled in on every hit. Entries of disconnected blocks and of the block the
+ * chain forked from are dropped when the tip changes. Results that also
+ * depend on later blocks in other ways, such as the spent information of
+ * -spentindex, must not be stored.
+ */
+class CRPCResponseCache
+{
+public:
+    CRPCResponseCache();
+
+    /** Set the memory limit in bytes (0 disables the cache) and the depth required for caching */
+    void SetLimits(size_t nMaxUsageIn, int nMinDepthIn);
+
+    /** Whether results about pindex, a block of chain, may be cached */
+    bool IsCacheable(const CBlockIndex* pindex, const CChainSnapshot& chain) const;
+
+    /** Look up the result of strMethod for strParams; counts a hit or a miss for strMethod */
+    bool Get(const std::string& strMethod, const std::string& strParams, const CChainSnapshot& chain, std::string& strJSON);
+
+    /** Largest result worth caching, so that a single huge block does not flush everything else */
+    size_t GetMaxEntrySize() const;
+
+    /** Store a result about pindex if it is deep enough in chain and small enough to be worth it */
+    void Put(const std::string& strMethod, const std::string& strParams, const CBlockIndex* pindex,
+             const CChainSnapshot& chain, const std::string& strJSON);
+
+    /** Drop the entries of blocks no longer in the chain ending at pindexNew, or whose successor changed */
+    void BlockTipChanged(const CBlockIndex* pindexNew);
+
+    void Clear();
+
+    CRPCCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        std::string strKey;
+        const CBlockIndex* pindex;
+        //! successor of pindex when the result was built, NULL at the tip
+        const CBlockIndex* pindexNext;
+        /** The result is strPrefix, then the confirmations when fConfirmations, then strSuffix */
+        std::string strPrefix;
+        std::string strSuffix;
+        bool fConfirmations;
+        size_t nUsage;
+    };
+    typedef std::list<Entry> EntryList;
+
+    mutable CCriticalSection cs;
+    //! most recently used first
+    EntryList lru;
+    std::unordered_map<std::string, EntryList::iterator> mapEntries;
+    size_t nUsage;
+    size_t nMaxUsage;
+    int nMinDepth;
+    const CBlockIndex* pindexTip;
+    uint64_t nEvicted;
+    uint64_t nInvalidated;
+    std::map<std::string, CRPCCacheMethodStats> mapMethods;
+
+    void Erase(EntryList::iterator it);
+};
+
+extern CRPCResponseCache rpcResponseCache;
+
+/**
+ * Answer the RPC call running on this thread from the response cache. On a hit the
+ * result is written to the result stream if there is one, and result is set to
+ * what the handler should return.
+ */
+bool RPCResultFromCache(const std::string& strMethod, const std::string& strParams, const CChainSnapshot& chain, UniValue& result);
+
+/** Offer the result of an RPC call about pindex to the response cache */
+void RPCCacheResult(const std::string& strMethod, const std::string& strParams, const CBlockIndex* pindex,
+                    const CChainSnapshot& chain, const UniValue& result);
+
+#endif // BITCOIN_RPCCACHE_H
@@ -94,6 +94,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "searchlogs", 1, "toBlock"},
     { "searchlogs", 2, "address"},
     { "searchlogs", 3, "topics"},
+    { "gettokenhistory", 2, "fromBlock"},
+    { "gettokenhistory", 3, "toBlock"},
+    { "gettokenhistory", 4, "count"},
     { "waitforlogs", 0, "fromBlock"},
     { "waitforlogs", 1, "txlimit"},
     { "waitforlogs", 2, "address"},
@@ -144,6 +147,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getmempoolancestors", 1, "verbose" },
     { "getmempooldescendants", 1, "verbose" },
     { "bumpfee", 1, "options" },
+    { "callcontract", 3, "gasLimit" },
+    { "callcontract", 4, "height" },
+    { "callcontract", 5, "trace" },
     { "createcontract", 1, "gasLimit" },
     { "createcontract", 2, "gasPrice" },
     { "createcontract", 4, "broadcast" },
@@ -582,7 +582,6 @@ UniValue verifymessage(const UniValue& params, bool fHelp)
             "\nVerify the signature\n" + HelpExampleCli("verifymessage", "\"1D1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XZ\" \"signature\" \"my message\"") +
             "\nAs json rpc\n" + HelpExampleRpc("verifymessage", "\"1D1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XZ\", \"signature\", \"my message\""));
 
-    LOCK(cs_main);
     string strAddress   = params[0].get_str();
     string strSign      = params[1].get_str();
     string strMessage   = params[2].get_str();
@@ -785,6 +784,8 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "    \"height\"    (number) The block height\n"
             "  },...\n"
             "]\n"
+            "\nWith \"limit\" (number) and \"cursor\" (string) in the arguments object, the result is a\n"
+            "page {\"utxos\": [...], \"next\": cursor or null} in address index order\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "\"LYmrT81UoxqfskSNt28ZKZ3XXskSFENEtg\"")
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"LYmrT81UoxqfskSNt28ZKZ3XXskSFENEtg\"]}'")
@@ -796,14 +797,41 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    AddressUnspentVector unspentOutputs;
-    for (AddressTypeVector::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent(it->first, it->second, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    // paging follows the index order, by address then txid, a cursor is the hex key of the next output
+    size_t limit = 0;
+    CAddressUnspentKey cursorKey;
+    bool fPaged = false, fCursor = false;
+    if (params[0].isObject()) {
+        UniValue limitValue = find_value(params[0].get_obj(), "limit");
+        UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+        if (!limitValue.isNull()) {
+            if (!limitValue.isNum() || limitValue.get_int() <= 0)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be a positive number");
+            limit = limitValue.get_int();
+            fPaged = true;
+        }
+        if (fPaged && !cursorValue.isNull()) {
+            if (!cursorValue.isStr() || !IsHex(cursorValue.get_str()))
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+            std::vector<unsigned char> vchCursor = ParseHex(cursorValue.get_str());
+            CDataStream ssCursor(vchCursor, SER_DISK, CLIENT_VERSION);
+            try {
+                ssCursor >> cursorKey;
+            } catch (const std::exception&) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+            }
+            fCursor = true;
         }
     }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    AddressUnspentVector unspentOutputs;
+    CAddressUnspentKey nextKey;
+    if (!GetAddressUnspentBatch(addresses, unspentOutputs, fCursor ? &cursorKey : NULL, limit, &nextKey)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    if (!fPaged)
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
 
     UniValue result(UniValue::VARR);
 
@@ -823,9 +851,90 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         result.push_back(output);
     }
 
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("utxos", result));
+        if (nextKey.hashType == 0) {
+            page.push_back(Pair("next", NullUniValue));
+        } else {
+            CDataStream ssNext(SER_DISK, CLIENT_VERSION);
+            ssNext << nextKey;
+            page.push_back(Pair("next", HexStr(ssNext.begin(), ssNext.end())));
+        }
+        return page;
+    }
+
     return result;
 }
 
+// Paging of getaddressdeltas and getaddresstxids, the cursor is the "height:blockindex"
+// position of the first transaction of the next page
+static bool getAddressPageFromParams(const UniValue& params, size_t &limit, int &start, unsigned int &startIndex)
+{
+    if (!params[0].isObject())
+        return false;
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    if (limitValue.isNull())
+        return false;
+    if (!limitValue.isNum() || limitValue.get_int() <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be a positive number");
+    limit = limitValue.get_int();
+
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (cursorValue.isStr()) {
+        std::string cursor = cursorValue.get_str();
+        size_t pos = cursor.find(':');
+        int32_t height, index;
+        if (pos == std::string::npos || !ParseInt32(cursor.substr(0, pos), &height) ||
+            !ParseInt32(cursor.substr(pos + 1), &index) || height < 0 || index < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        start = height;
+        startIndex = index;
+    } else if (!cursorValue.isNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+
+    return true;
+}
+
+static bool heightIndexSort(std::pair<CAddressIndexKey, CAmount> a,
+                            std::pair<CAddressIndexKey, CAmount> b) {
+    if (a.first.blockHeight != b.first.blockHeight)
+        return a.first.blockHeight < b.first.blockHeight;
+    if (a.first.blockIndex != b.first.blockIndex)
+        return a.first.blockIndex < b.first.blockIndex;
+    return CAddressIndexKeyCompare()(a.first, b.first);
+}
+
+// Read the next page of the addresses' entries, merged by height and position in block.
+// next is set to the cursor of the following page, or null on the last one.
+static void getAddressIndexPage(const AddressTypeVector &addresses, int start, unsigned int startIndex, int end,
+                                size_t limit, AddressIndexVector &page, UniValue &next)
+{
+    AddressIndexVector merged;
+    bool fMore = false;
+    if (!GetAddressIndexBatch(addresses, merged, start, startIndex, end, limit, fMore)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    std::sort(merged.begin(), merged.end(), heightIndexSort);
+
+    // every address read at least limit entries up to its last one, so a page cut
+    // after limit entries never skips an entry of an address that has more
+    next = NullUniValue;
+    for (AddressIndexVector::const_iterator it = merged.begin(); it != merged.end(); it++) {
+        if (page.size() >= limit && (it->first.blockHeight != page.back().first.blockHeight ||
+                                     it->first.blockIndex != page.back().first.blockIndex)) {
+            next = strprintf("%d:%u", it->first.blockHeight, it->first.blockIndex);
+            return;
+        }
+        page.push_back(*it);
+    }
+    if (fMore && !page.empty())
+        next = strprintf("%d:%u", page.back().first.blockHeight, page.back().first.blockIndex + 1);
+}
+
 UniValue getaddressdeltas(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 1)
@@ -838,7 +947,9 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "    ,...\n"
             "  ],\n"
             "  \"start\",    (number) The start block height (optional)\n"
-            "  \"end\"       (number) The end block height (optional)\n"
+            "  \"end\",      (number) The end block height (optional)\n"
+            "  \"limit\",    (number) Return pages of about this many deltas (optional)\n"
+            "  \"cursor\"    (string) The \"next\" value of the previous page (optional)\n"
             "}\n"
             "\nResult: [\n"
             "  {\n"
@@ -851,9 +962,14 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "    \"flags\"       (number) The type of movement\n"
             "  },...\n"
             "]\n"
+            "\nResult with a limit: {\n"
+            "  \"deltas\": [...], (array) The deltas of the page, ordered by height and block index\n"
+            "  \"next\"           (string) The cursor of the next page, null on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "\"LYmrT81UoxqfskSNt28ZKZ3XXskSFENEtg\" 0 10000")
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"LYmrT81UoxqfskSNt28ZKZ3XXskSFENEtg\"], \"start\": 0, \"end\": 35000}'")
+            + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"LYmrT81UoxqfskSNt28ZKZ3XXskSFENEtg\"], \"limit\": 1000, \"cursor\": \"35000:2\"}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"LYmrT81UoxqfskSNt28ZKZ3XXskSFENEtg\"], \"start\": 0, \"end\": 35000}")
         );
 
@@ -883,14 +999,25 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    size_t limit = 0;
+    unsigned int startIndex = 0;
+    bool fPaged = getAddressPageFromParams(params, limit, start, startIndex);
+
     AddressIndexVector addressIndex;
-    for (AddressTypeVector::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex(it->first, it->second, addressIndex, start, end)) {
+    UniValue next;
+    if (fPaged) {
+        getAddressIndexPage(addresses, start, startIndex, end, limit, addressIndex, next);
+    } else {
+        bool fMore;
+        if (!GetAddressIndexBatch(addresses, addressIndex, start, 0, end, 0, fMore)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
+        if (addresses.size() > 1)
+            std::sort(addressIndex.begin(), addressIndex.end(), heightIndexSort);
     }
 
-    UniValue result(UniValue::VARR);
+    // An unpaged history can be arbitrarily long, stream it when possible
+    RPCResultArray result(!fPaged);
 
     for (AddressIndexVector::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         std::string address;
@@ -909,7 +1036,14 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         result.push_back(delta);
     }
 
-    return result;
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("deltas", result.Finish()));
+        page.push_back(Pair("next", next));
+        return page;
+    }
+
+    return result.Finish();
 }
 
 UniValue getaddressbalance(const UniValue& params, bool fHelp)
@@ -930,7 +1064,8 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
             "  \"spent\",    (number) The total amount spent (excluding stakes)\n"
             "  \"sent\",     (number) The total amount sent (excl. stakes and amounts sent to same addr.)\n"
             "  \"staked\",   (number) The total amount of Proof of Stake incomes\n"
-            "  \"deltas\"    (number) The total amount of movements indexed\n"
+            "  \"deltas\",   (number) The total amount of movements indexed\n"
+            "  \"txcount\"   (number) The number of transactions involving the address(es)\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressbalance", "\"LYmrT81UoxqfskSNt28ZKZ3XXskSFENEtg\"")
@@ -943,54 +1078,23 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    AddressIndexVector addressIndex;
-
+    CAddressBalanceValue total;
     for (AddressTypeVector::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+        CAddressBalanceValue balance;
+        if (!GetAddressBalance((*it).first, (*it).second, balance)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-    }
-
-    CAmount balance = 0;
-    CAmount received = 0;
-    CAmount spent = 0, sent = 0;
-    CAmount staked = 0;
-    uint256 lastStakeHash = uint256(-1);
-    uint256 lastSpentHash = uint256(-1);
-
-    for (AddressIndexVector::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++)
-    {
-        balance += it->second;
-
-        if (it->second > 0) {
-            // outputs
-            received += it->second;
-            if (it->first.txhash == lastStakeHash) {
-                staked += it->second;
-            } else if (it->first.txhash == lastSpentHash) {
-                // sent to same address
-                sent += it->second;
-            }
-        } else {
-            // inputs
-            if (it->first.spentFlags & ANDX_IS_STAKE) {
-                staked += it->second;
-                lastStakeHash = it->first.txhash;
-            } else {
-                sent += it->second;
-                spent += it->second;
-                lastSpentHash = it->first.txhash;
-            }
-        }
+        total += balance;
     }
 
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("balance", balance));
-    result.push_back(Pair("received", received));
-    result.push_back(Pair("sent", (0 - sent)));
-    result.push_back(Pair("spent", (0 - spent)));
-    result.push_back(Pair("staked", staked));
-    result.push_back(Pair("deltas", (int64_t)addressIndex.size()));
+    result.push_back(Pair("balance", total.balance));
+    result.push_back(Pair("received", total.received));
+    result.push_back(Pair("sent", (0 - total.sent)));
+    result.push_back(Pair("spent", (0 - total.spent)));
+    result.push_back(Pair("staked", total.staked));
+    result.push_back(Pair("deltas", total.deltas));
+    result.push_back(Pair("txcount", total.txCount));
 
     return result;
 }
@@ -1006,13 +1110,19 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
             "   \"address\" (string) The base58 encoded address\n"
             "   ,...\n"
             "  ],\n"
-            "  \"start\", (number) The start block height (optional)\n"
-            "  \"end\"    (number) The end block height (optional)\n"
+            "  \"start\",  (number) The start block height (optional)\n"
+            "  \"end\",    (number) The end block height (optional)\n"
+            "  \"limit\",  (number) Return pages of about this many index entries (optional)\n"
+            "  \"cursor\"  (string) The \"next\" value of the previous page (optional)\n"
             "}\n"
             "\nResult: [\n"
             "  \"txid\"   (string) The transaction hash\n"
             "  ,...\n"
             "]\n"
+            "\nResult with a limit: {\n"
+            "  \"txids\": [...], (array) The txids of the page, ordered by height and block index\n"
+            "  \"next\"          (string) The cursor of the next page, null on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "\"LYmrT81UoxqfskSNt28ZKZ3XXskSFENEtg\" 0 100000")
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"LYmrT81UoxqfskSNt28ZKZ3XXskSFENEtg\"]}'")
@@ -1046,11 +1156,30 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
     if (end < start)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "End value is expected to be greater than start");
 
-    AddressIndexVector addressIndex;
-    for (AddressTypeVector::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex(it->first, it->second, addressIndex, start, end)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    size_t limit = 0;
+    unsigned int startIndex = 0;
+    if (getAddressPageFromParams(params, limit, start, startIndex)) {
+        AddressIndexVector addressIndex;
+        UniValue next;
+        getAddressIndexPage(addresses, start, startIndex, end, limit, addressIndex, next);
+
+        // entries of a transaction are adjacent in the page
+        UniValue txids(UniValue::VARR);
+        for (AddressIndexVector::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+            if (it == addressIndex.begin() || it->first.txhash != (it - 1)->first.txhash)
+                txids.push_back(it->first.txhash.GetHex());
         }
+
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("txids", txids));
+        page.push_back(Pair("next", next));
+        return page;
+    }
+
+    AddressIndexVector addressIndex;
+    bool fMore;
+    if (!GetAddressIndexBatch(addresses, addressIndex, start, 0, end, 0, fMore)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
     }
 
     std::set<std::pair<int, std::string> > txhashes;
@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "rpcserver.h"
+#include "addrman.h"
 #include "core_io.h"
 #include "clientversion.h"
 #include "main.h"
@@ -88,6 +89,8 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
             "    \"lastrecv\": ttt,           (numeric) The time in seconds since epoch (Jan 1 1970 GMT) of the last receive\n"
             "    \"bytessent\": n,            (numeric) The total bytes sent\n"
             "    \"bytesrecv\": n,            (numeric) The total bytes received\n"
+            "    \"sendbuffer\": n,           (numeric) The bytes queued to be sent, counted against the send buffer limit\n"
+            "    \"recvbuffer\": n,           (numeric) The bytes held for messages not processed yet, counted against the receive flood limit\n"
             "    \"conntime\": ttt,           (numeric) The connection time in seconds since epoch (Jan 1 1970 GMT)\n"
             "    \"pingtime\": n,             (numeric) ping time (if available)\n"
             "    \"minping\": n,              (numeric) minimum observed ping time (if any at all)\n"
@@ -129,6 +132,8 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
         obj.push_back(Pair("lastrecv", stats.nLastRecv));
         obj.push_back(Pair("bytessent", stats.nSendBytes));
         obj.push_back(Pair("bytesrecv", stats.nRecvBytes));
+        obj.push_back(Pair("sendbuffer", (uint64_t)stats.nSendSize));
+        obj.push_back(Pair("recvbuffer", (uint64_t)stats.nRecvSize));
         obj.push_back(Pair("conntime", stats.nTimeConnected));
         obj.push_back(Pair("pingtime", stats.dPingTime));
         if (stats.dPingWait > 0.0)
@@ -520,3 +525,35 @@ UniValue clearbanned(const UniValue& params, bool fHelp)
 
     return NullUniValue;
 }
+
+UniValue getaddrmaninfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getaddrmaninfo\n"
+            "\nReturns the size of the address manager's tables and how its selections of addresses to connect to went.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"new\": n,               (numeric) Addresses not connected to yet\n"
+            "  \"tried\": n,             (numeric) Addresses connected to before\n"
+            "  \"selects\": n,           (numeric) Addresses selected\n"
+            "  \"draws\": n,             (numeric) Entries drawn at random for the selections\n"
+            "  \"skipped\": n,           (numeric) Drawn entries passed over as terrible or tried too recently\n"
+            "  \"scans\": n,             (numeric) Selections that chose among the suitable entries after running out of draws\n"
+            "  \"fallbacks\": n          (numeric) Selections that found no suitable entry\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getaddrmaninfo", "") + HelpExampleRpc("getaddrmaninfo", ""));
+
+    CAddrManStats stats = addrman.GetStats();
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("new", stats.nNew));
+    obj.push_back(Pair("tried", stats.nTried));
+    obj.push_back(Pair("selects", stats.nSelects));
+    obj.push_back(Pair("draws", stats.nDraws));
+    obj.push_back(Pair("skipped", stats.nSkipped));
+    obj.push_back(Pair("scans", stats.nScans));
+    obj.push_back(Pair("fallbacks", stats.nFallbacks));
+    return obj;
+}
@@ -14,6 +14,7 @@
 #include "merkleblock.h"
 #include "net.h"
 #include "primitives/transaction.h"
+#include "rpccache.h"
 #include "rpcserver.h"
 #include "script/script.h"
 #include "script/sign.h"
@@ -134,10 +135,11 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 
     if (hashBlock != uint256()) {
         entry.push_back(Pair("blockhash", hashBlock.GetHex()));
-        CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+        CChainSnapshotRef chain = GetChainSnapshot();
+        CBlockIndex* pindex = LookupBlockIndexConcurrent(hashBlock);
         if (pindex) {
-            if (chainActive.Contains(pindex)) {
-                entry.push_back(Pair("confirmations", 1 + chainActive.Height() - pindex->nHeight));
+            if (chain->Contains(pindex)) {
+                entry.push_back(Pair("confirmations", 1 + chain->Height() - pindex->nHeight));
                 entry.push_back(Pair("time", pindex->GetBlockTime()));
                 entry.push_back(Pair("blocktime", pindex->GetBlockTime()));
             } else {
@@ -214,14 +216,21 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getrawtransaction", "\"mytxid\"") + HelpExampleCli("getrawtransaction", "\"mytxid\" 1") + HelpExampleRpc("getrawtransaction", "\"mytxid\", 1"));
 
-    LOCK(cs_main);
-
     uint256 hash = ParseHashV(params[0], "parameter 1");
 
     bool fVerbose = false;
     if (params.size() > 1)
         fVerbose = (params[1].get_int() != 0);
 
+    // Confirmed transactions are answered from the cache without cs_main
+    std::string strCacheParams = hash.GetHex() + (fVerbose ? "/1" : "/0");
+    CChainSnapshotRef chain = GetChainSnapshot();
+    UniValue cached;
+    if (RPCResultFromCache("getrawtransaction", strCacheParams, *chain, cached))
+        return cached;
+
+    LOCK(cs_main);
+
     CTransaction tx;
     uint256 hashBlock = uint256();
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true))
@@ -229,12 +238,17 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
 
     string strHex = EncodeHexTx(tx);
 
-    if (!fVerbose)
-        return strHex;
-
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hex", strHex));
-    TxToJSON(tx, hashBlock, result);
+    if (!fVerbose) {
+        result = strHex;
+    } else {
+        result.push_back(Pair("hex", strHex));
+        TxToJSON(tx, hashBlock, result);
+    }
+
+    // With -spentindex the outputs name the transactions spending them, which later blocks change
+    if (!hashBlock.IsNull() && !(fVerbose && fSpentIndex))
+        RPCCacheResult("getrawtransaction", strCacheParams, LookupBlockIndexConcurrent(hashBlock), *chain, result);
     return result;
 }
 
@@ -591,9 +605,9 @@ UniValue createrawtransaction(const UniValue& params, bool fHelp)
 
             // Get dgp gas limit and gas price
             LOCK(cs_main);
-            LuxDGP luxDGP(globalState.get(), fGettingValuesDGP);
-            uint64_t blockGasLimit = luxDGP.getBlockGasLimit(chainActive.Height());
-            uint64_t minGasPrice = CAmount(luxDGP.getMinGasPrice(chainActive.Height()));
+            const LuxDGPParams& dgpParams = GetTipDGPParams(chainActive.Height());
+            uint64_t blockGasLimit = dgpParams.blockGasLimit;
+            uint64_t minGasPrice = CAmount(dgpParams.minGasPrice);
             CAmount nGasPrice = (minGasPrice>DEFAULT_GAS_PRICE)?minGasPrice:DEFAULT_GAS_PRICE;
 
             // Get the contract address
@@ -726,8 +740,6 @@ UniValue decoderawtransaction(const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("decoderawtransaction", "\"hexstring\"") + HelpExampleRpc("decoderawtransaction", "\"hexstring\""));
 
-    LOCK(cs_main);
-
     RPCTypeCheck(params, list_of(UniValue::VSTR));
 
     CTransaction tx;
@@ -764,8 +776,6 @@ UniValue decodescript(const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("decodescript", "\"hexstring\"") + HelpExampleRpc("decodescript", "\"hexstring\""));
 
-    LOCK(cs_main);
-
     RPCTypeCheck(params, list_of(UniValue::VSTR));
 
     UniValue r(UniValue::VOBJ);
@@ -13,6 +13,7 @@
 #include "ui_interface.h"
 #include "util.h"
 #include "random.h"
+#include "rpccache.h"
 #include "sync.h"
 #include "utilstrencodings.h"
 #include "univalue/univalue.h"
@@ -243,6 +244,124 @@ UniValue stop(const UniValue& params, bool fHelp)
     return "LUX server stopping";
 }
 
+static std::string HTTPWorkClassName(HTTPWorkClass workClass)
+{
+    static const char* const NAMES[HTTP_WORK_CLASSES] = {"fast", "slow", "longpoll"};
+    return NAMES[workClass];
+}
+
+UniValue getrpcqueueinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrpcqueueinfo\n"
+            "\nReturns the state of the HTTP work queues and per-method request counters.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"queues\": [                (array) One entry per worker pool\n"
+            "    {\n"
+            "      \"class\": \"fast|slow|longpoll\",  (string) The work class served by the pool\n"
+            "      \"depth\": n,            (numeric) Requests waiting\n"
+            "      \"capacity\": n,         (numeric) Requests that can wait before new ones are rejected\n"
+            "      \"threads\": n,          (numeric) Worker threads\n"
+            "      \"idle\": n              (numeric) Worker threads waiting for work\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"methods\": {               (object) Counters per RPC method or REST path\n"
+            "    \"name\": {\n"
+            "      \"class\": \"fast|slow|longpoll\",  (string) The work class of the method\n"
+            "      \"requests\": n,         (numeric) Requests started\n"
+            "      \"rejected\": n,         (numeric) Requests rejected because the queue was full\n"
+            "      \"avgwaitmicros\": n,    (numeric) Average time spent queued\n"
+            "      \"maxwaitmicros\": n     (numeric) Longest time spent queued\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getrpcqueueinfo", "") + HelpExampleRpc("getrpcqueueinfo", ""));
+
+    std::vector<HTTPQueueStats> vQueues;
+    std::map<std::string, HTTPWorkStats> mapRequests;
+    if (!GetHTTPWorkQueueStats(vQueues, mapRequests))
+        throw JSONRPCError(RPC_MISC_ERROR, "HTTP server is not running");
+
+    UniValue queues(UniValue::VARR);
+    for (const HTTPQueueStats& stats : vQueues) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("class", HTTPWorkClassName(stats.workClass)));
+        obj.push_back(Pair("depth", (uint64_t)stats.nDepth));
+        obj.push_back(Pair("capacity", (uint64_t)stats.nCapacity));
+        obj.push_back(Pair("threads", stats.nThreads));
+        obj.push_back(Pair("idle", stats.nIdle));
+        queues.push_back(obj);
+    }
+
+    UniValue methods(UniValue::VOBJ);
+    for (const auto& item : mapRequests) {
+        const HTTPWorkStats& stats = item.second;
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("class", HTTPWorkClassName(stats.workClass)));
+        obj.push_back(Pair("requests", stats.nRequests));
+        obj.push_back(Pair("rejected", stats.nRejected));
+        obj.push_back(Pair("avgwaitmicros", stats.nRequests ? stats.nWaitMicros / (int64_t)stats.nRequests : 0));
+        obj.push_back(Pair("maxwaitmicros", stats.nMaxWaitMicros));
+        methods.push_back(Pair(item.first, obj));
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("queues", queues));
+    result.push_back(Pair("methods", methods));
+    return result;
+}
+
+UniValue getrpccacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrpccacheinfo\n"
+            "\nReturns the state of the cache of RPC and REST results about old blocks.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"entries\": n,            (numeric) Results in the cache\n"
+            "  \"usage\": n,              (numeric) Memory used by the cache in bytes\n"
+            "  \"maxusage\": n,           (numeric) Memory limit of the cache in bytes (-rpccachesize)\n"
+            "  \"mindepth\": n,           (numeric) Confirmations a block needs before results about it are cached\n"
+            "  \"evicted\": n,            (numeric) Results dropped to make room\n"
+            "  \"invalidated\": n,        (numeric) Results dropped because their block was disconnected\n"
+            "  \"methods\": {             (object) Counters per RPC method or REST path\n"
+            "    \"name\": {\n"
+            "      \"hits\": n,           (numeric) Requests answered from the cache\n"
+            "      \"misses\": n,         (numeric) Requests the cache could not answer\n"
+            "      \"hitrate\": x.xxx     (numeric) Fraction of requests answered from the cache\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getrpccacheinfo", "") + HelpExampleRpc("getrpccacheinfo", ""));
+
+    CRPCCacheStats stats = rpcResponseCache.GetStats();
+
+    UniValue methods(UniValue::VOBJ);
+    for (const auto& item : stats.mapMethods) {
+        uint64_t nRequests = item.second.nHits + item.second.nMisses;
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("hits", item.second.nHits));
+        obj.push_back(Pair("misses", item.second.nMisses));
+        obj.push_back(Pair("hitrate", nRequests ? (double)item.second.nHits / nRequests : 0.0));
+        methods.push_back(Pair(item.first, obj));
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("entries", (uint64_t)stats.nEntries));
+    result.push_back(Pair("usage", (uint64_t)stats.nUsage));
+    result.push_back(Pair("maxusage", (uint64_t)stats.nMaxUsage));
+    result.push_back(Pair("mindepth", stats.nMinDepth));
+    result.push_back(Pair("evicted", stats.nEvicted));
+    result.push_back(Pair("invalidated", stats.nInvalidated));
+    result.push_back(Pair("methods", methods));
+    return result;
+}
+
 
 /**
  * Call Table
@@ -256,6 +375,8 @@ static const CRPCCommand vRPCCommands[] =
         {"control", "getstateinfo", &getstateinfo, true, false, false}, /* uses wallet if enabled */
         {"control", "help", &help, true, true, false},
         {"control", "stop", &stop, true, true, false},
+        {"control", "getrpcqueueinfo", &getrpcqueueinfo, true, true, false},
+        {"control", "getrpccacheinfo", &getrpccacheinfo, true, true, false},
 
         /* P2P networking */
         {"network", "getnetworkinfo", &getnetworkinfo, true, false, false},
@@ -269,6 +390,7 @@ static const CRPCCommand vRPCCommands[] =
         {"network", "setban", &setban, true, false, false},
         {"network", "listbanned", &listbanned, true, false, false},
         {"network", "clearbanned", &clearbanned, true, false, false},
+        {"network", "getaddrmaninfo", &getaddrmaninfo, true, true, false},
         {"network", "switchnetwork", &switchnetwork, true, false, false },
 
         /* Block chain and UTXO */
@@ -306,6 +428,10 @@ static const CRPCCommand vRPCCommands[] =
         {"blockchain", "listcontracts", &listcontracts,true, true, false },
         {"blockchain", "gettransactionreceipt", &gettransactionreceipt,true, true, false },
         {"blockchain", "searchlogs", &searchlogs,true, true, false },
+        {"blockchain", "tracetransaction", &tracetransaction,true, true, false },
+        {"blockchain", "gettokenbalance", &gettokenbalance,true, true, false },
+        {"blockchain", "gettokenhistory", &gettokenhistory,true, true, false },
+        {"blockchain", "getblockfilter", &getblockfilter,true, true, false },
         {"blockchain", "waitforlogs", &waitforlogs,true, true, false },
         {"blockchain", "createcontract", &createcontract,true, true, false },
         {"blockchain", "sendtocontract", &sendtocontract,true, true, false },
@@ -529,6 +655,134 @@ void JSONRequest::PollReply(const UniValue& result) {
     req->ChunkEnd();
 }
 
+JSONStreamWriter::JSONStreamWriter(const Sink& sinkIn, size_t nChunkSizeIn) : sink(sinkIn),
+                                                                               nChunkSize(nChunkSizeIn),
+                                                                               fFirst(true),
+                                                                               fAfterKey(false),
+                                                                               fUsed(false)
+{
+}
+
+void JSONStreamWriter::Separate()
+{
+    fUsed = true;
+    if (fAfterKey)
+        fAfterKey = false;
+    else if (!fFirst)
+        buf += ',';
+    fFirst = false;
+}
+
+void JSONStreamWriter::Open(char chOpen, char chClose)
+{
+    Separate();
+    buf += chOpen;
+    vClose.push_back(chClose);
+    fFirst = true;
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    Open('[', ']');
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    Open('{', '}');
+}
+
+void JSONStreamWriter::End()
+{
+    assert(!vClose.empty() && !fAfterKey);
+    buf += vClose.back();
+    vClose.pop_back();
+    fFirst = false;
+    if (buf.size() >= nChunkSize)
+        Flush();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!vClose.empty() && vClose.back() == '}' && !fAfterKey);
+    Separate();
+    buf += UniValue(key).write() + ':';
+    fAfterKey = true;
+}
+
+static bool HasContainer(const UniValue& value)
+{
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i].isArray() || value[i].isObject())
+            return true;
+    }
+    return false;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    if (value.isArray()) {
+        BeginArray();
+        for (size_t i = 0; i < value.size(); i++)
+            Value(value[i]);
+        End();
+    } else if (value.isObject() && HasContainer(value)) {
+        const std::vector<std::string>& keys = value.getKeys();
+        BeginObject();
+        for (size_t i = 0; i < keys.size(); i++)
+            KeyValue(keys[i], value[i]);
+        End();
+    } else {
+        // leaves and flat objects are written whole
+        Separate();
+        buf += value.write();
+        if (buf.size() >= nChunkSize)
+            Flush();
+    }
+}
+
+void JSONStreamWriter::WriteRaw(const std::string& str)
+{
+    fUsed = true;
+    buf += str;
+    if (buf.size() >= nChunkSize)
+        Flush();
+}
+
+void JSONStreamWriter::CloseAll()
+{
+    if (fAfterKey)
+        Value(NullUniValue);
+    while (!vClose.empty())
+        End();
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (!buf.empty()) {
+        sink(buf);
+        buf.clear();
+    }
+}
+
+static void NoStreamCleanup(JSONStreamWriter*) {}
+/** The stream is owned by whoever set it up for the call */
+static boost::thread_specific_ptr<JSONStreamWriter> rpcResultStream(NoStreamCleanup);
+
+JSONStreamWriter* RPCResultStream()
+{
+    return rpcResultStream.get();
+}
+
+RPCResultStreamScope::RPCResultStreamScope(JSONStreamWriter* stream)
+{
+    rpcResultStream.reset(stream);
+}
+
+RPCResultStreamScope::~RPCResultStreamScope()
+{
+    rpcResultStream.reset(NULL);
+}
+
 void RPCSetTimerInterfaceIfUnset(RPCTimerInterface *iface)
 {
     if (!timerInterface)
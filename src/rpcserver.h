@@ -11,10 +11,12 @@
 #include "rpcprotocol.h"
 #include "uint256.h"
 
+#include <functional>
 #include <list>
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <vector>
 #include <httpserver.h>
 #include <boost/function.hpp>
 
@@ -149,6 +151,107 @@ public:
     // FIXME: make this private?
     HTTPRequest *req;
 };
+
+/**
+ * Writes a single JSON value incrementally, for results too large to build as
+ * one UniValue. Containers are opened and closed explicitly and filled with
+ * keys and values; the text goes to the sink in chunks of about nChunkSize
+ * bytes, so only one chunk is ever held in memory.
+ */
+class JSONStreamWriter
+{
+public:
+    typedef std::function<void(const std::string&)> Sink;
+
+    JSONStreamWriter(const Sink& sinkIn, size_t nChunkSizeIn);
+
+    void BeginArray();
+    void BeginObject();
+    /** Close the innermost open array or object */
+    void End();
+    /** Key of the next value in the innermost object */
+    void Key(const std::string& key);
+    /** Write a value; arrays and objects holding containers are written piecewise */
+    void Value(const UniValue& value);
+    void KeyValue(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+
+    /** Append JSON text as is */
+    void WriteRaw(const std::string& str);
+    /** Close every open container, so that output cut short by an error is still valid JSON */
+    void CloseAll();
+    void Flush();
+
+    /** Whether anything has been written */
+    bool Used() const { return fUsed; }
+
+private:
+    Sink sink;
+    size_t nChunkSize;
+    std::string buf;
+    std::vector<char> vClose;
+    bool fFirst;
+    bool fAfterKey;
+    bool fUsed;
+
+    void Separate();
+    void Open(char chOpen, char chClose);
+};
+
+/**
+ * Stream for the result of the RPC call running on this thread, or NULL if its
+ * transport cannot stream (batch requests, the GUI console). A handler that writes
+ * its result through the stream must return NullUniValue.
+ */
+JSONStreamWriter* RPCResultStream();
+
+/** Makes a result stream available to the RPC calls run on this thread while in scope */
+class RPCResultStreamScope
+{
+public:
+    explicit RPCResultStreamScope(JSONStreamWriter* stream);
+    ~RPCResultStreamScope();
+};
+
+/**
+ * Array result of an RPC call: streamed to the client as it is filled when the
+ * transport allows it, otherwise collected into a UniValue. Create it once the
+ * arguments are checked, and return Finish() from the handler.
+ */
+class RPCResultArray
+{
+public:
+    /** Pass fAllowStream false when the array ends up nested in a larger result */
+    explicit RPCResultArray(bool fAllowStream = true) : stream(fAllowStream ? RPCResultStream() : NULL), result(UniValue::VARR)
+    {
+        if (stream)
+            stream->BeginArray();
+    }
+
+    void push_back(const UniValue& value)
+    {
+        if (stream)
+            stream->Value(value);
+        else
+            result.push_back(value);
+    }
+
+    UniValue Finish()
+    {
+        if (!stream)
+            return result;
+        stream->End();
+        return NullUniValue;
+    }
+
+private:
+    JSONStreamWriter* stream;
+    UniValue result;
+};
+
 /** Query whether RPC is running */
 bool IsRPCRunning();
 
@@ -296,6 +399,7 @@ extern UniValue getnettotals(const UniValue& params, bool fHelp);
 extern UniValue setban(const UniValue& params, bool fHelp);
 extern UniValue listbanned(const UniValue& params, bool fHelp);
 extern UniValue clearbanned(const UniValue& params, bool fHelp);
+extern UniValue getaddrmaninfo(const UniValue& params, bool fHelp);
 
 extern UniValue dumpprivkey(const UniValue& params, bool fHelp); // in rpcdump.cpp
 extern UniValue importprivkey(const UniValue& params, bool fHelp);
@@ -436,6 +540,10 @@ extern UniValue getstorage(const UniValue& params, bool fHelp);
 extern UniValue listcontracts(const UniValue& params, bool fHelp);
 extern UniValue gettransactionreceipt(const UniValue& params, bool fHelp);
 extern UniValue searchlogs(const UniValue& params, bool fHelp);
+extern UniValue tracetransaction(const UniValue& params, bool fHelp);
+extern UniValue gettokenbalance(const UniValue& params, bool fHelp);
+extern UniValue gettokenhistory(const UniValue& params, bool fHelp);
+extern UniValue getblockfilter(const UniValue& params, bool fHelp);
 extern UniValue waitforlogs(const UniValue& params, bool fHelp);
 extern UniValue pruneblockchain(const UniValue& params, bool fHelp);
 
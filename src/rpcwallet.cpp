@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <string>
 #include "miner.h"
+#include "lux/luxcallengine.h"
 
 #include "libdevcore/CommonData.h"
 
@@ -80,7 +81,9 @@ void WalletTxToJSON(const CWalletTx& wtx, UniValue& entry)
     if (confirms > 0) {
         entry.push_back(Pair("blockhash", wtx.hashBlock.GetHex()));
         entry.push_back(Pair("blockindex", wtx.nIndex));
-        entry.push_back(Pair("blocktime", mapBlockIndex[wtx.hashBlock]->GetBlockTime()));
+        BlockMap::const_iterator mi = mapBlockIndex.find(wtx.hashBlock);
+        if (mi != mapBlockIndex.end())
+            entry.push_back(Pair("blocktime", mi->second->GetBlockTime()));
     } else {
         entry.push_back(Pair("trusted", wtx.IsTrusted()));
     }
@@ -2841,22 +2844,22 @@ UniValue multisend(const UniValue& params, bool fHelp)
 ////////////////////////////////////////////////////////////////////// // lux
 UniValue callcontract(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() < 2)
+    if (fHelp || params.size() < 2 || params.size() > 6)
         throw runtime_error(
-                "callcontract \"address\" \"data\" ( address )\n"
+                "callcontract \"address\" \"data\" ( address gasLimit height trace )\n"
                 "\nArgument:\n"
                 "1. \"address\"          (string, required) The account address\n"
                 "2. \"data\"             (string, required) The data hex string\n"
                 "3. address              (string, optional) The sender address hex string\n"
                 "4. gasLimit             (string, optional) The gas limit for executing the contract\n"
+                "5. height               (numeric, optional) Execute against the contract state after this block (default: the tip)\n"
+                "6. trace                (boolean, optional, default=false) Add an execution profile (see tracetransaction)\n"
         );
 
     if (chainActive.Height() < Params().FirstSCBlock()) {
         throw JSONRPCError(RPC_VERIFY_ERROR, "Smart contracts hardfork is not active yet. Activation block number - " + std::to_string(Params().FirstSCBlock()));
     }
 
-    LOCK(cs_main);
-
     std::string strAddr = params[0].get_str();
     std::string data = params[1].get_str();
 
@@ -2867,11 +2870,9 @@ UniValue callcontract(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect address");
 
     dev::Address addrAccount(strAddr);
-    if(!globalState->addressInUse(addrAccount))
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
 
     dev::Address senderAddress;
-    if(params.size() == 3){
+    if(params.size() > 2 && !params[2].isNull() && !params[2].get_str().empty()){
         CTxDestination luxSenderAddress = DecodeDestination(params[2].get_str());
         if(IsValidDestination(luxSenderAddress)) {
             CKeyID *keyid = boost::get<CKeyID>(&luxSenderAddress);
@@ -2883,14 +2884,45 @@ UniValue callcontract(const UniValue& params, bool fHelp)
 
     }
     uint64_t gasLimit=0;
-    if(params.size() == 4){
+    if(params.size() > 3 && !params[3].isNull()){
         gasLimit = params[3].get_int();
     }
-
-
-    std::vector<ResultExecute> execResults = CallContract(addrAccount, ParseHex(data), senderAddress, gasLimit);
+    int nHeight = -1;
+    if(params.size() > 4 && !params[4].isNull()){
+        nHeight = params[4].get_int();
+        if(nHeight < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+    }
+    std::unique_ptr<LuxExecutionProfiler> profiler;
+    if(params.size() > 5 && !params[5].isNull() && params[5].get_bool())
+        profiler.reset(new LuxExecutionProfiler());
+
+    std::vector<ResultExecute> execResults;
+    if(pluxCallEngine && pluxCallEngine->IsRunning()){
+        // Served from an immutable snapshot of the block state on the call engine
+        // threads, so concurrent calls neither take cs_main nor touch globalState.
+        std::string strError;
+        LuxCallSnapshotRef snapshot = pluxCallEngine->GetSnapshot(nHeight, strError);
+        if(!snapshot)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strError);
+        if(!pluxCallEngine->AddressInUse(snapshot, addrAccount))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
+
+        if(!pluxCallEngine->Call(snapshot, addrAccount, ParseHex(data), senderAddress, gasLimit, execResults, strError, profiler.get()))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, strError);
+    }else{
+        LOCK(cs_main);
+        if(nHeight >= 0 && nHeight != chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Historical calls need -callcontractthreads");
+        if(!globalState->addressInUse(addrAccount))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
+        execResults = CallContract(addrAccount, ParseHex(data), senderAddress, gasLimit, profiler ? profiler->Hook() : OnOpFunc());
+        if(profiler)
+            profiler->Finish();
+    }
 
     if(fRecordLogOpcodes){
+        LOCK(cs_main);
         writeVMlog(execResults);
     }
 
@@ -2898,6 +2930,8 @@ UniValue callcontract(const UniValue& params, bool fHelp)
     result.push_back(Pair("address", strAddr));
     result.push_back(Pair("executionResult", executionResultToJSON(execResults[0].execRes)));
     result.push_back(Pair("transactionReceipt", transactionReceiptToJSON(execResults[0].txRec)));
+    if(profiler)
+        result.push_back(Pair("trace", profiler->ToJSON()));
 
     return result;
 }
@@ -2908,9 +2942,9 @@ UniValue createcontract(const UniValue& params, bool fHelp){
         return NullUniValue;
 
     LOCK2(cs_main, pwalletMain->cs_wallet);
-    LuxDGP luxDGP(globalState.get(), fGettingValuesDGP);
-    uint64_t blockGasLimit = luxDGP.getBlockGasLimit(chainActive.Height());
-    uint64_t minGasPrice = CAmount(luxDGP.getMinGasPrice(chainActive.Height()));
+    const LuxDGPParams& dgpParams = GetTipDGPParams(chainActive.Height());
+    uint64_t blockGasLimit = dgpParams.blockGasLimit;
+    uint64_t minGasPrice = CAmount(dgpParams.minGasPrice);
     CAmount nGasPrice = (minGasPrice>DEFAULT_GAS_PRICE)?minGasPrice:DEFAULT_GAS_PRICE;
 
     if (fHelp || params.size() < 1 || params.size() > 6)
@@ -3116,9 +3150,9 @@ UniValue sendtocontract(const UniValue& params, bool fHelp){
         return NullUniValue;
 
     LOCK2(cs_main, pwalletMain->cs_wallet);
-    LuxDGP luxDGP(globalState.get(), fGettingValuesDGP);
-    uint64_t blockGasLimit = luxDGP.getBlockGasLimit(chainActive.Height());
-    uint64_t minGasPrice = CAmount(luxDGP.getMinGasPrice(chainActive.Height()));
+    const LuxDGPParams& dgpParams = GetTipDGPParams(chainActive.Height());
+    uint64_t blockGasLimit = dgpParams.blockGasLimit;
+    uint64_t minGasPrice = CAmount(dgpParams.minGasPrice);
     CAmount nGasPrice = (minGasPrice>DEFAULT_GAS_PRICE)?minGasPrice:DEFAULT_GAS_PRICE;
 
     if (fHelp || params.size() < 2 || params.size() > 8)
@@ -921,7 +921,9 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                         //serror is set
                         return false;
                     }
-                    bool fSuccess = checker.CheckSig(vchSig, vchPubKey, scriptCode, sigversion, flags);
+                    bool fRequired = opcode == OP_CHECKSIGVERIFY || ((flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size());
+                    bool fSuccess = fRequired ? checker.CheckSigRequired(vchSig, vchPubKey, scriptCode, sigversion, flags)
+                                              : checker.CheckSig(vchSig, vchPubKey, scriptCode, sigversion, flags);
 
                     if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size())
                         return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
@@ -1295,20 +1297,31 @@ bool BaseSignatureChecker::VerifySignature(const std::vector<uint8_t>& vchSig, c
     }
 }
 
-bool TransactionSignatureChecker::CheckSig(const vector<unsigned char>& vchSigIn, const vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, uint32_t flags) const
+bool TransactionSignatureChecker::PrepareSignature(const vector<unsigned char>& vchSigIn, const vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion,
+                                                   CPubKey& pubkey, vector<unsigned char>& vchSig, uint256& sighash) const
 {
-    CPubKey pubkey(vchPubKey);
+    pubkey.Set(vchPubKey.begin(), vchPubKey.end());
     if (!pubkey.IsValid())
         return false;
 
     // Hash type is one byte tacked on to the end of the signature
-    vector<unsigned char> vchSig(vchSigIn);
+    vchSig = vchSigIn;
     if (vchSig.empty())
         return false;
     int nHashType = vchSig.back();
     vchSig.pop_back();
 
-    uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, sigversion, this->txdata);
+    sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, sigversion, this->txdata);
+    return true;
+}
+
+bool TransactionSignatureChecker::CheckSig(const vector<unsigned char>& vchSigIn, const vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, uint32_t flags) const
+{
+    CPubKey pubkey;
+    vector<unsigned char> vchSig;
+    uint256 sighash;
+    if (!PrepareSignature(vchSigIn, vchPubKey, scriptCode, sigversion, pubkey, vchSig, sighash))
+        return false;
 
     if (!VerifySignature(vchSig, pubkey, sighash, flags))
         return false;
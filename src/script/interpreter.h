@@ -156,6 +156,15 @@ public:
         return false;
     }
 
+    //! Same as CheckSig, for a signature whose failure fails the script: CHECKSIGVERIFY, or a non-empty
+    //! CHECKSIG signature under NULLFAIL. Only an invalid script has such a signature fail, so a checker
+    //! may take it as valid for now and confirm it later. CHECKMULTISIG never comes through here, as it
+    //! tries signatures against keys they do not belong to.
+    virtual bool CheckSigRequired(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, uint32_t flags) const
+    {
+        return CheckSig(scriptSig, vchPubKey, scriptCode, sigversion, flags);
+    }
+
     virtual bool CheckLockTime(const CScriptNum& nLockTime) const
     {
          return false;
@@ -177,6 +186,11 @@ private:
     const CAmount amount;
     const PrecomputedTransactionData* txdata;
 
+protected:
+    //! Split a CHECKSIG signature from its hash type and compute what it signs; false if it cannot be valid
+    bool PrepareSignature(const std::vector<unsigned char>& vchSigIn, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion,
+                          CPubKey& pubkey, std::vector<unsigned char>& vchSig, uint256& sighash) const;
+
 public:
     TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(nullptr) {}
     TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(&txdataIn) {}
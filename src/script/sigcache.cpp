@@ -116,12 +116,80 @@ void InitSignatureCache()
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+void CSignatureBatch::Add(const CPubKey& pubkey, const uint256& sighash, const std::vector<unsigned char>& vchSig, const uint256& entry, bool store)
+{
+    vPubKeys.push_back(pubkey);
+    vHashes.push_back(sighash);
+    vSigs.push_back(vchSig);
+    vEntries.push_back(store ? entry : uint256());
+}
+
+void CSignatureBatch::Truncate(size_t nSize)
+{
+    if (nSize >= vSigs.size())
+        return;
+    vPubKeys.resize(nSize);
+    vHashes.resize(nSize);
+    vSigs.resize(nSize);
+    vEntries.resize(nSize);
+}
+
+bool CSignatureBatch::Verify(size_t nBegin, size_t nEnd)
+{
+    assert(nBegin <= nEnd && nEnd <= vSigs.size());
+    bool fOk;
+    if (nBegin == nEnd) {
+        fOk = true;
+    } else if (nBegin == 0 && nEnd == vSigs.size()) {
+        fOk = CPubKey::VerifySchnorrBatch(vPubKeys, vHashes, vSigs);
+    } else {
+        fOk = CPubKey::VerifySchnorrBatch(std::vector<CPubKey>(vPubKeys.begin() + nBegin, vPubKeys.begin() + nEnd),
+                                          std::vector<uint256>(vHashes.begin() + nBegin, vHashes.begin() + nEnd),
+                                          std::vector<std::vector<unsigned char> >(vSigs.begin() + nBegin, vSigs.begin() + nEnd));
+    }
+    if (fOk) {
+        for (size_t i = nBegin; i < nEnd; i++)
+            if (!vEntries[i].IsNull())
+                signatureCache.Set(vEntries[i]);
+    }
+    return fOk;
+}
+
+bool CSignatureBatch::Verify()
+{
+    bool fOk = Verify(0, vSigs.size());
+    Truncate(0);
+    return fOk;
+}
+
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash, uint32_t flags) const
+{
+    return VerifySignature(vchSig, pubkey, sighash, flags, false);
+}
+
+bool CachingTransactionSignatureChecker::CheckSigRequired(const std::vector<unsigned char>& vchSigIn, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, uint32_t flags) const
+{
+    CPubKey pubkey;
+    std::vector<unsigned char> vchSig;
+    uint256 sighash;
+    if (!PrepareSignature(vchSigIn, vchPubKey, scriptCode, sigversion, pubkey, vchSig, sighash))
+        return false;
+    return VerifySignature(vchSig, pubkey, sighash, flags, true);
+}
+
+bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash, uint32_t flags, bool fDefer) const
 {
     uint256 entry;
     signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey, flags);
     if (signatureCache.Get(entry, !store))
         return true;
+    // Schnorr signatures the script cannot pass without are assumed valid for now
+    // and checked later with the rest of the batch; if that check fails, the
+    // caller re-runs the scripts that added to it without a batch.
+    if (fDefer && batch && (flags & SCRIPT_ENABLE_SCHNORR) && vchSig.size() == 64 && pubkey.IsValid()) {
+        batch->Add(pubkey, sighash, vchSig, entry, store);
+        return true;
+    }
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash, flags))
         return false;
     if (store)
@@ -6,7 +6,9 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include <pubkey.h>
 #include <script/interpreter.h>
+#include <uint256.h>
 
 #include <vector>
 
@@ -38,15 +40,50 @@ public:
     }
 };
 
+/**
+ * Schnorr signatures whose verification has been deferred, so that they can
+ * be checked together with one multi-scalar multiplication. Signatures that
+ * pass are added to the signature cache.
+ */
+class CSignatureBatch
+{
+private:
+    std::vector<CPubKey> vPubKeys;
+    std::vector<uint256> vHashes;
+    std::vector<std::vector<unsigned char> > vSigs;
+    //! Signature cache entries, only set for signatures that should be stored
+    std::vector<uint256> vEntries;
+
+public:
+    void Add(const CPubKey& pubkey, const uint256& sighash, const std::vector<unsigned char>& vchSig, const uint256& entry, bool store);
+
+    //! Drop all signatures added after the first nSize ones
+    void Truncate(size_t nSize);
+
+    //! Verify the signatures in [nBegin, nEnd) and cache those that pass, keeping the batch
+    bool Verify(size_t nBegin, size_t nEnd);
+
+    //! Verify all pending signatures and clear the batch
+    bool Verify();
+
+    size_t size() const { return vSigs.size(); }
+    bool empty() const { return vSigs.empty(); }
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
     bool store;
+    CSignatureBatch* batch;
+
+    //! VerifySignature, leaving Schnorr signatures to the batch if fDefer
+    bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash, uint32_t flags, bool fDefer) const;
 
 public:
-    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn), store(storeIn) {}
+    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn, CSignatureBatch* batchIn = nullptr) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn), store(storeIn), batch(batchIn) {}
 
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash, uint32_t flags) const override;
+    bool CheckSigRequired(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, uint32_t flags) const override;
 };
 
 void InitSignatureCache();
@@ -23,6 +23,29 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorr_verify(
   const secp256k1_pubkey *pubkey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/**
+ * Verify a batch of signatures created by secp256k1_schnorr_sign.
+ *
+ * All signatures are checked together with a single multi-scalar
+ * multiplication, using random weights derived from the inputs. A result of 0
+ * does not tell which signature is invalid; callers that need to know have to
+ * fall back to secp256k1_schnorr_verify for each entry.
+ * Returns: 1: all signatures are correct (or n_sigs is 0)
+ *          0: at least one signature is incorrect
+ * Args:    ctx:       a secp256k1 context object, initialized for verification.
+ * In:      sig64:     array of n_sigs pointers to 64-byte signatures
+ *          msg32:     array of n_sigs pointers to 32-byte message hashes
+ *          pubkeys:   array of n_sigs pointers to public keys
+ *          n_sigs:    number of signatures in the batch
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorr_verify_batch(
+  const secp256k1_context* ctx,
+  const unsigned char *const *sig64,
+  const unsigned char *const *msg32,
+  const secp256k1_pubkey *const *pubkeys,
+  size_t n_sigs
+) SECP256K1_ARG_NONNULL(1);
+
 /**
  * Create a signature using a custom EC-Schnorr-SHA256 construction. It
  * produces non-malleable 64-byte signatures which support batch validation,
@@ -27,6 +27,34 @@
     return secp256k1_schnorr_sig_verify(&ctx->ecmult_ctx, sig64, &q, msg32);
 }
 
+ int secp256k1_schnorr_verify_batch(
+    const secp256k1_context* ctx,
+    const unsigned char *const *sig64,
+    const unsigned char *const *msg32,
+    const secp256k1_pubkey *const *pubkeys,
+    size_t n_sigs
+) {
+    secp256k1_ge *q;
+    size_t i;
+    int ret;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    if (n_sigs == 0) {
+        return 1;
+    }
+    ARG_CHECK(sig64 != NULL);
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(pubkeys != NULL);
+
+    q = (secp256k1_ge*)checked_malloc(&ctx->error_callback, sizeof(secp256k1_ge) * n_sigs);
+    for (i = 0; i < n_sigs; i++) {
+        secp256k1_pubkey_load(ctx, &q[i], pubkeys[i]);
+    }
+    ret = secp256k1_schnorr_sig_verify_batch(&ctx->ecmult_ctx, &ctx->error_callback, sig64, q, msg32, n_sigs);
+    free(q);
+    return ret;
+}
+
  int secp256k1_schnorr_sign(
     const secp256k1_context *ctx,
     unsigned char *sig64,
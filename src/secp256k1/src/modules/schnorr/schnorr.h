@@ -17,6 +17,15 @@
     const unsigned char *msg32
 );
 
+ static int secp256k1_schnorr_sig_verify_batch(
+    const secp256k1_ecmult_context* ctx,
+    const secp256k1_callback* cb,
+    const unsigned char *const *sig64,
+    secp256k1_ge *pubkeys,
+    const unsigned char *const *msg32,
+    size_t n
+);
+
  static int secp256k1_schnorr_compute_e(
     secp256k1_scalar* res,
     const unsigned char *r,
@@ -100,6 +100,200 @@ static int secp256k1_schnorr_sig_verify(
     return 1;
 }
 
+ /**
+ * Compute r = sum(sc[i] * pts[i]) with Strauss' algorithm: every point gets
+ * its own table of odd multiples, but all of them share a single chain of
+ * doublings, which is where the saving over n separate ecmults comes from.
+ */
+static void secp256k1_schnorr_ecmult_multi_var(
+    const secp256k1_callback* cb,
+    secp256k1_gej *r,
+    const secp256k1_ge *pts,
+    const secp256k1_scalar *sc,
+    size_t n
+) {
+    secp256k1_gej prej[ECMULT_TABLE_SIZE(WINDOW_A)];
+    secp256k1_fe zr[ECMULT_TABLE_SIZE(WINDOW_A)];
+    secp256k1_ge tmpa;
+    secp256k1_gej tmpj;
+    secp256k1_ge *pre;
+    secp256k1_fe *globalz;
+    secp256k1_fe *globalzi;
+    int *wnaf;
+    int *nbits;
+    int bits = 0;
+    int i;
+    size_t j, k;
+
+    secp256k1_gej_set_infinity(r);
+    if (n == 0) {
+        return;
+    }
+
+    pre = (secp256k1_ge*)checked_malloc(cb, sizeof(secp256k1_ge) * ECMULT_TABLE_SIZE(WINDOW_A) * n);
+    globalz = (secp256k1_fe*)checked_malloc(cb, sizeof(secp256k1_fe) * n);
+    globalzi = (secp256k1_fe*)checked_malloc(cb, sizeof(secp256k1_fe) * n);
+    wnaf = (int*)checked_malloc(cb, sizeof(int) * 256 * n);
+    nbits = (int*)checked_malloc(cb, sizeof(int) * n);
+
+    /* Build each table on its own Z denominator, then make all of them
+     * affine with a single batched field inversion. */
+    for (j = 0; j < n; j++) {
+        secp256k1_gej a;
+        secp256k1_gej_set_ge(&a, &pts[j]);
+        secp256k1_ecmult_odd_multiples_table(ECMULT_TABLE_SIZE(WINDOW_A), prej, zr, &a);
+        secp256k1_ge_globalz_set_table_gej(ECMULT_TABLE_SIZE(WINDOW_A), &pre[j * ECMULT_TABLE_SIZE(WINDOW_A)], &globalz[j], prej, zr);
+        nbits[j] = secp256k1_ecmult_wnaf(&wnaf[j * 256], 256, &sc[j], WINDOW_A);
+        if (nbits[j] > bits) {
+            bits = nbits[j];
+        }
+    }
+    secp256k1_fe_inv_all_var(globalzi, globalz, n);
+    for (j = 0; j < n; j++) {
+        for (k = 0; k < ECMULT_TABLE_SIZE(WINDOW_A); k++) {
+            secp256k1_ge *p = &pre[j * ECMULT_TABLE_SIZE(WINDOW_A) + k];
+            tmpj.x = p->x;
+            tmpj.y = p->y;
+            tmpj.infinity = 0;
+            secp256k1_ge_set_gej_zinv(p, &tmpj, &globalzi[j]);
+        }
+    }
+
+    for (i = bits - 1; i >= 0; i--) {
+        int m;
+        secp256k1_gej_double_var(r, r, NULL);
+        for (j = 0; j < n; j++) {
+            if (i < nbits[j] && (m = wnaf[j * 256 + i])) {
+                ECMULT_TABLE_GET_GE(&tmpa, &pre[j * ECMULT_TABLE_SIZE(WINDOW_A)], m, WINDOW_A);
+                secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+            }
+        }
+    }
+
+    free(nbits);
+    free(wnaf);
+    free(globalzi);
+    free(globalz);
+    free(pre);
+}
+
+ /**
+ * Batch verification (option 2 above) of n signatures.
+ *
+ * With random weights a_i (a_0 = 1) the batch is valid iff
+ *   (sum a_i * s_i) * G - sum a_i * R_i - sum (a_i * e_i) * P_i == 0.
+ * The weights are derived from a hash of every input, so a set of invalid
+ * signatures cannot be chosen to cancel each other out.
+ *
+ * The G term and the first public key go through secp256k1_ecmult, which uses
+ * the precomputed G table; every other point is handled by a single Strauss
+ * multiplication.
+ */
+static int secp256k1_schnorr_sig_verify_batch(
+    const secp256k1_ecmult_context* ctx,
+    const secp256k1_callback* cb,
+    const unsigned char *const *sig64,
+    secp256k1_ge *pubkeys,
+    const unsigned char *const *msg32,
+    size_t n
+) {
+    secp256k1_sha256_t sha;
+    unsigned char seed[32];
+    unsigned char buf[36];
+    secp256k1_scalar sg, a, e, e0, s;
+    secp256k1_gej Pj, Aj, Rj;
+    secp256k1_fe Rx;
+    secp256k1_ge *pts;
+    secp256k1_scalar *sc;
+    size_t i, size;
+    int overflow;
+    int ret = 0;
+
+    if (n == 0) {
+        return 1;
+    }
+
+    /* Seed the weights with all signatures, messages and public keys. */
+    secp256k1_sha256_initialize(&sha);
+    for (i = 0; i < n; i++) {
+        if (secp256k1_ge_is_infinity(&pubkeys[i])) {
+            return 0;
+        }
+        secp256k1_sha256_write(&sha, sig64[i], 64);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+        if (!secp256k1_eckey_pubkey_serialize(&pubkeys[i], buf, &size, 1)) {
+            return 0;
+        }
+        secp256k1_sha256_write(&sha, buf, 33);
+    }
+    secp256k1_sha256_finalize(&sha, seed);
+
+    /* pts holds R_0..R_{n-1} followed by P_1..P_{n-1}. */
+    pts = (secp256k1_ge*)checked_malloc(cb, sizeof(secp256k1_ge) * (2 * n - 1));
+    sc = (secp256k1_scalar*)checked_malloc(cb, sizeof(secp256k1_scalar) * (2 * n - 1));
+
+    secp256k1_scalar_clear(&sg);
+    for (i = 0; i < n; i++) {
+        /* Extract s */
+        overflow = 0;
+        secp256k1_scalar_set_b32(&s, sig64[i] + 32, &overflow);
+        if (overflow) {
+            goto done;
+        }
+
+        /* Extract R.x and decompress it into R, with R.y a quadratic residue */
+        if (!secp256k1_fe_set_b32(&Rx, sig64[i])) {
+            goto done;
+        }
+        if (!secp256k1_ge_set_xquad(&pts[i], &Rx)) {
+            goto done;
+        }
+
+        /* Compute e */
+        secp256k1_schnorr_compute_e(&e, sig64[i], &pubkeys[i], msg32[i]);
+
+        /* Compute the weight a_i */
+        if (i == 0) {
+            secp256k1_scalar_set_int(&a, 1);
+        } else {
+            memcpy(buf, seed, 32);
+            buf[32] = i >> 24;
+            buf[33] = i >> 16;
+            buf[34] = i >> 8;
+            buf[35] = i;
+            secp256k1_sha256_initialize(&sha);
+            secp256k1_sha256_write(&sha, buf, 36);
+            secp256k1_sha256_finalize(&sha, buf);
+            secp256k1_scalar_set_b32(&a, buf, NULL);
+        }
+
+        /* Accumulate a_i * s_i for G, and -a_i, -a_i * e_i for R_i, P_i */
+        secp256k1_scalar_mul(&s, &s, &a);
+        secp256k1_scalar_add(&sg, &sg, &s);
+        secp256k1_scalar_negate(&sc[i], &a);
+        secp256k1_scalar_mul(&e, &e, &a);
+        secp256k1_scalar_negate(&e, &e);
+        if (i == 0) {
+            e0 = e;
+        } else {
+            pts[n + i - 1] = pubkeys[i];
+            sc[n + i - 1] = e;
+        }
+    }
+
+    secp256k1_gej_set_ge(&Pj, &pubkeys[0]);
+    secp256k1_ecmult(ctx, &Aj, &Pj, &e0, &sg);
+
+    secp256k1_schnorr_ecmult_multi_var(cb, &Rj, pts, sc, 2 * n - 1);
+    secp256k1_gej_add_var(&Rj, &Rj, &Aj, NULL);
+    ret = secp256k1_gej_is_infinity(&Rj);
+
+done:
+    free(sc);
+    free(pts);
+    return ret;
+}
+
  static int secp256k1_schnorr_compute_e(
     secp256k1_scalar* e,
     const unsigned char *r,
@@ -75,6 +75,48 @@
     }
 }
 
+void test_schnorr_verify_batch(void) {
+    unsigned char privkey[SIG_COUNT][32];
+    unsigned char message[SIG_COUNT][32];
+    unsigned char sig[SIG_COUNT][64];
+    secp256k1_pubkey pubkey[SIG_COUNT];
+    const unsigned char *psig[SIG_COUNT];
+    const unsigned char *pmsg[SIG_COUNT];
+    const secp256k1_pubkey *ppub[SIG_COUNT];
+    int i, n;
+
+    for (i = 0; i < SIG_COUNT; i++) {
+        secp256k1_scalar key;
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(privkey[i], &key);
+        secp256k1_rand256_test(message[i]);
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pubkey[i], privkey[i]) == 1);
+        CHECK(secp256k1_schnorr_sign(ctx, sig[i], message[i], privkey[i], NULL, NULL) == 1);
+        psig[i] = sig[i];
+        pmsg[i] = message[i];
+        ppub[i] = &pubkey[i];
+    }
+
+    CHECK(secp256k1_schnorr_verify_batch(ctx, NULL, NULL, NULL, 0) == 1);
+    for (n = 1; n <= SIG_COUNT; n++) {
+        int pos = secp256k1_rand_bits(6);
+        int mod = 1 + secp256k1_rand_int(255);
+        int bad = secp256k1_rand_int(n);
+
+        CHECK(secp256k1_schnorr_verify_batch(ctx, psig, pmsg, ppub, n) == 1);
+
+        /* A single bad signature anywhere fails the whole batch. */
+        sig[bad][pos] ^= mod;
+        CHECK(secp256k1_schnorr_verify_batch(ctx, psig, pmsg, ppub, n) == 0);
+        sig[bad][pos] ^= mod;
+
+        /* So does a signature checked against the wrong message. */
+        pmsg[bad] = message[(bad + 1) % SIG_COUNT];
+        CHECK(secp256k1_schnorr_verify_batch(ctx, psig, pmsg, ppub, n) == 0);
+        pmsg[bad] = message[bad];
+    }
+}
+
  #undef SIG_COUNT
 
  void run_schnorr_compact_test(void) {
@@ -515,6 +557,7 @@
     }
 
      test_schnorr_sign_verify();
+    test_schnorr_verify_batch();
     run_schnorr_compact_test();
 }
 
@@ -314,6 +314,11 @@ struct CAddressIndexIteratorKey {
         ser_writedata8(s, hashType);
         hashBytes.Serialize(s, nType, nVersion);
     }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        hashType = ser_readdata8(s);
+        hashBytes.Unserialize(s, nType, nVersion);
+    }
 
     CAddressIndexIteratorKey(uint16_t addressType, uint160 addressHash) {
         hashBytes = addressHash;
@@ -364,5 +369,148 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+// DB_ADDRESSBALANCE value, running totals of the DB_ADDRESSINDEX entries of an address
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+    CAmount sent;
+    CAmount spent;
+    CAmount staked;
+    int64_t deltas;
+    int64_t txCount;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(sent);
+        READWRITE(spent);
+        READWRITE(staked);
+        READWRITE(deltas);
+        READWRITE(txCount);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = received = sent = spent = staked = 0;
+        deltas = txCount = 0;
+    }
+
+    bool IsNull() const {
+        return (deltas == 0);
+    }
+
+    CAddressBalanceValue& operator+=(const CAddressBalanceValue& b) {
+        balance += b.balance;
+        received += b.received;
+        sent += b.sent;
+        spent += b.spent;
+        staked += b.staked;
+        deltas += b.deltas;
+        txCount += b.txCount;
+        return *this;
+    }
+
+    CAddressBalanceValue& operator-=(const CAddressBalanceValue& b) {
+        balance -= b.balance;
+        received -= b.received;
+        sent -= b.sent;
+        spent -= b.spent;
+        staked -= b.staked;
+        deltas -= b.deltas;
+        txCount -= b.txCount;
+        return *this;
+    }
+};
+
+// DB_ADDRESSBALANCEUNDO value, what was added to the balances for the block at a height
+struct CAddressBalanceUndo {
+    uint256 hashBlock;
+    std::vector<std::pair<CAddressIndexIteratorKey, CAddressBalanceValue> > vDeltas;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(hashBlock);
+        READWRITE(vDeltas);
+    }
+
+    CAddressBalanceUndo() {
+        SetNull();
+    }
+
+    void SetNull() {
+        hashBlock.SetNull();
+        vDeltas.clear();
+    }
+};
+
+// Sums the DB_ADDRESSINDEX entries of one address, fed in key order
+struct CAddressBalanceAccumulator {
+    CAddressBalanceValue value;
+    uint256 lastStakeHash;
+    uint256 lastSpentHash;
+    uint256 lastTxHash;
+
+    CAddressBalanceAccumulator() : lastStakeHash(uint256(-1)), lastSpentHash(uint256(-1)), lastTxHash(uint256(-1)) {}
+
+    void Add(const CAddressIndexKey& key, CAmount amount) {
+        value.balance += amount;
+        value.deltas++;
+        if (key.txhash != lastTxHash) {
+            value.txCount++;
+            lastTxHash = key.txhash;
+        }
+
+        if (amount > 0) {
+            // outputs
+            value.received += amount;
+            if (key.txhash == lastStakeHash) {
+                value.staked += amount;
+            } else if (key.txhash == lastSpentHash) {
+                // sent to same address
+                value.sent += amount;
+            }
+        } else {
+            // inputs
+            if (key.spentFlags & ANDX_IS_STAKE) {
+                value.staked += amount;
+                lastStakeHash = key.txhash;
+            } else {
+                value.sent += amount;
+                value.spent += amount;
+                lastSpentHash = key.txhash;
+            }
+        }
+    }
+};
+
+// DB_ADDRESSINDEX key order within one address
+struct CAddressIndexKeyCompare
+{
+    bool operator()(const CAddressIndexKey& a, const CAddressIndexKey& b) const {
+        if (a.hashType != b.hashType)
+            return a.hashType < b.hashType;
+        if (a.hashBytes != b.hashBytes)
+            return a.hashBytes < b.hashBytes;
+        if (a.blockHeight != b.blockHeight)
+            return a.blockHeight < b.blockHeight;
+        if (a.blockIndex != b.blockIndex)
+            return a.blockIndex < b.blockIndex;
+        if (a.indexType != b.indexType)
+            return a.indexType < b.indexType;
+        if (a.indexInOut != b.indexInOut)
+            return a.indexInOut < b.indexInOut;
+        if (a.spentFlags != b.spentFlags)
+            return a.spentFlags < b.spentFlags;
+        return a.txhash < b.txhash;
+    }
+};
 
 #endif // BITCOIN_SPENTINDEX_H
@@ -173,10 +173,11 @@ static bool FindModifierBlockFromCandidates(vector <pair<int64_t, uint256>>& vSo
     pindexSelected = nullptr;
 
     for (auto& item : vSortedCandidates) {
-        if (!mapBlockIndex.count(item.second))
+        BlockMap::const_iterator mi = mapBlockIndex.find(item.second);
+        if (mi == mapBlockIndex.end())
             return error("%s: invalid candidate block %s", __func__, item.second.GetHex());
 
-        const CBlockIndex* pindex = mapBlockIndex[item.second];
+        const CBlockIndex* pindex = mi->second;
         if (pindex->IsProofOfStake() && pindex->hashProofOfStake == 0) {
             return error("%s: zero stake (block %s)", __func__, item.second.GetHex());
         }
@@ -340,10 +341,11 @@ bool Stake::ComputeNextModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeM
 bool GetKernelStakeModifier(uint256 hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake)
 {
     nStakeModifier = 0;
-    if (!mapBlockIndex.count(hashBlockFrom))
+    BlockMap::const_iterator mi = mapBlockIndex.find(hashBlockFrom);
+    if (mi == mapBlockIndex.end())
         return error("GetKernelStakeModifier() : block not indexed");
 
-    const CBlockIndex* pindexFrom = mapBlockIndex[hashBlockFrom];
+    const CBlockIndex* pindexFrom = mi->second;
     nStakeModifierHeight = pindexFrom->nHeight;
     nStakeModifierTime = pindexFrom->GetBlockTime();
 
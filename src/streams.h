@@ -293,6 +293,52 @@ public:
         data.insert(data.end(), begin(), end());
         clear();
     }
+
+    /** Exchange the unread data with the contents of data, without copying either */
+    void Swap(CSerializeData& data)
+    {
+        Compact();
+        vch.swap(data);
+    }
+};
+
+
+/** Read-only stream over serialized data owned by someone else, to deserialize
+ *  from a buffer that has to stay intact afterwards.
+ */
+class CBufferReader
+{
+private:
+    const char* pbegin;
+    const char* pend;
+
+public:
+    int nType;
+    int nVersion;
+
+    CBufferReader(const char* pbeginIn, const char* pendIn, int nTypeIn, int nVersionIn) : pbegin(pbeginIn), pend(pendIn), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    size_t size() const { return pend - pbegin; }
+    bool empty() const { return pbegin == pend; }
+    int GetType() { return nType; }
+    int GetVersion() { return nVersion; }
+
+    CBufferReader& read(char* pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CBufferReader::read() : end of data");
+        memcpy(pch, pbegin, nSize);
+        pbegin += nSize;
+        return (*this);
+    }
+
+    template <typename T>
+    CBufferReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
 };
 
 
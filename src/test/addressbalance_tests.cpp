@@ -0,0 +1,56 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "amount.h"
+#include "spentindex.h"
+#include "txdb.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressbalance_tests)
+
+BOOST_AUTO_TEST_CASE(addressbalance_connect_idempotent)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 addr(std::string("2d8ba8d0ca8f9a9a1f4f7f2a1fb2c1a2d8f6d3c1"));
+    uint256 hashBlock(10), hashOther(11);
+
+    // An output of 5 and an input of 2 in the block at height 100
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vect;
+    vect.push_back(std::make_pair(CAddressIndexKey(1, addr, 100, 1, uint256(1), 0, 0), 5 * COIN));
+    vect.push_back(std::make_pair(CAddressIndexKey(1, addr, 100, 2, uint256(2), 0, ANDX_IS_SPENT), -2 * COIN));
+    BOOST_CHECK(db.WriteAddressIndex(vect));
+
+    // Connecting the same block again, as after an unclean shutdown, counts it once
+    BOOST_CHECK(db.ConnectAddressBalances(vect, 100, hashBlock));
+    BOOST_CHECK(db.ConnectAddressBalances(vect, 100, hashBlock));
+    CAddressBalanceValue value;
+    BOOST_CHECK(db.ReadAddressBalance(addr, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 3 * COIN);
+    BOOST_CHECK_EQUAL(value.received, 5 * COIN);
+    BOOST_CHECK_EQUAL(value.deltas, 2);
+    BOOST_CHECK_EQUAL(value.txCount, 2);
+
+    // So does disconnecting it twice
+    BOOST_CHECK(db.DisconnectAddressBalances(vect, 100, hashBlock));
+    BOOST_CHECK(db.DisconnectAddressBalances(vect, 100, hashBlock));
+    BOOST_CHECK(db.ReadAddressBalance(addr, 1, value));
+    BOOST_CHECK(value.IsNull());
+
+    // A block of another branch counted at the same height and never disconnected is replaced
+    BOOST_CHECK(db.ConnectAddressBalances(vect, 100, hashBlock));
+    std::vector<std::pair<CAddressIndexKey, CAmount> > other;
+    other.push_back(std::make_pair(CAddressIndexKey(1, addr, 100, 1, uint256(3), 0, 0), 7 * COIN));
+    BOOST_CHECK(db.ConnectAddressBalances(other, 100, hashOther));
+    BOOST_CHECK(db.ReadAddressBalance(addr, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 7 * COIN);
+    BOOST_CHECK_EQUAL(value.deltas, 1);
+
+    CAddressBalanceUndo undo;
+    BOOST_CHECK(db.ReadAddressBalanceUndo(100, undo));
+    BOOST_CHECK(undo.hashBlock == hashOther);
+    BOOST_CHECK_EQUAL(undo.vDeltas.size(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,179 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "amount.h"
+#include "script/script.h"
+#include "spentindex.h"
+#include "txdb.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+/** An address of the given type whose key sorts by n among those of its type */
+static std::pair<uint160, uint16_t> TestAddress(uint16_t type, unsigned char n)
+{
+    uint160 addr;
+    *addr.begin() = n;
+    return std::make_pair(addr, type);
+}
+
+/** Entries as they are stored, so that the results of different readers can be compared */
+template <typename Vector>
+static std::string Serialized(const Vector& vect)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    for (const auto& entry : vect)
+        ss << entry.first << entry.second;
+    return ss.str();
+}
+
+/**
+ * Index entries of a, its neighbours b and f, and d, which has the same hash as a but
+ * another type. e has no entries.
+ */
+struct AddressIndexSetup {
+    CBlockTreeDB db;
+    std::pair<uint160, uint16_t> a, b, d, e, f;
+
+    AddressIndexSetup() : db(1 << 20, true), a(TestAddress(1, 1)), b(TestAddress(1, 2)), d(TestAddress(2, 1)), e(TestAddress(1, 4)), f(TestAddress(1, 5))
+    {
+        AddressIndexVector vect;
+        // a receives and spends in the same transaction at height 10
+        vect.push_back(std::make_pair(CAddressIndexKey(a.second, a.first, 10, 1, uint256(1), 0, 0), 5 * COIN));
+        vect.push_back(std::make_pair(CAddressIndexKey(a.second, a.first, 10, 1, uint256(1), 0, ANDX_IS_SPENT), -3 * COIN));
+        vect.push_back(std::make_pair(CAddressIndexKey(a.second, a.first, 20, 3, uint256(2), 1, 0), 2 * COIN));
+        vect.push_back(std::make_pair(CAddressIndexKey(a.second, a.first, 30, 1, uint256(3), 0, 0), 1 * COIN));
+        vect.push_back(std::make_pair(CAddressIndexKey(b.second, b.first, 15, 2, uint256(4), 0, 0), 4 * COIN));
+        vect.push_back(std::make_pair(CAddressIndexKey(b.second, b.first, 20, 3, uint256(2), 0, 0), 6 * COIN));
+        vect.push_back(std::make_pair(CAddressIndexKey(d.second, d.first, 25, 1, uint256(5), 0, 0), 7 * COIN));
+        vect.push_back(std::make_pair(CAddressIndexKey(f.second, f.first, 12, 1, uint256(6), 0, 0), 8 * COIN));
+        BOOST_CHECK(db.WriteAddressIndex(vect));
+
+        AddressUnspentVector unspent;
+        unspent.push_back(std::make_pair(CAddressUnspentKey(a.second, a.first, uint256(2), 1), CAddressUnspentValue(2 * COIN, CScript() << OP_1, 20)));
+        unspent.push_back(std::make_pair(CAddressUnspentKey(a.second, a.first, uint256(3), 0), CAddressUnspentValue(1 * COIN, CScript() << OP_1, 30)));
+        unspent.push_back(std::make_pair(CAddressUnspentKey(a.second, a.first, uint256(7), 2), CAddressUnspentValue(3 * COIN, CScript() << OP_1, 31)));
+        unspent.push_back(std::make_pair(CAddressUnspentKey(b.second, b.first, uint256(4), 0), CAddressUnspentValue(4 * COIN, CScript() << OP_2, 15)));
+        unspent.push_back(std::make_pair(CAddressUnspentKey(d.second, d.first, uint256(5), 0), CAddressUnspentValue(7 * COIN, CScript() << OP_3, 25)));
+        unspent.push_back(std::make_pair(CAddressUnspentKey(f.second, f.first, uint256(6), 0), CAddressUnspentValue(8 * COIN, CScript() << OP_4, 12)));
+        BOOST_CHECK(db.UpdateAddressUnspentIndex(unspent));
+    }
+
+    /** The addresses of a batch in the order the batch readers return them */
+    AddressTypeVector KeyOrder() const
+    {
+        AddressTypeVector order;
+        order.push_back(a);
+        order.push_back(b);
+        order.push_back(e);
+        order.push_back(d);
+        return order;
+    }
+
+    /** Requested out of order, with a duplicate */
+    AddressTypeVector Requested() const
+    {
+        AddressTypeVector addresses;
+        addresses.push_back(d);
+        addresses.push_back(e);
+        addresses.push_back(b);
+        addresses.push_back(a);
+        addresses.push_back(b);
+        return addresses;
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(addressindex_batch_matches_single, AddressIndexSetup)
+{
+    AddressIndexVector batch, single;
+    bool fMore = true;
+    BOOST_CHECK(db.ReadAddressIndexBatch(Requested(), batch, 0, 0, 0, 0, fMore));
+    BOOST_CHECK(!fMore);
+    for (const auto& addr : KeyOrder())
+        BOOST_CHECK(db.ReadAddressIndex(addr.first, addr.second, single));
+    BOOST_CHECK_EQUAL(batch.size(), 7U);
+    BOOST_CHECK_EQUAL(batch.size(), single.size());
+    BOOST_CHECK(Serialized(batch) == Serialized(single));
+
+    // The same within a height range
+    batch.clear();
+    single.clear();
+    BOOST_CHECK(db.ReadAddressIndexBatch(Requested(), batch, 15, 0, 25, 0, fMore));
+    for (const auto& addr : KeyOrder())
+        BOOST_CHECK(db.ReadAddressIndex(addr.first, addr.second, single, 15, 25));
+    BOOST_CHECK_EQUAL(batch.size(), 4U);
+    BOOST_CHECK_EQUAL(batch.size(), single.size());
+    BOOST_CHECK(Serialized(batch) == Serialized(single));
+
+    // Addresses without entries give nothing
+    batch.clear();
+    AddressTypeVector empty;
+    empty.push_back(e);
+    empty.push_back(TestAddress(2, 9));
+    BOOST_CHECK(db.ReadAddressIndexBatch(empty, batch, 0, 0, 0, 0, fMore));
+    BOOST_CHECK(batch.empty());
+    BOOST_CHECK(!fMore);
+
+    // Pages of one entry still end on a transaction boundary and add up to everything
+    AddressTypeVector one(1, a);
+    AddressIndexVector paged;
+    int start = 0;
+    unsigned int startIndex = 0;
+    for (int i = 0; i < 10; i++) {
+        AddressIndexVector page;
+        BOOST_CHECK(db.ReadAddressIndexBatch(one, page, start, startIndex, 0, 1, fMore));
+        paged.insert(paged.end(), page.begin(), page.end());
+        if (!fMore)
+            break;
+        BOOST_CHECK(!page.empty());
+        start = page.back().first.blockHeight;
+        startIndex = page.back().first.blockIndex + 1;
+    }
+    BOOST_CHECK(!fMore);
+    single.clear();
+    BOOST_CHECK(db.ReadAddressIndex(a.first, a.second, single));
+    BOOST_CHECK(Serialized(paged) == Serialized(single));
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_unspent_batch_matches_single, AddressIndexSetup)
+{
+    AddressUnspentVector batch, single;
+    CAddressUnspentKey nextKey(1, uint160(), uint256(1), 1);
+    BOOST_CHECK(db.ReadAddressUnspentIndexBatch(Requested(), batch, NULL, 0, &nextKey));
+    BOOST_CHECK(nextKey.txHash.IsNull());
+    for (const auto& addr : KeyOrder())
+        BOOST_CHECK(db.ReadAddressUnspentIndex(addr.first, addr.second, single));
+    BOOST_CHECK_EQUAL(batch.size(), 5U);
+    BOOST_CHECK_EQUAL(batch.size(), single.size());
+    BOOST_CHECK(Serialized(batch) == Serialized(single));
+
+    // Addresses without outputs give nothing
+    batch.clear();
+    AddressTypeVector empty;
+    empty.push_back(e);
+    empty.push_back(TestAddress(2, 9));
+    BOOST_CHECK(db.ReadAddressUnspentIndexBatch(empty, batch, NULL, 0, &nextKey));
+    BOOST_CHECK(batch.empty());
+    BOOST_CHECK(nextKey.txHash.IsNull());
+
+    // Pages of two, each continuing at the cursor of the last, add up to everything
+    AddressUnspentVector paged;
+    CAddressUnspentKey cursorKey;
+    bool fCursor = false;
+    for (int i = 0; i < 10; i++) {
+        AddressUnspentVector page;
+        BOOST_CHECK(db.ReadAddressUnspentIndexBatch(Requested(), page, fCursor ? &cursorKey : NULL, 2, &nextKey));
+        BOOST_CHECK(page.size() <= 2);
+        paged.insert(paged.end(), page.begin(), page.end());
+        if (nextKey.txHash.IsNull())
+            break;
+        cursorKey = nextKey;
+        fCursor = true;
+    }
+    BOOST_CHECK(nextKey.txHash.IsNull());
+    BOOST_CHECK(Serialized(paged) == Serialized(single));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
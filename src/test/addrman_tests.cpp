@@ -0,0 +1,79 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addrman.h"
+#include "clientversion.h"
+#include "streams.h"
+
+#include <boost/test/unit_test.hpp>
+
+static CAddress MakeAddress(int n)
+{
+    CAddress addr(CService(strprintf("%d.%d.1.1", 100 + n / 256, n % 256), 9999), NODE_NETWORK);
+    addr.nTime = GetAdjustedTime();
+    return addr;
+}
+
+BOOST_AUTO_TEST_SUITE(addrman_tests)
+
+BOOST_AUTO_TEST_CASE(addrman_select_skips_unsuitable)
+{
+    CAddrMan addrman;
+    CNetAddr source("252.2.2.2");
+    BOOST_CHECK(!addrman.Select(true).IsValid());
+
+    // Entries colliding with an earlier one are dropped, the first one always stays
+    for (int i = 0; i < 200; i++)
+        addrman.Add(MakeAddress(i), source);
+    for (int i = 1; i < 20; i++)
+        addrman.Good(MakeAddress(i));
+    CAddrManStats stats = addrman.GetStats();
+    BOOST_CHECK_EQUAL(stats.nNew + stats.nTried, addrman.size());
+    BOOST_CHECK(stats.nTried > 0);
+
+    // With a single entry left untried, only that entry is worth selecting
+    int64_t nNow = GetAdjustedTime();
+    for (int i = 1; i < 200; i++)
+        addrman.Attempt(MakeAddress(i), nNow);
+    for (int i = 0; i < 20; i++)
+        BOOST_CHECK(addrman.Select(true) == MakeAddress(0));
+
+    // Once everything was tried, something is still returned
+    addrman.Attempt(MakeAddress(0), nNow);
+    BOOST_CHECK(addrman.Select(true).IsValid());
+    BOOST_CHECK(addrman.Select(false).IsValid());
+
+    stats = addrman.GetStats();
+    BOOST_CHECK_EQUAL(stats.nSelects, 22U);
+    BOOST_CHECK(stats.nSkipped > 0);
+    BOOST_CHECK(stats.nScans > 0);
+    BOOST_CHECK_EQUAL(stats.nFallbacks, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(addrman_serialize_roundtrip)
+{
+    CAddrMan addrman;
+    CNetAddr source("252.2.2.2");
+    for (int i = 0; i < 500; i++)
+        addrman.Add(MakeAddress(i), source);
+    for (int i = 0; i < 500; i += 7)
+        addrman.Good(MakeAddress(i));
+
+    CDataStream ssPeers(SER_DISK, CLIENT_VERSION);
+    ssPeers << addrman;
+    std::string strFirst = ssPeers.str();
+
+    CAddrMan addrman2;
+    ssPeers >> addrman2;
+    BOOST_CHECK_EQUAL(addrman2.size(), addrman.size());
+    BOOST_CHECK_EQUAL(addrman2.GetStats().nTried, addrman.GetStats().nTried);
+
+    // The reloaded tables serialize to the same bytes
+    CDataStream ssPeers2(SER_DISK, CLIENT_VERSION);
+    ssPeers2 << addrman2;
+    BOOST_CHECK(ssPeers2.str() == strFirst);
+    BOOST_CHECK(addrman2.Select().IsValid());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,157 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2018 The Luxcore developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+#include "clientversion.h"
+#include "lux/luxstate.h"
+#include "lux/luxtransaction.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "script/standard.h"
+#include "streams.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockfilter_tests)
+
+BOOST_AUTO_TEST_CASE(gcsfilter_test)
+{
+    GCSFilter::ElementSet included_elements, excluded_elements;
+    for (int i = 0; i < 100; ++i) {
+        GCSFilter::Element element1(32);
+        element1[0] = i;
+        included_elements.insert(std::move(element1));
+
+        GCSFilter::Element element2(32);
+        element2[1] = i;
+        excluded_elements.insert(std::move(element2));
+    }
+
+    GCSFilter filter(GCSFilter::Params(0, 0, 10, 1 << 10), included_elements);
+    for (const GCSFilter::Element& element : included_elements) {
+        BOOST_CHECK(filter.Match(element));
+
+        GCSFilter::ElementSet query = excluded_elements;
+        query.insert(element);
+        BOOST_CHECK(filter.MatchAny(query));
+    }
+
+    // The encoding must decode to the same filter
+    GCSFilter decoded(filter.GetParams(), filter.GetEncoded());
+    BOOST_CHECK_EQUAL(decoded.GetN(), 100U);
+    for (const GCSFilter::Element& element : included_elements)
+        BOOST_CHECK(decoded.Match(element));
+
+    // Trailing or missing data is rejected
+    std::vector<unsigned char> encoded = filter.GetEncoded();
+    encoded.push_back(0);
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), encoded), std::ios_base::failure);
+    encoded.resize(encoded.size() - 2);
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), encoded), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_default_constructor)
+{
+    GCSFilter filter;
+    BOOST_CHECK_EQUAL(filter.GetN(), 0U);
+    BOOST_CHECK_EQUAL(filter.GetEncoded().size(), 1U);
+    BOOST_CHECK(!filter.Match(GCSFilter::Element(32)));
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_basic_test)
+{
+    CScript included_scripts[4], excluded_scripts[2];
+
+    // First two are outputs on a single transaction.
+    included_scripts[0] << std::vector<unsigned char>(0, 65) << OP_CHECKSIG;
+    included_scripts[1] << OP_DUP << OP_HASH160 << std::vector<unsigned char>(1, 20) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    // Third is an output on in a second transaction.
+    included_scripts[2] << OP_1 << std::vector<unsigned char>(2, 33) << OP_1 << OP_CHECKMULTISIG;
+
+    // Last is spent by this block.
+    included_scripts[3] << OP_0 << std::vector<unsigned char>(3, 32);
+
+    // OP_RETURN outputs and empty scripts are left out.
+    excluded_scripts[0] << OP_RETURN << OP_4 << OP_ADD << OP_8 << OP_EQUAL;
+
+    CMutableTransaction tx_1;
+    tx_1.vout.resize(3);
+    tx_1.vout[0].scriptPubKey = included_scripts[0];
+    tx_1.vout[1].scriptPubKey = included_scripts[1];
+    tx_1.vout[2].scriptPubKey = excluded_scripts[0];
+
+    CMutableTransaction tx_2;
+    tx_2.vout.resize(2);
+    tx_2.vout[0].scriptPubKey = included_scripts[2];
+    tx_2.vout[1].scriptPubKey = excluded_scripts[1];
+
+    CBlock block;
+    block.vtx.push_back(tx_1);
+    block.vtx.push_back(tx_2);
+
+    CBlockUndo block_undo;
+    block_undo.vtxundo.push_back(CTxUndo());
+    block_undo.vtxundo.back().vprevout.push_back(CTxInUndo(CTxOut(100, included_scripts[3])));
+
+    uint256 block_hash = GetRandHash();
+    BlockFilter block_filter(BLOCK_FILTER_BASIC, block_hash, block, block_undo);
+    const GCSFilter& filter = block_filter.GetFilter();
+
+    for (const CScript& script : included_scripts)
+        BOOST_CHECK(filter.Match(GCSFilter::Element(script.begin(), script.end())));
+    for (const CScript& script : excluded_scripts)
+        BOOST_CHECK(!filter.Match(GCSFilter::Element(script.begin(), script.end())));
+
+    // Test serialization/unserialization.
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << block_filter;
+    BlockFilter block_filter2;
+    stream >> block_filter2;
+
+    BOOST_CHECK_EQUAL(block_filter.GetFilterType(), block_filter2.GetFilterType());
+    BOOST_CHECK(block_filter.GetBlockHash() == block_filter2.GetBlockHash());
+    BOOST_CHECK(block_filter.GetEncodedFilter() == block_filter2.GetEncodedFilter());
+
+    // Headers chain through the previous one.
+    uint256 prev_header = GetRandHash();
+    BOOST_CHECK(block_filter.ComputeHeader(prev_header) != block_filter.ComputeHeader(uint256()));
+    BOOST_CHECK(block_filter.ComputeHeader(prev_header) == block_filter2.ComputeHeader(prev_header));
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_contract_elements)
+{
+    // A contract created and a contract called in the block are matched by their addresses
+    uint160 called_contract(std::string("c4cbb0b7d2cb4e6d3c0a8a8ca0a9d2d68a1c3f2b"));
+    CScript create_script = CScript() << CScriptNum(VersionVM::GetEVMDefault().toRaw()) << CScriptNum(DEFAULT_GAS_LIMIT_OP_SEND)
+                                      << CScriptNum(DEFAULT_GAS_PRICE) << ParseHex("6060604052") << OP_CREATE;
+    CScript call_script = CScript() << CScriptNum(VersionVM::GetEVMDefault().toRaw()) << CScriptNum(DEFAULT_GAS_LIMIT_OP_SEND)
+                                    << CScriptNum(DEFAULT_GAS_PRICE) << ParseHex("a9059cbb")
+                                    << std::vector<unsigned char>(called_contract.begin(), called_contract.end()) << OP_CALL;
+
+    CMutableTransaction tx;
+    tx.vout.resize(2);
+    tx.vout[0].scriptPubKey = create_script;
+    tx.vout[1].scriptPubKey = call_script;
+    CTransaction final_tx(tx);
+
+    CBlock block;
+    block.vtx.push_back(final_tx);
+    BlockFilter block_filter(BLOCK_FILTER_BASIC, GetRandHash(), block, CBlockUndo());
+    const GCSFilter& filter = block_filter.GetFilter();
+
+    uint160 created(LuxState::createLuxAddress(uintToh256(final_tx.GetHash()), 0).asBytes());
+    BOOST_CHECK(filter.Match(GCSFilter::Element(created.begin(), created.end())));
+    BOOST_CHECK(filter.Match(GCSFilter::Element(called_contract.begin(), called_contract.end())));
+    BOOST_CHECK(filter.Match(GCSFilter::Element(create_script.begin(), create_script.end())));
+    BOOST_CHECK(filter.Match(GCSFilter::Element(call_script.begin(), call_script.end())));
+
+    // The address of a contract created by another output is not
+    uint160 other(LuxState::createLuxAddress(uintToh256(final_tx.GetHash()), 1).asBytes());
+    BOOST_CHECK(!filter.Match(GCSFilter::Element(other.begin(), other.end())));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
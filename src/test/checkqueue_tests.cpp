@@ -0,0 +1,176 @@
+// Copyright (c) 2012-2017 The Bitcoin Core developers
+// Copyright (c) 2017-2018 The Luxcore developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "checkqueue.h"
+#include "coins.h"
+#include "key.h"
+#include "main.h"
+#include "sync.h"
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_AUTO_TEST_SUITE(checkqueue_tests)
+
+/** Check that succeeds unless it was created with fOk = false. */
+struct FakeCheck {
+    bool fOk;
+    FakeCheck() : fOk(true) {}
+    explicit FakeCheck(bool fOkIn) : fOk(fOkIn) {}
+    bool operator()() { return fOk; }
+    void swap(FakeCheck& x) { std::swap(fOk, x.fOk); }
+};
+
+BOOST_AUTO_TEST_CASE(checkqueue_correct_and_stats)
+{
+    CCheckQueue<FakeCheck> queue(16);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < 7; i++)
+        threadGroup.create_thread(boost::bind(&CCheckQueue<FakeCheck>::Thread, boost::ref(queue)));
+
+    for (int nRound = 0; nRound < 200; nRound++) {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        const bool fExpected = nRound % 10 != 0;
+        unsigned int nTotal = 0;
+        for (int nTx = 0; nTx < 1 + nRound % 25; nTx++) {
+            std::vector<FakeCheck> vChecks;
+            for (int j = 0; j < 1 + (nTx * 7 + nRound) % 13; j++)
+                vChecks.push_back(FakeCheck(fExpected || nTx != 0 || j != 0));
+            nTotal += vChecks.size();
+            control.Add(vChecks);
+        }
+        BOOST_CHECK_EQUAL(control.Wait(), fExpected);
+
+        CCheckQueueStats stats = control.GetStats();
+        BOOST_CHECK_EQUAL(stats.nChecks, nTotal);
+        BOOST_CHECK(stats.nActive <= stats.nThreads);
+        BOOST_CHECK(stats.nBusyMax <= stats.nBusyTotal);
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_failure_resets)
+{
+    CCheckQueue<FakeCheck> queue(16);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < 3; i++)
+        threadGroup.create_thread(boost::bind(&CCheckQueue<FakeCheck>::Thread, boost::ref(queue)));
+
+    {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        std::vector<FakeCheck> vChecks(1, FakeCheck(false));
+        control.Add(vChecks);
+        BOOST_CHECK(!control.Wait());
+    }
+
+    // A failure among many good checks is still reported
+    {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        std::vector<FakeCheck> vChecks(1000);
+        vChecks[500] = FakeCheck(false);
+        control.Add(vChecks);
+        BOOST_CHECK(!control.Wait());
+    }
+
+    // The next session starts out successful again
+    {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        std::vector<FakeCheck> vChecks(100);
+        control.Add(vChecks);
+        BOOST_CHECK(control.Wait());
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+/** Sign input 0 of txTo, spending scriptCode, with a Schnorr signature */
+static std::vector<unsigned char> SignSchnorrInput(const CKey& key, const CScript& scriptCode, const CMutableTransaction& txTo, CAmount amount)
+{
+    uint256 hash = SignatureHash(scriptCode, txTo, 0, SIGHASH_ALL, amount, SIGVERSION_BASE);
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(key.SignSchnorr(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    return vchSig;
+}
+
+/** Run the scripts of all vTxTo as one share of RunCheckBatch, each under its own flags */
+static bool RunSchnorrChecks(const CCoins& coins, const std::vector<CMutableTransaction>& vTxTo, const std::vector<unsigned int>& vFlags)
+{
+    std::vector<CTransaction> vTx(vTxTo.begin(), vTxTo.end());
+    std::vector<PrecomputedTransactionData> vTxData(vTx.begin(), vTx.end());
+    std::vector<CScriptCheck> vChecks;
+    for (size_t i = 0; i < vTx.size(); i++)
+        vChecks.push_back(CScriptCheck(coins, vTx[i], 0, vFlags[i], false, &vTxData[i]));
+    return RunCheckBatch(vChecks);
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_batch_sigs)
+{
+    const bool fBatchSigVerifySaved = fBatchSigVerify;
+    fBatchSigVerify = true;
+    const unsigned int flags = SCRIPT_ENABLE_SCHNORR | SCRIPT_VERIFY_NULLFAIL;
+
+    // Outputs 0-7 pay to a key each; output 8 is a 1-of-2 multisig of keys 0 and 1 and
+    // output 9 needs a failing signature for key 2
+    CKey keys[8];
+    CMutableTransaction txFrom;
+    txFrom.vout.resize(10);
+    for (int i = 0; i < 8; i++) {
+        keys[i].MakeNewKey(true);
+        txFrom.vout[i].scriptPubKey = CScript() << ToByteVector(keys[i].GetPubKey()) << OP_CHECKSIG;
+    }
+    txFrom.vout[8].scriptPubKey = CScript() << OP_1 << ToByteVector(keys[0].GetPubKey()) << ToByteVector(keys[1].GetPubKey()) << OP_2 << OP_CHECKMULTISIG;
+    txFrom.vout[9].scriptPubKey = CScript() << ToByteVector(keys[2].GetPubKey()) << OP_CHECKSIG << OP_NOT;
+    for (int i = 0; i < 10; i++)
+        txFrom.vout[i].nValue = COIN;
+    CCoins coins(txFrom, 0);
+
+    std::vector<CMutableTransaction> vTxTo(10);
+    std::vector<std::vector<unsigned char> > vSigs(10);
+    for (int i = 0; i < 10; i++) {
+        vTxTo[i].vin.resize(1);
+        vTxTo[i].vin[0].prevout = COutPoint(txFrom.GetHash(), i);
+        vTxTo[i].vout.resize(1);
+        vTxTo[i].vout[0].nValue = COIN;
+        vSigs[i] = SignSchnorrInput(keys[i < 8 ? i : i - 8], txFrom.vout[i].scriptPubKey, vTxTo[i], COIN);
+    }
+    // The multisig signature is by key 0, so it is tried against key 1 first
+    vSigs[8] = SignSchnorrInput(keys[0], txFrom.vout[8].scriptPubKey, vTxTo[8], COIN);
+    vSigs[9][10] ^= 1;
+    for (int i = 0; i < 10; i++)
+        vTxTo[i].vin[0].scriptSig = i == 8 ? CScript() << OP_0 << vSigs[i] : CScript() << vSigs[i];
+
+    // CHECKSIG NOT may pass on a failing signature only without NULLFAIL
+    std::vector<unsigned int> vFlags(10, flags);
+    vFlags[9] = SCRIPT_ENABLE_SCHNORR;
+    BOOST_CHECK(RunSchnorrChecks(coins, vTxTo, vFlags));
+    vFlags[9] = flags;
+    BOOST_CHECK(!RunSchnorrChecks(coins, vTxTo, vFlags));
+    vFlags[9] = SCRIPT_ENABLE_SCHNORR;
+
+    // A bad signature anywhere in the share is found, whichever half it is in
+    for (int nBad : {0, 3, 4, 7}) {
+        std::vector<CMutableTransaction> vTxBad(vTxTo);
+        std::vector<unsigned char> vchSig(vSigs[nBad]);
+        vchSig[10] ^= 1;
+        vTxBad[nBad].vin[0].scriptSig = CScript() << vchSig;
+        BOOST_CHECK_MESSAGE(!RunSchnorrChecks(coins, vTxBad, vFlags), strprintf("bad signature %d", nBad));
+    }
+
+    // ... as is a signature that is valid for the wrong key
+    std::vector<CMutableTransaction> vTxSwapped(vTxTo);
+    std::swap(vTxSwapped[5].vin[0].scriptSig, vTxSwapped[6].vin[0].scriptSig);
+    BOOST_CHECK(!RunSchnorrChecks(coins, vTxSwapped, vFlags));
+
+    fBatchSigVerify = fBatchSigVerifySaved;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "httprpc.h"
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(httprpc_tests)
+
+static bool Peek(const std::string& strBody, const std::string& strExpected)
+{
+    std::string strMethod;
+    return PeekRPCMethod(strBody, strMethod) && strMethod == strExpected;
+}
+
+static bool NoMethod(const std::string& strBody)
+{
+    std::string strMethod;
+    return !PeekRPCMethod(strBody, strMethod);
+}
+
+BOOST_AUTO_TEST_CASE(peek_method_top_level)
+{
+    BOOST_CHECK(Peek("{\"method\":\"getblockcount\"}", "getblockcount"));
+    BOOST_CHECK(Peek(" \r\n{ \"method\" :\t\"getblockcount\" , \"params\":[] }", "getblockcount"));
+    BOOST_CHECK(Peek("{\"jsonrpc\":\"1.0\",\"id\":12,\"params\":[1,true,null],\"method\":\"getblockhash\"}", "getblockhash"));
+    BOOST_CHECK(Peek("{\"method\":\"\"}", ""));
+}
+
+BOOST_AUTO_TEST_CASE(peek_method_nested)
+{
+    // A "method" key below the top level belongs to the arguments
+    BOOST_CHECK(Peek("{\"params\":{\"method\":\"stop\"},\"method\":\"getblockcount\"}", "getblockcount"));
+    BOOST_CHECK(Peek("{\"params\":[{\"method\":\"stop\"},[\"method\"]],\"method\":\"getblockcount\"}", "getblockcount"));
+    BOOST_CHECK(Peek("{\"params\":[\"]}\",\"{[\"],\"method\":\"getblockcount\"}", "getblockcount"));
+    BOOST_CHECK(NoMethod("{\"params\":{\"method\":\"stop\"}}"));
+    BOOST_CHECK(NoMethod("{\"params\":[{\"method\":\"stop\"}],\"id\":1}"));
+}
+
+BOOST_AUTO_TEST_CASE(peek_method_escapes)
+{
+    // Escaped quotes do not end a string, escaped backslashes do not escape the quote after them
+    BOOST_CHECK(Peek("{\"id\":\"x\\\",\\\"method\\\":\\\"stop\",\"method\":\"getinfo\"}", "getinfo"));
+    BOOST_CHECK(Peek("{\"id\":\"a\\\\\",\"method\":\"getinfo\"}", "getinfo"));
+    BOOST_CHECK(Peek("{\"id\\\"\":1,\"method\":\"getinfo\"}", "getinfo"));
+    // Escapes in the key are not decoded, so the method is not recognized
+    BOOST_CHECK(NoMethod("{\"meth\\u006fd\":\"stop\"}"));
+    // nor in the name, which then matches no command
+    BOOST_CHECK(Peek("{\"method\":\"get\\\"info\"}", "get\\\"info"));
+}
+
+BOOST_AUTO_TEST_CASE(peek_method_invalid)
+{
+    BOOST_CHECK(NoMethod(""));
+    BOOST_CHECK(NoMethod(" \n"));
+    BOOST_CHECK(NoMethod("null"));
+    BOOST_CHECK(NoMethod("\"method\""));
+    BOOST_CHECK(NoMethod("{}"));
+    BOOST_CHECK(NoMethod("{,\"method\":\"getinfo\"}"));
+    BOOST_CHECK(NoMethod("{\"method\" \"getinfo\"}"));
+    BOOST_CHECK(NoMethod("{\"method\":1}"));
+    BOOST_CHECK(NoMethod("{\"id\":1 \"method\":\"getinfo\"}"));
+    BOOST_CHECK(NoMethod("{method:\"getinfo\"}"));
+
+    // Cut off at every position before the name is complete
+    const std::string strBody = "{\"id\":\"a\\\"b\",\"params\":[{\"x\":[1]}],\"method\":\"getinfo\"}";
+    const size_t nNameEnd = strBody.rfind('"') + 1;
+    for (size_t n = 0; n < nNameEnd; n++)
+        BOOST_CHECK_MESSAGE(NoMethod(strBody.substr(0, n)), strBody.substr(0, n));
+    for (size_t n = nNameEnd; n <= strBody.size(); n++)
+        BOOST_CHECK(Peek(strBody.substr(0, n), "getinfo"));
+}
+
+BOOST_AUTO_TEST_CASE(classify_request)
+{
+    std::string label;
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("{\"method\":\"getblockcount\"}", label), HTTP_WORK_FAST);
+    BOOST_CHECK_EQUAL(label, "getblockcount");
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("{\"method\":\"getaddressutxos\",\"params\":[]}", label), HTTP_WORK_SLOW);
+    BOOST_CHECK_EQUAL(label, "getaddressutxos");
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("{\"method\":\"getblocktemplate\"}", label), HTTP_WORK_LONGPOLL);
+    BOOST_CHECK_EQUAL(label, "getblocktemplate");
+
+    // Batches run as slow work whatever they contain
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("[{\"method\":\"getblockcount\"}]", label), HTTP_WORK_SLOW);
+    BOOST_CHECK_EQUAL(label, "batch");
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("\n [{\"method\":\"getblocktemplate\"},{\"method\":\"stop\"}]", label), HTTP_WORK_SLOW);
+    BOOST_CHECK_EQUAL(label, "batch");
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("[", label), HTTP_WORK_SLOW);
+    BOOST_CHECK_EQUAL(label, "batch");
+
+    // Unregistered, nested, escaped or missing names are all accounted as "other"
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("{\"method\":\"nosuchcommand\"}", label), HTTP_WORK_FAST);
+    BOOST_CHECK_EQUAL(label, "other");
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("{\"params\":{\"method\":\"getblocktemplate\"}}", label), HTTP_WORK_FAST);
+    BOOST_CHECK_EQUAL(label, "other");
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("{\"method\":\"getblock\\u0074emplate\"}", label), HTTP_WORK_FAST);
+    BOOST_CHECK_EQUAL(label, "other");
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("{\"method\":\"getblockte", label), HTTP_WORK_FAST);
+    BOOST_CHECK_EQUAL(label, "other");
+    BOOST_CHECK_EQUAL(ClassifyRPCRequest("", label), HTTP_WORK_FAST);
+    BOOST_CHECK_EQUAL(label, "other");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 #include <key.h>
 
 #include <base58.h>
+#include <random.h>
 #include <script/script.h>
 #include <uint256.h>
 #include <util.h>
@@ -156,4 +157,46 @@ BOOST_AUTO_TEST_CASE(key_test1)
     BOOST_CHECK(detsigc == ParseHex("2052d8a32079c11e79db95af63bb9600c5b04f21a9ca33dc129c2bfa8ac9dc1cd561d8ae5e0f6c1a16bde3719c64c2fd70e404b6428ab9a69566962e8771b5944d"));
 }
 
+BOOST_AUTO_TEST_CASE(key_schnorr_batch)
+{
+    std::vector<CPubKey> vPubKeys;
+    std::vector<uint256> vHashes;
+    std::vector<std::vector<unsigned char> > vSigs;
+
+    BOOST_CHECK(CPubKey::VerifySchnorrBatch(vPubKeys, vHashes, vSigs));
+
+    for (int i = 0; i < 16; i++) {
+        CKey key;
+        key.MakeNewKey(i % 2 == 0);
+        uint256 hash = GetRandHash();
+        std::vector<unsigned char> vchSig;
+        BOOST_CHECK(key.SignSchnorr(hash, vchSig));
+        BOOST_CHECK(key.GetPubKey().VerifySchnorr(hash, vchSig));
+        vPubKeys.push_back(key.GetPubKey());
+        vHashes.push_back(hash);
+        vSigs.push_back(vchSig);
+        BOOST_CHECK(CPubKey::VerifySchnorrBatch(vPubKeys, vHashes, vSigs));
+    }
+
+    // One bad signature makes the whole batch fail
+    vSigs[7][10] ^= 1;
+    BOOST_CHECK(!CPubKey::VerifySchnorrBatch(vPubKeys, vHashes, vSigs));
+    vSigs[7][10] ^= 1;
+
+    // ... and so does a signature checked against another key
+    std::swap(vPubKeys[3], vPubKeys[4]);
+    BOOST_CHECK(!CPubKey::VerifySchnorrBatch(vPubKeys, vHashes, vSigs));
+    std::swap(vPubKeys[3], vPubKeys[4]);
+
+    // ECDSA signatures cannot be part of a batch
+    CKey key;
+    key.MakeNewKey(true);
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(key.SignECDSA(vHashes[0], vchSig));
+    vPubKeys.push_back(key.GetPubKey());
+    vHashes.push_back(vHashes[0]);
+    vSigs.push_back(vchSig);
+    BOOST_CHECK(!CPubKey::VerifySchnorrBatch(vPubKeys, vHashes, vSigs));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,215 @@
+// Copyright (c) 2017-2018 The Luxcore developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//
+// Unit tests for read-only contract calls on the call engine's block snapshots
+//
+
+#include "chainparams.h"
+#include "lux/luxcallengine.h"
+#include "main.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include <libethashseal/Ethash.h>
+#include <libethashseal/GenesisInfo.h>
+#include <libethereum/ChainParams.h>
+
+#include <atomic>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+/** Contract state at the chain tip: one contract returning the block number, one its storage slot 0 and one looping until it runs out of gas */
+struct CallEngineSetup {
+    const dev::Address addrNumber;
+    const dev::Address addrStorage;
+    const dev::Address addrLoop;
+    int nFirstSCBlockSaved;
+    uint256 hashStateRootSaved;
+    uint256 hashUTXORootSaved;
+
+    CallEngineSetup() : addrNumber(0xa01), addrStorage(0xa02), addrLoop(0xa03)
+    {
+        nFirstSCBlockSaved = Params().FirstSCBlock();
+        ModifiableParams()->setFirstSCBlock(0);
+
+        dev::eth::Ethash::init();
+        const std::string dirLux((GetDataDir() / "stateLux").string());
+        globalState = std::unique_ptr<LuxState>(new LuxState(dev::u256(0), LuxState::openDB(dirLux, dev::sha3(dev::rlp("")), dev::WithExisting::Kill), dirLux, dev::eth::BaseState::Empty));
+        dev::eth::ChainParams cp((dev::eth::genesisInfo(dev::eth::Network::luxMainNetwork)));
+        globalSealEngine = std::unique_ptr<dev::eth::SealEngineFace>(cp.createSealEngine());
+        globalState->setRoot(dev::sha3(dev::rlp("")));
+        globalState->setRootUTXO(uintToh256(Params().GenesisBlock().hashUTXORoot));
+        globalState->populateFrom(cp.genesisState);
+
+        // NUMBER / PUSH1 0 SLOAD, then return the word; JUMPDEST PUSH1 0 JUMP
+        AddContract(addrNumber, ParseHex("4360005260206000f3"));
+        AddContract(addrStorage, ParseHex("60005460005260206000f3"));
+        AddContract(addrLoop, ParseHex("5b600056"));
+        globalState->setStorage(addrStorage, 0, 42);
+        globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+        globalState->db().commit();
+        globalState->dbUtxo().commit();
+
+        LOCK(cs_main);
+        // Block assembly leaves the schedule of the next block on the global seal engine
+        globalSealEngine->setLuxSchedule(GetTipDGPParams(chainActive.Height() + 1).schedule);
+        CBlockIndex* pindex = chainActive.Tip();
+        hashStateRootSaved = pindex->hashStateRoot;
+        hashUTXORootSaved = pindex->hashUTXORoot;
+        pindex->hashStateRoot = h256Touint(globalState->rootHash());
+        pindex->hashUTXORoot = h256Touint(globalState->rootHashUTXO());
+    }
+
+    ~CallEngineSetup()
+    {
+        {
+            LOCK(cs_main);
+            chainActive.Tip()->hashStateRoot = hashStateRootSaved;
+            chainActive.Tip()->hashUTXORoot = hashUTXORootSaved;
+        }
+        globalSealEngine.reset();
+        globalState.reset();
+        ModifiableParams()->setFirstSCBlock(nFirstSCBlockSaved);
+    }
+
+    void AddContract(const dev::Address& addr, const std::vector<unsigned char>& code)
+    {
+        globalState->createContract(addr);
+        globalState->setNewCode(addr, dev::bytes(code.begin(), code.end()));
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(luxcallengine_tests, CallEngineSetup)
+
+BOOST_AUTO_TEST_CASE(callengine_matches_callcontract)
+{
+    LuxCallEngine engine;
+    BOOST_CHECK(engine.Start(2));
+
+    std::string strError;
+    LuxCallSnapshotRef snapshot = engine.GetSnapshot(-1, strError);
+    BOOST_REQUIRE_MESSAGE(snapshot, strError);
+    BOOST_CHECK_EQUAL(snapshot->nHeight, chainActive.Height());
+    BOOST_CHECK(snapshot->hashBlock == chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK(engine.AddressInUse(snapshot, addrNumber));
+    BOOST_CHECK(!engine.AddressInUse(snapshot, dev::Address(0xa04)));
+
+    for (const dev::Address& addr : {addrNumber, addrStorage}) {
+        std::vector<ResultExecute> results;
+        BOOST_CHECK(engine.Call(snapshot, addr, std::vector<unsigned char>(), dev::Address(), 0, results, strError));
+        BOOST_REQUIRE_EQUAL(results.size(), 1U);
+
+        std::vector<ResultExecute> expected;
+        {
+            LOCK(cs_main);
+            expected = CallContract(addr, std::vector<unsigned char>());
+        }
+        BOOST_REQUIRE_EQUAL(expected.size(), 1U);
+        BOOST_CHECK(results[0].execRes.excepted == dev::eth::TransactionException::None);
+        BOOST_CHECK(results[0].execRes.excepted == expected[0].execRes.excepted);
+        BOOST_CHECK(results[0].execRes.output == expected[0].execRes.output);
+        BOOST_CHECK(results[0].execRes.gasUsed == expected[0].execRes.gasUsed);
+        if (addr == addrStorage)
+            BOOST_CHECK(dev::u256(dev::h256(results[0].execRes.output)) == 42);
+    }
+
+    engine.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(callengine_snapshot_reuse)
+{
+    LuxCallEngine engine;
+    BOOST_CHECK(engine.Start(1));
+
+    std::string strError;
+    LuxCallSnapshotRef snapshot = engine.GetSnapshot(-1, strError);
+    BOOST_REQUIRE_MESSAGE(snapshot, strError);
+    BOOST_CHECK(engine.GetSnapshot(-1, strError) == snapshot);
+    BOOST_CHECK(engine.GetSnapshot(chainActive.Height(), strError) == snapshot);
+
+    // Stopping drops the cached snapshots
+    engine.Stop();
+    BOOST_CHECK(engine.Start(1));
+    LuxCallSnapshotRef rebuilt = engine.GetSnapshot(-1, strError);
+    BOOST_REQUIRE_MESSAGE(rebuilt, strError);
+    BOOST_CHECK(rebuilt != snapshot);
+    BOOST_CHECK(rebuilt->hashBlock == snapshot->hashBlock);
+
+    engine.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(callengine_heights)
+{
+    LuxCallEngine engine;
+    std::string strError;
+    BOOST_CHECK(!engine.GetSnapshot(-1, strError));
+    BOOST_CHECK_EQUAL(strError, "No active chain");
+
+    BOOST_CHECK(engine.Start(1));
+    BOOST_CHECK(!engine.GetSnapshot(chainActive.Height() + 1, strError));
+    BOOST_CHECK_EQUAL(strError, "Block height out of range");
+
+    ModifiableParams()->setFirstSCBlock(chainActive.Height() + 1);
+    BOOST_CHECK(!engine.GetSnapshot(-1, strError));
+    BOOST_CHECK_EQUAL(strError, "Smart contracts are not active at this height");
+    BOOST_CHECK(!engine.GetSnapshot(chainActive.Height(), strError));
+    BOOST_CHECK_EQUAL(strError, "Smart contracts are not active at this height");
+
+    ModifiableParams()->setFirstSCBlock(chainActive.Height());
+    BOOST_CHECK(engine.GetSnapshot(chainActive.Height(), strError));
+
+    engine.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(callengine_pending_limit)
+{
+    LuxCallEngine engine;
+    BOOST_CHECK(engine.Start(1));
+    std::string strError;
+    LuxCallSnapshotRef snapshot = engine.GetSnapshot(-1, strError);
+    BOOST_REQUIRE_MESSAGE(snapshot, strError);
+
+    // Keep the only worker busy with a call that runs until the block gas limit
+    boost::thread_group threads;
+    std::atomic<bool> fLooping(false);
+    threads.create_thread([&] {
+        std::vector<ResultExecute> results;
+        std::string strLoopError;
+        fLooping = true;
+        engine.Call(snapshot, addrLoop, std::vector<unsigned char>(), dev::Address(), 0, results, strLoopError);
+    });
+    while (!fLooping || engine.PendingCalls() > 0)
+        boost::this_thread::yield();
+
+    // Far more callers than fit in the queue behind it
+    const int nCallers = 2 * CALLCONTRACT_QUEUE_SIZE;
+    std::atomic<int> nDone(0), nRefused(0);
+    for (int i = 0; i < nCallers; i++) {
+        threads.create_thread([&] {
+            std::vector<ResultExecute> results;
+            std::string strCallError;
+            if (engine.Call(snapshot, addrNumber, std::vector<unsigned char>(), dev::Address(), 0, results, strCallError)) {
+                if (results.size() == 1 && results[0].execRes.excepted == dev::eth::TransactionException::None)
+                    nDone++;
+            } else if (strCallError == "Too many pending contract calls") {
+                nRefused++;
+            }
+        });
+    }
+    threads.join_all();
+
+    BOOST_CHECK(nRefused >= 1);
+    BOOST_CHECK_EQUAL(nDone + nRefused, nCallers);
+    BOOST_CHECK_EQUAL(engine.PendingCalls(), 0U);
+
+    // Calls are refused once the engine is stopped
+    engine.Stop();
+    std::vector<ResultExecute> results;
+    BOOST_CHECK(!engine.Call(snapshot, addrNumber, std::vector<unsigned char>(), dev::Address(), 0, results, strError));
+    BOOST_CHECK_EQUAL(strError, "Contract call engine is not running");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
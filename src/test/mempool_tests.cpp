@@ -102,4 +102,39 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
     BOOST_CHECK_EQUAL(testPool.size(), 0U);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolGasPriceIndexTest)
+{
+    CTxMemPool testPool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    // Contract txs with cached gas values, and two plain txs
+    CMutableTransaction tx[5];
+    for (int i = 0; i < 5; i++)
+    {
+        tx[i].vin.resize(1);
+        tx[i].vin[0].scriptSig = CScript() << OP_11;
+        tx[i].vout.resize(1);
+        tx[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx[i].vout[0].nValue = 10000LL + i;
+    }
+    testPool.addUnchecked(tx[0].GetHash(), entry.Fee(1000LL).MinGasPrice(40).GasLimit(250000, 250000).FromTx(tx[0]));
+    testPool.addUnchecked(tx[1].GetHash(), entry.Fee(1000LL).MinGasPrice(60).GasLimit(300000, 200000).FromTx(tx[1]));
+    testPool.addUnchecked(tx[2].GetHash(), entry.Fee(1000LL).MinGasPrice(40).GasLimit(100000, 100000).FromTx(tx[2]));
+    testPool.addUnchecked(tx[3].GetHash(), entry.Fee(5000LL).MinGasPrice(0).GasLimit(0, 0).FromTx(tx[3]));
+    testPool.addUnchecked(tx[4].GetHash(), entry.Fee(2000LL).FromTx(tx[4]));
+
+    // Highest gas price first, then the smaller gas limit; plain txs last
+    std::vector<uint256> order;
+    for (const CTxMemPoolEntry& e : testPool.mapTx.get<gas_price>())
+        order.push_back(e.GetTx().GetHash());
+    BOOST_CHECK_EQUAL(order.size(), 5U);
+    BOOST_CHECK(order[0] == tx[1].GetHash());
+    BOOST_CHECK(order[1] == tx[2].GetHash());
+    BOOST_CHECK(order[2] == tx[0].GetHash());
+
+    CTxMemPool::txiter it = testPool.mapTx.find(tx[1].GetHash());
+    BOOST_CHECK_EQUAL(it->GetGasLimit(), 300000U);
+    BOOST_CHECK_EQUAL(it->GetMaxGasLimit(), 200000U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
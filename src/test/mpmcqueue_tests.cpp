@@ -0,0 +1,112 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "mpmcqueue.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(mpmcqueue_tests)
+
+BOOST_AUTO_TEST_CASE(mpmcqueue_capacity)
+{
+    BOOST_CHECK_EQUAL(BoundedMPMCQueue<int>(0).Capacity(), 2U);
+    BOOST_CHECK_EQUAL(BoundedMPMCQueue<int>(1).Capacity(), 2U);
+    BOOST_CHECK_EQUAL(BoundedMPMCQueue<int>(3).Capacity(), 4U);
+    BOOST_CHECK_EQUAL(BoundedMPMCQueue<int>(8).Capacity(), 8U);
+    BOOST_CHECK_EQUAL(BoundedMPMCQueue<int>(9).Capacity(), 16U);
+}
+
+BOOST_AUTO_TEST_CASE(mpmcqueue_full_and_empty)
+{
+    BoundedMPMCQueue<int> queue(4);
+    int value = -1;
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+    BOOST_CHECK(!queue.TryPop(value));
+    BOOST_CHECK_EQUAL(value, -1);
+
+    for (int i = 0; i < 4; i++)
+        BOOST_CHECK(queue.TryPush(i));
+    BOOST_CHECK_EQUAL(queue.Size(), 4U);
+    BOOST_CHECK(!queue.TryPush(4));
+    BOOST_CHECK_EQUAL(queue.Size(), 4U);
+
+    for (int i = 0; i < 4; i++) {
+        BOOST_CHECK(queue.TryPop(value));
+        BOOST_CHECK_EQUAL(value, i);
+    }
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+    BOOST_CHECK(!queue.TryPop(value));
+
+    // A freed cell can be filled again
+    BOOST_CHECK(queue.TryPush(5));
+    BOOST_CHECK(queue.TryPop(value));
+    BOOST_CHECK_EQUAL(value, 5);
+}
+
+BOOST_AUTO_TEST_CASE(mpmcqueue_wraparound)
+{
+    // Positions run many times around the ring, with the queue at every fill level
+    BoundedMPMCQueue<int> queue(4);
+    int nNext = 0, nExpected = 0, value;
+    for (int round = 0; round < 1000; round++) {
+        size_t nFill = round % 5;
+        while (queue.Size() < nFill)
+            BOOST_REQUIRE(queue.TryPush(nNext++));
+        if (nFill == queue.Capacity())
+            BOOST_CHECK(!queue.TryPush(-1));
+        while (queue.Size() > nFill / 2) {
+            BOOST_REQUIRE(queue.TryPop(value));
+            BOOST_CHECK_EQUAL(value, nExpected++);
+        }
+    }
+    while (queue.TryPop(value))
+        BOOST_CHECK_EQUAL(value, nExpected++);
+    BOOST_CHECK_EQUAL(nExpected, nNext);
+    BOOST_CHECK(nNext > 1000);
+}
+
+BOOST_AUTO_TEST_CASE(mpmcqueue_threads)
+{
+    // Every pushed item is popped exactly once, whatever the interleaving
+    static const int nThreads = 4, nPerThread = 20000;
+    BoundedMPMCQueue<int> queue(16);
+    std::vector<std::atomic<int> > vSeen(nThreads * nPerThread);
+    for (std::atomic<int>& seen : vSeen)
+        seen = 0;
+    std::atomic<int> nPopped(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&queue, t] {
+            for (int i = t * nPerThread; i < (t + 1) * nPerThread; i++)
+                while (!queue.TryPush(i))
+                    std::this_thread::yield();
+        });
+        threads.emplace_back([&queue, &vSeen, &nPopped] {
+            int value;
+            while (nPopped < nThreads * nPerThread) {
+                if (queue.TryPop(value)) {
+                    vSeen[value]++;
+                    nPopped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    int nOnce = 0;
+    for (const std::atomic<int>& seen : vSeen)
+        nOnce += seen == 1;
+    BOOST_CHECK_EQUAL(nOnce, nThreads * nPerThread);
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
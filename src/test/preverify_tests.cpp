@@ -0,0 +1,138 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//
+// Unit tests for verifying relayed transaction scripts ahead of AcceptToMemoryPool
+//
+
+#include "keystore.h"
+#include "main.h"
+#include "mruset.h"
+#include "policy/policy.h"
+#include "script/sign.h"
+#include "txmempool.h"
+
+#include <boost/test/unit_test.hpp>
+
+// Tests this internal-to-main.cpp state:
+extern mruset<uint256> setRecentRejects;
+
+BOOST_AUTO_TEST_SUITE(preverify_tests)
+
+/** Flags AcceptToMemoryPool checks loose transactions with at the current tip */
+static unsigned int MempoolScriptFlags()
+{
+    unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    if (chainActive.Height() >= Params().StartDevfeeBlock())
+        flags |= SCRIPT_ENABLE_SCHNORR;
+    return flags;
+}
+
+/** A coin paying key in the chain tip view, and a transaction spending it */
+struct PreVerifySetup {
+    CBasicKeyStore keystore;
+    CMutableTransaction txFrom;
+    CMutableTransaction txSpend;
+
+    PreVerifySetup(CAmount nFee = COIN)
+    {
+        CKey key;
+        key.MakeNewKey(true);
+        keystore.AddKey(key);
+
+        txFrom.vin.resize(1);
+        txFrom.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        txFrom.vout.resize(1);
+        txFrom.vout[0].nValue = 10 * COIN;
+        txFrom.vout[0].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+        {
+            LOCK(cs_main);
+            pcoinsTip->ModifyCoins(txFrom.GetHash())->FromTx(txFrom, 0);
+        }
+
+        txSpend.vin.resize(1);
+        txSpend.vin[0].prevout = COutPoint(txFrom.GetHash(), 0);
+        txSpend.vout.resize(1);
+        txSpend.vout[0].nValue = 10 * COIN - nFee;
+        txSpend.vout[0].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+        BOOST_CHECK(SignSignature(keystore, txFrom, txSpend, 0, SIGHASH_ALL));
+    }
+
+    ~PreVerifySetup()
+    {
+        LOCK(cs_main);
+        pcoinsTip->ModifyCoins(txFrom.GetHash())->Clear();
+    }
+};
+
+BOOST_AUTO_TEST_CASE(preverify_flags)
+{
+    PreVerifySetup setup;
+    CTransaction tx(setup.txSpend);
+    unsigned int flags = MempoolScriptFlags();
+    BOOST_CHECK(!HavePreVerifiedScripts(tx, flags));
+
+    BOOST_CHECK(PreVerifyTransactionScripts(tx));
+    BOOST_CHECK(HavePreVerifiedScripts(tx, flags));
+
+    // AcceptToMemoryPool only skips its script checks for exactly the same flags
+    BOOST_CHECK(!HavePreVerifiedScripts(tx, MANDATORY_SCRIPT_VERIFY_FLAGS));
+    BOOST_CHECK(!HavePreVerifiedScripts(tx, flags ^ SCRIPT_VERIFY_LOW_S));
+    BOOST_CHECK(!HavePreVerifiedScripts(tx, flags ^ SCRIPT_ENABLE_SCHNORR));
+
+    // Nor for another transaction spending the same coin
+    CMutableTransaction txOther(setup.txSpend);
+    txOther.vout[0].nValue -= 1;
+    BOOST_CHECK(!HavePreVerifiedScripts(CTransaction(txOther), flags));
+}
+
+BOOST_AUTO_TEST_CASE(preverify_failures)
+{
+    PreVerifySetup setup;
+    unsigned int flags = MempoolScriptFlags();
+
+    // Signature for other outputs
+    CMutableTransaction txBadSig(setup.txSpend);
+    txBadSig.vout[0].nValue -= 1;
+    BOOST_CHECK(!PreVerifyTransactionScripts(CTransaction(txBadSig)));
+    BOOST_CHECK(!HavePreVerifiedScripts(CTransaction(txBadSig), flags));
+
+    // Unknown input
+    CMutableTransaction txNoInput(setup.txSpend);
+    txNoInput.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    BOOST_CHECK(!PreVerifyTransactionScripts(CTransaction(txNoInput)));
+    BOOST_CHECK(!HavePreVerifiedScripts(CTransaction(txNoInput), flags));
+
+    // Below the relay fee, left for AcceptToMemoryPool to reject without verifying
+    PreVerifySetup setupFree(0);
+    BOOST_CHECK(!PreVerifyTransactionScripts(CTransaction(setupFree.txSpend)));
+    BOOST_CHECK(!HavePreVerifiedScripts(CTransaction(setupFree.txSpend), flags));
+}
+
+BOOST_AUTO_TEST_CASE(preverify_recent_rejects)
+{
+    PreVerifySetup setup;
+    CTransaction tx(setup.txSpend);
+    unsigned int flags = MempoolScriptFlags();
+
+    // The first lookup also ties the reject set to the current tip
+    PreVerifySetup setupPassing;
+    BOOST_CHECK(PreVerifyTransactionScripts(CTransaction(setupPassing.txSpend)));
+
+    {
+        LOCK(cs_main);
+        setRecentRejects.insert(tx.GetHash());
+    }
+    BOOST_CHECK(!PreVerifyTransactionScripts(tx));
+    BOOST_CHECK(!HavePreVerifiedScripts(tx, flags));
+
+    {
+        LOCK(cs_main);
+        setRecentRejects.clear();
+    }
+    BOOST_CHECK(PreVerifyTransactionScripts(tx));
+    BOOST_CHECK(HavePreVerifiedScripts(tx, flags));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
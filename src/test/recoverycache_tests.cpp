@@ -0,0 +1,42 @@
+// Copyright (c) 2017-2018 The Luxcore developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <libdevcrypto/RecoveryCache.h>
+
+#include <boost/test/unit_test.hpp>
+
+using dev::h256;
+using dev::Public;
+using dev::Signature;
+using dev::crypto::RecoveryCache;
+
+BOOST_AUTO_TEST_SUITE(recoverycache_tests)
+
+BOOST_AUTO_TEST_CASE(recoverycache_lookup_and_eviction)
+{
+    RecoveryCache cache(2);
+    const h256 hash1(1), hash2(2), hash3(3);
+    const Signature sig1(11), sig2(12), sig3(13);
+    const Public pub1(21), pub2(22), pub3(23);
+    Public pub;
+
+    cache.store(hash1, sig1, pub1);
+    BOOST_CHECK(cache.get(hash1, sig1, pub) && pub == pub1);
+
+    // The same message hash with another signature is another entry
+    BOOST_CHECK(!cache.get(hash1, sig2, pub));
+    cache.store(hash1, sig2, pub2);
+    BOOST_CHECK(cache.get(hash1, sig2, pub) && pub == pub2);
+    BOOST_CHECK(cache.get(hash1, sig1, pub) && pub == pub1);
+
+    // hash1/sig1 was used last, so hash1/sig2 makes room for hash3/sig3
+    cache.store(hash3, sig3, pub3);
+    BOOST_CHECK_EQUAL(cache.size(), 2U);
+    BOOST_CHECK(!cache.get(hash1, sig2, pub));
+    BOOST_CHECK(cache.get(hash1, sig1, pub) && pub == pub1);
+    BOOST_CHECK(cache.get(hash3, sig3, pub) && pub == pub3);
+    BOOST_CHECK(!cache.get(hash2, sig1, pub));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
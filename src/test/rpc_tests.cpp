@@ -338,4 +338,39 @@ BOOST_AUTO_TEST_CASE(rpc_convert_values_generatetoaddress)
     BOOST_CHECK_EQUAL(result[2].get_int(), 9);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_json_stream_writer)
+{
+    UniValue value;
+    BOOST_CHECK(value.read("{\"a\":[1,2,{\"b\":[\"x\",null]}],\"c\":{\"d\":true},\"e\":\"f\"}"));
+
+    // Small chunks force several flushes; the joined output matches a single write
+    std::string out;
+    size_t nChunks = 0;
+    JSONStreamWriter writer([&](const std::string& chunk) { out += chunk; nChunks++; }, 4);
+    writer.Value(value);
+    writer.Flush();
+    BOOST_CHECK_EQUAL(out, value.write());
+    BOOST_CHECK(nChunks > 1);
+    BOOST_CHECK(writer.Used());
+
+    // Output cut short still parses once the open containers are closed
+    out.clear();
+    JSONStreamWriter partial([&](const std::string& chunk) { out += chunk; }, 1024);
+    partial.BeginObject();
+    partial.KeyValue("n", UniValue(1));
+    partial.Key("list");
+    partial.BeginArray();
+    partial.Value(UniValue("item"));
+    partial.CloseAll();
+    partial.Flush();
+    BOOST_CHECK_EQUAL(out, "{\"n\":1,\"list\":[\"item\"]}");
+
+    // Without a stream in scope, results are collected as usual
+    BOOST_CHECK(RPCResultStream() == NULL);
+    RPCResultArray result;
+    result.push_back(UniValue(7));
+    UniValue collected = result.Finish();
+    BOOST_CHECK_EQUAL(collected.write(), "[7]");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
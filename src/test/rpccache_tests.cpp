@@ -0,0 +1,173 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain.h"
+#include "rpccache.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(rpccache_tests)
+
+BOOST_AUTO_TEST_CASE(rpccache_confirmations_and_reorg)
+{
+    // A main chain of 1000 blocks and a branch splitting off at block 899.
+    std::vector<CBlockIndex> vBlocksMain(1000);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+        vBlocksMain[i].BuildSkip();
+    }
+    std::vector<CBlockIndex> vBlocksSide(200);
+    for (unsigned int i=0; i<vBlocksSide.size(); i++) {
+        vBlocksSide[i].nHeight = i + 900;
+        vBlocksSide[i].pprev = i ? &vBlocksSide[i - 1] : &vBlocksMain[899];
+        vBlocksSide[i].BuildSkip();
+    }
+
+    CChain chain;
+    chain.SetTip(&vBlocksMain[950]);
+    CChainSnapshot first(chain, NULL);
+    chain.SetTip(&vBlocksMain.back());
+    CChainSnapshot second(chain, &first);
+    chain.SetTip(&vBlocksSide.back());
+    CChainSnapshot side(chain, &second);
+
+    CRPCResponseCache cache;
+    cache.SetLimits(1 << 20, 10);
+    cache.BlockTipChanged(first.Tip());
+
+    // Too shallow to cache
+    BOOST_CHECK(!cache.IsCacheable(&vBlocksMain[945], first));
+    cache.Put("getblock", "945", &vBlocksMain[945], first, "{\"confirmations\":6}");
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 0U);
+
+    // The confirmations follow the chain the result is served from
+    std::string strJSON;
+    cache.Put("getblock", "100", &vBlocksMain[100], first, "{\"hash\":\"a\",\"confirmations\":851,\"tx\":[]}");
+    cache.Put("getblock", "920", &vBlocksMain[920], first, "{\"hash\":\"b\",\"confirmations\":31,\"tx\":[]}");
+    cache.Put("getblockheader", "100", &vBlocksMain[100], first, "{\"version\":1}");
+    BOOST_CHECK(cache.Get("getblock", "100", first, strJSON));
+    BOOST_CHECK_EQUAL(strJSON, "{\"hash\":\"a\",\"confirmations\":851,\"tx\":[]}");
+    BOOST_CHECK(cache.Get("getblock", "100", second, strJSON));
+    BOOST_CHECK_EQUAL(strJSON, "{\"hash\":\"a\",\"confirmations\":900,\"tx\":[]}");
+    BOOST_CHECK(cache.Get("getblockheader", "100", second, strJSON));
+    BOOST_CHECK_EQUAL(strJSON, "{\"version\":1}");
+    BOOST_CHECK(!cache.Get("getblockheader", "920", second, strJSON));
+
+    // A result about a block missing from the chain it is checked against is not served
+    BOOST_CHECK(!cache.Get("getblock", "920", side, strJSON));
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 3U);
+
+    // Extending the chain keeps everything, a reorg drops what was disconnected
+    cache.BlockTipChanged(second.Tip());
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 3U);
+    cache.BlockTipChanged(side.Tip());
+    CRPCCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 2U);
+    BOOST_CHECK_EQUAL(stats.nInvalidated, 1U);
+    BOOST_CHECK(cache.Get("getblock", "100", side, strJSON));
+    BOOST_CHECK_EQUAL(strJSON, "{\"hash\":\"a\",\"confirmations\":1000,\"tx\":[]}");
+
+    stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.mapMethods["getblock"].nHits, 3U);
+    BOOST_CHECK_EQUAL(stats.mapMethods["getblock"].nMisses, 1U);
+    BOOST_CHECK_EQUAL(stats.mapMethods["getblockheader"].nHits, 1U);
+    BOOST_CHECK_EQUAL(stats.mapMethods["getblockheader"].nMisses, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(rpccache_eviction)
+{
+    std::vector<CBlockIndex> vBlocks(100);
+    for (unsigned int i=0; i<vBlocks.size(); i++) {
+        vBlocks[i].nHeight = i;
+        vBlocks[i].pprev = i ? &vBlocks[i - 1] : NULL;
+    }
+    CChain chain;
+    chain.SetTip(&vBlocks.back());
+    CChainSnapshot snapshot(chain, NULL);
+
+    CRPCResponseCache cache;
+    const std::string strResult(1000, 'x');
+    const size_t nMaxUsage = 64 * 1024;
+    cache.SetLimits(nMaxUsage, 1);
+    for (int i = 0; i < 99; i++)
+        cache.Put("getrawtransaction", std::to_string(i), &vBlocks[i], snapshot, "\"" + strResult + "\"");
+
+    CRPCCacheStats stats = cache.GetStats();
+    BOOST_CHECK(stats.nUsage <= nMaxUsage);
+    BOOST_CHECK(stats.nEvicted > 0);
+    BOOST_CHECK_EQUAL(stats.nEntries + stats.nEvicted, 99U);
+
+    // The least recently used entries went first
+    std::string strJSON;
+    BOOST_CHECK(!cache.Get("getrawtransaction", "0", snapshot, strJSON));
+    BOOST_CHECK(cache.Get("getrawtransaction", "98", snapshot, strJSON));
+    BOOST_CHECK_EQUAL(strJSON, "\"" + strResult + "\"");
+
+    // Results too large for their share of the cache are not kept
+    cache.Put("getblock", "99", &vBlocks[99], snapshot, std::string(nMaxUsage / 4, 'x'));
+    BOOST_CHECK(!cache.Get("getblock", "99", snapshot, strJSON));
+
+    cache.SetLimits(0, 1);
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 0U);
+    BOOST_CHECK(!cache.Get("getrawtransaction", "98", snapshot, strJSON));
+}
+
+BOOST_AUTO_TEST_CASE(rpccache_next_block)
+{
+    // A chain of 100 blocks and a branch splitting off at block 89
+    std::vector<CBlockIndex> vBlocksMain(100);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+        vBlocksMain[i].BuildSkip();
+    }
+    std::vector<CBlockIndex> vBlocksSide(20);
+    for (unsigned int i=0; i<vBlocksSide.size(); i++) {
+        vBlocksSide[i].nHeight = i + 90;
+        vBlocksSide[i].pprev = i ? &vBlocksSide[i - 1] : &vBlocksMain[89];
+        vBlocksSide[i].BuildSkip();
+    }
+
+    CChain chain;
+    chain.SetTip(&vBlocksMain.back());
+    CChainSnapshot mainChain(chain, NULL);
+    chain.SetTip(&vBlocksSide.back());
+    CChainSnapshot side(chain, &mainChain);
+
+    CRPCResponseCache cache;
+    cache.SetLimits(1 << 20, 1);
+    cache.BlockTipChanged(mainChain.Tip());
+
+    // The fork block stays in both chains, but its successor differs
+    std::string strJSON;
+    cache.Put("getblock", "89", &vBlocksMain[89], mainChain, "{\"confirmations\":11,\"nextblockhash\":\"main\"}");
+    cache.Put("getblock", "88", &vBlocksMain[88], mainChain, "{\"confirmations\":12,\"nextblockhash\":\"89\"}");
+    BOOST_CHECK(cache.Get("getblock", "89", mainChain, strJSON));
+    BOOST_CHECK(!cache.Get("getblock", "89", side, strJSON));
+    BOOST_CHECK(cache.Get("getblock", "88", side, strJSON));
+
+    cache.BlockTipChanged(side.Tip());
+    CRPCCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 1U);
+    BOOST_CHECK_EQUAL(stats.nInvalidated, 1U);
+    cache.Put("getblock", "89", &vBlocksMain[89], side, "{\"confirmations\":21,\"nextblockhash\":\"side\"}");
+    BOOST_CHECK(cache.Get("getblock", "89", side, strJSON));
+    BOOST_CHECK_EQUAL(strJSON, "{\"confirmations\":21,\"nextblockhash\":\"side\"}");
+
+    // The tip gets a successor when the chain is extended
+    chain.SetTip(&vBlocksSide[10]);
+    CChainSnapshot shorter(chain, &side);
+    cache.BlockTipChanged(shorter.Tip());
+    cache.Put("getblock", "100", &vBlocksSide[10], shorter, "{\"confirmations\":1}");
+    BOOST_CHECK(cache.Get("getblock", "100", shorter, strJSON));
+    BOOST_CHECK(!cache.Get("getblock", "100", side, strJSON));
+    cache.BlockTipChanged(side.Tip());
+    BOOST_CHECK(!cache.Get("getblock", "100", shorter, strJSON));
+    BOOST_CHECK(cache.Get("getblock", "89", side, strJSON));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
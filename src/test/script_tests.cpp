@@ -1425,4 +1425,70 @@ BOOST_AUTO_TEST_CASE(script_FindAndDelete)
     BOOST_CHECK(s == expect);
 }
 
+/** Accepts a signature whose first byte is 1 and whose second is the first byte of the key, and counts how it was asked for */
+class CountingSignatureChecker : public BaseSignatureChecker
+{
+public:
+    mutable int nCheckSig = 0;
+    mutable int nRequired = 0;
+
+    bool CheckSig(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, uint32_t flags) const override
+    {
+        nCheckSig++;
+        return scriptSig.size() > 1 && scriptSig[0] == 1 && !vchPubKey.empty() && scriptSig[1] == vchPubKey[0];
+    }
+
+    bool CheckSigRequired(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, uint32_t flags) const override
+    {
+        nRequired++;
+        return scriptSig.size() > 1 && scriptSig[0] == 1 && !vchPubKey.empty() && scriptSig[1] == vchPubKey[0];
+    }
+};
+
+BOOST_AUTO_TEST_CASE(script_checksig_required)
+{
+    // Only checks whose failure fails the script may be taken as valid and confirmed later
+    std::vector<unsigned char> key(33, 2), good(64, 2), bad(64, 2);
+    good[0] = 1;
+    std::vector<std::vector<unsigned char> > stack;
+    ScriptError err;
+
+    CountingSignatureChecker checkVerify;
+    BOOST_CHECK(EvalScript(stack, CScript() << good << key << OP_CHECKSIGVERIFY << OP_1, SCRIPT_VERIFY_NONE, checkVerify, SIGVERSION_BASE, &err));
+    BOOST_CHECK_EQUAL(checkVerify.nRequired, 1);
+    BOOST_CHECK_EQUAL(checkVerify.nCheckSig, 0);
+
+    // CHECKSIG NOT may pass with a failing signature, unless NULLFAIL forbids it
+    stack.clear();
+    CountingSignatureChecker checkNot;
+    BOOST_CHECK(EvalScript(stack, CScript() << bad << key << OP_CHECKSIG << OP_NOT, SCRIPT_VERIFY_NONE, checkNot, SIGVERSION_BASE, &err));
+    BOOST_CHECK_EQUAL(checkNot.nRequired, 0);
+    BOOST_CHECK_EQUAL(checkNot.nCheckSig, 1);
+
+    stack.clear();
+    CountingSignatureChecker checkNullFail;
+    BOOST_CHECK(!EvalScript(stack, CScript() << bad << key << OP_CHECKSIG << OP_NOT, SCRIPT_VERIFY_NULLFAIL, checkNullFail, SIGVERSION_BASE, &err));
+    BOOST_CHECK_EQUAL(err, SCRIPT_ERR_SIG_NULLFAIL);
+    BOOST_CHECK_EQUAL(checkNullFail.nRequired, 1);
+    BOOST_CHECK_EQUAL(checkNullFail.nCheckSig, 0);
+
+    stack.clear();
+    CountingSignatureChecker checkEmpty;
+    BOOST_CHECK(EvalScript(stack, CScript() << OP_0 << key << OP_CHECKSIG << OP_NOT, SCRIPT_VERIFY_NULLFAIL, checkEmpty, SIGVERSION_BASE, &err));
+    BOOST_CHECK_EQUAL(checkEmpty.nRequired, 0);
+    BOOST_CHECK_EQUAL(checkEmpty.nCheckSig, 1);
+
+    // CHECKMULTISIG tries signatures against keys they do not belong to, even in a valid
+    // 2-of-3 that leaves out the last key
+    stack.clear();
+    std::vector<unsigned char> keyA(33, 2), keyB(33, 3), keyC(33, 4), sigA(64, 2), sigB(64, 3);
+    sigA[0] = sigB[0] = 1;
+    CountingSignatureChecker checkMulti;
+    CScript multisig = CScript() << OP_0 << sigA << sigB << OP_2 << keyA << keyB << keyC << OP_3 << OP_CHECKMULTISIG;
+    BOOST_CHECK(EvalScript(stack, multisig, SCRIPT_VERIFY_NULLFAIL, checkMulti, SIGVERSION_BASE, &err));
+    BOOST_CHECK(stack.size() == 1 && stack.back() == std::vector<unsigned char>(1, 1));
+    BOOST_CHECK_EQUAL(checkMulti.nRequired, 0);
+    BOOST_CHECK_EQUAL(checkMulti.nCheckSig, 3);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
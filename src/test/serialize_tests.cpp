@@ -161,4 +161,30 @@ BOOST_AUTO_TEST_CASE(insert_delete)
     BOOST_CHECK_EQUAL(ss.size(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(swap_and_buffer_reader)
+{
+    CDataStream ss(SER_NETWORK, 0);
+    ss << (uint32_t)1 << std::string("abc") << (uint64_t)2;
+    uint32_t n;
+    ss >> n;
+
+    // Swap hands over only the unread part, and the buffer it got back
+    CSerializeData d;
+    d.push_back('x');
+    ss.Swap(d);
+    BOOST_CHECK_EQUAL(d.size(), 12U);
+    BOOST_CHECK_EQUAL(ss.size(), 1U);
+
+    // Reading leaves the buffer untouched
+    std::string str;
+    uint64_t n64;
+    CBufferReader reader(d.data(), d.data() + d.size(), SER_NETWORK, 0);
+    reader >> str >> n64;
+    BOOST_CHECK_EQUAL(str, "abc");
+    BOOST_CHECK_EQUAL(n64, 2U);
+    BOOST_CHECK(reader.empty());
+    BOOST_CHECK_EQUAL(d.size(), 12U);
+    BOOST_CHECK_THROW(reader >> n, std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
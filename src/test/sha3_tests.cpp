@@ -0,0 +1,70 @@
+// Copyright (c) 2017-2018 The Luxcore developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "random.h"
+
+#include <libdevcore/CommonData.h>
+#include <libdevcore/SHA3.h>
+
+#include <boost/test/unit_test.hpp>
+
+using dev::bytes;
+using dev::bytesConstRef;
+using dev::h256;
+
+BOOST_AUTO_TEST_SUITE(sha3_tests)
+
+static bytes RandomBytes(size_t size)
+{
+    bytes data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = insecure_rand();
+    return data;
+}
+
+static h256 Portable(bytesConstRef input)
+{
+    h256 ret;
+    dev::sha3Portable(input, ret.ref());
+    return ret;
+}
+
+BOOST_AUTO_TEST_CASE(sha3_known_vectors)
+{
+    dev::sha3AutoDetect();
+    BOOST_CHECK_EQUAL(dev::sha3(bytesConstRef()).hex(), "c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470");
+    BOOST_CHECK_EQUAL(dev::sha3(std::string("abc")).hex(), "4e03657aea45a94fc7d47ba826c8d667c0d1e6e33a64a036ec44f58fa12d6c45");
+    BOOST_CHECK_EQUAL(Portable(bytesConstRef()), dev::EmptySHA3);
+}
+
+BOOST_AUTO_TEST_CASE(sha3_matches_portable)
+{
+    dev::sha3AutoDetect();
+    seed_insecure_rand(true);
+    // every length around the 136 byte rate boundaries
+    for (size_t size = 0; size < 600; size++) {
+        bytes data = RandomBytes(size);
+        BOOST_CHECK_EQUAL(dev::sha3(data), Portable(&data));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sha3_batch)
+{
+    dev::sha3AutoDetect();
+    seed_insecure_rand(true);
+    for (size_t count = 0; count < 40; count++) {
+        std::vector<bytes> data;
+        for (size_t i = 0; i < count; i++)
+            data.push_back(RandomBytes(insecure_rand() % 4 ? insecure_rand() % 136 : insecure_rand() % 400));
+        std::vector<bytesConstRef> inputs;
+        for (const bytes& d : data)
+            inputs.push_back(&d);
+        std::vector<h256> outputs(count);
+        dev::sha3(inputs.data(), outputs.data(), count);
+        for (size_t i = 0; i < count; i++)
+            BOOST_CHECK_EQUAL(outputs[i], Portable(inputs[i]));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
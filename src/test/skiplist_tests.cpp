@@ -99,4 +99,49 @@ BOOST_AUTO_TEST_CASE(getlocator_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(chainsnapshot_test)
+{
+    // A main chain of 10000 blocks and a branch splitting off at block 8999.
+    std::vector<CBlockIndex> vBlocksMain(10000);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+    }
+    std::vector<CBlockIndex> vBlocksSide(2000);
+    for (unsigned int i=0; i<vBlocksSide.size(); i++) {
+        vBlocksSide[i].nHeight = i + 9000;
+        vBlocksSide[i].pprev = i ? &vBlocksSide[i - 1] : &vBlocksMain[8999];
+    }
+
+    CChain chain;
+    CChainSnapshot empty(chain, NULL);
+    BOOST_CHECK_EQUAL(empty.Height(), -1);
+    BOOST_CHECK(empty.Tip() == NULL);
+
+    chain.SetTip(&vBlocksMain[5000]);
+    CChainSnapshot first(chain, NULL);
+    chain.SetTip(&vBlocksMain.back());
+    CChainSnapshot second(chain, &first);
+    chain.SetTip(&vBlocksSide.back());
+    CChainSnapshot third(chain, &second);
+
+    // Earlier snapshots are unaffected by later ones sharing their segments
+    BOOST_CHECK(first.Tip() == &vBlocksMain[5000]);
+    BOOST_CHECK(first[5001] == NULL);
+    BOOST_CHECK(second.Tip() == &vBlocksMain.back());
+    BOOST_CHECK(third.Tip() == &vBlocksSide.back());
+    BOOST_CHECK_EQUAL(third.Height(), 10999);
+
+    for (int n=0; n<1000; n++) {
+        int nHeight = insecure_rand() % 11000;
+        BOOST_CHECK(third[nHeight] == chain[nHeight]);
+        if (nHeight < 10000)
+            BOOST_CHECK(second[nHeight] == &vBlocksMain[nHeight]);
+    }
+    BOOST_CHECK(second.Contains(&vBlocksMain[9500]));
+    BOOST_CHECK(!third.Contains(&vBlocksMain[9500]));
+    BOOST_CHECK(third.Next(&vBlocksMain[8999]) == &vBlocksSide[0]);
+    BOOST_CHECK(second.Next(&vBlocksMain.back()) == NULL);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
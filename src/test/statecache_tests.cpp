@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2018 The Luxcore developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <libethereum/StateCache.h>
+
+#include <boost/test/unit_test.hpp>
+
+using dev::Address;
+using dev::h256;
+using dev::u256;
+using dev::eth::StateCache;
+
+BOOST_AUTO_TEST_SUITE(statecache_tests)
+
+BOOST_AUTO_TEST_CASE(statecache_account_lineage)
+{
+    StateCache cache;
+    const h256 root1(1), root2(2), root3(3), fork(4);
+    const Address a(10), b(11);
+    std::string rlp;
+
+    cache.storeAccount(root1, a, "a1");
+    cache.storeAccount(root1, b, "b1");
+    BOOST_CHECK(cache.account(root1, a, rlp) && rlp == "a1");
+    BOOST_CHECK(!cache.account(root2, a, rlp));
+
+    // root1 -> root2 changes b only: a is still valid, b must be reloaded
+    cache.noteCommit(root1, root2, dev::AddressHash{b});
+    BOOST_CHECK(cache.account(root2, a, rlp) && rlp == "a1");
+    BOOST_CHECK(!cache.account(root2, b, rlp));
+    cache.storeAccount(root2, b, "b2");
+
+    cache.noteCommit(root2, root3, dev::AddressHash{a});
+    BOOST_CHECK(!cache.account(root3, a, rlp));
+    BOOST_CHECK(cache.account(root3, b, rlp) && rlp == "b2");
+
+    // switching back to an older root, as on a reorg, still sees the old values
+    BOOST_CHECK(cache.account(root1, b, rlp) && rlp == "b1");
+    cache.noteCommit(root1, fork, dev::AddressHash{});
+    BOOST_CHECK(cache.account(fork, b, rlp) && rlp == "b1");
+}
+
+BOOST_AUTO_TEST_CASE(statecache_storage_bounded)
+{
+    StateCache cache;
+    const h256 root(7);
+    u256 value;
+
+    cache.storeStorage(root, 1, 100);
+    BOOST_CHECK(cache.storage(root, 1, value) && value == 100);
+    BOOST_CHECK(!cache.storage(h256(8), 1, value));
+
+    cache.setMaxSize(64 * 1024);
+    for (unsigned i = 0; i < 10000; i++)
+        cache.storeStorage(root, i, i);
+    BOOST_CHECK(cache.memoryUsage() <= 64 * 1024);
+    BOOST_CHECK(cache.storage(root, 9999, value) && value == 9999);
+    BOOST_CHECK(!cache.storage(root, 0, value));
+
+    cache.setMaxSize(0);
+    BOOST_CHECK_EQUAL(cache.size(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
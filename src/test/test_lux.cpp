@@ -4,8 +4,11 @@
 
 #define BOOST_TEST_MODULE Lux Test Suite
 
+#include "key.h"
 #include "main.h"
+#include "pubkey.h"
 #include "random.h"
+#include "script/sigcache.h"
 #include "txdb.h"
 #include "ui_interface.h"
 #include "util.h"
@@ -25,15 +28,18 @@ extern bool fPrintToConsole;
 extern void noui_connect();
 
 struct TestingSetup {
+    ECCVerifyHandle globalVerifyHandle;
     CCoinsViewDB *pcoinsdbview;
     boost::filesystem::path pathTemp;
     boost::thread_group threadGroup;
 
     TestingSetup() {
+        ECC_Start();
         SetupEnvironment();
         fPrintToDebugLog = false; // don't want to write to debug.log file
         fCheckBlockIndex = true;
         SelectParams(CBaseChainParams::UNITTEST);
+        InitSignatureCache();
         noui_connect();
 #ifdef ENABLE_WALLET
         bitdb.MakeMock();
@@ -72,6 +78,7 @@ struct TestingSetup {
         bitdb.Flush(true);
 #endif
         boost::filesystem::remove_all(pathTemp);
+        ECC_Stop();
     }
 };
 
@@ -90,17 +97,19 @@ struct TestMemPoolEntryHelper
     LockPoints lp;
     bool poolHasNoInputsOf;
     CAmount minGasPrice;
+    uint64_t gasLimit;
+    uint64_t maxGasLimit;
 
     TestMemPoolEntryHelper() :
             nFee(0), nTime(0), nHeight(1), priority(0.0), inChainInputValue(0),
-            spendsCoinbase(false), sigOpCost(4), poolHasNoInputsOf(false), minGasPrice(0) { }
+            spendsCoinbase(false), sigOpCost(4), poolHasNoInputsOf(false), minGasPrice(0), gasLimit(0), maxGasLimit(0) { }
 
     CTxMemPoolEntry FromTx(const CMutableTransaction& tx) {
         return FromTx(MakeTransactionRef(tx));
     }
     CTxMemPoolEntry FromTx(const CTransactionRef& tx) {
         return CTxMemPoolEntry(tx, nFee, nTime, priority, nHeight, inChainInputValue,
-                               spendsCoinbase, sigOpCost, lp, poolHasNoInputsOf, minGasPrice);
+                               spendsCoinbase, sigOpCost, lp, poolHasNoInputsOf, minGasPrice, gasLimit, maxGasLimit);
     }
 
     // Change the default value
@@ -113,6 +122,7 @@ struct TestMemPoolEntryHelper
     TestMemPoolEntryHelper &SigOpsCost(int64_t _sigopsCost) { sigOpCost = _sigopsCost; return *this; }
     TestMemPoolEntryHelper &PoolHasNoInputs(bool _poolHasNoInputsOf) { poolHasNoInputsOf = _poolHasNoInputsOf; return *this; }
     TestMemPoolEntryHelper &MinGasPrice(CAmount _minGasPrice) { minGasPrice = _minGasPrice; return *this; }
+    TestMemPoolEntryHelper &GasLimit(uint64_t _gasLimit, uint64_t _maxGasLimit) { gasLimit = _gasLimit; maxGasLimit = _maxGasLimit; return *this; }
 };
 
 BOOST_GLOBAL_FIXTURE(TestingSetup);
@@ -0,0 +1,118 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "clientversion.h"
+#include "streams.h"
+#include "tokenindex.h"
+#include "txdb.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(tokenindex_tests)
+
+static std::string SerializeKey(const CTokenHistoryKey& key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << key;
+    return ss.str();
+}
+
+BOOST_AUTO_TEST_CASE(tokenindex_key_layout)
+{
+    uint160 token(std::string("eb6a149ec16aaa7fc1e4d2f5f6d6e0e3e4aafbc7"));
+    uint160 holder(std::string("2d8ba8d0ca8f9a9a1f4f7f2a1fb2c1a2d8f6d3c1"));
+
+    // A holder key must be a prefix of its history keys, so history can be read with a seek
+    CDataStream ssHolder(SER_DISK, CLIENT_VERSION);
+    ssHolder << CTokenHolderKey(token, holder);
+    std::string history = SerializeKey(CTokenHistoryKey(token, holder, 1000, 2, 3, true));
+    BOOST_CHECK_EQUAL(history.size(), 53U);
+    BOOST_CHECK_EQUAL(history.substr(0, ssHolder.size()), ssHolder.str());
+
+    // Keys sort by height, then transaction, then log position
+    BOOST_CHECK(SerializeKey(CTokenHistoryKey(token, holder, 255, 9, 9, true)) < SerializeKey(CTokenHistoryKey(token, holder, 256, 0, 0, false)));
+    BOOST_CHECK(SerializeKey(CTokenHistoryKey(token, holder, 300, 1, 9, true)) < SerializeKey(CTokenHistoryKey(token, holder, 300, 2, 0, false)));
+    BOOST_CHECK(SerializeKey(CTokenHistoryKey(token, holder, 300, 2, 0, false)) < SerializeKey(CTokenHistoryKey(token, holder, 300, 2, 0, true)));
+
+    CTokenHistoryKey key;
+    CDataStream ss(history.data(), history.data() + history.size(), SER_DISK, CLIENT_VERSION);
+    ss >> key;
+    BOOST_CHECK(key.token == token && key.holder == holder);
+    BOOST_CHECK_EQUAL(key.blockHeight, 1000);
+    BOOST_CHECK_EQUAL(key.txIndex, 2U);
+    BOOST_CHECK_EQUAL(key.logIndex, 3U);
+    BOOST_CHECK_EQUAL(key.fIncoming, 1);
+}
+
+static CTokenTransfer MakeTransfer(const uint160& token, const uint160& from, const uint160& to, uint64_t amount, uint32_t txIndex)
+{
+    CTokenTransfer t;
+    t.token = token;
+    t.from = from;
+    t.to = to;
+    t.amount = u256Touint(dev::u256(amount));
+    t.txhash = uint256(txIndex + 1);
+    t.txIndex = txIndex;
+    return t;
+}
+
+static uint64_t Balance(CBlockTreeDB& db, const uint160& token, const uint160& holder)
+{
+    CTokenBalanceValue value;
+    BOOST_CHECK(db.ReadTokenBalance(token, holder, value));
+    return uintTou256(value.balance).convert_to<uint64_t>();
+}
+
+BOOST_AUTO_TEST_CASE(tokenindex_connect_undo)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 token(std::string("eb6a149ec16aaa7fc1e4d2f5f6d6e0e3e4aafbc7"));
+    uint160 minter, alice(1), bob(2);
+
+    std::vector<CTokenTransfer> block1, block2;
+    block1.push_back(MakeTransfer(token, minter, alice, 100, 0));
+    block2.push_back(MakeTransfer(token, alice, bob, 30, 0));
+    block2.push_back(MakeTransfer(token, bob, alice, 10, 1));
+
+    BOOST_CHECK(db.WriteTokenTransfers(1, block1));
+    BOOST_CHECK(db.WriteTokenTransfers(2, block2));
+    // connecting the same block again, as after an unclean shutdown, changes nothing
+    BOOST_CHECK(db.WriteTokenTransfers(2, block2));
+    BOOST_CHECK_EQUAL(Balance(db, token, alice), 80U);
+    BOOST_CHECK_EQUAL(Balance(db, token, bob), 20U);
+    CTokenBalanceValue value;
+    BOOST_CHECK(db.ReadTokenBalance(token, alice, value));
+    BOOST_CHECK_EQUAL(value.transfers, 3);
+    TokenHistoryVector history;
+    BOOST_CHECK(db.ReadTokenHistory(token, bob, history));
+    BOOST_CHECK_EQUAL(history.size(), 2U);
+
+    // undoing block 2 restores the balances of block 1, twice is harmless
+    BOOST_CHECK(db.EraseTokenTransfers(2));
+    BOOST_CHECK(db.EraseTokenTransfers(2));
+    BOOST_CHECK_EQUAL(Balance(db, token, alice), 100U);
+    BOOST_CHECK_EQUAL(Balance(db, token, bob), 0U);
+    BOOST_CHECK(db.ReadTokenBalance(token, bob, value));
+    BOOST_CHECK(value.IsNull());
+    history.clear();
+    BOOST_CHECK(db.ReadTokenHistory(token, bob, history));
+    BOOST_CHECK(history.empty());
+
+    // a block of another branch left at height 2 is replaced, not added to
+    BOOST_CHECK(db.WriteTokenTransfers(2, block2));
+    std::vector<CTokenTransfer> other(1, MakeTransfer(token, alice, bob, 5, 0));
+    BOOST_CHECK(db.WriteTokenTransfers(2, other));
+    BOOST_CHECK_EQUAL(Balance(db, token, alice), 95U);
+    BOOST_CHECK_EQUAL(Balance(db, token, bob), 5U);
+    history.clear();
+    BOOST_CHECK(db.ReadTokenHistory(token, bob, history));
+    BOOST_CHECK_EQUAL(history.size(), 1U);
+
+    BOOST_CHECK(db.EraseTokenTransfers(2));
+    BOOST_CHECK(db.EraseTokenTransfers(1));
+    BOOST_CHECK(db.ReadTokenBalance(token, alice, value));
+    BOOST_CHECK(value.IsNull());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
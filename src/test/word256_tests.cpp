@@ -0,0 +1,110 @@
+// Copyright (c) 2017-2018 The Luxcore developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "random.h"
+
+#include <libdevcore/CommonData.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Word256.h>
+
+#include <boost/test/unit_test.hpp>
+
+using dev::u256;
+using dev::Word256;
+
+BOOST_AUTO_TEST_SUITE(word256_tests)
+
+static uint64_t RandomLimb()
+{
+    // Bias towards the values where carries, borrows and normalization go wrong.
+    switch (insecure_rand() % 6) {
+    case 0: return 0;
+    case 1: return ~uint64_t(0);
+    case 2: return uint64_t(1) << (insecure_rand() % 64);
+    case 3: return insecure_rand() % 16;
+    default: return (uint64_t(insecure_rand()) << 32) | insecure_rand();
+    }
+}
+
+/** Random value whose high limbs are often zero, so small and mixed-width operands are covered too. */
+static u256 RandomU256()
+{
+    unsigned nLimbs = 1 + insecure_rand() % 4;
+    u256 v = 0;
+    for (unsigned i = 0; i < nLimbs; i++)
+        v = (v << 64) | RandomLimb();
+    return v;
+}
+
+static void CheckEqual(const Word256& w, const u256& expected)
+{
+    BOOST_CHECK_MESSAGE(w.toU256() == expected, "got " << w.toU256() << ", expected " << expected);
+}
+
+BOOST_AUTO_TEST_CASE(word256_conversion)
+{
+    seed_insecure_rand(true);
+    CheckEqual(Word256::zero(), 0);
+    CheckEqual(Word256::fromU256(~u256(0)), ~u256(0));
+    for (int i = 0; i < 10000; i++) {
+        u256 a = RandomU256();
+        Word256 w = Word256::fromU256(a);
+        CheckEqual(w, a);
+        BOOST_CHECK_EQUAL(w.isZero(), a == 0);
+
+        // big-endian memory layout must match the h256 conversions used before
+        dev::h256 h(a);
+        Word256 loaded = Word256::loadBigEndian(h.data());
+        CheckEqual(loaded, a);
+        dev::h256 stored;
+        w.storeBigEndian(stored.data());
+        BOOST_CHECK(stored == h);
+
+        // PUSHn reads the n low-order bytes
+        unsigned n = 1 + insecure_rand() % 32;
+        u256 expected = 0;
+        for (unsigned j = 32 - n; j < 32; j++)
+            expected = (expected << 8) | h[j];
+        CheckEqual(Word256::loadBigEndian(h.data() + 32 - n, n), expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(word256_arithmetic_differential)
+{
+    seed_insecure_rand(true);
+    for (int i = 0; i < 100000; i++) {
+        u256 a = RandomU256();
+        u256 b = RandomU256();
+        Word256 wa = Word256::fromU256(a);
+        Word256 wb = Word256::fromU256(b);
+
+        CheckEqual(wa + wb, a + b);
+        CheckEqual(wa - wb, a - b);
+        CheckEqual(wa * wb, a * b);
+        CheckEqual(wa / wb, b ? u256(a / b) : u256(0));
+        CheckEqual(wa % wb, b ? u256(a % b) : u256(0));
+        BOOST_CHECK_EQUAL(wa < wb, a < b);
+        BOOST_CHECK_EQUAL(wa == wb, a == b);
+        BOOST_CHECK_EQUAL(wa.bitLength(), a ? boost::multiprecision::msb(a) + 1 : 0);
+
+        unsigned shift = insecure_rand() % 260;
+        CheckEqual(wa << shift, shift < 256 ? u256(a << shift) : u256(0));
+        CheckEqual(wa >> shift, shift < 256 ? u256(a >> shift) : u256(0));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(word256_division_edges)
+{
+    const u256 max = ~u256(0);
+    CheckEqual(Word256::fromU256(max) / Word256::fromU256(1), max);
+    CheckEqual(Word256::fromU256(max) % Word256::fromU256(max), 0);
+    CheckEqual(Word256::fromU256(max) / Word256::fromU256(max - 1), 1);
+    CheckEqual(Word256::fromU256(max - 1) / Word256::fromU256(max), 0);
+    CheckEqual(Word256::fromU256(max) / Word256::fromU256(u256(1) << 64), max >> 64);
+    CheckEqual(Word256::fromU256(max) % Word256::fromU256((u256(1) << 64) + 1), max % ((u256(1) << 64) + 1));
+    CheckEqual(Word256::fromU256(12345) / Word256::zero(), 0);
+    CheckEqual(Word256::fromU256(12345) % Word256::zero(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
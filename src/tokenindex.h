@@ -0,0 +1,211 @@
+// Copyright (c) 2017-2018 The LUX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TOKENINDEX_H
+#define BITCOIN_TOKENINDEX_H
+
+#include "uint256.h"
+#include "spentindex.h"
+
+#include <vector>
+
+/** keccak256("Transfer(address,address,uint256)"), topic 0 of the LSR/ERC20 Transfer event */
+static const char TOKEN_TRANSFER_TOPIC[] = "ddf252ad1be2c89b69c2b068fc378daa952ba7f163c4a11628f55a4df523b3ef";
+
+/** A Transfer event emitted by a token contract in a connected block */
+struct CTokenTransfer {
+    uint160 token;
+    uint160 from;
+    uint160 to;
+    uint256 amount;  //!< big-endian 256-bit value, as in the event data
+    uint256 txhash;
+    int32_t blockHeight;
+    uint32_t txIndex;
+    uint32_t logIndex;  //!< index of the event among the logs of the transaction
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(token);
+        READWRITE(from);
+        READWRITE(to);
+        READWRITE(amount);
+        READWRITE(txhash);
+        READWRITE(blockHeight);
+        READWRITE(txIndex);
+        READWRITE(logIndex);
+    }
+
+    CTokenTransfer() {
+        SetNull();
+    }
+
+    void SetNull() {
+        token.SetNull();
+        from.SetNull();
+        to.SetNull();
+        amount.SetNull();
+        txhash.SetNull();
+        blockHeight = 0;
+        txIndex = 0;
+        logIndex = 0;
+    }
+};
+
+/** One transfer in the history of a holder of a token, ordered by block position */
+struct CTokenHistoryKey {
+    uint160 token;
+    uint160 holder;
+    int32_t blockHeight;
+    uint32_t txIndex;
+    uint32_t logIndex;
+    uint8_t fIncoming;  //!< a transfer to oneself has both entries
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 53;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        token.Serialize(s, nType, nVersion);
+        holder.Serialize(s, nType, nVersion);
+        // Heights and positions are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txIndex);
+        ser_writedata32be(s, logIndex);
+        ser_writedata8(s, fIncoming);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        token.Unserialize(s, nType, nVersion);
+        holder.Unserialize(s, nType, nVersion);
+        blockHeight = ser_readdata32be(s);
+        txIndex = ser_readdata32be(s);
+        logIndex = ser_readdata32be(s);
+        fIncoming = ser_readdata8(s);
+    }
+
+    CTokenHistoryKey(const uint160& tokenIn, const uint160& holderIn, int height, unsigned int txIndexIn,
+                     unsigned int logIndexIn, bool fIncomingIn) {
+        token = tokenIn;
+        holder = holderIn;
+        blockHeight = (int32_t) height;
+        txIndex = (uint32_t) txIndexIn;
+        logIndex = (uint32_t) logIndexIn;
+        fIncoming = fIncomingIn ? 1 : 0;
+    }
+
+    CTokenHistoryKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        token.SetNull();
+        holder.SetNull();
+        blockHeight = 0;
+        txIndex = 0;
+        logIndex = 0;
+        fIncoming = 0;
+    }
+};
+
+/** Serialize order should match the start of CTokenHistoryKey */
+struct CTokenHolderKey {
+    uint160 token;
+    uint160 holder;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 40;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        token.Serialize(s, nType, nVersion);
+        holder.Serialize(s, nType, nVersion);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        token.Unserialize(s, nType, nVersion);
+        holder.Unserialize(s, nType, nVersion);
+    }
+
+    CTokenHolderKey(const uint160& tokenIn, const uint160& holderIn) {
+        token = tokenIn;
+        holder = holderIn;
+    }
+
+    CTokenHolderKey() {
+        token.SetNull();
+        holder.SetNull();
+    }
+};
+
+struct CTokenHistoryValue {
+    uint160 counterparty;
+    uint256 amount;
+    uint256 txhash;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(counterparty);
+        READWRITE(amount);
+        READWRITE(txhash);
+    }
+
+    CTokenHistoryValue(const uint160& counterpartyIn, const uint256& amountIn, const uint256& txhashIn) {
+        counterparty = counterpartyIn;
+        amount = amountIn;
+        txhash = txhashIn;
+    }
+
+    CTokenHistoryValue() {
+        counterparty.SetNull();
+        amount.SetNull();
+        txhash.SetNull();
+    }
+};
+
+/**
+ * Running totals of the Transfer events of a holder. Amounts are big-endian 256-bit
+ * values summed modulo 2^256; the balance only matches the token's own bookkeeping if
+ * the token emits a Transfer for every change, including minting.
+ */
+struct CTokenBalanceValue {
+    uint256 balance;
+    uint256 received;
+    uint256 sent;
+    int64_t transfers;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(sent);
+        READWRITE(transfers);
+    }
+
+    CTokenBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance.SetNull();
+        received.SetNull();
+        sent.SetNull();
+        transfers = 0;
+    }
+
+    bool IsNull() const {
+        return (transfers == 0);
+    }
+};
+
+typedef std::vector<std::pair<CTokenHistoryKey, CTokenHistoryValue> > TokenHistoryVector;
+
+#endif // BITCOIN_TOKENINDEX_H
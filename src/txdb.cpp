@@ -22,6 +22,12 @@ static const char DB_BLOCK_INDEX = 'b';
 
 ////////////////////////////////////////// // lux
 static const char DB_HEIGHTINDEX = 'h';
+static const char DB_TOKENHISTORY = 'k';
+static const char DB_TOKENBALANCE = 'K';
+static const char DB_TOKENBLOCK = 'T';
+static const char DB_BLOCKFILTER = 'g';
+static const char DB_BLOCKFILTERHEADER = 'G';
+static const char DB_BLOCKFILTERBEST = 'q';
 //////////////////////////////////////////
 
 static const char DB_BEST_BLOCK = 'B';
@@ -30,6 +36,8 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_SPENTINDEX = 's';
+static const char DB_ADDRESSBALANCE = 'w';
+static const char DB_ADDRESSBALANCEUNDO = 'W';
 
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
@@ -426,6 +434,342 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addrHash, uint16_t addrType, Address
     return true;
 }
 
+// Addresses in DB key order, so that a shared iterator only ever seeks forward
+static bool AddressKeyOrder(const std::pair<uint160, uint16_t>& a, const std::pair<uint160, uint16_t>& b)
+{
+    if (a.second != b.second)
+        return a.second < b.second;
+    return memcmp(a.first.begin(), b.first.begin(), a.first.size()) < 0;
+}
+
+static AddressTypeVector SortAddresses(const AddressTypeVector &addresses)
+{
+    AddressTypeVector sorted(addresses);
+    std::sort(sorted.begin(), sorted.end(), AddressKeyOrder);
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    return sorted;
+}
+
+bool CBlockTreeDB::ReadAddressIndexBatch(const AddressTypeVector &addresses, AddressIndexVector &addressIndex,
+                                         int start, unsigned int startIndex, int end, size_t nLimit, bool &fMore)
+{
+    // a single iterator, and so a single consistent view of the index, serves all the addresses
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    fMore = false;
+    AddressTypeVector sorted = SortAddresses(addresses);
+    for (AddressTypeVector::const_iterator it = sorted.begin(); it != sorted.end(); it++) {
+        const uint160 &addrHash = it->first;
+        const uint16_t addrType = it->second;
+
+        CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+        ssKeySet << make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(addrType, addrHash, start));
+        pcursor->Seek(ssKeySet.str());
+
+        size_t nRead = 0;
+        CAddressIndexKey lastKey;
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CAddressIndexKey indexKey;
+            try {
+                ssKey >> chType;
+                ssKey >> indexKey;
+            } catch (const std::exception& e) {
+                // a record of another kind past the end of the index
+                break;
+            }
+            if (chType != DB_ADDRESSINDEX || indexKey.hashType != addrType || indexKey.hashBytes != addrHash)
+                break;
+            if (end > 0 && indexKey.blockHeight > end)
+                break;
+            if (indexKey.blockHeight == start && indexKey.blockIndex < startIndex) {
+                pcursor->Next();
+                continue;
+            }
+            // a full page still ends on a transaction boundary
+            if (nLimit > 0 && nRead >= nLimit &&
+                (indexKey.blockHeight != lastKey.blockHeight || indexKey.blockIndex != lastKey.blockIndex)) {
+                fMore = true;
+                break;
+            }
+            try {
+                leveldb::Slice slValue = pcursor->value();
+                CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+                CAmount nValue;
+                ssValue >> nValue;
+                addressIndex.push_back(make_pair(indexKey, nValue));
+            } catch (const std::exception& e) {
+                return error("failed to get address index page");
+            }
+            lastKey = indexKey;
+            nRead++;
+            pcursor->Next();
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndexBatch(const AddressTypeVector &addresses, AddressUnspentVector &unspentOutputs,
+                                                const CAddressUnspentKey *pcursorKey, size_t nLimit, CAddressUnspentKey *pnextKey)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    if (pnextKey)
+        pnextKey->SetNull();
+    AddressTypeVector sorted = SortAddresses(addresses);
+    for (AddressTypeVector::const_iterator it = sorted.begin(); it != sorted.end(); it++) {
+        const uint160 &addrHash = it->first;
+        const uint16_t addrType = it->second;
+
+        CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+        if (pcursorKey) {
+            // addresses before the cursor were done on previous pages
+            std::pair<uint160, uint16_t> cursorAddress(pcursorKey->hashBytes, pcursorKey->hashType);
+            if (AddressKeyOrder(*it, cursorAddress))
+                continue;
+            if (*it == cursorAddress)
+                ssKeySet << make_pair(DB_ADDRESSUNSPENTINDEX, *pcursorKey);
+        }
+        if (ssKeySet.empty())
+            ssKeySet << make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(addrType, addrHash));
+        pcursor->Seek(ssKeySet.str());
+
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CAddressUnspentKey indexKey;
+            try {
+                ssKey >> chType;
+                ssKey >> indexKey;
+            } catch (const std::exception& e) {
+                // a record of another kind past the end of the index
+                break;
+            }
+            if (chType != DB_ADDRESSUNSPENTINDEX || indexKey.hashType != addrType || indexKey.hashBytes != addrHash)
+                break;
+            if (nLimit > 0 && unspentOutputs.size() >= nLimit) {
+                if (pnextKey)
+                    *pnextKey = indexKey;
+                return true;
+            }
+            try {
+                leveldb::Slice slValue = pcursor->value();
+                CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+                CAddressUnspentValue nValue;
+                ssValue >> nValue;
+                unspentOutputs.push_back(make_pair(indexKey, nValue));
+            } catch (const std::exception& e) {
+                return error("failed to get address unspent value");
+            }
+            pcursor->Next();
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressBalance(uint160 addrHash, uint16_t addrType, CAddressBalanceValue &value)
+{
+    value.SetNull();
+    if (!Exists(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(addrType, addrHash))))
+        return true;
+    return Read(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(addrType, addrHash)), value);
+}
+
+static bool AddressIndexEntryCompare(const std::pair<CAddressIndexKey, CAmount>& a, const std::pair<CAddressIndexKey, CAmount>& b)
+{
+    return CAddressIndexKeyCompare()(a.first, b.first);
+}
+
+typedef std::map<std::pair<uint8_t, uint160>, CAddressBalanceValue> AddressBalanceMap;
+
+// the balance of an address as changed so far in this batch
+static CAddressBalanceValue& GetPendingBalance(CBlockTreeDB& db, AddressBalanceMap& balances, uint8_t addrType, const uint160& addrHash, bool& fError)
+{
+    std::pair<AddressBalanceMap::iterator, bool> ret = balances.insert(std::make_pair(std::make_pair(addrType, addrHash), CAddressBalanceValue()));
+    if (ret.second && !db.ReadAddressBalance(addrHash, addrType, ret.first->second))
+        fError = true;
+    return ret.first->second;
+}
+
+static void WriteBalances(CLevelDBBatch& batch, const AddressBalanceMap& balances)
+{
+    for (AddressBalanceMap::const_iterator it = balances.begin(); it != balances.end(); it++) {
+        std::pair<char, CAddressIndexIteratorKey> key(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(it->first.first, it->first.second));
+        if (it->second.IsNull())
+            batch.Erase(key);
+        else
+            batch.Write(key, it->second);
+    }
+}
+
+bool CBlockTreeDB::ReadAddressBalanceUndo(int nHeight, CAddressBalanceUndo& undo)
+{
+    undo.SetNull();
+    if (!Exists(std::make_pair(DB_ADDRESSBALANCEUNDO, nHeight)))
+        return false;
+    return Read(std::make_pair(DB_ADDRESSBALANCEUNDO, nHeight), undo);
+}
+
+bool CBlockTreeDB::ConnectAddressBalances(const AddressIndexVector &vect, int nHeight, const uint256& hashBlock)
+{
+    // The balances and the undo record of a block are written in one batch, so a block
+    // replayed after an unclean shutdown finds its record and is not counted twice.
+    CAddressBalanceUndo undoOld;
+    bool fUndoOld = ReadAddressBalanceUndo(nHeight, undoOld);
+    if (fUndoOld && undoOld.hashBlock == hashBlock)
+        return true;
+
+    bool fError = false;
+    AddressBalanceMap balances;
+    if (fUndoOld) {
+        // a block of another branch was counted at this height and never disconnected
+        LogPrintf("%s: undoing address balances of %s at height %d\n", __func__, undoOld.hashBlock.ToString(), nHeight);
+        for (const std::pair<CAddressIndexIteratorKey, CAddressBalanceValue>& entry : undoOld.vDeltas)
+            GetPendingBalance(*this, balances, entry.first.hashType, entry.first.hashBytes, fError) -= entry.second;
+    }
+
+    // the entries of a block, grouped by address in the order getaddressbalance used to sum them
+    AddressIndexVector sorted(vect);
+    std::stable_sort(sorted.begin(), sorted.end(), AddressIndexEntryCompare);
+
+    CAddressBalanceUndo undo;
+    undo.hashBlock = hashBlock;
+    AddressIndexVector::const_iterator it = sorted.begin();
+    while (it != sorted.end()) {
+        const CAddressIndexKey& first = it->first;
+        CAddressBalanceAccumulator delta;
+        for (; it != sorted.end() && it->first.hashType == first.hashType && it->first.hashBytes == first.hashBytes; it++) {
+            // a key pushed twice ends up as a single entry, the last one written
+            AddressIndexVector::const_iterator next = it + 1;
+            if (next != sorted.end() && !AddressIndexEntryCompare(*it, *next))
+                continue;
+            delta.Add(it->first, it->second);
+        }
+
+        GetPendingBalance(*this, balances, first.hashType, first.hashBytes, fError) += delta.value;
+        undo.vDeltas.push_back(std::make_pair(CAddressIndexIteratorKey(first.hashType, first.hashBytes), delta.value));
+    }
+    if (fError)
+        return error("%s: unable to read address balance", __func__);
+
+    CLevelDBBatch batch;
+    WriteBalances(batch, balances);
+    batch.Write(std::make_pair(DB_ADDRESSBALANCEUNDO, nHeight), undo);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::DisconnectAddressBalances(const AddressIndexVector &vect, int nHeight, const uint256& hashBlock)
+{
+    std::set<std::pair<uint8_t, uint160> > setAddresses;
+    for (AddressIndexVector::const_iterator it = vect.begin(); it != vect.end(); it++)
+        setAddresses.insert(std::make_pair(it->first.hashType, it->first.hashBytes));
+
+    // Subtract exactly what was added for the block. A record of another block means
+    // this one was not counted. Blocks counted before the records existed, by
+    // BuildAddressBalanceIndex, subtract the entries stored at their height, which
+    // are erased in the same batch so that a second disconnect finds none.
+    CAddressBalanceUndo undo;
+    bool fUndo = ReadAddressBalanceUndo(nHeight, undo);
+    bool fError = false;
+    AddressBalanceMap balances;
+    if (fUndo && undo.hashBlock == hashBlock) {
+        for (const std::pair<CAddressIndexIteratorKey, CAddressBalanceValue>& entry : undo.vDeltas)
+            GetPendingBalance(*this, balances, entry.first.hashType, entry.first.hashBytes, fError) -= entry.second;
+    }
+
+    CLevelDBBatch batch;
+    for (std::set<std::pair<uint8_t, uint160> >::const_iterator it = setAddresses.begin(); it != setAddresses.end(); it++) {
+        // erase what is stored for the block rather than what the disconnect recomputed,
+        // the spent flags of the stored entries may differ
+        AddressIndexVector entries;
+        if (!ReadAddressIndex(it->second, it->first, entries, nHeight, nHeight))
+            return error("%s: unable to read address index", __func__);
+
+        CAddressBalanceAccumulator delta;
+        for (AddressIndexVector::const_iterator e = entries.begin(); e != entries.end(); e++) {
+            if (e->first.blockHeight != nHeight)
+                continue;
+            delta.Add(e->first, e->second);
+            batch.Erase(std::make_pair(DB_ADDRESSINDEX, e->first));
+        }
+        if (!fUndo && delta.value.deltas > 0)
+            GetPendingBalance(*this, balances, it->first, it->second, fError) -= delta.value;
+    }
+    if (fError)
+        return error("%s: unable to read address balance", __func__);
+
+    WriteBalances(batch, balances);
+    if (fUndo && undo.hashBlock == hashBlock)
+        batch.Erase(std::make_pair(DB_ADDRESSBALANCEUNDO, nHeight));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::BuildAddressBalanceIndex()
+{
+    LogPrintf("%s: building address balances from the address index...\n", __func__);
+
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << DB_ADDRESSINDEX;
+    pcursor->Seek(ssKeySet.str());
+
+    CLevelDBBatch batch;
+    CAddressIndexKey lastKey;
+    CAddressBalanceAccumulator acc;
+    size_t nAddresses = 0;
+    while (true) {
+        boost::this_thread::interruption_point();
+        bool fEntry = false;
+        CAddressIndexKey indexKey;
+        CAmount nValue = 0;
+        if (pcursor->Valid()) {
+            try {
+                leveldb::Slice slKey = pcursor->key();
+                CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+                char chType;
+                ssKey >> chType;
+                if (chType == DB_ADDRESSINDEX) {
+                    ssKey >> indexKey;
+                    leveldb::Slice slValue = pcursor->value();
+                    CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+                    ssValue >> nValue;
+                    fEntry = true;
+                }
+            } catch (const std::exception& e) {
+                return error("%s: failed to read address index", __func__);
+            }
+        }
+
+        // flush the totals of the previous address
+        if (acc.value.deltas > 0 && (!fEntry || indexKey.hashType != lastKey.hashType || indexKey.hashBytes != lastKey.hashBytes)) {
+            batch.Write(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(lastKey.hashType, lastKey.hashBytes)), acc.value);
+            acc = CAddressBalanceAccumulator();
+            if (++nAddresses % 10000 == 0) {
+                if (!WriteBatch(batch))
+                    return false;
+                batch.Clear();
+                LogPrintf("%s: %u addresses\n", __func__, nAddresses);
+            }
+        }
+        if (!fEntry)
+            break;
+
+        acc.Add(indexKey, nValue);
+        lastKey = indexKey;
+        pcursor->Next();
+    }
+
+    LogPrintf("%s: done, %u addresses\n", __func__, nAddresses);
+    return WriteBatch(batch);
+}
+
 // Parse all addressindex entries matching a txid (slow, not using address keys)
 bool CBlockTreeDB::FindTxEntriesInAddressIndex(uint256 txid, AddressIndexVector &addressIndex)
 {
@@ -710,5 +1054,253 @@ bool CBlockTreeDB::WipeHeightIndex() {
     return WriteBatch(batch);
 }
 
-///////////////////////////////////////////////////////
+static void ApplyTokenTransfer(CTokenBalanceValue& value, const CTokenTransfer& transfer, bool fIncoming, bool fUndo)
+{
+    // amounts wrap modulo 2^256 like the EVM, so undoing always restores the previous value
+    dev::u256 amount = uintTou256(transfer.amount);
+    dev::u256 balance = uintTou256(value.balance);
+    if (fIncoming) {
+        dev::u256 received = uintTou256(value.received);
+        value.received = u256Touint(fUndo ? received - amount : received + amount);
+        value.balance = u256Touint(fUndo ? balance - amount : balance + amount);
+    } else {
+        dev::u256 sent = uintTou256(value.sent);
+        value.sent = u256Touint(fUndo ? sent - amount : sent + amount);
+        value.balance = u256Touint(fUndo ? balance + amount : balance - amount);
+    }
+    value.transfers += fUndo ? -1 : 1;
+}
+
+typedef std::map<std::pair<uint160, uint160>, CTokenBalanceValue> TokenBalanceMap;
+
+static bool ApplyTokenTransfers(CBlockTreeDB& db, TokenBalanceMap& balances, const std::vector<CTokenTransfer>& transfers, bool fUndo)
+{
+    for (const CTokenTransfer& t : transfers) {
+        for (const uint160& holder : {t.from, t.to}) {
+            std::pair<uint160, uint160> key(t.token, holder);
+            if (!balances.count(key) && !db.ReadTokenBalance(t.token, holder, balances[key]))
+                return error("%s: unable to read token balance", __func__);
+        }
+    }
+    if (fUndo) {
+        for (std::vector<CTokenTransfer>::const_reverse_iterator it = transfers.rbegin(); it != transfers.rend(); it++) {
+            ApplyTokenTransfer(balances[std::make_pair(it->token, it->to)], *it, true, true);
+            ApplyTokenTransfer(balances[std::make_pair(it->token, it->from)], *it, false, true);
+        }
+    } else {
+        for (const CTokenTransfer& t : transfers) {
+            ApplyTokenTransfer(balances[std::make_pair(t.token, t.from)], t, false, false);
+            ApplyTokenTransfer(balances[std::make_pair(t.token, t.to)], t, true, false);
+        }
+    }
+    return true;
+}
+
+static void WriteTokenBalances(CLevelDBBatch& batch, const TokenBalanceMap& balances)
+{
+    for (TokenBalanceMap::const_iterator it = balances.begin(); it != balances.end(); it++) {
+        CTokenHolderKey key(it->first.first, it->first.second);
+        if (it->second.IsNull())
+            batch.Erase(std::make_pair(DB_TOKENBALANCE, key));
+        else
+            batch.Write(std::make_pair(DB_TOKENBALANCE, key), it->second);
+    }
+}
+
+static void EraseTokenHistory(CLevelDBBatch& batch, int nHeight, const std::vector<CTokenTransfer>& transfers)
+{
+    for (const CTokenTransfer& t : transfers) {
+        batch.Erase(std::make_pair(DB_TOKENHISTORY, CTokenHistoryKey(t.token, t.from, nHeight, t.txIndex, t.logIndex, false)));
+        batch.Erase(std::make_pair(DB_TOKENHISTORY, CTokenHistoryKey(t.token, t.to, nHeight, t.txIndex, t.logIndex, true)));
+    }
+}
+
+static bool ReadTokenBlock(CBlockTreeDB& db, int nHeight, std::vector<CTokenTransfer>& transfers)
+{
+    transfers.clear();
+    if (!db.Exists(std::make_pair(DB_TOKENBLOCK, nHeight)))
+        return true;
+    if (!db.Read(std::make_pair(DB_TOKENBLOCK, nHeight), transfers))
+        return error("%s: unable to read the token transfers of block %d", __func__, nHeight);
+    return true;
+}
+
+static bool SameTokenTransfers(const std::vector<CTokenTransfer>& a, const std::vector<CTokenTransfer>& b)
+{
+    CDataStream ssA(SER_DISK, CLIENT_VERSION), ssB(SER_DISK, CLIENT_VERSION);
+    ssA << a;
+    ssB << b;
+    return ssA.str() == ssB.str();
+}
+
+bool CBlockTreeDB::WriteTokenTransfers(int nHeight, const std::vector<CTokenTransfer>& transfers)
+{
+    // A block replayed after an unclean shutdown is already applied, and a
+    // block of another branch left behind at this height is undone first,
+    // so the running balances never count a transfer twice.
+    std::vector<CTokenTransfer> stored;
+    if (!ReadTokenBlock(*this, nHeight, stored))
+        return false;
+    if (stored.empty() && transfers.empty())
+        return true;
+    if (SameTokenTransfers(stored, transfers))
+        return true;
+
+    CLevelDBBatch batch;
+    TokenBalanceMap balances;
+    EraseTokenHistory(batch, nHeight, stored);
+    if (!ApplyTokenTransfers(*this, balances, stored, true))
+        return false;
+    for (const CTokenTransfer& t : transfers) {
+        batch.Write(std::make_pair(DB_TOKENHISTORY, CTokenHistoryKey(t.token, t.from, nHeight, t.txIndex, t.logIndex, false)),
+                    CTokenHistoryValue(t.to, t.amount, t.txhash));
+        batch.Write(std::make_pair(DB_TOKENHISTORY, CTokenHistoryKey(t.token, t.to, nHeight, t.txIndex, t.logIndex, true)),
+                    CTokenHistoryValue(t.from, t.amount, t.txhash));
+    }
+    if (!ApplyTokenTransfers(*this, balances, transfers, false))
+        return false;
+    WriteTokenBalances(batch, balances);
+    // kept so that disconnecting the block needs neither the block nor its receipts
+    if (transfers.empty())
+        batch.Erase(std::make_pair(DB_TOKENBLOCK, nHeight));
+    else
+        batch.Write(std::make_pair(DB_TOKENBLOCK, nHeight), transfers);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseTokenTransfers(int nHeight)
+{
+    std::vector<CTokenTransfer> transfers;
+    if (!ReadTokenBlock(*this, nHeight, transfers))
+        return false;
+    if (transfers.empty())
+        return true;
+
+    CLevelDBBatch batch;
+    TokenBalanceMap balances;
+    EraseTokenHistory(batch, nHeight, transfers);
+    if (!ApplyTokenTransfers(*this, balances, transfers, true))
+        return false;
+    WriteTokenBalances(batch, balances);
+    batch.Erase(std::make_pair(DB_TOKENBLOCK, nHeight));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadTokenBalance(const uint160& token, const uint160& holder, CTokenBalanceValue& value)
+{
+    value.SetNull();
+    if (!Exists(std::make_pair(DB_TOKENBALANCE, CTokenHolderKey(token, holder))))
+        return true;
+    return Read(std::make_pair(DB_TOKENBALANCE, CTokenHolderKey(token, holder)), value);
+}
+
+bool CBlockTreeDB::ReadTokenHistory(const uint160& token, const uint160& holder, TokenHistoryVector& history,
+                                    int start, int end, size_t nLimit)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
 
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << std::make_pair(DB_TOKENHISTORY, CTokenHistoryKey(token, holder, std::max(start, 0), 0, 0, false));
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        if (nLimit && history.size() >= nLimit)
+            break;
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CTokenHistoryKey key;
+            ssKey >> chType;
+            ssKey >> key;
+            if (chType != DB_TOKENHISTORY || key.token != token || key.holder != holder)
+                break;
+            if (end > 0 && key.blockHeight > end)
+                break;
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CTokenHistoryValue value;
+            ssValue >> value;
+            history.push_back(std::make_pair(key, value));
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            return error("%s: failed to read token history", __func__);
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::WipeTokenIndex()
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+    CLevelDBBatch batch;
+
+    for (char chPrefix : {DB_TOKENHISTORY, DB_TOKENBALANCE, DB_TOKENBLOCK}) {
+        CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+        ssKeySet << chPrefix;
+        pcursor->Seek(ssKeySet.str());
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            ssKey >> chType;
+            if (chType != chPrefix)
+                break;
+            if (chType == DB_TOKENHISTORY) {
+                CTokenHistoryKey key;
+                ssKey >> key;
+                batch.Erase(std::make_pair(DB_TOKENHISTORY, key));
+            } else if (chType == DB_TOKENBALANCE) {
+                CTokenHolderKey key;
+                ssKey >> key;
+                batch.Erase(std::make_pair(DB_TOKENBALANCE, key));
+            } else {
+                int nHeight;
+                ssKey >> nHeight;
+                batch.Erase(std::make_pair(DB_TOKENBLOCK, nHeight));
+            }
+            pcursor->Next();
+        }
+    }
+
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::WriteBlockFilter(const BlockFilter& filter, const uint256& header, bool fBest)
+{
+    CLevelDBBatch batch;
+    batch.Write(std::make_pair(DB_BLOCKFILTER, filter.GetBlockHash()), filter);
+    batch.Write(std::make_pair(DB_BLOCKFILTERHEADER, filter.GetBlockHash()), std::make_pair(filter.GetHash(), header));
+    if (fBest)
+        batch.Write(DB_BLOCKFILTERBEST, filter.GetBlockHash());
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadBlockFilter(const uint256& hashBlock, BlockFilter& filter)
+{
+    return Read(std::make_pair(DB_BLOCKFILTER, hashBlock), filter);
+}
+
+bool CBlockTreeDB::ReadBlockFilterHeader(const uint256& hashBlock, uint256& filterHash, uint256& header)
+{
+    std::pair<uint256, uint256> value;
+    if (!Read(std::make_pair(DB_BLOCKFILTERHEADER, hashBlock), value))
+        return false;
+    filterHash = value.first;
+    header = value.second;
+    return true;
+}
+
+bool CBlockTreeDB::WriteBlockFilterBest(const uint256& hashBlock)
+{
+    return Write(DB_BLOCKFILTERBEST, hashBlock);
+}
+
+bool CBlockTreeDB::ReadBlockFilterBest(uint256& hashBlock)
+{
+    return Read(DB_BLOCKFILTERBEST, hashBlock);
+}
+
+///////////////////////////////////////////////////////
@@ -10,6 +10,8 @@
 #include "leveldbwrapper.h"
 #include "main.h"
 #include "addressindex.h"
+#include "blockfilter.h"
+#include "tokenindex.h"
 
 #include <map>
 #include <string>
@@ -87,6 +89,26 @@ public:
     bool EraseAddressIndex(const AddressIndexVector &vect);
     bool FindTxEntriesInAddressIndex(uint256 txid, AddressIndexVector &addressIndex);
     bool ReadAddressIndex(uint160 addrHash, uint16_t addrType, AddressIndexVector &addressIndex, int start = 0, int end = 0);
+    /**
+     * Read the entries of several addresses through one iterator, from (start, startIndex) on.
+     * With nLimit set, about nLimit entries are read per address, always up to a transaction
+     * boundary, and fMore tells whether any address has more.
+     */
+    bool ReadAddressIndexBatch(const AddressTypeVector &addresses, AddressIndexVector &addressIndex,
+                               int start, unsigned int startIndex, int end, size_t nLimit, bool &fMore);
+    /**
+     * Read the unspent outputs of several addresses through one iterator, in key order from
+     * pcursorKey on. With nLimit set, pnextKey is set to the first output not read, or null.
+     */
+    bool ReadAddressUnspentIndexBatch(const AddressTypeVector &addresses, AddressUnspentVector &unspentOutputs,
+                                      const CAddressUnspentKey *pcursorKey, size_t nLimit, CAddressUnspentKey *pnextKey);
+    bool ReadAddressBalance(uint160 addrHash, uint16_t addrType, CAddressBalanceValue &value);
+    bool ReadAddressBalanceUndo(int nHeight, CAddressBalanceUndo& undo);
+    /** Add the entries of block hashBlock to the balances, unless its undo record shows they already are */
+    bool ConnectAddressBalances(const AddressIndexVector &vect, int nHeight, const uint256& hashBlock);
+    /** Undo the balances of block hashBlock and erase the entries of the addresses in vect stored at nHeight */
+    bool DisconnectAddressBalances(const AddressIndexVector &vect, int nHeight, const uint256& hashBlock);
+    bool BuildAddressBalanceIndex();
     bool WriteFlag(const std::string& name, bool fValue);
     bool ReadFlag(const std::string& name, bool& fValue);
     bool LoadBlockIndexGuts();
@@ -111,6 +133,28 @@ public:
     bool EraseHeightIndex(const unsigned int &height);
     bool WipeHeightIndex();
 
+    /** Store the Transfer events of the block at nHeight and add them to the holders' balances */
+    bool WriteTokenTransfers(int nHeight, const std::vector<CTokenTransfer>& transfers);
+    /** Undo what WriteTokenTransfers stored for the block at nHeight */
+    bool EraseTokenTransfers(int nHeight);
+    bool ReadTokenBalance(const uint160& token, const uint160& holder, CTokenBalanceValue& value);
+    /** Transfers of holder in token between the heights start and end (ignored if <= 0), at most nLimit if set */
+    bool ReadTokenHistory(const uint160& token, const uint160& holder, TokenHistoryVector& history,
+                          int start = 0, int end = 0, size_t nLimit = 0);
+    bool WipeTokenIndex();
+
+    /**
+     * Store a filter and its header; fBest also marks its block as the end of the complete part of the index.
+     * Both only depend on the block and its ancestors, so they are kept when the block is disconnected.
+     */
+    bool WriteBlockFilter(const BlockFilter& filter, const uint256& header, bool fBest);
+    bool ReadBlockFilter(const uint256& hashBlock, BlockFilter& filter);
+    /** Hash and header of the filter of a block, without reading the filter itself */
+    bool ReadBlockFilterHeader(const uint256& hashBlock, uint256& filterHash, uint256& header);
+    /** Last block up to which the filters of the chain are known to be complete */
+    bool WriteBlockFilterBest(const uint256& hashBlock);
+    bool ReadBlockFilterBest(uint256& hashBlock);
+
     //////////////////////////////////////////////////////////////////////////////
 };
 
@@ -21,11 +21,12 @@
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, double _entryPriority, unsigned int _entryHeight,
                     CAmount _inChainInputValue, bool _spendsCoinbase,
-                    int64_t _sigOpsCost, LockPoints lp, bool poolHasNoInputsOf, CAmount _nMinGasPrice):
+                    int64_t _sigOpsCost, LockPoints lp, bool poolHasNoInputsOf, CAmount _nMinGasPrice,
+                    uint64_t _nGasLimit, uint64_t _nMaxGasLimit):
     tx(_tx), nFee(_nFee), nTime(_nTime), entryPriority(_entryPriority), entryHeight(_entryHeight),
     inChainInputValue(_inChainInputValue),
     spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp),
-    nMinGasPrice(_nMinGasPrice), hadNoDependencies(poolHasNoInputsOf)
+    nMinGasPrice(_nMinGasPrice), nGasLimit(_nGasLimit), nMaxGasLimit(_nMaxGasLimit), hadNoDependencies(poolHasNoInputsOf)
 {
     nTxWeight = GetTransactionCost(*tx);
     nModSize = tx->CalculateModifiedSize(GetTxSize());
@@ -999,8 +1000,8 @@ bool CCoinsViewMemPool::HaveCoin(const COutPoint &outpoint) const {
 
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    // Estimate the overhead of mapTx to be 18 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 18 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
@@ -99,6 +99,8 @@ private:
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
     CAmount nMinGasPrice;      //!< The minimum gas price among the contract outputs of the tx
+    uint64_t nGasLimit;        //!< Sum of the gas limits of the contract outputs, zero for non-contract txs
+    uint64_t nMaxGasLimit;     //!< ... and the largest gas limit of a single contract output
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
@@ -120,7 +122,8 @@ public:
     CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, double _entryPriority, unsigned int _entryHeight,
                     CAmount _inChainInputValue, bool spendsCoinbase,
-                    int64_t nSigOpsCost, LockPoints lp, bool poolHasNoInputsOf, CAmount _nMinGasPrice = 0);
+                    int64_t nSigOpsCost, LockPoints lp, bool poolHasNoInputsOf, CAmount _nMinGasPrice = 0,
+                    uint64_t _nGasLimit = 0, uint64_t _nMaxGasLimit = 0);
     CTxMemPoolEntry(const CTxMemPoolEntry& other);
     CTxMemPoolEntry();
 
@@ -142,6 +145,8 @@ public:
     const LockPoints& GetLockPoints() const { return lockPoints; }
     bool WasClearAtEntry() const { return hadNoDependencies; }
     const CAmount& GetMinGasPrice() const { return nMinGasPrice; }
+    uint64_t GetGasLimit() const { return nGasLimit; }
+    uint64_t GetMaxGasLimit() const { return nMaxGasLimit; }
 
     // Adjusts the descendant state, if this entry is not dirty.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
@@ -362,12 +367,36 @@ public:
     }
 };
 
+/** Sort contract transactions by their minimum gas price, highest first, and
+ *  then by gas limit, smallest first. Non-contract transactions go last.
+ */
+class CompareTxMemPoolEntryByGasPrice
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        bool fAIsContract = a.GetGasLimit() != 0;
+        bool fBIsContract = b.GetGasLimit() != 0;
+        if(fAIsContract != fBIsContract) {
+            return fAIsContract;
+        }
+        if(a.GetMinGasPrice() != b.GetMinGasPrice()) {
+            return a.GetMinGasPrice() > b.GetMinGasPrice();
+        }
+        if(a.GetGasLimit() != b.GetGasLimit()) {
+            return a.GetGasLimit() < b.GetGasLimit();
+        }
+        return a.GetTx().GetHash() < b.GetTx().GetHash();
+    }
+};
+
 // Multi_index tag names
 struct descendant_score {};
 struct entry_time {};
 struct mining_score {};
 struct ancestor_score {};
 struct ancestor_score_or_gas_price {};
+struct gas_price {};
 
 class CBlockPolicyEstimator;
 
@@ -550,7 +579,13 @@ public:
                 boost::multi_index::tag<ancestor_score_or_gas_price>,
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByAncestorFeeOrGasPrice
-             >
+             >,
+            // sorted by gas price for contract txs
+            boost::multi_index::ordered_unique<
+                boost::multi_index::tag<gas_price>,
+                boost::multi_index::identity<CTxMemPoolEntry>,
+                CompareTxMemPoolEntryByGasPrice
+            >
         >
     > indexed_transaction_set;
 
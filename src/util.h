@@ -205,14 +205,7 @@ bool GetBoolArg(const std::string& strArg, bool fDefault);
 /**
  * Set an argument if it doesn't already have a value
  *
- CBlock block;
-    CBlockIndex* pblockindex =chainActive[nHeight];
-    std::string strHash =  pblockindex->GetBlockHash().GetHex();
-    uint256 hash(strHash);
-    CBlockIndex* pblockindex2 = mapBlockIndex[hash];
-    //  a.push_back();
-    return pblockindex2;
-} to set (e.g. "-foo")
+ * @param strArg Argument to set (e.g. "-foo")
  * @param strValue Value (e.g. "1")
  * @return true if argument gets set, false if it already had a value
  */
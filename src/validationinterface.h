@@ -10,6 +10,8 @@
 #include <boost/signals2/signal.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <vector>
+
 class CBlock;
 
 struct CBlockLocator;
@@ -26,6 +28,8 @@ class CValidationState;
 
 class uint256;
 
+struct TransactionReceiptInfo;
+
 // These functions dispatch to one or all registered wallets
 
 /** Register a wallet to receive updates from core */
@@ -44,6 +48,8 @@ class CValidationInterface {
 protected:
     virtual void UpdatedBlockTip(const CBlockIndex *pindex) {}
 
+    virtual void BlockConnected(const CBlock &block, const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts) {}
+
     virtual void SyncTransaction(const CTransaction &tx, const CBlock *pblock) {}
 
     virtual void NotifyTransactionLock(const CTransaction &tx) {}
@@ -71,6 +77,8 @@ protected:
 struct CMainSignals {
     /** Notifies listeners of updated block chain tip */
     boost::signals2::signal<void(const CBlockIndex *)> UpdatedBlockTip;
+    /** Notifies listeners of a block connected to the active chain, with the receipts of its contract executions (if -logevents) */
+    boost::signals2::signal<void(const CBlock &, const CBlockIndex *, const std::vector<TransactionReceiptInfo> &)> BlockConnected;
     /** Notifies listeners of updated transaction data (transaction, and optionally the block it is found in. */
     boost::signals2::signal<void(const CTransaction &, const CBlock *)> SyncTransaction;
     /** Notifies listeners of an updated transaction lock without new data. */
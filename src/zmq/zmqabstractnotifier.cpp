@@ -14,10 +14,18 @@ bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/) {
     return true;
 }
 
+bool CZMQAbstractNotifier::NotifyBlockConnected(const CBlock &/*block*/, const CBlockIndex * /*pindex*/, const std::vector<TransactionReceiptInfo> &/*receipts*/) {
+    return true;
+}
+
 bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/) {
     return true;
 }
 
 bool CZMQAbstractNotifier::NotifyTransactionLock(const CTransaction &/*transaction*/) {
     return true;
-}
\ No newline at end of file
+}
+
+bool CZMQAbstractNotifier::NotifyTransactionRemoved(const CTransaction &/*transaction*/, MemPoolRemovalReason /*reason*/) {
+    return true;
+}
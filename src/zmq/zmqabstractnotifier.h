@@ -7,8 +7,12 @@
 
 #include "zmqconfig.h"
 
+#include <vector>
+
 class CBlockIndex;
 class CZMQAbstractNotifier;
+struct TransactionReceiptInfo;
+enum class MemPoolRemovalReason;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
@@ -33,8 +37,10 @@ public:
     virtual void Shutdown() = 0;
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
+    virtual bool NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts);
     virtual bool NotifyTransaction(const CTransaction &transaction);
     virtual bool NotifyTransactionLock(const CTransaction &transaction);
+    virtual bool NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason);
 
 protected:
     void *psocket;
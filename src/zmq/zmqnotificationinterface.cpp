@@ -8,8 +8,11 @@
 #include "version.h"
 #include "main.h"
 #include "streams.h"
+#include "txmempool.h"
 #include "util.h"
 
+#include <boost/bind.hpp>
+
 void zmqError(const char *str)
 {
     LogPrint("zmq", "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
@@ -41,6 +44,9 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
     factories["pubrawtxlock"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionLockNotifier>;
+    factories["pubrawreceipts"] = CZMQAbstractNotifier::Create<CZMQPublishRawReceiptsNotifier>;
+    factories["publogs"] = CZMQAbstractNotifier::Create<CZMQPublishLogsNotifier>;
+    factories["pubmempoolremove"] = CZMQAbstractNotifier::Create<CZMQPublishMempoolRemoveNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -105,6 +111,8 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    mempool.NotifyEntryRemoved.connect(boost::bind(&CZMQNotificationInterface::TransactionRemovedFromMempool, this, _1, _2));
+
     return true;
 }
 
@@ -114,6 +122,7 @@ void CZMQNotificationInterface::Shutdown()
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
     if (pcontext)
     {
+        mempool.NotifyEntryRemoved.disconnect(boost::bind(&CZMQNotificationInterface::TransactionRemovedFromMempool, this, _1, _2));
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
@@ -126,12 +135,13 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+template <typename Function>
+void CZMQNotificationInterface::TryForEachAndRemoveFailed(const Function& func)
 {
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindex))
+        if (func(notifier))
         {
             i++;
         }
@@ -143,36 +153,37 @@ void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
     }
 }
 
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    TryForEachAndRemoveFailed([pindex](CZMQAbstractNotifier *notifier) {
+        return notifier->NotifyBlock(pindex);
+    });
+}
+
+void CZMQNotificationInterface::BlockConnected(const CBlock &block, const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts)
+{
+    TryForEachAndRemoveFailed([&block, pindex, &receipts](CZMQAbstractNotifier *notifier) {
+        return notifier->NotifyBlockConnected(block, pindex, receipts);
+    });
+}
+
 void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
 {
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
-    }
+    TryForEachAndRemoveFailed([&tx](CZMQAbstractNotifier *notifier) {
+        return notifier->NotifyTransaction(tx);
+    });
 }
 
 void CZMQNotificationInterface::NotifyTransactionLock(const CTransaction &tx)
 {
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransactionLock(tx))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
-    }
+    TryForEachAndRemoveFailed([&tx](CZMQAbstractNotifier *notifier) {
+        return notifier->NotifyTransactionLock(tx);
+    });
+}
+
+void CZMQNotificationInterface::TransactionRemovedFromMempool(CTransactionRef ptx, MemPoolRemovalReason reason)
+{
+    TryForEachAndRemoveFailed([&ptx, reason](CZMQAbstractNotifier *notifier) {
+        return notifier->NotifyTransactionRemoved(*ptx, reason);
+    });
 }
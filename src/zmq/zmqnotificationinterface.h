@@ -6,11 +6,14 @@
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
 #include "validationinterface.h"
+#include "primitives/transaction.h"
+#include <list>
 #include <string>
 #include <map>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
+enum class MemPoolRemovalReason;
 
 class CZMQNotificationInterface : public CValidationInterface
 {
@@ -26,11 +29,19 @@ protected:
     // CValidationInterface
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    void BlockConnected(const CBlock &block, const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts);
     void NotifyTransactionLock(const CTransaction &tx);
 
+    // CTxMemPool::NotifyEntryRemoved
+    void TransactionRemovedFromMempool(CTransactionRef ptx, MemPoolRemovalReason reason);
+
 private:
     CZMQNotificationInterface();
 
+    /** Call func on every notifier, shutting down and dropping those for which it fails */
+    template <typename Function>
+    void TryForEachAndRemoveFailed(const Function& func);
+
     void *pcontext;
     std::list<CZMQAbstractNotifier*> notifiers;
 };
@@ -16,6 +16,25 @@ static const char *MSG_HASHTXLOCK = "hashtxlock";
 static const char *MSG_RAWBLOCK   = "rawblock";
 static const char *MSG_RAWTX      = "rawtx";
 static const char *MSG_RAWTXLOCK = "rawtxlock";
+static const char *MSG_RAWRECEIPTS = "rawreceipts";
+static const char *MSG_LOGS       = "logs";
+static const char *MSG_MEMPOOLREMOVE = "mempoolremove";
+
+// EVM addresses and topics are sent as their raw bytes, in EVM order
+template <unsigned N>
+static void WriteFixedHash(CDataStream &ss, const dev::FixedHash<N> &hash)
+{
+    ss.write((const char*)hash.data(), N);
+}
+
+static void SerializeLog(CDataStream &ss, const dev::eth::LogEntry &log)
+{
+    WriteFixedHash(ss, log.address);
+    WriteCompactSize(ss, log.topics.size());
+    for (const dev::h256 &topic : log.topics)
+        WriteFixedHash(ss, topic);
+    ss << log.data;
+}
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -173,23 +192,12 @@ bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransa
     return SendMessage(MSG_HASHTXLOCK, data, 32);
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishRawBlockNotifier::NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
-    }
-
+    ss << block;
     return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
 }
 
@@ -210,3 +218,63 @@ bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransac
     ss << transaction;
     return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishRawReceiptsNotifier::NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts)
+{
+    if (receipts.empty())
+        return true;
+    LogPrint("zmq", "zmq: Publish rawreceipts %s\n", pindex->GetBlockHash().GetHex());
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << pindex->GetBlockHash() << (uint32_t)pindex->nHeight;
+    WriteCompactSize(ss, receipts.size());
+    for (const TransactionReceiptInfo &receipt : receipts)
+    {
+        ss << receipt.transactionHash << receipt.transactionIndex;
+        WriteFixedHash(ss, receipt.from);
+        WriteFixedHash(ss, receipt.to);
+        ss << receipt.cumulativeGasUsed << receipt.gasUsed;
+        WriteFixedHash(ss, receipt.contractAddress);
+        ss << (uint32_t)receipt.excepted;
+        WriteCompactSize(ss, receipt.logs.size());
+        for (const dev::eth::LogEntry &log : receipt.logs)
+            SerializeLog(ss, log);
+    }
+    return SendMessage(MSG_RAWRECEIPTS, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishLogsNotifier::NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts)
+{
+    uint256 hashBlock = pindex->GetBlockHash();
+    uint256 hashTx;
+    uint32_t nLogIndex = 0;
+    for (const TransactionReceiptInfo &receipt : receipts)
+    {
+        // Logs are numbered within their transaction, over all its executions
+        if (receipt.transactionHash != hashTx)
+        {
+            hashTx = receipt.transactionHash;
+            nLogIndex = 0;
+        }
+        for (const dev::eth::LogEntry &log : receipt.logs)
+        {
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << hashBlock << (uint32_t)pindex->nHeight << receipt.transactionHash << receipt.transactionIndex << nLogIndex++;
+            SerializeLog(ss, log);
+            if (!SendMessage(MSG_LOGS, &(*ss.begin()), ss.size()))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool CZMQPublishMempoolRemoveNotifier::NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason)
+{
+    uint256 hash = transaction.GetHash();
+    LogPrint("zmq", "zmq: Publish mempoolremove %s\n", hash.GetHex());
+    char data[33];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    data[32] = (char)reason;
+    return SendMessage(MSG_MEMPOOLREMOVE, data, 33);
+}
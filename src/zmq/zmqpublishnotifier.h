@@ -15,6 +15,7 @@ private:
     uint32_t nSequence; // upcounting per message sequence number
 
 public:
+    CZMQAbstractPublishNotifier() : nSequence(0U) { }
 
     /* send zmq multipart message
        parts:
@@ -49,7 +50,7 @@ public:
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts);
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -64,4 +65,22 @@ public:
     bool NotifyTransactionLock(const CTransaction &transaction);
 };
 
+class CZMQPublishRawReceiptsNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts);
+};
+
+class CZMQPublishLogsNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts);
+};
+
+class CZMQPublishMempoolRemoveNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H